@@ -18,6 +18,9 @@ type PrefilterSpec struct {
 	// deny
 	Deny []string `json:"deny"`
 
+	// Replace all CIDR ranges with the deny list atomically
+	Replace bool `json:"replace,omitempty"`
+
 	// revision
 	Revision int64 `json:"revision,omitempty"`
 }
@@ -2335,6 +2335,10 @@ func init() {
             "type": "string"
           }
         },
+        "replace": {
+          "description": "Replace all CIDR ranges with the deny list atomically",
+          "type": "boolean"
+        },
         "revision": {
           "type": "integer"
         }
@@ -5157,6 +5161,10 @@ func init() {
             "type": "string"
           }
         },
+        "replace": {
+          "description": "Replace all CIDR ranges with the deny list atomically",
+          "type": "boolean"
+        },
         "revision": {
           "type": "integer"
         }
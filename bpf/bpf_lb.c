@@ -62,6 +62,7 @@ static inline int handle_ipv6(struct __sk_buff *skb)
 	struct csum_offset csum_off = {};
 	int l3_off, l4_off, ret, hdrlen;
 	union v6addr new_dst;
+	struct ipv6_frag_info frag;
 	__u8 nexthdr;
 	__u16 slave;
 
@@ -73,7 +74,7 @@ static inline int handle_ipv6(struct __sk_buff *skb)
 	nexthdr = ip6->nexthdr;
 	ipv6_addr_copy(&key.address, (union v6addr *) &ip6->daddr);
 	l3_off = ETH_HLEN;
-	hdrlen = ipv6_hdrlen(skb, ETH_HLEN, &nexthdr);
+	hdrlen = ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag);
 	if (hdrlen < 0)
 		return hdrlen;
 
@@ -81,7 +82,8 @@ static inline int handle_ipv6(struct __sk_buff *skb)
 	csum_l4_offset_and_flags(nexthdr, &csum_off);
 
 #ifdef LB_L4
-	ret = extract_l4_port(skb, nexthdr, l4_off, &key.dport);
+	ret = ipv6_extract_l4_port(skb, nexthdr, l4_off, &frag, &key.dport,
+				   true);
 	if (IS_ERR(ret)) {
 		if (ret == DROP_UNKNOWN_L4) {
 			/* Pass unknown L4 to stack */
@@ -105,7 +107,8 @@ static inline int handle_ipv6(struct __sk_buff *skb)
 	if (svc->rev_nat_index)
 		new_dst.p4 |= svc->rev_nat_index;
 
-	ret = lb6_xlate(skb, &new_dst, nexthdr, l3_off, l4_off, &csum_off, &key, svc);
+	ret = lb6_xlate(skb, &new_dst, nexthdr, l3_off, l4_off, &csum_off, &key, svc,
+			frag.has_l4_header);
 	if (IS_ERR(ret))
 		return ret;
 
@@ -123,6 +126,7 @@ static inline int handle_ipv4(struct __sk_buff *skb)
 	struct iphdr *ip;
 	struct csum_offset csum_off = {};
 	int l3_off, l4_off, ret;
+	bool has_l4_header;
 	__be32 new_dst;
 	__u8 nexthdr;
 	__u16 slave;
@@ -136,10 +140,11 @@ static inline int handle_ipv4(struct __sk_buff *skb)
 	key.address = ip->daddr;
 	l3_off = ETH_HLEN;
 	l4_off = ETH_HLEN + ipv4_hdrlen(ip);
+	has_l4_header = ipv4_has_l4_header(ip);
 	csum_l4_offset_and_flags(nexthdr, &csum_off);
 
 #ifdef LB_L4
-	ret = extract_l4_port(skb, nexthdr, l4_off, &key.dport);
+	ret = ipv4_extract_l4_port(skb, nexthdr, l4_off, &key.dport, true);
 	if (IS_ERR(ret)) {
 		if (ret == DROP_UNKNOWN_L4) {
 			/* Pass unknown L4 to stack */
@@ -160,7 +165,8 @@ static inline int handle_ipv4(struct __sk_buff *skb)
 		return DROP_NO_SERVICE;
 
 	new_dst = svc->target;
-	ret = lb4_xlate(skb, &new_dst, NULL, NULL, nexthdr, l3_off, l4_off, &csum_off, &key, svc);
+	ret = lb4_xlate(skb, &new_dst, NULL, NULL, nexthdr, l3_off, l4_off,
+			&csum_off, &key, svc, has_l4_header);
 	if (IS_ERR(ret))
 		return ret;
 
@@ -49,6 +49,7 @@
 #include "lib/csum.h"
 #include "lib/conntrack.h"
 #include "lib/encap.h"
+#include "lib/latency.h"
 
 #ifdef HAVE_LRU_MAP_TYPE
 #define CT_MAP_TYPE BPF_MAP_TYPE_LRU_HASH
@@ -138,6 +139,7 @@ static inline int ipv6_l3_from_lxc(struct __sk_buff *skb,
 	union macaddr router_mac = NODE_MAC;
 	int ret, verdict, l4_off, forwarding_reason, hdrlen;
 	struct csum_offset csum_off = {};
+	struct ipv6_frag_info frag;
 	struct endpoint_info *ep;
 	struct lb6_service *svc;
 	struct lb6_key key = {};
@@ -147,6 +149,7 @@ static inline int ipv6_l3_from_lxc(struct __sk_buff *skb,
 	union v6addr *daddr, orig_dip;
 	__u32 tunnel_endpoint = 0;
 	__u32 monitor = 0;
+	__u64 lat;
 
 	if (unlikely(!is_valid_lxc_src_ip(ip6)))
 		return DROP_INVALID_SIP;
@@ -154,13 +157,14 @@ static inline int ipv6_l3_from_lxc(struct __sk_buff *skb,
 	ipv6_addr_copy(&tuple->daddr, (union v6addr *) &ip6->daddr);
 	ipv6_addr_copy(&tuple->saddr, (union v6addr *) &ip6->saddr);
 
-	hdrlen = ipv6_hdrlen(skb, l3_off, &tuple->nexthdr);
+	hdrlen = ipv6_hdrlen_frag(skb, l3_off, &tuple->nexthdr, &frag);
 	if (hdrlen < 0)
 		return hdrlen;
 
 	l4_off = l3_off + hdrlen;
 
-	ret = lb6_extract_key(skb, tuple, l4_off, &key, &csum_off, CT_EGRESS);
+	ret = lb6_extract_key(skb, tuple, l4_off, &frag, &key, &csum_off,
+			      CT_EGRESS);
 	if (IS_ERR(ret)) {
 		if (ret == DROP_UNKNOWN_L4)
 			goto skip_service_lookup;
@@ -177,12 +181,15 @@ static inline int ipv6_l3_from_lxc(struct __sk_buff *skb,
 	 * entry for destination endpoints where we can't encode the state in the
 	 * address.
 	 */
+	lat = latency_now();
 	if ((svc = lb6_lookup_service(skb, &key)) != NULL) {
 		ret = lb6_local(get_ct_map6(tuple), skb, l3_off, l4_off,
-				&csum_off, &key, tuple, svc, &ct_state_new);
+				&csum_off, &key, tuple, svc, &ct_state_new,
+				&frag);
 		if (IS_ERR(ret))
 			return ret;
 	}
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_LB, lat);
 
 skip_service_lookup:
 	/* The verifier wants to see this assignment here in case the above goto
@@ -201,8 +208,10 @@ skip_service_lookup:
 	 * entry to allow reverse packets and return set cb[CB_POLICY] to
 	 * POLICY_SKIP if the packet is a reply packet to an existing
 	 * incoming connection. */
-	ret = ct_lookup6(get_ct_map6(tuple), tuple, skb, l4_off, CT_EGRESS,
-			 &ct_state, &monitor);
+	lat = latency_now();
+	ret = ct_lookup6(get_ct_map6(tuple), tuple, skb, l4_off, &frag,
+			 CT_EGRESS, &ct_state, &monitor);
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_CT, lat);
 	if (ret < 0) {
 		relax_verifier();
 		return ret;
@@ -215,9 +224,9 @@ skip_service_lookup:
 
 	/* Determine the destination category for policy fallback. */
 	if (1) {
-		struct remote_endpoint_info *info;
+		struct remote_endpoint_info *info, buf;
 
-		info = lookup_ip6_remote_endpoint(&orig_dip);
+		info = lookup_ip6_remote_endpoint(&orig_dip, &buf);
 		if (info != NULL && info->sec_label) {
 			*dstID = info->sec_label;
 			tunnel_endpoint = info->tunnel_endpoint;
@@ -232,8 +241,10 @@ skip_service_lookup:
 	/* If the packet is in the establishing direction and it's destined
 	 * within the cluster, it must match policy or be dropped. If it's
 	 * bound for the host/outside, perform the CIDR policy check. */
+	lat = latency_now();
 	verdict = policy_can_egress6(skb, tuple, *dstID,
 				     ipv6_ct_tuple_get_daddr(tuple));
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_POLICY, lat);
 	if (ret != CT_REPLY && ret != CT_RELATED && verdict < 0) {
 		/* If the connection was previously known and packet is now
 		 * denied, remove the connection tracking entry */
@@ -266,7 +277,8 @@ skip_service_lookup:
 
 		if (ct_state.rev_nat_index) {
 			ret = lb6_rev_nat(skb, l4_off, &csum_off,
-					  ct_state.rev_nat_index, tuple, 0);
+					  ct_state.rev_nat_index, tuple, 0,
+					  frag.has_l4_header);
 			if (IS_ERR(ret))
 				return ret;
 
@@ -290,7 +302,7 @@ skip_service_lookup:
 						 verdict, tuple->dport,
 						 orig_dip, tuple, &host_ip,
 						 SECLABEL, forwarding_reason,
-						 monitor);
+						 monitor, frag.has_l4_header);
 		if (IS_ERR(ret))
 			return ret;
 
@@ -325,7 +337,8 @@ skip_service_lookup:
 		}
 
 		policy_clear_mark(skb);
-		return ipv6_local_delivery(skb, l3_off, l4_off, SECLABEL, ip6, tuple->nexthdr, ep, METRIC_EGRESS);
+		return ipv6_local_delivery(skb, l3_off, l4_off, SECLABEL, ip6, tuple->nexthdr, ep, METRIC_EGRESS,
+					   LATENCY_PROG_FROM_LXC);
 	}
 
 	/* The packet goes to a peer not managed by this agent instance */
@@ -451,11 +464,11 @@ int tail_handle_ipv6(struct __sk_buff *skb)
 
 	if (IS_ERR(ret)) {
 		relax_verifier();
-		return send_drop_notify(skb, SECLABEL, dstID, 0, ret, TC_ACT_SHOT,
-		                        METRIC_EGRESS);
+		ret = send_drop_notify(skb, SECLABEL, dstID, 0, ret, TC_ACT_SHOT,
+				       METRIC_EGRESS);
 	}
 
-	return ret;
+	return latency_end(LATENCY_PROG_FROM_LXC, ret);
 }
 #endif /* ENABLE_IPV6 */
 
@@ -476,6 +489,8 @@ static inline int handle_ipv4_from_lxc(struct __sk_buff *skb, __u32 *dstID)
 	__be32 orig_dip;
 	__u32 tunnel_endpoint = 0;
 	__u32 monitor = 0;
+	bool has_l4_header;
+	__u64 lat;
 
 	if (!revalidate_data(skb, &data, &data_end, &ip4))
 		return DROP_INVALID;
@@ -489,6 +504,7 @@ static inline int handle_ipv4_from_lxc(struct __sk_buff *skb, __u32 *dstID)
 	tuple.saddr = ip4->saddr;
 
 	l4_off = l3_off + ipv4_hdrlen(ip4);
+	has_l4_header = ipv4_has_l4_header(ip4);
 
 	ret = lb4_extract_key(skb, &tuple, l4_off, &key, &csum_off, CT_EGRESS);
 	if (IS_ERR(ret)) {
@@ -499,12 +515,15 @@ static inline int handle_ipv4_from_lxc(struct __sk_buff *skb, __u32 *dstID)
 	}
 
 	ct_state_new.orig_dport = key.dport;
+	lat = latency_now();
 	if ((svc = lb4_lookup_service(skb, &key)) != NULL) {
 		ret = lb4_local(get_ct_map4(&tuple), skb, l3_off, l4_off, &csum_off,
-				&key, &tuple, svc, &ct_state_new, ip4->saddr);
+				&key, &tuple, svc, &ct_state_new, ip4->saddr,
+				has_l4_header);
 		if (IS_ERR(ret))
 			return ret;
 	}
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_LB, lat);
 
 skip_service_lookup:
 	/* The verifier wants to see this assignment here in case the above goto
@@ -522,8 +541,10 @@ skip_service_lookup:
 	 * entry to allow reverse packets and return set cb[CB_POLICY] to
 	 * POLICY_SKIP if the packet is a reply packet to an existing
 	 * incoming connection. */
+	lat = latency_now();
 	ret = ct_lookup4(get_ct_map4(&tuple), &tuple, skb, l4_off, CT_EGRESS,
 			 &ct_state, &monitor);
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_CT, lat);
 	if (ret < 0)
 		return ret;
 
@@ -531,9 +552,9 @@ skip_service_lookup:
 
 	/* Determine the destination category for policy fallback. */
 	if (1) {
-		struct remote_endpoint_info *info;
+		struct remote_endpoint_info *info, buf;
 
-		info = lookup_ip4_remote_endpoint(orig_dip);
+		info = lookup_ip4_remote_endpoint(orig_dip, &buf);
 		if (info != NULL && info->sec_label) {
 			*dstID = info->sec_label;
 			tunnel_endpoint = info->tunnel_endpoint;
@@ -548,7 +569,9 @@ skip_service_lookup:
 	/* If the packet is in the establishing direction and it's destined
 	 * within the cluster, it must match policy or be dropped. If it's
 	 * bound for the host/outside, perform the CIDR policy check. */
+	lat = latency_now();
 	verdict = policy_can_egress4(skb, &tuple, *dstID, ipv4_ct_tuple_get_daddr(&tuple));
+	latency_record(LATENCY_PROG_FROM_LXC, LATENCY_STAGE_POLICY, lat);
 	if (ret != CT_REPLY && ret != CT_RELATED && verdict < 0) {
 		/* If the connection was previously known and packet is now
 		 * denied, remove the connection tracking entry */
@@ -581,7 +604,7 @@ skip_service_lookup:
 
 		if (ct_state.rev_nat_index) {
 			ret = lb4_rev_nat(skb, l3_off, l4_off, &csum_off,
-					  &ct_state, &tuple, 0);
+					  &ct_state, &tuple, 0, has_l4_header);
 			if (IS_ERR(ret)) {
 				relax_verifier();
 				return ret;
@@ -599,7 +622,8 @@ skip_service_lookup:
 		ret = ipv4_redirect_to_host_port(skb, &csum_off, l4_off,
 						 verdict, tuple.dport,
 						 orig_dip, &tuple, SECLABEL,
-						 forwarding_reason, monitor);
+						 forwarding_reason, monitor,
+						 has_l4_header);
 		if (IS_ERR(ret))
 			return ret;
 
@@ -643,7 +667,8 @@ skip_service_lookup:
 #endif
 		}
 		policy_clear_mark(skb);
-		return ipv4_local_delivery(skb, l3_off, l4_off, SECLABEL, ip4, ep, METRIC_EGRESS);
+		return ipv4_local_delivery(skb, l3_off, l4_off, SECLABEL, ip4, ep, METRIC_EGRESS,
+					   LATENCY_PROG_FROM_LXC);
 	}
 
 #ifdef ENCAP_IFINDEX
@@ -738,10 +763,10 @@ int tail_handle_ipv4(struct __sk_buff *skb)
 	int ret = handle_ipv4_from_lxc(skb, &dstID);
 
 	if (IS_ERR(ret))
-		return send_drop_notify(skb, SECLABEL, dstID, 0, ret, TC_ACT_SHOT,
-		                        METRIC_EGRESS);
+		ret = send_drop_notify(skb, SECLABEL, dstID, 0, ret, TC_ACT_SHOT,
+				       METRIC_EGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_FROM_LXC, ret);
 }
 
 #ifdef ENABLE_ARP_RESPONDER
@@ -763,6 +788,7 @@ int handle_xgress(struct __sk_buff *skb)
 {
 	int ret;
 
+	latency_start(LATENCY_PROG_FROM_LXC);
 	bpf_clear_cb(skb);
 
 	send_trace_notify(skb, TRACE_FROM_LXC, SECLABEL, 0, 0, 0, 0,
@@ -792,9 +818,9 @@ int handle_xgress(struct __sk_buff *skb)
 	}
 
 	if (IS_ERR(ret))
-		return send_drop_notify(skb, SECLABEL, 0, 0, ret, TC_ACT_SHOT,
-					METRIC_EGRESS);
-	return ret;
+		ret = send_drop_notify(skb, SECLABEL, 0, 0, ret, TC_ACT_SHOT,
+				       METRIC_EGRESS);
+	return latency_end(LATENCY_PROG_FROM_LXC, ret);
 }
 
 #ifdef ENABLE_IPV6
@@ -805,12 +831,14 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 	void *data, *data_end;
 	struct ipv6hdr *ip6;
 	struct csum_offset csum_off = {};
+	struct ipv6_frag_info frag;
 	int ret, l4_off, verdict, hdrlen;
 	struct ct_state ct_state = {};
 	struct ct_state ct_state_new = {};
 	bool skip_proxy = false;
 	union v6addr orig_dip = {};
 	__u32 monitor = 0;
+	__u64 lat;
 
 	if (!revalidate_data(skb, &data, &data_end, &ip6))
 		return DROP_INVALID;
@@ -826,7 +854,7 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 	 * redirection to the egress proxy as we would loop forever. */
 	skip_proxy = tc_index_skip_proxy(skb);
 
-	hdrlen = ipv6_hdrlen(skb, ETH_HLEN, &tuple.nexthdr);
+	hdrlen = ipv6_hdrlen_frag(skb, ETH_HLEN, &tuple.nexthdr, &frag);
 	if (hdrlen < 0)
 		return hdrlen;
 
@@ -844,7 +872,7 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 		if (IS_ERR(ret))
 			return DROP_WRITE_ERROR;
 
-		if (csum_off.offset) {
+		if (csum_off.offset && frag.has_l4_header) {
 			__u32 zero_nat = 0;
 			__be32 sum = csum_diff(&ct_state_new.rev_nat_index, 4, &zero_nat, 4, 0);
 			if (csum_l4_replace(skb, l4_off, &csum_off, 0, sum, BPF_F_PSEUDO_HDR) < 0)
@@ -852,8 +880,10 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 		}
 	}
 
-	ret = ct_lookup6(get_ct_map6(&tuple), &tuple, skb, l4_off, CT_INGRESS,
-			 &ct_state, &monitor);
+	lat = latency_now();
+	ret = ct_lookup6(get_ct_map6(&tuple), &tuple, skb, l4_off, &frag,
+			 CT_INGRESS, &ct_state, &monitor);
+	latency_record(LATENCY_PROG_TO_LXC, LATENCY_STAGE_CT, lat);
 	if (ret < 0)
 		return ret;
 
@@ -863,17 +893,20 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 		int ret2;
 
 		ret2 = lb6_rev_nat(skb, l4_off, &csum_off,
-				   ct_state.rev_nat_index, &tuple, 0);
+				   ct_state.rev_nat_index, &tuple, 0,
+				   frag.has_l4_header);
 		if (IS_ERR(ret2))
 			return ret2;
 	}
 
+	lat = latency_now();
 	if (!(cfg->flags & EP_F_SKIP_POLICY_INGRESS))
 		verdict = policy_can_access_ingress(skb, src_label, tuple.dport,
 				tuple.nexthdr, sizeof(tuple.saddr),
 				&tuple.saddr, false);
 	else
 		verdict = TC_ACT_OK;
+	latency_record(LATENCY_PROG_TO_LXC, LATENCY_STAGE_POLICY, lat);
 
 	/* Reply packets and related packets are allowed, all others must be
 	 * permitted by policy */
@@ -909,7 +942,8 @@ ipv6_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 		ret = ipv6_redirect_to_host_port(skb, &csum_off, l4_off,
 						 verdict, tuple.dport,
 						 orig_dip, &tuple, &host_ip, src_label,
-						 *forwarding_reason, monitor);
+						 *forwarding_reason, monitor,
+						 frag.has_l4_header);
 		if (IS_ERR(ret))
 			return ret;
 
@@ -947,10 +981,10 @@ int tail_ipv6_policy(struct __sk_buff *skb)
 		ret = DROP_NO_CONFIG;
 
 	if (IS_ERR(ret))
-		return send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
-					ret, TC_ACT_SHOT, METRIC_INGRESS);
+		ret = send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
+				       ret, TC_ACT_SHOT, METRIC_INGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_TO_LXC, ret);
 }
 #endif /* ENABLE_IPV6 */
 
@@ -967,8 +1001,10 @@ ipv4_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 	struct ct_state ct_state_new = {};
 	bool skip_proxy = false;
 	__be32 orig_dip, orig_sip;
-	bool is_fragment = false;
+	bool is_untracked_fragment = false;
+	bool has_l4_header;
 	__u32 monitor = 0;
+	__u64 lat;
 
 	if (!revalidate_data(skb, &data, &data_end, &ip4))
 		return DROP_INVALID;
@@ -987,10 +1023,17 @@ ipv4_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 
 	l4_off = ETH_HLEN + ipv4_hdrlen(ip4);
 	csum_l4_offset_and_flags(tuple.nexthdr, &csum_off);
-	is_fragment = ipv4_is_fragment(ip4);
+	has_l4_header = ipv4_has_l4_header(ip4);
+#ifndef ENABLE_IPV4_FRAGMENTS
+	/* Indicate that this is a datagram fragment for which we cannot
+	 * retrieve L4 ports. Do not set flag if we support fragmentation. */
+	is_untracked_fragment = ipv4_is_fragment(ip4);
+#endif
 
+	lat = latency_now();
 	ret = ct_lookup4(get_ct_map4(&tuple), &tuple, skb, l4_off, CT_INGRESS, &ct_state,
 			 &monitor);
+	latency_record(LATENCY_PROG_TO_LXC, LATENCY_STAGE_CT, lat);
 	if (ret < 0)
 		return ret;
 
@@ -1009,18 +1052,20 @@ ipv4_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 
 		ret2 = lb4_rev_nat(skb, ETH_HLEN, l4_off, &csum_off,
 				   &ct_state, &tuple,
-				   REV_NAT_F_TUPLE_SADDR);
+				   REV_NAT_F_TUPLE_SADDR, has_l4_header);
 		if (IS_ERR(ret2))
 			return ret2;
 	}
 
+	lat = latency_now();
 	if (!(cfg->flags & EP_F_SKIP_POLICY_INGRESS))
 		verdict = policy_can_access_ingress(skb, src_label, tuple.dport,
 						    tuple.nexthdr,
 						    sizeof(orig_sip),
-						    &orig_sip, is_fragment);
+						    &orig_sip, is_untracked_fragment);
 	else
 		verdict = TC_ACT_OK;
+	latency_record(LATENCY_PROG_TO_LXC, LATENCY_STAGE_POLICY, lat);
 
 	/* Reply packets and related packets are allowed, all others must be
 	 * permitted by policy */
@@ -1053,7 +1098,8 @@ ipv4_policy(struct __sk_buff *skb, int ifindex, __u32 src_label, int *forwarding
 		ret = ipv4_redirect_to_host_port(skb, &csum_off, l4_off,
 						 verdict, tuple.dport,
 						 orig_dip, &tuple, src_label,
-						 *forwarding_reason, monitor);
+						 *forwarding_reason, monitor,
+						 has_l4_header);
 		if (IS_ERR(ret))
 			return ret;
 
@@ -1097,10 +1143,10 @@ int tail_ipv4_policy(struct __sk_buff *skb)
 	else
 		ret = DROP_NO_CONFIG;
 	if (IS_ERR(ret))
-		return send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
-					ret, TC_ACT_SHOT, METRIC_INGRESS);
+		ret = send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
+				       ret, TC_ACT_SHOT, METRIC_INGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_TO_LXC, ret);
 }
 #endif /* ENABLE_IPV4 */
 
@@ -1116,6 +1162,8 @@ __section_tail(CILIUM_MAP_POLICY, LXC_ID) int handle_policy(struct __sk_buff *sk
 	int ret;
 	__u32 src_label = skb->cb[CB_SRC_LABEL];
 
+	latency_start(LATENCY_PROG_TO_LXC);
+
 	switch (skb->protocol) {
 #ifdef ENABLE_IPV6
 	case bpf_htons(ETH_P_IPV6):
@@ -1135,10 +1183,10 @@ __section_tail(CILIUM_MAP_POLICY, LXC_ID) int handle_policy(struct __sk_buff *sk
 	}
 
 	if (IS_ERR(ret))
-		return send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
-					ret, TC_ACT_SHOT, METRIC_INGRESS);
+		ret = send_drop_notify(skb, src_label, SECLABEL, LXC_ID,
+				       ret, TC_ACT_SHOT, METRIC_INGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_TO_LXC, ret);
 }
 
 #ifdef ENABLE_NAT46
@@ -47,6 +47,13 @@
 #include "lib/policy.h"
 #include "lib/drop.h"
 #include "lib/encap.h"
+#include "lib/latency.h"
+
+#ifdef FROM_HOST
+#define LATENCY_PROG_NETDEV LATENCY_PROG_FROM_HOST
+#else
+#define LATENCY_PROG_NETDEV LATENCY_PROG_FROM_NETDEV
+#endif
 
 
 #if defined FROM_HOST && (defined ENABLE_IPV4 || defined ENABLE_IPV6)
@@ -194,7 +201,7 @@ static inline int handle_ipv6(struct __sk_buff *skb, __u32 src_identity)
 	/* Packets from the proxy will already have a real identity. */
 	if (identity_is_reserved(src_identity)) {
 		union v6addr *src = (union v6addr *) &ip6->saddr;
-		info = ipcache_lookup6(&IPCACHE_MAP, src, V6_CACHE_KEY_LEN);
+		info = ipcache_lookup6(&IPCACHE6_LOOKUP_MAP, src, V6_CACHE_KEY_LEN);
 		if (info != NULL) {
 			__u32 sec_label = info->sec_label;
 			if (sec_label)
@@ -234,12 +241,13 @@ static inline int handle_ipv6(struct __sk_buff *skb, __u32 src_identity)
 		if (ep->flags & ENDPOINT_F_HOST)
 			return TC_ACT_OK;
 
-		return ipv6_local_delivery(skb, l3_off, l4_off, secctx, ip6, nexthdr, ep, METRIC_INGRESS);
+		return ipv6_local_delivery(skb, l3_off, l4_off, secctx, ip6, nexthdr, ep, METRIC_INGRESS,
+					   LATENCY_PROG_NETDEV);
 	}
 
 #ifdef ENCAP_IFINDEX
 	dst = (union v6addr *) &ip6->daddr;
-	info = ipcache_lookup6(&IPCACHE_MAP, dst, V6_CACHE_KEY_LEN);
+	info = ipcache_lookup6(&IPCACHE6_LOOKUP_MAP, dst, V6_CACHE_KEY_LEN);
 	if (info != NULL && info->tunnel_endpoint != 0) {
 		int ret = encap_and_redirect_with_nodeid(skb, info->tunnel_endpoint,
 							 secctx, TRACE_PAYLOAD_LEN);
@@ -379,7 +387,7 @@ static inline int handle_ipv4(struct __sk_buff *skb, __u32 src_identity)
 
 	/* Packets from the proxy will already have a real identity. */
 	if (identity_is_reserved(src_identity)) {
-		info = ipcache_lookup4(&IPCACHE_MAP, ip4->saddr, V4_CACHE_KEY_LEN);
+		info = ipcache_lookup4(&IPCACHE4_LOOKUP_MAP, ip4->saddr, V4_CACHE_KEY_LEN);
 		if (info != NULL) {
 			__u32 sec_label = info->sec_label;
 			if (sec_label) {
@@ -436,11 +444,12 @@ static inline int handle_ipv4(struct __sk_buff *skb, __u32 src_identity)
 			return TC_ACT_OK;
 #endif
 
-		return ipv4_local_delivery(skb, ETH_HLEN, l4_off, secctx, ip4, ep, METRIC_INGRESS);
+		return ipv4_local_delivery(skb, ETH_HLEN, l4_off, secctx, ip4, ep, METRIC_INGRESS,
+					   LATENCY_PROG_NETDEV);
 	}
 
 #ifdef ENCAP_IFINDEX
-	info = ipcache_lookup4(&IPCACHE_MAP, ip4->daddr, V4_CACHE_KEY_LEN);
+	info = ipcache_lookup4(&IPCACHE4_LOOKUP_MAP, ip4->daddr, V4_CACHE_KEY_LEN);
 	if (info != NULL && info->tunnel_endpoint != 0) {
 		int ret = encap_and_redirect_with_nodeid(skb, info->tunnel_endpoint,
 							 secctx, TRACE_PAYLOAD_LEN);
@@ -490,9 +499,9 @@ __section_tail(CILIUM_MAP_CALLS, CILIUM_CALL_IPV4_FROM_LXC) int tail_handle_ipv4
 	int ret = handle_ipv4(skb, proxy_identity);
 
 	if (IS_ERR(ret))
-		return send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
+		ret = send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_NETDEV, ret);
 }
 
 #endif /* ENABLE_IPV4 */
@@ -532,6 +541,8 @@ int from_netdev(struct __sk_buff *skb)
 	__u32 identity = 0;
 	int ret;
 
+	latency_start(LATENCY_PROG_NETDEV);
+
 #ifdef ENABLE_IPSEC
 	if (1) {
 		__u32 magic = skb->mark & MARK_MAGIC_HOST_MASK;
@@ -582,7 +593,7 @@ int from_netdev(struct __sk_buff *skb)
 		/* We should only be seeing an error here for packets which have
 		 * been targetting an endpoint managed by us. */
 		if (IS_ERR(ret))
-			return send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
+			ret = send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
 		break;
 #endif
 
@@ -593,8 +604,9 @@ int from_netdev(struct __sk_buff *skb)
 		/* We are not returning an error here to always allow traffic to
 		 * the stack in case maps have become unavailable.
 		 *
-		 * Note: Since drop notification requires a tail call as well,
-		 * this notification is unlikely to succeed. */
+		 * Note: Unless the kernel supports BPF-to-BPF calls next to
+		 * tail calls, drop notification requires a tail call as well
+		 * and this notification is unlikely to succeed. */
 		return send_drop_notify_error(skb, DROP_MISSED_TAIL_CALL,
 		                              TC_ACT_OK, METRIC_INGRESS);
 
@@ -605,7 +617,7 @@ int from_netdev(struct __sk_buff *skb)
 		ret = TC_ACT_OK;
 	}
 
-	return ret;
+	return latency_end(LATENCY_PROG_NETDEV, ret);
 }
 
 BPF_LICENSE("GPL");
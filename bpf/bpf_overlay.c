@@ -35,6 +35,7 @@
 #include "lib/l3.h"
 #include "lib/drop.h"
 #include "lib/policy.h"
+#include "lib/latency.h"
 
 #ifdef ENABLE_IPV6
 static inline int handle_ipv6(struct __sk_buff *skb)
@@ -93,7 +94,8 @@ not_esp:
 			return hdrlen;
 
 		l4_off = l3_off + hdrlen;
-		return ipv6_local_delivery(skb, l3_off, l4_off, key.tunnel_id, ip6, nexthdr, ep, METRIC_INGRESS);
+		return ipv6_local_delivery(skb, l3_off, l4_off, key.tunnel_id, ip6, nexthdr, ep, METRIC_INGRESS,
+					   LATENCY_PROG_FROM_OVERLAY);
 	}
 
 to_host:
@@ -171,7 +173,8 @@ not_esp:
 		if (ep->flags & ENDPOINT_F_HOST)
 			goto to_host;
 
-		return ipv4_local_delivery(skb, ETH_HLEN, l4_off, key.tunnel_id, ip4, ep, METRIC_INGRESS);
+		return ipv4_local_delivery(skb, ETH_HLEN, l4_off, key.tunnel_id, ip4, ep, METRIC_INGRESS,
+					   LATENCY_PROG_FROM_OVERLAY);
 	}
 
 to_host:
@@ -200,9 +203,9 @@ __section_tail(CILIUM_MAP_CALLS, CILIUM_CALL_IPV4_FROM_LXC) int tail_handle_ipv4
 	int ret = handle_ipv4(skb);
 
 	if (IS_ERR(ret))
-		return send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
+		ret = send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
 
-	return ret;
+	return latency_end(LATENCY_PROG_FROM_OVERLAY, ret);
 }
 
 #endif
@@ -212,6 +215,7 @@ int from_overlay(struct __sk_buff *skb)
 {
 	int ret;
 
+	latency_start(LATENCY_PROG_FROM_OVERLAY);
 	bpf_clear_cb(skb);
 
 	send_trace_notify(skb, TRACE_FROM_OVERLAY, 0, 0, 0,
@@ -242,9 +246,9 @@ int from_overlay(struct __sk_buff *skb)
 	}
 
 	if (IS_ERR(ret))
-		return send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
-	else
-		return ret;
+		ret = send_drop_notify_error(skb, ret, TC_ACT_SHOT, METRIC_INGRESS);
+
+	return latency_end(LATENCY_PROG_FROM_OVERLAY, ret);
 }
 
 BPF_LICENSE("GPL");
@@ -28,6 +28,8 @@
 
 #include <linux/bpf.h>
 #include <linux/if_ether.h>
+#include <linux/udp.h>
+#include <linux/tcp.h>
 
 #include "lib/utils.h"
 #include "lib/common.h"
@@ -39,6 +41,24 @@
 #ifndef HAVE_LPM_MAP_TYPE
 # undef CIDR4_LPM_PREFILTER
 # undef CIDR6_LPM_PREFILTER
+# undef DST4_FILTER
+# undef DST6_FILTER
+# undef RATE4_FILTER
+# undef RATE6_FILTER
+#endif
+
+#ifndef HAVE_LRU_MAP_TYPE
+# undef RATE4_FILTER
+# undef RATE6_FILTER
+# undef SYNCOOKIE_FILTER
+#endif
+
+#ifndef IP_OFFSET
+#define IP_OFFSET	0x1FFF
+#endif
+
+#ifndef IP_MF
+#define IP_MF		0x2000
 #endif
 
 #ifdef CIDR4_FILTER
@@ -51,6 +71,15 @@ struct bpf_elf_map __section_maps CIDR4_HMAP_NAME = {
 	.max_elem	= CIDR4_HMAP_ELEMS,
 };
 
+struct bpf_elf_map __section_maps CIDR4_HMAP1_NAME = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(struct lpm_v4_key),
+	.size_value	= sizeof(struct lpm_val),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CIDR4_HMAP_ELEMS,
+};
+
 #ifdef CIDR4_LPM_PREFILTER
 struct bpf_elf_map __section_maps CIDR4_LMAP_NAME = {
 	.type		= BPF_MAP_TYPE_LPM_TRIE,
@@ -60,6 +89,15 @@ struct bpf_elf_map __section_maps CIDR4_LMAP_NAME = {
 	.pinning	= PIN_GLOBAL_NS,
 	.max_elem	= CIDR4_LMAP_ELEMS,
 };
+
+struct bpf_elf_map __section_maps CIDR4_LMAP1_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v4_key),
+	.size_value	= sizeof(struct lpm_val),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CIDR4_LMAP_ELEMS,
+};
 #endif /* CIDR4_LPM_PREFILTER */
 #endif /* CIDR4_FILTER */
 
@@ -73,6 +111,15 @@ struct bpf_elf_map __section_maps CIDR6_HMAP_NAME = {
 	.max_elem	= CIDR4_HMAP_ELEMS,
 };
 
+struct bpf_elf_map __section_maps CIDR6_HMAP1_NAME = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(struct lpm_v6_key),
+	.size_value	= sizeof(struct lpm_val),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CIDR4_HMAP_ELEMS,
+};
+
 #ifdef CIDR6_LPM_PREFILTER
 struct bpf_elf_map __section_maps CIDR6_LMAP_NAME = {
 	.type		= BPF_MAP_TYPE_LPM_TRIE,
@@ -82,105 +129,835 @@ struct bpf_elf_map __section_maps CIDR6_LMAP_NAME = {
 	.pinning	= PIN_GLOBAL_NS,
 	.max_elem	= CIDR4_LMAP_ELEMS,
 };
+
+struct bpf_elf_map __section_maps CIDR6_LMAP1_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v6_key),
+	.size_value	= sizeof(struct lpm_val),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CIDR4_LMAP_ELEMS,
+};
 #endif /* CIDR6_LPM_PREFILTER */
 #endif /* CIDR6_FILTER */
 
+#if defined CIDR4_FILTER || defined CIDR6_FILTER
+/* The CIDR maps are double buffered: a full reload fills the maps of the
+ * inactive slot and then switches over by updating the slot map, so the
+ * datapath never sees a partially loaded set.
+ */
+struct bpf_elf_map __section_maps CIDR_SLOT_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(__u32),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+static __always_inline __u32 cidr_active_slot(void)
+{
+	__u32 zero = 0, *slot;
+
+	slot = map_lookup_elem(&CIDR_SLOT_MAP_NAME, &zero);
+	return slot ? *slot : 0;
+}
+#endif
+
+#ifdef DST4_FILTER
+struct bpf_elf_map __section_maps DST4_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v4_l4_key),
+	.size_value	= sizeof(struct xdp_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= DST_MAP_ELEMS,
+};
+#endif /* DST4_FILTER */
+
+#ifdef DST6_FILTER
+struct bpf_elf_map __section_maps DST6_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v6_l4_key),
+	.size_value	= sizeof(struct xdp_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= DST_MAP_ELEMS,
+};
+#endif /* DST6_FILTER */
+
+#ifdef EP_PORTS_FILTER
+struct bpf_elf_map __section_maps EP_PORTS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(struct xdp_ep_port_key),
+	.size_value	= sizeof(struct xdp_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= EP_PORTS_MAP_ELEMS,
+};
+#endif /* EP_PORTS_FILTER */
+
+#if defined DST4_FILTER || defined DST6_FILTER || defined EP_PORTS_FILTER || \
+    defined SYNCOOKIE_FILTER
+struct bpf_elf_map __section_maps RULE_STATS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct xdp_stats),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= PREFILTER_MAX_RULES,
+};
+
+static __always_inline int xdp_rule_hit(struct xdp_md *xdp,
+					const struct xdp_rule *rule, int reason)
+{
+	struct xdp_stats *stats;
+	__u32 rule_id = rule->rule_id;
+
+	stats = map_lookup_elem(&RULE_STATS_MAP_NAME, &rule_id);
+	if (stats) {
+		stats->packets++;
+		stats->bytes += xdp_data_end(xdp) - xdp_data(xdp);
+	}
+
+	return reason;
+}
+#endif
+
+/* Returns the TCP/UDP destination port of the packet, or 0 if the packet
+ * carries no such header. */
+static __always_inline __be16 xdp_l4_dport(struct xdp_md *xdp, void *l4,
+					   __u8 nexthdr)
+{
+	void *data_end = xdp_data_end(xdp);
+	__be16 *ports = l4;
+
+	if (nexthdr != IPPROTO_TCP && nexthdr != IPPROTO_UDP)
+		return 0;
+	if (xdp_no_room(ports + 2, data_end))
+		return 0;
+
+	return ports[1];
+}
+
+static __always_inline int check_ep_ports(struct xdp_md *xdp,
+					  struct endpoint_info *ep,
+					  __u8 nexthdr, __be16 dport)
+{
+#ifdef EP_PORTS_FILTER
+	struct xdp_ep_port_key key = {
+		.lxc_id = ep->lxc_id,
+	};
+	struct xdp_rule *rule;
+
+	if (ep->flags & ENDPOINT_F_HOST)
+		return PREFILTER_PASS_ENDPOINT;
+
+	rule = map_lookup_elem(&EP_PORTS_MAP_NAME, &key);
+	if (rule == NULL || dport == 0)
+		return PREFILTER_PASS_ENDPOINT;
+
+	key.nexthdr = nexthdr;
+	key.dport = dport;
+	if (map_lookup_elem(&EP_PORTS_MAP_NAME, &key))
+		return PREFILTER_PASS_ENDPOINT;
+
+	return xdp_rule_hit(xdp, rule, PREFILTER_DROP_EP_PORT);
+#else
+	return PREFILTER_PASS_ENDPOINT;
+#endif /* EP_PORTS_FILTER */
+}
+
 static __always_inline int check_v4_endpoint(struct xdp_md *xdp,
-					     struct iphdr *ipv4_hdr)
+					     struct iphdr *ipv4_hdr,
+					     __u8 nexthdr, __be16 dport)
 {
-	if (lookup_ip4_endpoint(ipv4_hdr))
-		return XDP_PASS;
+	struct endpoint_info *ep;
 
-	return XDP_DROP;
+	ep = lookup_ip4_endpoint(ipv4_hdr);
+	if (ep)
+		return check_ep_ports(xdp, ep, nexthdr, dport);
+
+	return PREFILTER_DROP_NO_ENDPOINT;
+}
+
+static __always_inline int check_v4_dst(struct xdp_md *xdp,
+					struct iphdr *ipv4_hdr)
+{
+	__u8 nexthdr = ipv4_hdr->protocol;
+	__be16 dport = 0;
+#ifdef DST4_FILTER
+	struct lpm_v4_l4_key pfx = {
+		.lpm = { XDP_L4_KEY_PREFIX + 32 },
+		.nexthdr = nexthdr,
+	};
+	struct xdp_rule *rule;
+#endif
+
+	if (!(ipv4_hdr->frag_off & bpf_htons(IP_OFFSET)))
+		dport = xdp_l4_dport(xdp, (void *)ipv4_hdr + (ipv4_hdr->ihl << 2),
+				     nexthdr);
+
+#ifdef DST4_FILTER
+	__builtin_memcpy(pfx.addr, &ipv4_hdr->daddr, sizeof(pfx.addr));
+	pfx.dport = dport;
+	rule = map_lookup_elem(&DST4_MAP_NAME, &pfx);
+	if (rule == NULL && dport) {
+		pfx.dport = 0;
+		rule = map_lookup_elem(&DST4_MAP_NAME, &pfx);
+	}
+	if (rule)
+		return xdp_rule_hit(xdp, rule, PREFILTER_DROP_DST);
+#endif /* DST4_FILTER */
+
+	return check_v4_endpoint(xdp, ipv4_hdr, nexthdr, dport);
 }
 
-static __always_inline int check_v4(struct xdp_md *xdp)
+static __always_inline int check_v4(struct xdp_md *xdp, __u32 l3_off)
 {
 	void *data_end = xdp_data_end(xdp);
 	void *data = xdp_data(xdp);
-	struct iphdr *ipv4_hdr = data + sizeof(struct ethhdr);
+	struct iphdr *ipv4_hdr = data + l3_off;
 	struct lpm_v4_key pfx __maybe_unused;
+	__u32 slot __maybe_unused;
 
 	if (xdp_no_room(ipv4_hdr + 1, data_end))
-		return XDP_DROP;
+		return PREFILTER_DROP_INVALID;
 
 #ifdef CIDR4_FILTER
 	__builtin_memcpy(pfx.lpm.data, &ipv4_hdr->saddr, sizeof(pfx.addr));
 	pfx.lpm.prefixlen = 32;
+	slot = cidr_active_slot();
 
 #ifdef CIDR4_LPM_PREFILTER
-	if (map_lookup_elem(&CIDR4_LMAP_NAME, &pfx))
-		return XDP_DROP;
+	if (slot ? map_lookup_elem(&CIDR4_LMAP1_NAME, &pfx) :
+		   map_lookup_elem(&CIDR4_LMAP_NAME, &pfx))
+		return PREFILTER_DROP_CIDR_LPM;
 	else
 #endif /* CIDR4_LPM_PREFILTER */
-		return map_lookup_elem(&CIDR4_HMAP_NAME, &pfx) ?
-		       XDP_DROP : check_v4_endpoint(xdp, ipv4_hdr);
+		return (slot ? map_lookup_elem(&CIDR4_HMAP1_NAME, &pfx) :
+			       map_lookup_elem(&CIDR4_HMAP_NAME, &pfx)) ?
+		       PREFILTER_DROP_CIDR : check_v4_dst(xdp, ipv4_hdr);
 #else
-	return check_v4_endpoint(xdp, ipv4_hdr);
+	return check_v4_dst(xdp, ipv4_hdr);
 #endif /* CIDR4_FILTER */
 }
 
 static __always_inline int check_v6_endpoint(struct xdp_md *xdp,
-					     struct ipv6hdr *ipv6_hdr)
+					     struct ipv6hdr *ipv6_hdr,
+					     __u8 nexthdr, __be16 dport)
 {
-	if (lookup_ip6_endpoint(ipv6_hdr))
-		return XDP_PASS;
+	struct endpoint_info *ep;
 
-	return XDP_DROP;
+	ep = lookup_ip6_endpoint(ipv6_hdr);
+	if (ep)
+		return check_ep_ports(xdp, ep, nexthdr, dport);
+
+	return PREFILTER_DROP_NO_ENDPOINT;
 }
 
-static __always_inline int check_v6(struct xdp_md *xdp)
+/* Extension headers are not walked, packets carrying them only match
+ * destination rules for all ports of their next header. */
+static __always_inline int check_v6_dst(struct xdp_md *xdp,
+					struct ipv6hdr *ipv6_hdr)
+{
+	__u8 nexthdr = ipv6_hdr->nexthdr;
+	__be16 dport;
+#ifdef DST6_FILTER
+	struct lpm_v6_l4_key pfx = {
+		.lpm = { XDP_L4_KEY_PREFIX + 128 },
+		.nexthdr = nexthdr,
+	};
+	struct xdp_rule *rule;
+#endif
+
+	dport = xdp_l4_dport(xdp, ipv6_hdr + 1, nexthdr);
+
+#ifdef DST6_FILTER
+	__builtin_memcpy(pfx.addr, &ipv6_hdr->daddr, sizeof(pfx.addr));
+	pfx.dport = dport;
+	rule = map_lookup_elem(&DST6_MAP_NAME, &pfx);
+	if (rule == NULL && dport) {
+		pfx.dport = 0;
+		rule = map_lookup_elem(&DST6_MAP_NAME, &pfx);
+	}
+	if (rule)
+		return xdp_rule_hit(xdp, rule, PREFILTER_DROP_DST);
+#endif /* DST6_FILTER */
+
+	return check_v6_endpoint(xdp, ipv6_hdr, nexthdr, dport);
+}
+
+static __always_inline int check_v6(struct xdp_md *xdp, __u32 l3_off)
 {
 	void *data_end = xdp_data_end(xdp);
 	void *data = xdp_data(xdp);
-	struct ipv6hdr *ipv6_hdr = data + sizeof(struct ethhdr);
+	struct ipv6hdr *ipv6_hdr = data + l3_off;
 	struct lpm_v6_key pfx __maybe_unused;
+	__u32 slot __maybe_unused;
 
 	if (xdp_no_room(ipv6_hdr + 1, data_end))
-		return XDP_DROP;
+		return PREFILTER_DROP_INVALID;
 
 #ifdef CIDR6_FILTER
 	__builtin_memcpy(pfx.lpm.data, &ipv6_hdr->saddr, sizeof(pfx.addr));
 	pfx.lpm.prefixlen = 128;
+	slot = cidr_active_slot();
 
 #ifdef CIDR6_LPM_PREFILTER
-	if (map_lookup_elem(&CIDR6_LMAP_NAME, &pfx))
-		return XDP_DROP;
+	if (slot ? map_lookup_elem(&CIDR6_LMAP1_NAME, &pfx) :
+		   map_lookup_elem(&CIDR6_LMAP_NAME, &pfx))
+		return PREFILTER_DROP_CIDR_LPM;
 	else
 #endif /* CIDR6_LPM_PREFILTER */
-		return map_lookup_elem(&CIDR6_HMAP_NAME, &pfx) ?
-		       XDP_DROP : check_v6_endpoint(xdp, ipv6_hdr);
+		return (slot ? map_lookup_elem(&CIDR6_HMAP1_NAME, &pfx) :
+			       map_lookup_elem(&CIDR6_HMAP_NAME, &pfx)) ?
+		       PREFILTER_DROP_CIDR : check_v6_dst(xdp, ipv6_hdr);
 #else
-	return check_v6_endpoint(xdp, ipv6_hdr);
+	return check_v6_dst(xdp, ipv6_hdr);
 #endif /* CIDR6_FILTER */
 }
 
-static __always_inline int check_filters(struct xdp_md *xdp)
+#ifdef RATE4_FILTER
+struct bpf_elf_map __section_maps RATE4_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v4_key),
+	.size_value	= sizeof(struct xdp_rate_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= RATE_MAP_ELEMS,
+};
+#endif /* RATE4_FILTER */
+
+#ifdef RATE6_FILTER
+struct bpf_elf_map __section_maps RATE6_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LPM_TRIE,
+	.size_key	= sizeof(struct lpm_v6_key),
+	.size_value	= sizeof(struct xdp_rate_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= RATE_MAP_ELEMS,
+};
+#endif /* RATE6_FILTER */
+
+#if defined RATE4_FILTER || defined RATE6_FILTER
+struct bpf_elf_map __section_maps RATE_CLASS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct xdp_rate_class),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= PREFILTER_MAX_RATE_CLASSES,
+};
+
+struct bpf_elf_map __section_maps RATE_STATS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct xdp_rate_stats),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= PREFILTER_MAX_RATE_CLASSES,
+};
+
+struct bpf_elf_map __section_maps RATE_BUCKETS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct xdp_rate_key),
+	.size_value	= sizeof(struct xdp_rate_bucket),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= RATE_BUCKETS_MAP_ELEMS,
+};
+
+/* Charges the packet to the token bucket of the source in the rate class.
+ * Buckets are shared between CPUs and updated without locking, concurrent
+ * packets of the same source may race and let a packet more through.
+ */
+static __always_inline int xdp_rate_limit(const struct xdp_rate_rule *rule,
+					  struct xdp_rate_key *key)
+{
+	struct xdp_rate_bucket *bucket, new_bucket;
+	struct xdp_rate_class *class;
+	struct xdp_rate_stats *stats;
+	__u32 class_id = rule->class_id;
+	__u64 now, tat;
+	int ret = PREFILTER_PASS_ENDPOINT;
+
+	class = map_lookup_elem(&RATE_CLASS_MAP_NAME, &class_id);
+	if (class == NULL || class->interval_ns == 0)
+		return PREFILTER_PASS_ENDPOINT;
+
+	if (class->flags & XDP_RATE_F_AGGREGATE) {
+		__builtin_memset(key->addr, 0, sizeof(key->addr));
+		key->family = 0;
+	}
+	key->class_id = class_id;
+
+	now = ktime_get_ns();
+	bucket = map_lookup_elem(&RATE_BUCKETS_MAP_NAME, key);
+	if (bucket == NULL) {
+		/* A new source starts with a full bucket. */
+		new_bucket.tat = now + class->interval_ns;
+		map_update_elem(&RATE_BUCKETS_MAP_NAME, key, &new_bucket, 0);
+	} else {
+		tat = bucket->tat > now ? bucket->tat : now;
+		tat += class->interval_ns;
+		if (tat - now > class->burst_ns)
+			ret = PREFILTER_DROP_RATE;
+		else
+			bucket->tat = tat;
+	}
+
+	stats = map_lookup_elem(&RATE_STATS_MAP_NAME, &class_id);
+	if (stats) {
+		if (ret == PREFILTER_DROP_RATE)
+			stats->dropped++;
+		else
+			stats->passed++;
+	}
+
+	return ret;
+}
+#endif /* RATE4_FILTER || RATE6_FILTER */
+
+#ifdef RATE4_FILTER
+static __always_inline int check_rate_v4(struct xdp_md *xdp, __u32 l3_off)
 {
 	void *data_end = xdp_data_end(xdp);
 	void *data = xdp_data(xdp);
-	struct ethhdr *eth = data;
-	__u16 proto;
+	struct iphdr *ipv4_hdr = data + l3_off;
+	struct lpm_v4_key pfx = {
+		.lpm = { 32 },
+	};
+	struct xdp_rate_key key = {
+		.family = ENDPOINT_KEY_IPV4,
+	};
+	struct xdp_rate_rule *rule;
+
+	if (xdp_no_room(ipv4_hdr + 1, data_end))
+		return PREFILTER_DROP_INVALID;
+
+	__builtin_memcpy(pfx.addr, &ipv4_hdr->saddr, sizeof(pfx.addr));
+	rule = map_lookup_elem(&RATE4_MAP_NAME, &pfx);
+	if (rule == NULL)
+		return PREFILTER_PASS_ENDPOINT;
+
+	__builtin_memcpy(key.addr, pfx.addr, sizeof(pfx.addr));
+	return xdp_rate_limit(rule, &key);
+}
+#endif /* RATE4_FILTER */
+
+#ifdef RATE6_FILTER
+static __always_inline int check_rate_v6(struct xdp_md *xdp, __u32 l3_off)
+{
+	void *data_end = xdp_data_end(xdp);
+	void *data = xdp_data(xdp);
+	struct ipv6hdr *ipv6_hdr = data + l3_off;
+	struct lpm_v6_key pfx = {
+		.lpm = { 128 },
+	};
+	struct xdp_rate_key key = {
+		.family = ENDPOINT_KEY_IPV6,
+	};
+	struct xdp_rate_rule *rule;
+
+	if (xdp_no_room(ipv6_hdr + 1, data_end))
+		return PREFILTER_DROP_INVALID;
+
+	__builtin_memcpy(pfx.addr, &ipv6_hdr->saddr, sizeof(pfx.addr));
+	rule = map_lookup_elem(&RATE6_MAP_NAME, &pfx);
+	if (rule == NULL)
+		return PREFILTER_PASS_ENDPOINT;
+
+	__builtin_memcpy(key.addr, pfx.addr, sizeof(pfx.addr));
+	return xdp_rate_limit(rule, &key);
+}
+#endif /* RATE6_FILTER */
+
+#ifdef SYNCOOKIE_FILTER
+/* Local endpoint ports protected with SYN cookies, see EP_PORTS_MAP_NAME
+ * for the key. */
+struct bpf_elf_map __section_maps SYNCOOKIE_PORTS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(struct xdp_ep_port_key),
+	.size_value	= sizeof(struct xdp_rule),
+	.flags		= BPF_F_NO_PREALLOC,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= EP_PORTS_MAP_ELEMS,
+};
+
+struct bpf_elf_map __section_maps SYNCOOKIE_SECRET_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct xdp_syncookie_secret),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+struct bpf_elf_map __section_maps SYNCOOKIE_VALID_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct xdp_rate_key),
+	.size_value	= sizeof(struct xdp_syncookie_valid),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= SYNCOOKIE_VALID_MAP_ELEMS,
+};
+
+static __always_inline __u32 xdp_syncookie(const struct xdp_syncookie_secret *secret,
+					   struct xdp_syncookie_tuple *tuple,
+					   __u32 slot)
+{
+	tuple->slot = slot;
+	return xdp_hsiphash(secret->key, (__u32 *)tuple,
+			    sizeof(*tuple) / sizeof(__u32));
+}
+
+/* Answers an unvalidated SYN to a protected port with a SYN-ACK carrying
+ * the cookie as acknowledgment number. The acknowledgment is outside of
+ * the client's window so the client responds with a RST carrying the
+ * cookie as sequence number, which validates the source. The client then
+ * retransmits its SYN which passes to the stack. The packet is rewritten
+ * in place except for the addresses, which the caller swaps.
+ *
+ * Returns the verdict reason, with PREFILTER_TX_SYNCOOKIE if the packet
+ * must be transmitted back.
+ */
+static __always_inline int xdp_syncookie_check(struct xdp_md *xdp,
+					       struct tcphdr *tcp,
+					       __u32 payload_len,
+					       struct xdp_syncookie_tuple *tuple,
+					       struct xdp_rate_key *key,
+					       __u16 lxc_id)
+{
+	struct xdp_ep_port_key port_key = {
+		.lxc_id = lxc_id,
+		.dport = tcp->dest,
+		.nexthdr = IPPROTO_TCP,
+	};
+	struct xdp_syncookie_valid *valid, entry = {};
+	struct xdp_syncookie_secret *secret;
+	struct ethhdr *eth = xdp_data(xdp);
+	__u8 mac[ETH_ALEN];
+	__be16 *flags, old_flags;
+	__be32 cookie, old;
+	struct xdp_rule *rule;
+	__u64 now;
+	__u32 zero = 0, slot;
+
+	rule = map_lookup_elem(&SYNCOOKIE_PORTS_MAP_NAME, &port_key);
+	if (rule == NULL)
+		return PREFILTER_PASS_ENDPOINT;
+
+	now = ktime_get_ns();
+	valid = map_lookup_elem(&SYNCOOKIE_VALID_MAP_NAME, key);
+	if (valid && valid->expires > now)
+		return PREFILTER_PASS_ENDPOINT;
+
+	secret = map_lookup_elem(&SYNCOOKIE_SECRET_MAP_NAME, &zero);
+	if (secret == NULL)
+		return PREFILTER_PASS_ENDPOINT;
+
+	tuple->sport = tcp->source;
+	tuple->dport = tcp->dest;
+	slot = now >> XDP_SYNCOOKIE_SLOT_SHIFT;
+
+	if (tcp->rst) {
+		old = bpf_ntohl(tcp->seq);
+		if (old != xdp_syncookie(secret, tuple, slot) &&
+		    old != xdp_syncookie(secret, tuple, slot - 1))
+			return PREFILTER_PASS_ENDPOINT;
+
+		entry.expires = now + SYNCOOKIE_LIFETIME * NSEC_PER_SEC;
+		map_update_elem(&SYNCOOKIE_VALID_MAP_NAME, key, &entry, 0);
+		return xdp_rule_hit(xdp, rule, PREFILTER_DROP_SYNCOOKIE_ACK);
+	}
+
+	/* The SYN-ACK can't carry the payload of the SYN. */
+	if (payload_len != tcp->doff << 2)
+		return xdp_rule_hit(xdp, rule, PREFILTER_DROP_SYNCOOKIE);
+
+	cookie = bpf_htonl(xdp_syncookie(secret, tuple, slot));
+
+	__builtin_memcpy(mac, eth->h_source, ETH_ALEN);
+	__builtin_memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+	__builtin_memcpy(eth->h_dest, mac, ETH_ALEN);
+
+	/* Swapping the ports and the addresses leaves the checksum intact. */
+	tcp->source = tuple->dport;
+	tcp->dest = tuple->sport;
+
+	flags = (void *)tcp + offsetof(struct tcphdr, ack_seq) + sizeof(__be32);
+	old_flags = *flags;
+	tcp->ack = 1;
+	xdp_csum_replace2(&tcp->check, old_flags, *flags);
+
+	old = tcp->ack_seq;
+	tcp->ack_seq = cookie;
+	xdp_csum_replace4(&tcp->check, old, cookie);
+
+	return xdp_rule_hit(xdp, rule, PREFILTER_TX_SYNCOOKIE);
+}
+
+/* Only SYNs and RSTs without acknowledgment are challenged or validated. */
+static __always_inline bool xdp_syncookie_candidate(const struct tcphdr *tcp)
+{
+	return (tcp->syn || tcp->rst) && !tcp->ack && !tcp->fin;
+}
+
+static __always_inline int check_syncookie_v4(struct xdp_md *xdp, __u32 l3_off)
+{
+	void *data_end = xdp_data_end(xdp);
+	void *data = xdp_data(xdp);
+	struct iphdr *ipv4_hdr = data + l3_off;
+	struct xdp_syncookie_tuple tuple = {};
+	struct xdp_rate_key key = {
+		.family = ENDPOINT_KEY_IPV4,
+	};
+	struct endpoint_info *ep;
+	struct tcphdr *tcp;
+	__be32 addr;
+	int ret;
+
+	if (xdp_no_room(ipv4_hdr + 1, data_end))
+		return PREFILTER_DROP_INVALID;
+	if (ipv4_hdr->protocol != IPPROTO_TCP ||
+	    ipv4_hdr->frag_off & bpf_htons(IP_OFFSET | IP_MF))
+		return PREFILTER_PASS_ENDPOINT;
+
+	tcp = (void *)ipv4_hdr + (ipv4_hdr->ihl << 2);
+	if (xdp_no_room(tcp + 1, data_end))
+		return PREFILTER_PASS_ENDPOINT;
+	if (!xdp_syncookie_candidate(tcp))
+		return PREFILTER_PASS_ENDPOINT;
+
+	ep = lookup_ip4_endpoint(ipv4_hdr);
+	if (ep == NULL || ep->flags & ENDPOINT_F_HOST)
+		return PREFILTER_PASS_ENDPOINT;
+
+	__builtin_memcpy(key.addr, &ipv4_hdr->saddr, sizeof(ipv4_hdr->saddr));
+	tuple.saddr[0] = ipv4_hdr->saddr;
+	tuple.daddr[0] = ipv4_hdr->daddr;
+
+	ret = xdp_syncookie_check(xdp, tcp, bpf_ntohs(ipv4_hdr->tot_len) -
+				  (ipv4_hdr->ihl << 2), &tuple, &key,
+				  ep->lxc_id);
+	if (ret == PREFILTER_TX_SYNCOOKIE) {
+		addr = ipv4_hdr->saddr;
+		ipv4_hdr->saddr = ipv4_hdr->daddr;
+		ipv4_hdr->daddr = addr;
+	}
+
+	return ret;
+}
+
+static __always_inline int check_syncookie_v6(struct xdp_md *xdp, __u32 l3_off)
+{
+	void *data_end = xdp_data_end(xdp);
+	void *data = xdp_data(xdp);
+	struct ipv6hdr *ipv6_hdr = data + l3_off;
+	struct xdp_syncookie_tuple tuple = {};
+	struct xdp_rate_key key = {
+		.family = ENDPOINT_KEY_IPV6,
+	};
+	struct endpoint_info *ep;
+	struct in6_addr addr;
+	struct tcphdr *tcp;
+	int ret;
+
+	if (xdp_no_room(ipv6_hdr + 1, data_end))
+		return PREFILTER_DROP_INVALID;
+	/* Extension headers are not parsed. */
+	if (ipv6_hdr->nexthdr != IPPROTO_TCP)
+		return PREFILTER_PASS_ENDPOINT;
+
+	tcp = (void *)(ipv6_hdr + 1);
+	if (xdp_no_room(tcp + 1, data_end))
+		return PREFILTER_PASS_ENDPOINT;
+	if (!xdp_syncookie_candidate(tcp))
+		return PREFILTER_PASS_ENDPOINT;
+
+	ep = lookup_ip6_endpoint(ipv6_hdr);
+	if (ep == NULL || ep->flags & ENDPOINT_F_HOST)
+		return PREFILTER_PASS_ENDPOINT;
+
+	__builtin_memcpy(key.addr, &ipv6_hdr->saddr, sizeof(key.addr));
+	__builtin_memcpy(tuple.saddr, &ipv6_hdr->saddr, sizeof(tuple.saddr));
+	__builtin_memcpy(tuple.daddr, &ipv6_hdr->daddr, sizeof(tuple.daddr));
+
+	ret = xdp_syncookie_check(xdp, tcp, bpf_ntohs(ipv6_hdr->payload_len),
+				  &tuple, &key, ep->lxc_id);
+	if (ret == PREFILTER_TX_SYNCOOKIE) {
+		addr = ipv6_hdr->saddr;
+		ipv6_hdr->saddr = ipv6_hdr->daddr;
+		ipv6_hdr->daddr = addr;
+	}
+
+	return ret;
+}
+#endif /* SYNCOOKIE_FILTER */
+
+/* Parses the Ethernet header and up to XDP_MAX_VLAN_TAGS 802.1Q/802.1ad
+ * tags starting at offset off. Returns the offset of the L3 header and
+ * stores its protocol in proto, or returns a negative value if the headers
+ * are truncated.
+ */
+static __always_inline int xdp_parse_eth(struct xdp_md *xdp, __u32 off,
+					 __u16 *proto)
+{
+	void *data_end = xdp_data_end(xdp);
+	void *data = xdp_data(xdp);
+	struct ethhdr *eth = data + off;
+	struct xdp_vlan_hdr *vlan;
+	int i;
 
 	if (xdp_no_room(eth + 1, data_end))
-		return XDP_DROP;
+		return -1;
+
+	*proto = eth->h_proto;
+	off += sizeof(*eth);
+
+#pragma unroll
+	for (i = 0; i < XDP_MAX_VLAN_TAGS; i++) {
+		if (*proto != bpf_htons(ETH_P_8021Q) &&
+		    *proto != bpf_htons(ETH_P_8021AD))
+			break;
+
+		vlan = data + off;
+		if (xdp_no_room(vlan + 1, data_end))
+			return -1;
+
+		*proto = vlan->h_vlan_encapsulated_proto;
+		off += sizeof(*vlan);
+	}
+
+	return off;
+}
 
-	proto = eth->h_proto;
+static __always_inline int check_l3(struct xdp_md *xdp, __u16 proto,
+				    __u32 l3_off)
+{
 	if (proto == bpf_htons(ETH_P_IP))
-		return check_v4(xdp);
+		return check_v4(xdp, l3_off);
 	else if (proto == bpf_htons(ETH_P_IPV6))
-		return check_v6(xdp);
+		return check_v6(xdp, l3_off);
 	else
 		/* Pass the rest to stack, we might later do more
 		 * fine-grained filtering here.
 		 */
-		return XDP_PASS;
+		return PREFILTER_PASS_NON_IP;
 }
 
+#ifdef ENABLE_PREFILTER_ENCAP
+/* Returns the offset of the inner Ethernet header if the packet is VXLAN
+ * or Geneve carrying Ethernet, 0 if it is not encapsulated, or a negative
+ * value if the headers are truncated. Outer IPv6 and IPv4 options are not
+ * parsed, such packets are treated as not encapsulated.
+ */
+static __always_inline int xdp_tunnel_inner_off(struct xdp_md *xdp,
+						__u16 proto, __u32 l3_off)
+{
+	void *data_end = xdp_data_end(xdp);
+	void *data = xdp_data(xdp);
+	struct iphdr *ipv4_hdr = data + l3_off;
+	struct udphdr *udp = (void *)(ipv4_hdr + 1);
+	struct xdp_tunnel_hdr *tun = (void *)(udp + 1);
+
+	if (proto != bpf_htons(ETH_P_IP))
+		return 0;
+	if (xdp_no_room(tun + 1, data_end))
+		return 0;
+	if (ipv4_hdr->ihl != 5 || ipv4_hdr->protocol != IPPROTO_UDP ||
+	    ipv4_hdr->frag_off & bpf_htons(IP_OFFSET))
+		return 0;
+
+	if (udp->dest == bpf_htons(PREFILTER_VXLAN_PORT))
+		return l3_off + sizeof(*ipv4_hdr) + sizeof(*udp) + sizeof(*tun);
+
+	if (udp->dest == bpf_htons(PREFILTER_GENEVE_PORT) &&
+	    tun->proto == bpf_htons(ETH_P_TEB))
+		return l3_off + sizeof(*ipv4_hdr) + sizeof(*udp) + sizeof(*tun) +
+		       ((tun->flags & 0x3f) << 2);
+
+	return 0;
+}
+#endif /* ENABLE_PREFILTER_ENCAP */
+
+/* Returns the verdict reason of the packet, see PREFILTER_* in <lib/xdp.h>. */
+static __always_inline int check_filters(struct xdp_md *xdp)
+{
+	__u16 proto;
+	int l3_off, ret;
+#ifdef ENABLE_PREFILTER_ENCAP
+	__u16 inner_proto;
+	int inner_off;
+#endif
+
+	l3_off = xdp_parse_eth(xdp, 0, &proto);
+	if (l3_off < 0)
+		return PREFILTER_DROP_INVALID;
+
+	ret = check_l3(xdp, proto, l3_off);
+	if (prefilter_is_drop(ret))
+		return ret;
+
+#ifdef ENABLE_PREFILTER_ENCAP
+	/* Inner headers are subject to the same source and destination
+	 * checks, rate limits only apply to the outer source. */
+	inner_off = xdp_tunnel_inner_off(xdp, proto, l3_off);
+	if (inner_off > 0) {
+		inner_off = xdp_parse_eth(xdp, inner_off, &inner_proto);
+		if (inner_off < 0)
+			return PREFILTER_DROP_INVALID;
+
+		ret = check_l3(xdp, inner_proto, inner_off);
+		if (prefilter_is_drop(ret))
+			return ret;
+	}
+#endif /* ENABLE_PREFILTER_ENCAP */
+
+#ifdef SYNCOOKIE_FILTER
+	if (proto == bpf_htons(ETH_P_IP))
+		ret = check_syncookie_v4(xdp, l3_off);
+	else if (proto == bpf_htons(ETH_P_IPV6))
+		ret = check_syncookie_v6(xdp, l3_off);
+	if (!prefilter_is_pass(ret))
+		return ret;
+#endif /* SYNCOOKIE_FILTER */
+
+	/* Rate limits only charge packets which passed all other filters. */
+#ifdef RATE4_FILTER
+	if (proto == bpf_htons(ETH_P_IP))
+		ret = check_rate_v4(xdp, l3_off);
+#endif
+#ifdef RATE6_FILTER
+	if (proto == bpf_htons(ETH_P_IPV6))
+		ret = check_rate_v6(xdp, l3_off);
+#endif
+
+	return ret;
+}
+
+struct bpf_elf_map __section_maps PREFILTER_STATS_MAP_NAME = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct xdp_stats),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= __PREFILTER_REASON_MAX,
+};
+
 __section("from-netdev")
 int xdp_start(struct xdp_md *xdp)
 {
-	return check_filters(xdp);
+	struct xdp_stats *stats;
+	__u32 reason;
+
+	reason = check_filters(xdp);
+
+	stats = map_lookup_elem(&PREFILTER_STATS_MAP_NAME, &reason);
+	if (stats) {
+		stats->packets++;
+		stats->bytes += xdp_data_end(xdp) - xdp_data(xdp);
+	}
+
+	if (prefilter_is_pass(reason))
+		return XDP_PASS;
+	if (reason == PREFILTER_TX_SYNCOOKIE)
+		return XDP_TX;
+
+	return XDP_DROP;
 }
 
 BPF_LICENSE("GPL");
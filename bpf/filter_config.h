@@ -29,3 +29,38 @@
 #define CIDR6_LMAP_NAME v6_dyn
 #define CIDR6_FILTER
 #define CIDR6_LPM_PREFILTER
+#define CIDR4_HMAP1_NAME v4_fix_1
+#define CIDR4_LMAP1_NAME v4_dyn_1
+#define CIDR6_HMAP1_NAME v6_fix_1
+#define CIDR6_LMAP1_NAME v6_dyn_1
+#define CIDR_SLOT_MAP_NAME cidr_slot
+#define DST_MAP_ELEMS 1024
+#define DST4_MAP_NAME dst4
+#define DST4_FILTER
+#define DST6_MAP_NAME dst6
+#define DST6_FILTER
+#define EP_PORTS_MAP_ELEMS 1024
+#define EP_PORTS_MAP_NAME ep_ports
+#define EP_PORTS_FILTER
+#define RULE_STATS_MAP_NAME rule_stats
+#define PREFILTER_MAX_RULES 1024
+#define RATE_MAP_ELEMS 1024
+#define RATE4_MAP_NAME rate4
+#define RATE4_FILTER
+#define RATE6_MAP_NAME rate6
+#define RATE6_FILTER
+#define RATE_CLASS_MAP_NAME rate_class
+#define RATE_STATS_MAP_NAME rate_stats
+#define RATE_BUCKETS_MAP_NAME rate_buckets
+#define RATE_BUCKETS_MAP_ELEMS 1024
+#define PREFILTER_MAX_RATE_CLASSES 256
+#define PREFILTER_STATS_MAP_NAME prefilter_stats
+#define ENABLE_PREFILTER_ENCAP
+#define PREFILTER_VXLAN_PORT 8472
+#define PREFILTER_GENEVE_PORT 6081
+#define SYNCOOKIE_PORTS_MAP_NAME syncookie_ports
+#define SYNCOOKIE_SECRET_MAP_NAME syncookie_secret
+#define SYNCOOKIE_VALID_MAP_NAME syncookie_valid
+#define SYNCOOKIE_VALID_MAP_ELEMS 1024
+#define SYNCOOKIE_LIFETIME 300
+#define SYNCOOKIE_FILTER
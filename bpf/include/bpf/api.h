@@ -51,6 +51,10 @@
 # define __inline__		__attribute__((always_inline))
 #endif
 
+#ifndef __noinline
+# define __noinline		__attribute__((noinline))
+#endif
+
 /** Section helper macros. */
 
 #ifndef __section
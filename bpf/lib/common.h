@@ -167,7 +167,7 @@ struct endpoint_key {
 
 #define ENDPOINT_F_HOST		1 /* Special endpoint representing local host */
 
-/* Value of endpoint map */
+/* Value of endpoint map and endpoint table */
 struct endpoint_info {
 	__u32		ifindex;
 	__u16		unused; /* used to be sec_label, no longer used */
@@ -183,6 +183,42 @@ struct remote_endpoint_info {
 	__u32		tunnel_endpoint;
 };
 
+/* Maximum number of distinct prefix lengths in the ipcache on kernels
+ * without LPM map support, must be in sync with pkg/maps/ipcache. */
+#define IPCACHE4_MAX_PREFIXES	18
+#define IPCACHE6_MAX_PREFIXES	4
+
+/* Prefix lengths present in the ipcache, ordered from high to low */
+struct ipcache_prefixes {
+	__u8		count4;
+	__u8		count6;
+	__u8		prefixes4[IPCACHE4_MAX_PREFIXES];
+	__u8		prefixes6[IPCACHE6_MAX_PREFIXES];
+};
+
+/* Value of the ipcache prefixes map. The agent writes the inactive slot
+ * first and flips active in a second update, so a reader never sees a
+ * partially written slot. */
+struct ipcache_prefixes_info {
+	struct ipcache_prefixes slots[2];
+	__u32		active;
+};
+
+/* Slot of the per-CPU ipcache front cache, see lib/eps.h */
+struct ipcache_front_entry {
+	union v6addr	addr;
+	__u32		generation;
+	__u8		family;
+	__u8		negative;
+	__u16		pad;
+	struct remote_endpoint_info info;
+};
+
+struct ipcache_front_stats {
+	__u64		hits;
+	__u64		misses;
+};
+
 struct policy_key {
 	__u32		sec_label;
 	__u16		dport;
@@ -193,18 +229,16 @@ struct policy_key {
 
 struct policy_entry {
 	__be16		proxy_port;
-	__u16		pad[3];
+	__u8		deny:1,
+			pad0:7;
+	__u8		pad1;
+	__u16		pad2[2];
 	__u64		packets;
 	__u64		bytes;
 };
 
-struct metrics_key {
-    __u8      reason;     //0: forwarded, >0 dropped
-    __u8      dir:2,      //1: ingress 2: egress
-              pad:6;
-    __u16     reserved[3]; // reserved for future extension
-};
-
+/* Metrics are indexed by (direction << 8) | reason, see metrics_key().
+ * METRICS_MAP_SIZE must thus be at least 1024. */
 
 struct metrics_value {
      __u64	count;
@@ -281,6 +315,8 @@ enum {
 #define DROP_UNKNOWN_CT			-163
 #define DROP_HOST_UNREACHABLE		-164
 #define DROP_NO_CONFIG		-165
+#define DROP_FRAG_NOT_FOUND	-166
+#define DROP_POLICY_DENY	-167
 
 /* Cilium metrics reason for forwarding packet.
  * If reason > 0 then this is a drop reason and value corresponds to -(DROP_*)
@@ -475,6 +511,45 @@ struct lb_sequence {
 	__u16 idx[LB_RR_MAX_SEQ];
 };
 
+/* Identifies an IPv4 datagram across all of its fragments (RFC791). */
+struct ipv4_frag_id {
+	__be32		daddr;
+	__be32		saddr;
+	__be16		id;
+	__u8		proto;
+	__u8		pad;
+} __attribute__((packed));
+
+/* L4 ports of a fragmented datagram, in the order found on the wire. */
+struct ipv4_frag_l4ports {
+	__be16		sport;
+	__be16		dport;
+} __attribute__((packed));
+
+/* Identifies an IPv6 datagram across all of its fragments (RFC8200). */
+struct ipv6_frag_id {
+	union v6addr	saddr;
+	union v6addr	daddr;
+	__be32		id;
+	__u8		proto;		/* Next header of the fragment header */
+	__u8		pad[3];
+} __attribute__((packed));
+
+/* L4 ports of a fragmented datagram, in the order found on the wire. */
+struct ipv6_frag_l4ports {
+	__be16		sport;
+	__be16		dport;
+} __attribute__((packed));
+
+/* State of an IPv6 datagram found in its first fragment. The upper layer
+ * protocol may follow extension headers which only the first fragment
+ * carries. */
+struct ipv6_frag_datagram {
+	struct ipv6_frag_l4ports ports;
+	__u8		nexthdr;	/* Upper layer protocol */
+	__u8		pad[3];
+} __attribute__((packed));
+
 struct ct_state {
 	__u16 rev_nat_index;
 	__u16 loopback:1,
@@ -23,6 +23,7 @@
 
 #include "common.h"
 #include "utils.h"
+#include "ipv4.h"
 #include "ipv6.h"
 #include "dbg.h"
 #include "l4.h"
@@ -302,9 +303,21 @@ static inline void __inline__ ipv6_ct_tuple_reverse(struct ipv6_ct_tuple *tuple)
 		tuple->flags |= TUPLE_F_IN;
 }
 
-/* Offset must point to IPv6 */
+static inline int __inline__
+ipv6_ct_extract_l4_ports(struct __sk_buff *skb, int l4_off,
+			 const struct ipv6_frag_info *frag,
+			 struct ipv6_ct_tuple *tuple, bool track)
+{
+	return ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, frag,
+				  (struct ipv6_frag_l4ports *) &tuple->dport,
+				  track);
+}
+
+/* Offset must point to IPv6, @frag is the fragmentation state returned by
+ * ipv6_hdrlen_frag() for the packet. */
 static inline int __inline__ ct_lookup6(void *map, struct ipv6_ct_tuple *tuple,
-					struct __sk_buff *skb, int l4_off, int dir,
+					struct __sk_buff *skb, int l4_off,
+					const struct ipv6_frag_info *frag, int dir,
 					struct ct_state *ct_state, __u32 *monitor)
 {
 	int ret = CT_NEW, action = ACTION_UNSPEC;
@@ -366,7 +379,15 @@ static inline int __inline__ ct_lookup6(void *map, struct ipv6_ct_tuple *tuple,
 		break;
 
 	case IPPROTO_TCP:
-		if (1) {
+		/* load sport + dport into tuple */
+		ret = ipv6_ct_extract_l4_ports(skb, l4_off, frag, tuple,
+					       dir != CT_SERVICE);
+		if (ret < 0)
+			return ret;
+
+		/* Non-first fragments carry payload where the TCP header
+		 * would be, they neither create nor close connections. */
+		if (frag->has_l4_header) {
 			if (skb_load_bytes(skb, l4_off + 12, &tcp_flags, 2) < 0)
 				return DROP_CT_INVALID_HDR;
 
@@ -375,16 +396,14 @@ static inline int __inline__ ct_lookup6(void *map, struct ipv6_ct_tuple *tuple,
 			else
 				action = ACTION_CREATE;
 		}
-
-		/* load sport + dport into tuple */
-		if (skb_load_bytes(skb, l4_off, &tuple->dport, 4) < 0)
-			return DROP_CT_INVALID_HDR;
 		break;
 
 	case IPPROTO_UDP:
 		/* load sport + dport into tuple */
-		if (skb_load_bytes(skb, l4_off, &tuple->dport, 4) < 0)
-			return DROP_CT_INVALID_HDR;
+		ret = ipv6_ct_extract_l4_ports(skb, l4_off, frag, tuple,
+					       dir != CT_SERVICE);
+		if (ret < 0)
+			return ret;
 
 		action = ACTION_CREATE;
 		break;
@@ -459,6 +478,35 @@ static inline void ct4_cilium_dbg_tuple(struct __sk_buff *skb, __u8 type,
 	cilium_dbg(skb, type, addr, rev_nat_index);
 }
 
+/* Load sport + dport of the packet into the tuple. Offset must point to the
+ * L4 header. Non-first fragments take their ports from the fragment tracking
+ * map, if enabled, and clear has_l4_header. See ipv4_load_l4_ports() for
+ * track. */
+static inline int __inline__
+ipv4_ct_extract_l4_ports(struct __sk_buff *skb, int off,
+			 struct ipv4_ct_tuple *tuple, bool track,
+			 bool *has_l4_header)
+{
+#ifdef ENABLE_IPV4_FRAGMENTS
+	void *data, *data_end;
+	struct iphdr *ip4;
+
+	if (!revalidate_data(skb, &data, &data_end, &ip4))
+		return DROP_CT_INVALID_HDR;
+
+	*has_l4_header = ipv4_has_l4_header(ip4);
+
+	return ipv4_load_l4_ports(skb, ip4, off,
+				  (struct ipv4_frag_l4ports *) &tuple->dport,
+				  track);
+#else
+	if (skb_load_bytes(skb, off, &tuple->dport, 4) < 0)
+		return DROP_CT_INVALID_HDR;
+
+	return 0;
+#endif
+}
+
 /* Offset must point to IPv4 header */
 static inline int __inline__ ct_lookup4(void *map, struct ipv4_ct_tuple *tuple,
 					struct __sk_buff *skb, int off, int dir,
@@ -467,6 +515,7 @@ static inline int __inline__ ct_lookup4(void *map, struct ipv4_ct_tuple *tuple,
 	int ret = CT_NEW, action = ACTION_UNSPEC;
 	bool is_tcp = tuple->nexthdr == IPPROTO_TCP;
 	union tcp_flags tcp_flags = { .value = 0 };
+	bool has_l4_header = true;
 
 	/* The tuple is created in reverse order initially to find a
 	 * potential reverse flow. This is required because the RELATED
@@ -522,7 +571,16 @@ static inline int __inline__ ct_lookup4(void *map, struct ipv4_ct_tuple *tuple,
 		break;
 
 	case IPPROTO_TCP:
-		if (1) {
+		/* load sport + dport into tuple */
+		ret = ipv4_ct_extract_l4_ports(skb, off, tuple,
+					       dir != CT_SERVICE,
+					       &has_l4_header);
+		if (ret < 0)
+			return ret;
+
+		/* Non-first fragments carry payload where the TCP header
+		 * would be, they neither create nor close connections. */
+		if (has_l4_header) {
 			if (skb_load_bytes(skb, off + 12, &tcp_flags, 2) < 0)
 				return DROP_CT_INVALID_HDR;
 
@@ -531,16 +589,15 @@ static inline int __inline__ ct_lookup4(void *map, struct ipv4_ct_tuple *tuple,
 			else
 				action = ACTION_CREATE;
 		}
-
-		/* load sport + dport into tuple */
-		if (skb_load_bytes(skb, off, &tuple->dport, 4) < 0)
-			return DROP_CT_INVALID_HDR;
 		break;
 
 	case IPPROTO_UDP:
 		/* load sport + dport into tuple */
-		if (skb_load_bytes(skb, off, &tuple->dport, 4) < 0)
-			return DROP_CT_INVALID_HDR;
+		ret = ipv4_ct_extract_l4_ports(skb, off, tuple,
+					       dir != CT_SERVICE,
+					       &has_l4_header);
+		if (ret < 0)
+			return ret;
 
 		action = ACTION_CREATE;
 		break;
@@ -769,7 +826,8 @@ static inline int __inline__ ct_create4(void *map, struct ipv4_ct_tuple *tuple,
 
 #else /* !CONNTRACK */
 static inline int __inline__ ct_lookup6(void *map, struct ipv6_ct_tuple *tuple,
-					struct __sk_buff *skb, int off, int dir,
+					struct __sk_buff *skb, int off,
+					const struct ipv6_frag_info *frag, int dir,
 					struct ct_state *ct_state, __u32 *monitor)
 {
 	return 0;
@@ -148,8 +148,190 @@ struct debug_msg {
 	__u32		arg3;
 };
 
+#ifdef DEBUG_FILTER_MAP
+#include <linux/ip.h>
+
+/* Debug filter modes */
+enum {
+	DBG_FILTER_MODE_ALL,	/* Emit all debug events (default) */
+	DBG_FILTER_MODE_NONE,	/* Emit no debug events */
+	DBG_FILTER_MODE_MATCH,	/* Emit debug events matching the filter */
+};
+
+/* Debug filter criteria, all set criteria must match */
+enum {
+	DBG_FILTER_ENDPOINT	= (1 << 0),
+	DBG_FILTER_IDENTITY	= (1 << 1),
+	DBG_FILTER_SUBTYPE	= (1 << 2),
+	DBG_FILTER_TUPLE	= (1 << 3),
+};
+
+#define DBG_FILTER_FAMILY_IPV4	4
+#define DBG_FILTER_FAMILY_IPV6	6
+
+/* Runtime filter of debug events, written by the agent. Zero family,
+ * addresses, ports and protocol in the tuple act as wildcards, the tuple
+ * matches packets of either direction.
+ */
+struct debug_filter {
+	__u8		mode;		/* DBG_FILTER_MODE_* */
+	__u8		family;		/* DBG_FILTER_FAMILY_* */
+	__u8		nexthdr;
+	__u8		flags;		/* DBG_FILTER_* */
+	__u32		identity;	/* Security identity of the program */
+	__u16		endpoint;	/* Endpoint ID, i.e. EVENT_SOURCE */
+	__be16		sport;
+	__be16		dport;
+	__u16		pad;
+	union v6addr	saddr;		/* IPv4 addresses in p1 */
+	union v6addr	daddr;
+	__u32		msg_types[8];	/* Bitmap of DBG_* subtypes */
+	__u32		capture_types[8]; /* Bitmap of DBG_CAPTURE_* subtypes */
+};
+
+struct bpf_elf_map __section_maps DEBUG_FILTER_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct debug_filter),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+static inline bool dbg_addr_match(const union v6addr *filter,
+				  const union v6addr *addr)
+{
+	if (!(filter->p1 | filter->p2 | filter->p3 | filter->p4))
+		return true;
+
+	return filter->p1 == addr->p1 && filter->p2 == addr->p2 &&
+	       filter->p3 == addr->p3 && filter->p4 == addr->p4;
+}
+
+static inline bool dbg_port_match(__be16 filter, __be16 port)
+{
+	return !filter || filter == port;
+}
+
+static inline bool dbg_filter_tuple(struct __sk_buff *skb,
+				    const struct debug_filter *filter)
+{
+	union v6addr saddr = {}, daddr = {};
+	__be16 ports[2] = {};
+	__u8 nexthdr;
+	int l4_off;
+
+	switch (skb->protocol) {
+#ifdef ENABLE_IPV4
+	case bpf_htons(ETH_P_IP): {
+		struct iphdr ip4;
+
+		if ((filter->family && filter->family != DBG_FILTER_FAMILY_IPV4) ||
+		    skb_load_bytes(skb, ETH_HLEN, &ip4, sizeof(ip4)) < 0)
+			return false;
+		saddr.p1 = ip4.saddr;
+		daddr.p1 = ip4.daddr;
+		nexthdr = ip4.protocol;
+		l4_off = ETH_HLEN + ip4.ihl * 4;
+		break;
+	}
+#endif
+#ifdef ENABLE_IPV6
+	case bpf_htons(ETH_P_IPV6): {
+		struct ipv6hdr ip6;
+
+		if ((filter->family && filter->family != DBG_FILTER_FAMILY_IPV6) ||
+		    skb_load_bytes(skb, ETH_HLEN, &ip6, sizeof(ip6)) < 0)
+			return false;
+		__builtin_memcpy(&saddr, &ip6.saddr, sizeof(saddr));
+		__builtin_memcpy(&daddr, &ip6.daddr, sizeof(daddr));
+		nexthdr = ip6.nexthdr;
+		l4_off = ETH_HLEN + sizeof(ip6);
+		break;
+	}
+#endif
+	default:
+		return false;
+	}
+
+	if (filter->nexthdr && filter->nexthdr != nexthdr)
+		return false;
+
+	/* Extension headers are not skipped, ports of such packets only
+	 * match wildcards. */
+	if ((nexthdr == IPPROTO_TCP || nexthdr == IPPROTO_UDP) &&
+	    skb_load_bytes(skb, l4_off, ports, sizeof(ports)) < 0)
+		return false;
+
+	if (dbg_addr_match(&filter->saddr, &saddr) &&
+	    dbg_addr_match(&filter->daddr, &daddr) &&
+	    dbg_port_match(filter->sport, ports[0]) &&
+	    dbg_port_match(filter->dport, ports[1]))
+		return true;
+
+	return dbg_addr_match(&filter->saddr, &daddr) &&
+	       dbg_addr_match(&filter->daddr, &saddr) &&
+	       dbg_port_match(filter->sport, ports[1]) &&
+	       dbg_port_match(filter->dport, ports[0]);
+}
+
+/**
+ * dbg_filter
+ * @skb:	socket buffer
+ * @capture:	true for DBG_CAPTURE_* subtypes, false for DBG_* subtypes
+ * @type:	debug event subtype
+ *
+ * Returns true if the debug event is to be emitted. This is called before
+ * the event is built, so that filtered events neither recalculate the
+ * packet hash nor touch the event buffer.
+ */
+static inline bool dbg_filter(struct __sk_buff *skb, bool capture, __u8 type)
+{
+	struct debug_filter *filter;
+	__u32 zero = 0, bits;
+
+	filter = map_lookup_elem(&DEBUG_FILTER_MAP, &zero);
+	if (!filter || filter->mode == DBG_FILTER_MODE_ALL)
+		return true;
+	if (filter->mode != DBG_FILTER_MODE_MATCH)
+		return false;
+
+	if ((filter->flags & DBG_FILTER_ENDPOINT) &&
+	    filter->endpoint != EVENT_SOURCE)
+		return false;
+
+	if (filter->flags & DBG_FILTER_IDENTITY) {
+#ifdef SECLABEL
+		if (filter->identity != SECLABEL)
+			return false;
+#else
+		return false;
+#endif
+	}
+
+	if (filter->flags & DBG_FILTER_SUBTYPE) {
+		bits = capture ? filter->capture_types[(type >> 5) & 7] :
+				 filter->msg_types[(type >> 5) & 7];
+		if (!(bits & (1U << (type & 31))))
+			return false;
+	}
+
+	if ((filter->flags & DBG_FILTER_TUPLE) && !dbg_filter_tuple(skb, filter))
+		return false;
+
+	return true;
+}
+#else
+static inline bool dbg_filter(struct __sk_buff *skb, bool capture, __u8 type)
+{
+	return true;
+}
+#endif /* DEBUG_FILTER_MAP */
+
 static inline void cilium_dbg(struct __sk_buff *skb, __u8 type, __u32 arg1, __u32 arg2)
 {
+	if (!dbg_filter(skb, false, type))
+		return;
+
 	uint32_t hash = get_hash_recalc(skb);
 	struct debug_msg msg = {
 		.type = CILIUM_NOTIFY_DBG_MSG,
@@ -160,12 +342,15 @@ static inline void cilium_dbg(struct __sk_buff *skb, __u8 type, __u32 arg1, __u3
 		.arg2 = arg2,
 	};
 
-	skb_event_output(skb, &EVENTS_MAP, BPF_F_CURRENT_CPU, &msg, sizeof(msg));
+	skb_event_emit(skb, &msg, sizeof(msg), 0);
 }
 
 static inline void cilium_dbg3(struct __sk_buff *skb, __u8 type, __u32 arg1,
 			       __u32 arg2, __u32 arg3)
 {
+	if (!dbg_filter(skb, false, type))
+		return;
+
 	uint32_t hash = get_hash_recalc(skb);
 	struct debug_msg msg = {
 		.type = CILIUM_NOTIFY_DBG_MSG,
@@ -177,7 +362,7 @@ static inline void cilium_dbg3(struct __sk_buff *skb, __u8 type, __u32 arg1,
 		.arg3 = arg3,
 	};
 
-	skb_event_output(skb, &EVENTS_MAP, BPF_F_CURRENT_CPU, &msg, sizeof(msg));
+	skb_event_emit(skb, &msg, sizeof(msg), 0);
 }
 
 struct debug_capture_msg {
@@ -190,6 +375,9 @@ struct debug_capture_msg {
 
 static inline void cilium_dbg_capture2(struct __sk_buff *skb, __u8 type, __u32 arg1, __u32 arg2)
 {
+	if (!dbg_filter(skb, true, type))
+		return;
+
 	uint64_t skb_len = (uint64_t)skb->len, cap_len = min((uint64_t)TRACE_PAYLOAD_LEN, (uint64_t)skb_len);
 	uint32_t hash = get_hash_recalc(skb);
 	struct debug_capture_msg msg = {
@@ -203,9 +391,7 @@ static inline void cilium_dbg_capture2(struct __sk_buff *skb, __u8 type, __u32 a
 		.arg2 = arg2,
 	};
 
-	skb_event_output(skb, &EVENTS_MAP,
-			 (cap_len << 32) | BPF_F_CURRENT_CPU,
-			 &msg, sizeof(msg));
+	skb_event_emit(skb, &msg, sizeof(msg), cap_len);
 }
 
 static inline void cilium_dbg_capture(struct __sk_buff *skb, __u8 type, __u32 arg1)
@@ -23,6 +23,14 @@
  * int send_drop_notify_error(skb, error, exitcode, __u8 direction)
  *
  * If DROP_NOTIFY is not defined, the API will be compiled in as a NOP.
+ *
+ * If the kernel allows BPF-to-BPF calls in programs using tail calls, the
+ * notification is built in a subprogram. Otherwise it is built in the
+ * CILIUM_CALL_DROP_NOTIFY tail call and lost if the tail call fails.
+ *
+ * With DROP_NOTIFY_RATE, notifications are limited to DROP_NOTIFY_RATE per
+ * second and drop reason on each CPU. Drops are accounted in the metrics
+ * and flow summaries regardless of notifications.
  */
 
 #ifndef __LIB_DROP__
@@ -33,6 +41,7 @@
 #include "common.h"
 #include "utils.h"
 #include "metrics.h"
+#include "flow.h"
 
 #ifdef DROP_NOTIFY
 
@@ -46,35 +55,118 @@ struct drop_notify {
 	__u32		unused;
 };
 
-__section_tail(CILIUM_MAP_CALLS, CILIUM_CALL_DROP_NOTIFY) int __send_drop_notify(struct __sk_buff *skb)
+#if defined DROP_NOTIFY_RATE && defined DROP_NOTIFY_RATE_MAP
+#define DROP_NOTIFY_INTERVAL_NS	(NSEC_PER_SEC / DROP_NOTIFY_RATE)
+#define DROP_NOTIFY_BURST_NS	NSEC_PER_SEC
+
+/* Token bucket of a drop reason on a CPU, expressed as the theoretical
+ * arrival time of the next conforming notification, along with the number
+ * of notifications suppressed so far. The latter is reported by
+ * "cilium bpf drop-notify list".
+ */
+struct drop_notify_bucket {
+	__u64		tat;
+	__u64		suppressed;
+};
+
+struct bpf_elf_map __section_maps DROP_NOTIFY_RATE_MAP = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct drop_notify_bucket),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 256,
+};
+
+/* The rate limiter is inlined into every drop path. Where subprograms can
+ * be mixed with tail calls, it is kept out of line to be verified once. */
+#ifdef HAVE_TAIL_CALL_SUBPROG
+# define __drop_notify_allowed_inline	__noinline
+#else
+# define __drop_notify_allowed_inline	__always_inline
+#endif
+
+/**
+ * drop_notify_allowed
+ * @reason:	Reason for drop
+ *
+ * Returns true if a notification for a drop of the given reason is within
+ * the rate limit and charges it to the bucket of the reason.
+ */
+static __drop_notify_allowed_inline int drop_notify_allowed(int reason)
 {
-	uint64_t skb_len = (uint64_t)skb->len, cap_len = min((uint64_t)TRACE_PAYLOAD_LEN, (uint64_t)skb_len);
+	struct drop_notify_bucket *bucket;
+	__u32 key = (-reason) & 0xff;
+	__u64 now, tat;
+
+	bucket = map_lookup_elem(&DROP_NOTIFY_RATE_MAP, &key);
+	if (!bucket)
+		return true;
+
+	now = ktime_get_ns();
+	tat = bucket->tat > now ? bucket->tat : now;
+	tat += DROP_NOTIFY_INTERVAL_NS;
+	if (tat - now > DROP_NOTIFY_BURST_NS) {
+		bucket->suppressed++;
+		return false;
+	}
+
+	bucket->tat = tat;
+	return true;
+}
+#else
+static __always_inline int drop_notify_allowed(int reason)
+{
+	return true;
+}
+#endif /* DROP_NOTIFY_RATE && DROP_NOTIFY_RATE_MAP */
+
+static __always_inline void
+drop_notify_emit(struct __sk_buff *skb, __u32 src, __u32 dst, __u32 dst_id,
+		 int error)
+{
+	uint64_t skb_len = (uint64_t)skb->len, cap_len;
 	uint32_t hash = get_hash_recalc(skb);
+
+	if (error < 0)
+		error = -error;
+
+	cap_len = event_capture_len(CAPTURE_LEN_DROP, error, TRACE_PAYLOAD_LEN);
+	cap_len = min(cap_len, skb_len);
+
 	struct drop_notify msg = {
 		.type = CILIUM_NOTIFY_DROP,
+		.subtype = error,
 		.source = EVENT_SOURCE,
 		.hash = hash,
 		.len_orig = skb_len,
 		.len_cap = cap_len,
-		.src_label = skb->cb[0],
-		.dst_label = skb->cb[1],
-		.dst_id = skb->cb[3],
+		.src_label = src,
+		.dst_label = dst,
+		.dst_id = dst_id,
 		.unused = 0,
 	};
-	// mask needed to calm verifier
-	int error = skb->cb[2] & 0xFFFFFFFF;
 
-	if (error < 0)
-		error = -error;
+	skb_event_emit(skb, &msg, sizeof(msg), cap_len);
+}
 
-	msg.subtype = error;
+#ifdef HAVE_TAIL_CALL_SUBPROG
+static __noinline int __send_drop_notify(struct __sk_buff *skb, __u32 src,
+					 __u32 dst, __u32 dst_id, int reason)
+{
+	drop_notify_emit(skb, src, dst, dst_id, reason);
+	return 0;
+}
+#else
+__section_tail(CILIUM_MAP_CALLS, CILIUM_CALL_DROP_NOTIFY) int __send_drop_notify(struct __sk_buff *skb)
+{
+	// mask needed to calm verifier
+	int error = skb->cb[2] & 0xFFFFFFFF;
 
-	skb_event_output(skb, &EVENTS_MAP,
-			 (cap_len << 32) | BPF_F_CURRENT_CPU,
-			 &msg, sizeof(msg));
+	drop_notify_emit(skb, skb->cb[0], skb->cb[1], skb->cb[3], error);
 
 	return skb->cb[4];
 }
+#endif /* HAVE_TAIL_CALL_SUBPROG */
 
 /**
  * send_drop_notify
@@ -92,15 +184,23 @@ __section_tail(CILIUM_MAP_CALLS, CILIUM_CALL_DROP_NOTIFY) int __send_drop_notify
 static inline int send_drop_notify(struct __sk_buff *skb, __u32 src, __u32 dst,
 				   __u32 dst_id, int reason, int exitcode, __u8 direction)
 {
+	update_metrics(skb->len, direction, -reason);
+	flow_summary_update(skb, src, dst, FLOW_VERDICT_DROPPED, -reason);
+
+	if (!drop_notify_allowed(reason))
+		return exitcode;
+
+#ifdef HAVE_TAIL_CALL_SUBPROG
+	__send_drop_notify(skb, src, dst, dst_id, reason);
+#else
 	skb->cb[0] = src;
 	skb->cb[1] = dst;
 	skb->cb[2] = reason;
 	skb->cb[3] = dst_id;
 	skb->cb[4] = exitcode;
 
-	update_metrics(skb->len, direction, -reason);
-
 	ep_tail_call(skb, CILIUM_CALL_DROP_NOTIFY);
+#endif
 
 	return exitcode;
 }
@@ -111,6 +211,7 @@ static inline int send_drop_notify(struct __sk_buff *skb, __u32 src, __u32 dst,
 				   __u32 dst_id, int reason, int exitcode, __u8 direction)
 {
 	update_metrics(skb->len, direction, -reason);
+	flow_summary_update(skb, src, dst, FLOW_VERDICT_DROPPED, -reason);
 	return exitcode;
 }
 
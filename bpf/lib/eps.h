@@ -23,6 +23,34 @@
 
 #include "maps.h"
 
+#ifdef ENABLE_ENDPOINT_TABLE
+/* The endpoint table splits ENDPOINTS_MAP into a slim hash per address family
+ * mapping the address to the endpoint ID, and a dense array indexed by the
+ * endpoint ID. Both are maintained by the agent next to ENDPOINTS_MAP, the
+ * table entry is written before the address is inserted. */
+static __always_inline struct endpoint_info *
+__lookup_endpoint_id(__u32 *lxc_id)
+{
+	if (lxc_id == NULL)
+		return NULL;
+
+	return map_lookup_elem(&ENDPOINTS_TABLE_MAP, lxc_id);
+}
+
+static __always_inline struct endpoint_info *
+lookup_ip6_endpoint(struct ipv6hdr *ip6)
+{
+	union v6addr *addr = (union v6addr *) &ip6->daddr;
+
+	return __lookup_endpoint_id(map_lookup_elem(&ENDPOINTS6_ID_MAP, addr));
+}
+
+static __always_inline struct endpoint_info *
+__lookup_ip4_endpoint(uint32_t ip)
+{
+	return __lookup_endpoint_id(map_lookup_elem(&ENDPOINTS4_ID_MAP, &ip));
+}
+#else
 static __always_inline struct endpoint_info *
 lookup_ip6_endpoint(struct ipv6hdr *ip6)
 {
@@ -44,6 +72,7 @@ __lookup_ip4_endpoint(uint32_t ip)
 
 	return map_lookup_elem(&ENDPOINTS_MAP, &key);
 }
+#endif /* ENABLE_ENDPOINT_TABLE */
 
 static __always_inline struct endpoint_info *
 lookup_ip4_endpoint(struct iphdr *ip4)
@@ -72,6 +101,18 @@ lookup_ip4_endpoint_policy_map(uint32_t ip)
 
 #define V6_CACHE_KEY_LEN (sizeof(union v6addr)*8)
 
+#ifdef ENABLE_SPLIT_IPCACHE
+static __always_inline struct remote_endpoint_info *
+ipcache_lookup6(struct bpf_elf_map *map, union v6addr *addr, __u32 prefix)
+{
+	struct ipcache6_key key = {
+		.lpm_key = { prefix },
+		.ip6 = *addr,
+	};
+	ipv6_addr_clear_suffix(&key.ip6, prefix);
+	return map_lookup_elem(map, &key);
+}
+#else
 static __always_inline struct remote_endpoint_info *
 ipcache_lookup6(struct bpf_elf_map *map, union v6addr *addr, __u32 prefix)
 {
@@ -83,9 +124,22 @@ ipcache_lookup6(struct bpf_elf_map *map, union v6addr *addr, __u32 prefix)
 	ipv6_addr_clear_suffix(&key.ip6, prefix);
 	return map_lookup_elem(map, &key);
 }
+#endif /* ENABLE_SPLIT_IPCACHE */
 
 #define V4_CACHE_KEY_LEN (sizeof(__u32)*8)
 
+#ifdef ENABLE_SPLIT_IPCACHE
+static __always_inline struct remote_endpoint_info *
+ipcache_lookup4(struct bpf_elf_map *map, __be32 addr, __u32 prefix)
+{
+	struct ipcache4_key key = {
+		.lpm_key = { prefix },
+		.ip4 = addr,
+	};
+	key.ip4 &= GET_PREFIX(prefix);
+	return map_lookup_elem(map, &key);
+}
+#else
 static __always_inline struct remote_endpoint_info *
 ipcache_lookup4(struct bpf_elf_map *map, __be32 addr, __u32 prefix)
 {
@@ -97,8 +151,52 @@ ipcache_lookup4(struct bpf_elf_map *map, __be32 addr, __u32 prefix)
 	key.ip4 &= GET_PREFIX(prefix);
 	return map_lookup_elem(map, &key);
 }
+#endif /* ENABLE_SPLIT_IPCACHE */
 
 #ifndef HAVE_LPM_MAP_TYPE
+#ifdef ENABLE_IPCACHE_PREFIXES_MAP
+/* Define a function with the following NAME which iterates through the
+ * COUNT prefix lengths stored in the PREFIXES array of IPCACHE_PREFIXES_MAP
+ * (ordered from high to low, at most MAX), performing a lookup in MAP using
+ * LOOKUP_FN to find a provided IP of type IPTYPE. The agent keeps the active
+ * slot in sync with the prefix lengths present in the ipcache, so absent
+ * prefix lengths are never probed and prefix length changes do not require
+ * the programs to be recompiled. */
+#define LPM_LOOKUP_FN(NAME, IPTYPE, MAX, COUNT, PREFIXES, MAP, LOOKUP_FN) \
+static __always_inline struct remote_endpoint_info *NAME(IPTYPE addr) \
+{									\
+	struct remote_endpoint_info *info;				\
+	struct ipcache_prefixes_info *info_cfg;				\
+	struct ipcache_prefixes *cfg;					\
+	volatile __u32 active;						\
+	__u32 key = 0;							\
+	int i;								\
+									\
+	info_cfg = map_lookup_elem(&IPCACHE_PREFIXES_MAP, &key);	\
+	if (info_cfg == NULL)						\
+		return NULL;						\
+	active = info_cfg->active;					\
+	cfg = &info_cfg->slots[active & 1];				\
+									\
+_Pragma("unroll")							\
+	for (i = 0; i < MAX; i++) {					\
+		if (i >= cfg->COUNT)					\
+			break;						\
+		info = LOOKUP_FN(&MAP, addr, cfg->PREFIXES[i]);		\
+		if (info != NULL)					\
+			return info;					\
+	}								\
+									\
+	return NULL;							\
+}
+LPM_LOOKUP_FN(__lookup_ip6_remote_endpoint, union v6addr *,
+	      IPCACHE6_MAX_PREFIXES, count6, prefixes6,
+	      IPCACHE6_LOOKUP_MAP, ipcache_lookup6)
+LPM_LOOKUP_FN(__lookup_ip4_remote_endpoint, __be32,
+	      IPCACHE4_MAX_PREFIXES, count4, prefixes4,
+	      IPCACHE4_LOOKUP_MAP, ipcache_lookup4)
+#undef LPM_LOOKUP_FN
+#else /* ENABLE_IPCACHE_PREFIXES_MAP */
 /* Define a function with the following NAME which iterates through PREFIXES
  * (a list of integers ordered from high to low representing prefix length),
  * performing a lookup in MAP using LOOKUP_FN to find a provided IP of type
@@ -121,21 +219,155 @@ _Pragma("unroll")							\
 	return NULL;							\
 }
 #ifdef IPCACHE6_PREFIXES
-LPM_LOOKUP_FN(lookup_ip6_remote_endpoint, union v6addr *, IPCACHE6_PREFIXES,
-	      IPCACHE_MAP, ipcache_lookup6)
+LPM_LOOKUP_FN(__lookup_ip6_remote_endpoint, union v6addr *, IPCACHE6_PREFIXES,
+	      IPCACHE6_LOOKUP_MAP, ipcache_lookup6)
 #endif
 #ifdef IPCACHE4_PREFIXES
-LPM_LOOKUP_FN(lookup_ip4_remote_endpoint, __be32, IPCACHE4_PREFIXES,
-	      IPCACHE_MAP, ipcache_lookup4)
+LPM_LOOKUP_FN(__lookup_ip4_remote_endpoint, __be32, IPCACHE4_PREFIXES,
+	      IPCACHE4_LOOKUP_MAP, ipcache_lookup4)
 #endif
 #undef LPM_LOOKUP_FN
+#endif /* ENABLE_IPCACHE_PREFIXES_MAP */
 #else /* HAVE_LPM_MAP_TYPE */
-#define lookup_ip6_remote_endpoint(addr) \
-	ipcache_lookup6(&IPCACHE_MAP, addr, V6_CACHE_KEY_LEN)
-#define lookup_ip4_remote_endpoint(addr) \
-	ipcache_lookup4(&IPCACHE_MAP, addr, V4_CACHE_KEY_LEN)
+#define __lookup_ip6_remote_endpoint(addr) \
+	ipcache_lookup6(&IPCACHE6_LOOKUP_MAP, addr, V6_CACHE_KEY_LEN)
+#define __lookup_ip4_remote_endpoint(addr) \
+	ipcache_lookup4(&IPCACHE4_LOOKUP_MAP, addr, V4_CACHE_KEY_LEN)
 #endif /* HAVE_LPM_MAP_TYPE */
 
+#ifdef ENABLE_IPCACHE_FRONT_CACHE
+/* The front cache is a per-CPU direct-mapped array in front of the ipcache
+ * lookups above. Each slot records the generation found in
+ * IPCACHE_FRONT_GEN_MAP before the ipcache lookup which filled it. The agent
+ * bumps the generation after every ipcache update, which invalidates all
+ * slots at once; a slot filled concurrently with an update therefore never
+ * outlives it. Failed lookups are cached as well since they are the most
+ * expensive ones without LPM support.
+ *
+ * A hit is copied to the caller provided @buf rather than returned as a
+ * pointer into the slot, which a later lookup colliding on the same slot
+ * would overwrite while the caller still uses it.
+ */
+static __always_inline __u32 ipcache_front_slot(__u32 hash)
+{
+	/* Multiplicative hashing, IPCACHE_FRONT_MAP_SIZE must be a power of
+	 * two no larger than 65536. */
+	return ((hash * 2654435761U) >> 16) & (IPCACHE_FRONT_MAP_SIZE - 1);
+}
+
+static __always_inline void ipcache_front_account(bool hit)
+{
+	struct ipcache_front_stats *stats;
+	__u32 key = 0;
+
+	stats = map_lookup_elem(&IPCACHE_FRONT_STATS_MAP, &key);
+	if (stats) {
+		/* Per-CPU, no atomic operations needed */
+		if (hit)
+			stats->hits++;
+		else
+			stats->misses++;
+	}
+}
+
+static __always_inline void
+ipcache_front_fill(struct ipcache_front_entry *entry, __u32 generation,
+		   __u8 family, struct remote_endpoint_info *info)
+{
+	entry->generation = generation;
+	entry->family = family;
+	if (info) {
+		entry->info = *info;
+		entry->negative = 0;
+	} else {
+		entry->negative = 1;
+	}
+}
+
+#if defined HAVE_LPM_MAP_TYPE || defined ENABLE_IPCACHE_PREFIXES_MAP || \
+    defined IPCACHE6_PREFIXES
+static __always_inline struct remote_endpoint_info *
+lookup_ip6_remote_endpoint(union v6addr *addr, struct remote_endpoint_info *buf)
+{
+	struct remote_endpoint_info *info;
+	struct ipcache_front_entry *entry;
+	__u32 key = 0, generation, *gen;
+
+	gen = map_lookup_elem(&IPCACHE_FRONT_GEN_MAP, &key);
+	if (!gen)
+		return __lookup_ip6_remote_endpoint(addr);
+	generation = *gen;
+
+	key = ipcache_front_slot(addr->p1 ^ addr->p2 ^ addr->p3 ^ addr->p4);
+	entry = map_lookup_elem(&IPCACHE_FRONT_MAP, &key);
+	if (!entry)
+		return __lookup_ip6_remote_endpoint(addr);
+
+	if (entry->generation == generation &&
+	    entry->family == ENDPOINT_KEY_IPV6 &&
+	    !ipv6_addrcmp(&entry->addr, addr)) {
+		ipcache_front_account(true);
+		if (entry->negative)
+			return NULL;
+		*buf = entry->info;
+		return buf;
+	}
+
+	info = __lookup_ip6_remote_endpoint(addr);
+	ipcache_front_account(false);
+	ipv6_addr_copy(&entry->addr, addr);
+	ipcache_front_fill(entry, generation, ENDPOINT_KEY_IPV6, info);
+
+	return info;
+}
+#endif
+
+#if defined HAVE_LPM_MAP_TYPE || defined ENABLE_IPCACHE_PREFIXES_MAP || \
+    defined IPCACHE4_PREFIXES
+static __always_inline struct remote_endpoint_info *
+lookup_ip4_remote_endpoint(__be32 addr, struct remote_endpoint_info *buf)
+{
+	struct remote_endpoint_info *info;
+	struct ipcache_front_entry *entry;
+	__u32 key = 0, generation, *gen;
+
+	gen = map_lookup_elem(&IPCACHE_FRONT_GEN_MAP, &key);
+	if (!gen)
+		return __lookup_ip4_remote_endpoint(addr);
+	generation = *gen;
+
+	key = ipcache_front_slot(addr);
+	entry = map_lookup_elem(&IPCACHE_FRONT_MAP, &key);
+	if (!entry)
+		return __lookup_ip4_remote_endpoint(addr);
+
+	if (entry->generation == generation &&
+	    entry->family == ENDPOINT_KEY_IPV4 &&
+	    entry->addr.p1 == addr) {
+		ipcache_front_account(true);
+		if (entry->negative)
+			return NULL;
+		*buf = entry->info;
+		return buf;
+	}
+
+	info = __lookup_ip4_remote_endpoint(addr);
+	ipcache_front_account(false);
+	entry->addr.p1 = addr;
+	ipcache_front_fill(entry, generation, ENDPOINT_KEY_IPV4, info);
+
+	return info;
+}
+#endif
+#else /* ENABLE_IPCACHE_FRONT_CACHE */
+/* Without the front cache, entries are returned directly from the ipcache
+ * and @buf is unused. */
+#define lookup_ip6_remote_endpoint(addr, buf) \
+	((void) (buf), __lookup_ip6_remote_endpoint(addr))
+#define lookup_ip4_remote_endpoint(addr, buf) \
+	((void) (buf), __lookup_ip4_remote_endpoint(addr))
+#endif /* ENABLE_IPCACHE_FRONT_CACHE */
+
 enum ep_cfg_flag {
 	EP_F_SKIP_POLICY_INGRESS = 1<<0,
 	EP_F_SKIP_POLICY_EGRESS = 1<<1,
@@ -20,6 +20,60 @@
 
 #include <bpf/api.h>
 
+#include "common.h"
+
+#if defined HAVE_RINGBUF_MAP_TYPE && defined EVENTS_RINGBUF_MAP
+# define ENABLE_EVENTS_RINGBUF
+#endif
+
+#ifdef ENABLE_EVENTS_RINGBUF
+/* The BPF ring buffer (Linux 5.8) postdates the UAPI headers of this tree,
+ * its map type and helpers are referenced by value.
+ */
+#define EVENTS_MAP_TYPE_RINGBUF		27
+
+#define EVENTS_RB_NO_WAKEUP		(1ULL << 0)
+#define EVENTS_RB_FORCE_WAKEUP		(1ULL << 1)
+#define EVENTS_RB_AVAIL_DATA		0
+
+static void *(*ringbuf_reserve)(void *map, __u64 size, __u64 flags) __maybe_unused = (void *) 131;
+static void (*ringbuf_submit)(void *data, __u64 flags) __maybe_unused = (void *) 132;
+static __u64 (*ringbuf_query)(void *map, __u64 flags) __maybe_unused = (void *) 134;
+
+#ifndef EVENTS_RINGBUF_SIZE
+# define EVENTS_RINGBUF_SIZE		(1 << 20)
+#endif
+
+/* Userspace is only woken up once this many bytes are pending, it polls
+ * with a timeout to pick up the remainder. */
+#ifndef EVENTS_RINGBUF_WAKEUP_BYTES
+# define EVENTS_RINGBUF_WAKEUP_BYTES	(EVENTS_RINGBUF_SIZE / 16)
+#endif
+
+struct bpf_elf_map __section_maps EVENTS_RINGBUF_MAP = {
+	.type		= EVENTS_MAP_TYPE_RINGBUF,
+	.size_key	= 0,
+	.size_value	= 0,
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= EVENTS_RINGBUF_SIZE,
+};
+
+/* Events which could not be reserved, indexed by 0. */
+struct bpf_elf_map __section_maps EVENTS_RINGBUF_LOST_MAP = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(__u64),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+/* Header of every ring buffer record. The record is sized for the largest
+ * capture, len holds the length of the event following the header. */
+struct event_ringbuf_hdr {
+	__u32		len;
+	__u32		cpu;
+};
+#else
 struct bpf_elf_map __section_maps EVENTS_MAP = {
 	.type		= BPF_MAP_TYPE_PERF_EVENT_ARRAY,
 	.size_key	= sizeof(__u32),
@@ -27,5 +81,155 @@ struct bpf_elf_map __section_maps EVENTS_MAP = {
 	.pinning	= PIN_GLOBAL_NS,
 	.max_elem	= __NR_CPUS__,
 };
+#endif /* ENABLE_EVENTS_RINGBUF */
+
+/* Length of the largest notification followed by packet data, struct
+ * trace_notify and struct drop_notify. */
+#define CAPTURE_NOTIFY_MAX_LEN	32
+
+/* The size of a perf sample is a u16 in struct perf_event_header, which also
+ * covers that header, the u32 size of the raw data, the alignment of the
+ * raw data to 8 bytes and the notification. Must be in sync with MaxLen in
+ * pkg/maps/capturemap. */
+#define CAPTURE_LEN_PERF_MAX	(((0xffff - 8) & ~7) - 4 - CAPTURE_NOTIFY_MAX_LEN)
+
+/* The size of a ring buffer reservation must be constant. Captures are
+ * rounded up to one of three record sizes, so that full frame captures such
+ * as DNS traces do not take up a record of the largest size: up to
+ * TRACE_PAYLOAD_LEN, up to a frame of the MTU plus the Ethernet header and a
+ * VLAN tag, and up to the largest capture. */
+#ifdef MTU
+# define CAPTURE_LEN_RINGBUF_FRAME	(MTU + 18)
+#else
+# define CAPTURE_LEN_RINGBUF_FRAME	1518
+#endif
+
+/* Ring buffer records are not limited by a header field */
+#define CAPTURE_LEN_RINGBUF_MAX	0xffff
+
+#ifdef ENABLE_EVENTS_RINGBUF
+# define CAPTURE_LEN_LIMIT	CAPTURE_LEN_RINGBUF_MAX
+#else
+# define CAPTURE_LEN_LIMIT	CAPTURE_LEN_PERF_MAX
+#endif
+
+/* Notification types of the capture length table */
+enum {
+	CAPTURE_LEN_TRACE,	/* indexed by observation point */
+	CAPTURE_LEN_DROP,	/* indexed by drop reason */
+	CAPTURE_LEN_MAX,
+};
+
+#ifdef CAPTURE_LEN_MAP
+/* Capture length of a notification type and subtype, written by the agent.
+ * Entries without CAPTURE_LEN_F_SET keep the default capture length. */
+#define CAPTURE_LEN_F_SET	1
+
+struct capture_len {
+	__u16		len;
+	__u8		flags;
+	__u8		pad;
+};
+
+struct bpf_elf_map __section_maps CAPTURE_LEN_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct capture_len),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CAPTURE_LEN_MAX << 8,
+};
+
+/**
+ * event_capture_len
+ * @type:	CAPTURE_LEN_*
+ * @subtype:	observation point or drop reason
+ * @cap_len:	default capture length
+ *
+ * Returns the configured capture length of the notification, 0 meaning
+ * header only, or @cap_len if none is configured. The result is limited to
+ * what the event transport can carry.
+ */
+static __always_inline __u64 event_capture_len(__u32 type, __u8 subtype,
+					       __u64 cap_len)
+{
+	__u32 key = (type << 8) | subtype;
+	struct capture_len *entry;
+
+	entry = map_lookup_elem(&CAPTURE_LEN_MAP, &key);
+	if (entry && (entry->flags & CAPTURE_LEN_F_SET))
+		cap_len = entry->len;
+
+	return cap_len > CAPTURE_LEN_LIMIT ? CAPTURE_LEN_LIMIT : cap_len;
+}
+#else
+static __always_inline __u64 event_capture_len(__u32 type, __u8 subtype,
+					       __u64 cap_len)
+{
+	return cap_len > CAPTURE_LEN_LIMIT ? CAPTURE_LEN_LIMIT : cap_len;
+}
+#endif /* CAPTURE_LEN_MAP */
+
+/**
+ * skb_event_emit
+ * @skb:	socket buffer
+ * @msg:	event message
+ * @msg_len:	length of the message, must be a constant
+ * @cap_len:	number of bytes of the packet to append to the message
+ *
+ * Emit an event to userspace, either through the per-CPU perf event array
+ * or the shared ring buffer. At most CAPTURE_LEN_LIMIT bytes of the packet
+ * are captured.
+ */
+static __always_inline void skb_event_emit(struct __sk_buff *skb,
+					   const void *msg, const __u32 msg_len,
+					   __u64 cap_len)
+{
+#ifdef ENABLE_EVENTS_RINGBUF
+	struct event_ringbuf_hdr *hdr;
+	__u64 flags = EVENTS_RB_NO_WAKEUP;
+	__u32 zero = 0;
+	__u64 *lost;
+
+	if (cap_len <= TRACE_PAYLOAD_LEN) {
+		hdr = ringbuf_reserve(&EVENTS_RINGBUF_MAP, sizeof(*hdr) +
+				      msg_len + TRACE_PAYLOAD_LEN, 0);
+	} else if (cap_len <= CAPTURE_LEN_RINGBUF_FRAME) {
+		hdr = ringbuf_reserve(&EVENTS_RINGBUF_MAP, sizeof(*hdr) +
+				      msg_len + CAPTURE_LEN_RINGBUF_FRAME, 0);
+	} else {
+		if (cap_len > CAPTURE_LEN_RINGBUF_MAX)
+			cap_len = CAPTURE_LEN_RINGBUF_MAX;
+		hdr = ringbuf_reserve(&EVENTS_RINGBUF_MAP, sizeof(*hdr) +
+				      msg_len + CAPTURE_LEN_RINGBUF_MAX, 0);
+	}
+	if (hdr == NULL) {
+		lost = map_lookup_elem(&EVENTS_RINGBUF_LOST_MAP, &zero);
+		if (lost)
+			(*lost)++;
+		return;
+	}
+
+	if (cap_len > skb->len)
+		cap_len = skb->len;
+
+	hdr->len = msg_len + cap_len;
+	hdr->cpu = get_smp_processor_id();
+	__builtin_memcpy((void *)(hdr + 1), msg, msg_len);
+	if (cap_len)
+		skb_load_bytes(skb, 0, (void *)(hdr + 1) + msg_len, cap_len);
+
+	/* Batch wakeups unless enough data is pending. */
+	if (ringbuf_query(&EVENTS_RINGBUF_MAP, EVENTS_RB_AVAIL_DATA) >=
+	    EVENTS_RINGBUF_WAKEUP_BYTES)
+		flags = EVENTS_RB_FORCE_WAKEUP;
+
+	ringbuf_submit(hdr, flags);
+#else
+	if (cap_len > CAPTURE_LEN_PERF_MAX)
+		cap_len = CAPTURE_LEN_PERF_MAX;
+	skb_event_output(skb, &EVENTS_MAP, (cap_len << 32) | BPF_F_CURRENT_CPU,
+			 (void *)msg, msg_len);
+#endif /* ENABLE_EVENTS_RINGBUF */
+}
 
 #endif
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (C) 2019 Authors of Cilium
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/*
+ * In-kernel flow summaries
+ *
+ * API:
+ * void flow_summary_update(skb, src, dst, verdict, obs_point)
+ *
+ * If ENABLE_FLOW_SUMMARY is defined, packets passing a trace or drop
+ * notification point are accounted in FLOW_SUMMARY_MAP, an LRU map keyed
+ * by the 5-tuple and the security identities of the flow. The agent scrapes
+ * the map periodically instead of reconstructing flows from per packet
+ * notifications. Otherwise the API is compiled in as a NOP.
+ *
+ * The observation point is not part of the key, a packet passing several
+ * TRACE_TO_* points on the node is accounted at each of them.
+ */
+
+#ifndef __LIB_FLOW__
+#define __LIB_FLOW__
+
+#include <linux/ip.h>
+
+#include "common.h"
+
+/* Verdict of a flow summary, the last one seen wins. */
+enum {
+	FLOW_VERDICT_FORWARDED = 1,
+	FLOW_VERDICT_DROPPED = 2,
+};
+
+#if defined ENABLE_FLOW_SUMMARY && defined FLOW_SUMMARY_MAP && defined HAVE_LRU_MAP_TYPE
+
+#ifndef FLOW_SUMMARY_MAP_SIZE
+#define FLOW_SUMMARY_MAP_SIZE 65536
+#endif
+
+/* IPv4 addresses are stored in the first word of the address. */
+struct flow_key {
+	union v6addr	saddr;
+	union v6addr	daddr;
+	__be16		sport;
+	__be16		dport;
+	__u8		nexthdr;
+	__u8		family;
+	__u16		pad;
+	__u32		src_label;
+	__u32		dst_label;
+};
+
+struct flow_value {
+	__u64		packets;
+	__u64		bytes;
+	__u64		first_seen;	/* ktime in ns */
+	__u64		last_seen;	/* ktime in ns */
+	__u8		verdict;	/* FLOW_VERDICT_* */
+	__u8		obs_point;	/* TRACE_* if forwarded */
+	__u8		drop_reason;	/* DROP_* if dropped */
+	__u8		pad1;
+	__u32		pad2;
+};
+
+struct bpf_elf_map __section_maps FLOW_SUMMARY_MAP = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct flow_key),
+	.size_value	= sizeof(struct flow_value),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= FLOW_SUMMARY_MAP_SIZE,
+};
+
+/**
+ * flow_key_extract
+ * @skb:	socket buffer
+ * @key:	flow key to fill in
+ *
+ * Fills in the addresses and ports of the packet. The ports are left zero
+ * for non-first fragments and packets with IPv6 extension headers.
+ *
+ * Returns 0 on success or a negative value if the packet is not IP.
+ */
+static __always_inline int flow_key_extract(struct __sk_buff *skb,
+					    struct flow_key *key)
+{
+	int l4_off;
+
+	switch (skb->protocol) {
+	case bpf_htons(ETH_P_IP): {
+		struct iphdr ip4;
+
+		if (skb_load_bytes(skb, ETH_HLEN, &ip4, sizeof(ip4)) < 0)
+			return -1;
+
+		key->family = ENDPOINT_KEY_IPV4;
+		key->saddr.p1 = ip4.saddr;
+		key->daddr.p1 = ip4.daddr;
+		key->nexthdr = ip4.protocol;
+		if (ip4.frag_off & bpf_htons(0x1FFF))
+			return 0;
+		l4_off = ETH_HLEN + ip4.ihl * 4;
+		break;
+	}
+	case bpf_htons(ETH_P_IPV6): {
+		struct ipv6hdr ip6;
+
+		if (skb_load_bytes(skb, ETH_HLEN, &ip6, sizeof(ip6)) < 0)
+			return -1;
+
+		key->family = ENDPOINT_KEY_IPV6;
+		key->saddr = *(union v6addr *) &ip6.saddr;
+		key->daddr = *(union v6addr *) &ip6.daddr;
+		key->nexthdr = ip6.nexthdr;
+		l4_off = ETH_HLEN + sizeof(ip6);
+		break;
+	}
+	default:
+		return -1;
+	}
+
+	switch (key->nexthdr) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+		/* Source and destination port are the first 4 bytes of both */
+		if (skb_load_bytes(skb, l4_off, &key->sport, 4) < 0) {
+			key->sport = 0;
+			key->dport = 0;
+		}
+		break;
+	}
+
+	return 0;
+}
+
+/**
+ * flow_summary_update
+ * @skb:	socket buffer
+ * @src:	source identity
+ * @dst:	destination identity
+ * @verdict:	FLOW_VERDICT_*
+ * @reason:	observation point if forwarded, drop reason if dropped
+ *
+ * Accounts the packet in the summary of its flow.
+ */
+#ifdef HAVE_TAIL_CALL_SUBPROG
+static __noinline int
+#else
+static __always_inline int
+#endif
+flow_summary_update(struct __sk_buff *skb, __u32 src, __u32 dst, __u8 verdict,
+		    __u8 reason)
+{
+	struct flow_key key = {
+		.src_label = src,
+		.dst_label = dst,
+	};
+	struct flow_value *entry;
+	__u64 now;
+
+	if (flow_key_extract(skb, &key) < 0)
+		return 0;
+
+	now = ktime_get_ns();
+	entry = map_lookup_elem(&FLOW_SUMMARY_MAP, &key);
+	if (entry) {
+		__sync_fetch_and_add(&entry->packets, 1);
+		__sync_fetch_and_add(&entry->bytes, skb->len);
+		entry->last_seen = now;
+		entry->verdict = verdict;
+		if (verdict == FLOW_VERDICT_DROPPED)
+			entry->drop_reason = reason;
+		else
+			entry->obs_point = reason;
+	} else {
+		struct flow_value value = {
+			.packets = 1,
+			.bytes = skb->len,
+			.first_seen = now,
+			.last_seen = now,
+			.verdict = verdict,
+		};
+
+		if (verdict == FLOW_VERDICT_DROPPED)
+			value.drop_reason = reason;
+		else
+			value.obs_point = reason;
+
+		/* A concurrent insert of the same flow loses this packet */
+		map_update_elem(&FLOW_SUMMARY_MAP, &key, &value, BPF_NOEXIST);
+	}
+
+	return 0;
+}
+#else
+static inline int flow_summary_update(struct __sk_buff *skb, __u32 src,
+				      __u32 dst, __u8 verdict, __u8 reason)
+{
+	return 0;
+}
+#endif /* ENABLE_FLOW_SUMMARY && FLOW_SUMMARY_MAP && HAVE_LRU_MAP_TYPE */
+
+#endif /* __LIB_FLOW__ */
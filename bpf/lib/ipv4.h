@@ -20,8 +20,35 @@
 
 #include <linux/ip.h>
 
+#include "common.h"
 #include "dbg.h"
 
+#ifndef IP_OFFSET
+#define IP_OFFSET	0x1FFF	/* Fragment offset part of frag_off */
+#endif
+
+/* Tracking fragments relies on LRU eviction to age out datagrams whose
+ * remaining fragments never show up, so it is only enabled when the kernel
+ * provides LRU maps. Without it, non-first fragments carry no L4 ports and
+ * can only match L3 policy.
+ */
+#if defined ENABLE_IPV4_FRAGMENTS && !defined HAVE_LRU_MAP_TYPE
+#undef ENABLE_IPV4_FRAGMENTS
+#endif
+
+#ifdef ENABLE_IPV4_FRAGMENTS
+/* Global map to remember the L4 ports found in the first fragment of a
+ * datagram, so that later fragments can be subject to the same conntrack,
+ * load-balancing and policy decisions. */
+struct bpf_elf_map __section_maps IPV4_FRAG_DATAGRAMS_MAP = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct ipv4_frag_id),
+	.size_value	= sizeof(struct ipv4_frag_l4ports),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CILIUM_IPV4_FRAG_MAP_MAX_ENTRIES,
+};
+#endif
+
 static inline int ipv4_load_daddr(struct __sk_buff *skb, int off, __u32 *dst)
 {
 	return skb_load_bytes(skb, off + offsetof(struct iphdr, daddr), dst, 4);
@@ -60,4 +87,79 @@ static inline bool ipv4_is_fragment(struct iphdr *ip4)
 	return ip4->frag_off & bpf_htons(0xBFFF);
 }
 
+static inline bool ipv4_is_not_first_fragment(struct iphdr *ip4)
+{
+	/* Ignore the "More fragments" bit to catch all fragments but the
+	 * first one, which is the only fragment carrying the L4 header. */
+	return ip4->frag_off & bpf_htons(IP_OFFSET);
+}
+
+/* Reverse of ipv4_is_not_first_fragment() to avoid double negations. */
+static inline bool ipv4_has_l4_header(struct iphdr *ip4)
+{
+	return !ipv4_is_not_first_fragment(ip4);
+}
+
+/**
+ * Load the L4 ports of an IPv4 packet
+ * @arg skb	packet
+ * @arg ip4	pointer to the validated IPv4 header
+ * @arg l4_off	offset to the L4 header
+ * @arg ports	ports in wire order (sport, dport) are stored here
+ * @arg track	remember the ports of a first fragment
+ *
+ * If fragment tracking is enabled, the ports of the first fragment of a
+ * datagram are remembered in IPV4_FRAG_DATAGRAMS_MAP and returned for all
+ * following fragments of the same datagram. A program loading the ports of
+ * a packet more than once only sets @track on one of the calls, so that the
+ * map is updated once per packet.
+ *
+ * Returns 0 on success, DROP_CT_INVALID_HDR if the ports could not be read
+ * from the packet or DROP_FRAG_NOT_FOUND if a non-first fragment arrived
+ * before the first fragment of its datagram.
+ */
+static inline int __inline__
+ipv4_load_l4_ports(struct __sk_buff *skb, struct iphdr *ip4, int l4_off,
+		   struct ipv4_frag_l4ports *ports, bool track)
+{
+#ifdef ENABLE_IPV4_FRAGMENTS
+	struct ipv4_frag_id frag_id = {
+		.daddr = ip4->daddr,
+		.saddr = ip4->saddr,
+		.id = ip4->id,
+		.proto = ip4->protocol,
+		.pad = 0,
+	};
+	bool is_fragment = ipv4_is_fragment(ip4);
+
+	if (unlikely(is_fragment) && ipv4_is_not_first_fragment(ip4)) {
+		struct ipv4_frag_l4ports *tmp;
+
+		tmp = map_lookup_elem(&IPV4_FRAG_DATAGRAMS_MAP, &frag_id);
+		if (!tmp)
+			return DROP_FRAG_NOT_FOUND;
+
+		/* Copy rather than pointing into the map, the entry may be
+		 * evicted at any time. */
+		ports->sport = tmp->sport;
+		ports->dport = tmp->dport;
+		return 0;
+	}
+#endif
+
+	if (skb_load_bytes(skb, l4_off, ports, sizeof(*ports)) < 0)
+		return DROP_CT_INVALID_HDR;
+
+#ifdef ENABLE_IPV4_FRAGMENTS
+	/* First fragment of the datagram, though not necessarily the first
+	 * one to arrive. A failed update does not prevent us from handling
+	 * this packet, the remaining fragments will be dropped as not found.
+	 */
+	if (unlikely(is_fragment) && track)
+		map_update_elem(&IPV4_FRAG_DATAGRAMS_MAP, &frag_id, ports, BPF_ANY);
+#endif
+
+	return 0;
+}
+
 #endif /* __LIB_IPV4__ */
@@ -28,8 +28,19 @@
 #define IPV6_TCLASS_MASK (IPV6_FLOWINFO_MASK & ~IPV6_FLOWLABEL_MASK)
 #define IPV6_TCLASS_SHIFT       20
 
-/* Number of extension headers that can be skipped */
+/* Tracking fragments relies on LRU eviction to age out datagrams whose
+ * remaining fragments never show up, see lib/ipv4.h. */
+#if defined ENABLE_IPV6_FRAGMENTS && !defined HAVE_LRU_MAP_TYPE
+#undef ENABLE_IPV6_FRAGMENTS
+#endif
+
+/* Number of extension headers that can be skipped. A fragment header takes
+ * one additional slot if fragment tracking is enabled. */
+#ifdef ENABLE_IPV6_FRAGMENTS
+#define IPV6_MAX_HEADERS 5
+#else
 #define IPV6_MAX_HEADERS 4
+#endif
 
 #define NEXTHDR_HOP             0       /* Hop-by-hop option header. */
 #define NEXTHDR_TCP             6       /* TCP segment. */
@@ -48,6 +59,56 @@
 
 #define NEXTHDR_MAX             255
 
+#define IPV6_FRAG_OFFSET	0xFFF8	/* Fragment offset part of frag_off */
+#define IPV6_FRAG_MF		0x0001	/* More fragments flag */
+
+/* See include/net/ipv6.h in the kernel */
+struct ipv6_frag_hdr {
+	__u8	nexthdr;
+	__u8	reserved;
+	__be16	frag_off;
+	__be32	id;
+};
+
+/* Fragmentation state of a packet, filled in by ipv6_hdrlen_frag(). */
+struct ipv6_frag_info {
+	__be32	id;
+	__u8	proto;		/* Next header of the fragment header */
+	__u8	nexthdr;	/* Upper layer protocol */
+	bool	is_fragment;
+	bool	has_l4_header;
+	bool	has_datagram;	/* Non-first fragment, datagram was found */
+	struct ipv6_frag_l4ports ports; /* Ports of the datagram, if found */
+};
+
+#ifdef ENABLE_IPV6_FRAGMENTS
+/* Global map to remember the upper layer protocol and the L4 ports found in
+ * the first fragment of a datagram, so that later fragments can be subject
+ * to the same conntrack, load-balancing and policy decisions. */
+struct bpf_elf_map __section_maps IPV6_FRAG_DATAGRAMS_MAP = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct ipv6_frag_id),
+	.size_value	= sizeof(struct ipv6_frag_datagram),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= CILIUM_IPV6_FRAG_MAP_MAX_ENTRIES,
+};
+
+static inline int __inline__
+ipv6_load_frag_id(struct __sk_buff *skb, int l3_off,
+		  const struct ipv6_frag_info *frag,
+		  struct ipv6_frag_id *frag_id)
+{
+	/* saddr and daddr are adjacent in both headers */
+	if (skb_load_bytes(skb, l3_off + offsetof(struct ipv6hdr, saddr),
+			   &frag_id->saddr, 32) < 0)
+		return DROP_INVALID;
+
+	frag_id->id = frag->id;
+	frag_id->proto = frag->proto;
+	return 0;
+}
+#endif
+
 static inline int ipv6_optlen(struct ipv6_opt_hdr *opthdr)
 {
 	return (opthdr->hdrlen + 1) << 3;
@@ -58,20 +119,93 @@ static inline int ipv6_authlen(struct ipv6_opt_hdr *opthdr)
 	return (opthdr->hdrlen + 2) << 2;
 }
 
-static inline int __inline__ ipv6_hdrlen(struct __sk_buff *skb, int l3_off, __u8 *nexthdr)
+/**
+ * Skip the IPv6 extension header chain
+ * @arg skb	packet
+ * @arg l3_off	offset to the IPv6 header
+ * @arg nexthdr	next header field of the IPv6 header, set to the upper layer
+ *		protocol on return
+ * @arg frag	optional, filled with the fragmentation state of the packet
+ *
+ * Fragments are only accepted if fragment tracking is enabled. For non-first
+ * fragments, parsing stops at the fragment header as everything following
+ * it is payload, the returned length then points to the fragment data. If
+ * @frag is given and the first fragment of the datagram has been seen,
+ * @nexthdr is set to the upper layer protocol it carried.
+ *
+ * Returns the length of the IPv6 header chain or a negative DROP_* reason.
+ */
+static inline int __inline__ ipv6_hdrlen_frag(struct __sk_buff *skb, int l3_off,
+					      __u8 *nexthdr,
+					      struct ipv6_frag_info *frag)
 {
 	int i, len = sizeof(struct ipv6hdr);
 	struct ipv6_opt_hdr opthdr;
 	__u8 nh = *nexthdr;
 
+	if (frag) {
+		frag->id = 0;
+		frag->proto = 0;
+		frag->nexthdr = 0;
+		frag->is_fragment = false;
+		frag->has_l4_header = true;
+		frag->has_datagram = false;
+	}
+
 #pragma unroll
 	for (i = 0; i < IPV6_MAX_HEADERS; i++) {
 		switch (nh) {
 		case NEXTHDR_NONE:
 			return DROP_INVALID_EXTHDR;
 
-		case NEXTHDR_FRAGMENT:
+		case NEXTHDR_FRAGMENT: {
+#ifdef ENABLE_IPV6_FRAGMENTS
+			struct ipv6_frag_hdr fraghdr;
+			bool first;
+
+			if (skb_load_bytes(skb, l3_off + len, &fraghdr, sizeof(fraghdr)) < 0)
+				return DROP_INVALID;
+
+			len += sizeof(fraghdr);
+			nh = fraghdr.nexthdr;
+			first = !(fraghdr.frag_off & bpf_htons(IPV6_FRAG_OFFSET));
+
+			if (frag) {
+				frag->id = fraghdr.id;
+				frag->proto = fraghdr.nexthdr;
+				frag->is_fragment = true;
+				frag->has_l4_header = first;
+			}
+
+			/* Everything after the fragment header of a non-first
+			 * fragment is payload, including extension headers
+			 * preceding the upper layer header in the first
+			 * fragment. */
+			if (!first) {
+				if (frag) {
+					struct ipv6_frag_datagram *dgram;
+					struct ipv6_frag_id frag_id = {};
+
+					if (ipv6_load_frag_id(skb, l3_off, frag, &frag_id) < 0)
+						return DROP_INVALID;
+
+					dgram = map_lookup_elem(&IPV6_FRAG_DATAGRAMS_MAP,
+								&frag_id);
+					if (dgram) {
+						nh = dgram->nexthdr;
+						frag->ports = dgram->ports;
+						frag->has_datagram = true;
+					}
+					frag->nexthdr = nh;
+				}
+				*nexthdr = nh;
+				return len;
+			}
+			break;
+#else
 			return DROP_FRAG_NOSUPPORT;
+#endif
+		}
 
 		case NEXTHDR_HOP:
 		case NEXTHDR_ROUTING:
@@ -88,6 +222,8 @@ static inline int __inline__ ipv6_hdrlen(struct __sk_buff *skb, int l3_off, __u8
 			break;
 
 		default:
+			if (frag)
+				frag->nexthdr = nh;
 			*nexthdr = nh;
 			return len;
 		}
@@ -97,6 +233,68 @@ static inline int __inline__ ipv6_hdrlen(struct __sk_buff *skb, int l3_off, __u8
 	return DROP_INVALID_EXTHDR;
 }
 
+static inline int __inline__ ipv6_hdrlen(struct __sk_buff *skb, int l3_off, __u8 *nexthdr)
+{
+	return ipv6_hdrlen_frag(skb, l3_off, nexthdr, NULL);
+}
+
+/**
+ * Load the L4 ports of an IPv6 packet
+ * @arg skb	packet
+ * @arg l3_off	offset to the IPv6 header
+ * @arg l4_off	offset to the L4 header
+ * @arg frag	fragmentation state as returned by ipv6_hdrlen_frag()
+ * @arg ports	ports in wire order (sport, dport) are stored here
+ * @arg track	remember the ports of a first fragment
+ *
+ * If fragment tracking is enabled, the ports and the upper layer protocol
+ * of the first fragment of a datagram are remembered in
+ * IPV6_FRAG_DATAGRAMS_MAP, ipv6_hdrlen_frag() returns them for all following
+ * fragments of the same datagram. Only one lookup per packet should set
+ * @track so that the map is updated once per first fragment.
+ *
+ * Returns 0 on success, DROP_CT_INVALID_HDR if the ports could not be read
+ * from the packet or DROP_FRAG_NOT_FOUND if a non-first fragment arrived
+ * before the first fragment of its datagram.
+ */
+static inline int __inline__
+ipv6_load_l4_ports(struct __sk_buff *skb, int l3_off, int l4_off,
+		   const struct ipv6_frag_info *frag,
+		   struct ipv6_frag_l4ports *ports, bool track)
+{
+#ifdef ENABLE_IPV6_FRAGMENTS
+	if (unlikely(!frag->has_l4_header)) {
+		if (!frag->has_datagram)
+			return DROP_FRAG_NOT_FOUND;
+
+		ports->sport = frag->ports.sport;
+		ports->dport = frag->ports.dport;
+		return 0;
+	}
+#endif
+
+	if (skb_load_bytes(skb, l4_off, ports, sizeof(*ports)) < 0)
+		return DROP_CT_INVALID_HDR;
+
+#ifdef ENABLE_IPV6_FRAGMENTS
+	if (unlikely(frag->is_fragment && track)) {
+		struct ipv6_frag_datagram dgram = {
+			.ports = *ports,
+			.nexthdr = frag->nexthdr,
+		};
+		struct ipv6_frag_id frag_id = {};
+
+		if (ipv6_load_frag_id(skb, l3_off, frag, &frag_id) < 0)
+			return DROP_INVALID;
+
+		map_update_elem(&IPV6_FRAG_DATAGRAMS_MAP, &frag_id, &dgram,
+				BPF_ANY);
+	}
+#endif
+
+	return 0;
+}
+
 static inline void ipv6_addr_copy(union v6addr *dst, union v6addr *src)
 {
 	dst->p1 = src->p1;
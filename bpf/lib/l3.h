@@ -27,6 +27,7 @@
 #include "l4.h"
 #include "icmp6.h"
 #include "csum.h"
+#include "latency.h"
 
 #ifdef ENABLE_IPV6
 static inline int __inline__ ipv6_l3(struct __sk_buff *skb, int l3_off,
@@ -73,7 +74,8 @@ static inline int __inline__ ipv4_l3(struct __sk_buff *skb, int l3_off,
 #ifdef ENABLE_IPV6
 static inline int ipv6_local_delivery(struct __sk_buff *skb, int l3_off, int l4_off,
 				      __u32 seclabel, struct ipv6hdr *ip6, __u8 nexthdr,
-				      struct endpoint_info *ep, __u8 direction)
+				      struct endpoint_info *ep, __u8 direction,
+				      __u32 latency_prog)
 {
 	int ret;
 
@@ -99,6 +101,9 @@ static inline int ipv6_local_delivery(struct __sk_buff *skb, int l3_off, int l4_
 	 */
 	update_metrics(skb->len, direction, REASON_FORWARDED);
 #endif
+	/* The policy program of the endpoint is not part of the calling
+	 * program, its time must not be accounted to it. */
+	latency_end(latency_prog, 0);
 	tail_call(skb, &POLICY_CALL_MAP, ep->lxc_id);
 	return DROP_MISSED_TAIL_CALL;
 }
@@ -106,7 +111,8 @@ static inline int ipv6_local_delivery(struct __sk_buff *skb, int l3_off, int l4_
 
 static inline int __inline__ ipv4_local_delivery(struct __sk_buff *skb, int l3_off, int l4_off,
 						 __u32 seclabel, struct iphdr *ip4,
-						 struct endpoint_info *ep, __u8 direction)
+						 struct endpoint_info *ep, __u8 direction,
+						 __u32 latency_prog)
 {
 	int ret;
 
@@ -131,6 +137,9 @@ static inline int __inline__ ipv4_local_delivery(struct __sk_buff *skb, int l3_o
 	 */
 	update_metrics(skb->len, direction, REASON_FORWARDED);
 #endif
+	/* The policy program of the endpoint is not part of the calling
+	 * program, its time must not be accounted to it. */
+	latency_end(latency_prog, 0);
 	tail_call(skb, &POLICY_CALL_MAP, ep->lxc_id);
 	return DROP_MISSED_TAIL_CALL;
 }
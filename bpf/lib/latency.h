@@ -0,0 +1,191 @@
+/*
+ *  Copyright (C) 2019 Authors of Cilium
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/*
+ * Datapath latency histograms
+ *
+ * API:
+ * void latency_start(prog)
+ * int latency_end(prog, ret)
+ * __u64 latency_now()
+ * void latency_record(prog, stage, start)
+ *
+ * If ENABLE_LATENCY_HISTOGRAMS is defined, the time spent in each program
+ * from latency_start() to latency_end() and in the stages measured with
+ * latency_now() and latency_record() is accounted in per-CPU log2
+ * histograms in LATENCY_MAP. Otherwise the API is compiled in as a NOP.
+ *
+ * The start of a program is kept per CPU so it can be ended in a tail call
+ * of the program. Before a tail call into another program, such as the
+ * policy program of an endpoint, the calling program must call
+ * latency_end() so that the time spent there is accounted to that program
+ * only.
+ */
+
+#ifndef __LIB_LATENCY__
+#define __LIB_LATENCY__
+
+#include "common.h"
+
+/* Instrumented programs */
+enum {
+	LATENCY_PROG_FROM_LXC,
+	LATENCY_PROG_TO_LXC,
+	LATENCY_PROG_FROM_NETDEV,
+	LATENCY_PROG_FROM_HOST,
+	LATENCY_PROG_FROM_OVERLAY,
+	LATENCY_PROG_MAX,
+};
+
+/* Measured stages of a program */
+enum {
+	LATENCY_STAGE_TOTAL,
+	LATENCY_STAGE_CT,
+	LATENCY_STAGE_LB,
+	LATENCY_STAGE_POLICY,
+	LATENCY_STAGE_MAX,
+};
+
+/* Bucket i counts samples in [2^i, 2^(i+1)) ns, the last one all above. */
+#define LATENCY_BUCKETS 32
+
+#if defined ENABLE_LATENCY_HISTOGRAMS && defined LATENCY_MAP
+
+struct latency_hist {
+	__u64		start;	/* ktime of latency_start(), TOTAL stage only */
+	__u64		buckets[LATENCY_BUCKETS];
+};
+
+struct bpf_elf_map __section_maps LATENCY_MAP = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct latency_hist),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= LATENCY_PROG_MAX * LATENCY_STAGE_MAX,
+};
+
+static __always_inline struct latency_hist *latency_lookup(__u32 prog, __u32 stage)
+{
+	__u32 key = prog * LATENCY_STAGE_MAX + stage;
+
+	return map_lookup_elem(&LATENCY_MAP, &key);
+}
+
+static __always_inline __u32 latency_bucket(__u64 delta)
+{
+	__u32 bucket = 0;
+
+	if (delta >> 32)
+		return LATENCY_BUCKETS - 1;
+	if (delta >> 16) {
+		delta >>= 16;
+		bucket += 16;
+	}
+	if (delta >> 8) {
+		delta >>= 8;
+		bucket += 8;
+	}
+	if (delta >> 4) {
+		delta >>= 4;
+		bucket += 4;
+	}
+	if (delta >> 2) {
+		delta >>= 2;
+		bucket += 2;
+	}
+	if (delta >> 1)
+		bucket += 1;
+
+	return bucket;
+}
+
+static __always_inline void latency_account(struct latency_hist *hist,
+					    __u64 start)
+{
+	__u32 bucket = latency_bucket(ktime_get_ns() - start);
+
+	if (bucket < LATENCY_BUCKETS)
+		hist->buckets[bucket]++;
+}
+
+static __always_inline __u64 latency_now(void)
+{
+	return ktime_get_ns();
+}
+
+/**
+ * latency_record
+ * @prog:	LATENCY_PROG_*
+ * @stage:	LATENCY_STAGE_*
+ * @start:	value of latency_now() at the start of the stage
+ */
+static __always_inline void latency_record(__u32 prog, __u32 stage, __u64 start)
+{
+	struct latency_hist *hist = latency_lookup(prog, stage);
+
+	if (hist)
+		latency_account(hist, start);
+}
+
+static __always_inline void latency_start(__u32 prog)
+{
+	struct latency_hist *hist = latency_lookup(prog, LATENCY_STAGE_TOTAL);
+
+	if (hist)
+		hist->start = ktime_get_ns();
+}
+
+/**
+ * latency_end
+ * @prog:	LATENCY_PROG_*
+ * @ret:	return value of the program
+ *
+ * Accounts the time since latency_start() of the program if not yet
+ * accounted and returns @ret.
+ */
+static __always_inline int latency_end(__u32 prog, int ret)
+{
+	struct latency_hist *hist = latency_lookup(prog, LATENCY_STAGE_TOTAL);
+
+	if (hist && hist->start) {
+		latency_account(hist, hist->start);
+		hist->start = 0;
+	}
+
+	return ret;
+}
+#else
+static inline __u64 latency_now(void)
+{
+	return 0;
+}
+
+static inline void latency_record(__u32 prog, __u32 stage, __u64 start)
+{
+}
+
+static inline void latency_start(__u32 prog)
+{
+}
+
+static inline int latency_end(__u32 prog, int ret)
+{
+	return ret;
+}
+#endif /* ENABLE_LATENCY_HISTOGRAMS && LATENCY_MAP */
+
+#endif /* __LIB_LATENCY__ */
@@ -267,7 +267,8 @@ static inline int __inline__ reverse_map_l4_port(struct __sk_buff *skb, __u8 nex
 static inline int __inline__ __lb6_rev_nat(struct __sk_buff *skb, int l4_off,
 					 struct csum_offset *csum_off,
 					 struct ipv6_ct_tuple *tuple, int flags,
-					 struct lb6_reverse_nat *nat)
+					 struct lb6_reverse_nat *nat,
+					 bool has_l4_header)
 {
 	union v6addr old_saddr;
 	union v6addr tmp;
@@ -277,7 +278,7 @@ static inline int __inline__ __lb6_rev_nat(struct __sk_buff *skb, int l4_off,
 
 	cilium_dbg_lb(skb, DBG_LB6_REVERSE_NAT, nat->address.p4, nat->port);
 
-	if (nat->port) {
+	if (nat->port && has_l4_header) {
 		ret = reverse_map_l4_port(skb, tuple->nexthdr, nat->port, l4_off, csum_off);
 		if (IS_ERR(ret))
 			return ret;
@@ -299,6 +300,9 @@ static inline int __inline__ __lb6_rev_nat(struct __sk_buff *skb, int l4_off,
 	if (IS_ERR(ret))
 		return DROP_WRITE_ERROR;
 
+	if (!has_l4_header)
+		return 0;
+
 	sum = csum_diff(old_saddr.addr, 16, new_saddr, 16, 0);
 	if (csum_l4_replace(skb, l4_off, csum_off, 0, sum, BPF_F_PSEUDO_HDR) < 0)
 		return DROP_CSUM_L4;
@@ -314,10 +318,12 @@ static inline int __inline__ __lb6_rev_nat(struct __sk_buff *skb, int l4_off,
  * @arg index		reverse NAT index
  * @arg tuple		tuple
  * @arg saddr_tuple	If set, tuple address will be updated with new source address
+ * @arg has_l4_header	false for non-first fragments, L4 is left untouched
  */
 static inline int __inline__ lb6_rev_nat(struct __sk_buff *skb, int l4_off,
 					 struct csum_offset *csum_off, __u16 index,
-					 struct ipv6_ct_tuple *tuple, int flags)
+					 struct ipv6_ct_tuple *tuple, int flags,
+					 bool has_l4_header)
 {
 	struct lb6_reverse_nat *nat;
 
@@ -326,13 +332,40 @@ static inline int __inline__ lb6_rev_nat(struct __sk_buff *skb, int l4_off,
 	if (nat == NULL)
 		return 0;
 
-	return __lb6_rev_nat(skb, l4_off, csum_off, tuple, flags, nat);
+	return __lb6_rev_nat(skb, l4_off, csum_off, tuple, flags, nat,
+			     has_l4_header);
+}
+
+/* Like extract_l4_port() but also resolves the destination port of non-first
+ * fragments if fragment tracking is enabled. Expects the IPv6 header at
+ * ETH_HLEN. */
+static inline int __inline__ ipv6_extract_l4_port(struct __sk_buff *skb, __u8 nexthdr,
+						  int l4_off,
+						  const struct ipv6_frag_info *frag,
+						  __be16 *port, bool track)
+{
+#ifdef ENABLE_IPV6_FRAGMENTS
+	if (nexthdr == IPPROTO_TCP || nexthdr == IPPROTO_UDP) {
+		struct ipv6_frag_l4ports ports = {};
+		int ret;
+
+		ret = ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, frag, &ports,
+					 track);
+		if (IS_ERR(ret))
+			return ret;
+
+		*port = ports.dport;
+		return 0;
+	}
+#endif
+	return extract_l4_port(skb, nexthdr, l4_off, port);
 }
 
 /** Extract IPv6 LB key from packet
  * @arg skb		packet
  * @arg tuple		tuple
  * @arg l4_off		Offset to L4 header
+ * @arg frag		Fragmentation state returned by ipv6_hdrlen_frag()
  * @arg key		Pointer to store LB key in
  * @arg csum_off	Pointer to store L4 checksum field offset and flags
  *
@@ -345,7 +378,8 @@ static inline int __inline__ lb6_rev_nat(struct __sk_buff *skb, int l4_off,
  *   - Negative error code
  */
 static inline int __inline__ lb6_extract_key(struct __sk_buff *skb, struct ipv6_ct_tuple *tuple,
-					     int l4_off, struct lb6_key *key,
+					     int l4_off, const struct ipv6_frag_info *frag,
+					     struct lb6_key *key,
 					     struct csum_offset *csum_off, int dir)
 {
 	union v6addr *addr;
@@ -355,7 +389,10 @@ static inline int __inline__ lb6_extract_key(struct __sk_buff *skb, struct ipv6_
 	csum_l4_offset_and_flags(tuple->nexthdr, csum_off);
 
 #ifdef LB_L4
-	return extract_l4_port(skb, tuple->nexthdr, l4_off, &key->dport);
+	/* The conntrack lookup following the service lookup remembers the
+	 * ports of a first fragment. */
+	return ipv6_extract_l4_port(skb, tuple->nexthdr, l4_off, frag,
+				    &key->dport, false);
 #else
 	return 0;
 #endif
@@ -410,10 +447,15 @@ static inline struct lb6_service *lb6_lookup_slave(struct __sk_buff *skb,
 
 static inline int __inline__ lb6_xlate(struct __sk_buff *skb, union v6addr *new_dst, __u8 nexthdr,
 				       int l3_off, int l4_off, struct csum_offset *csum_off,
-				       struct lb6_key *key, struct lb6_service *svc)
+				       struct lb6_key *key, struct lb6_service *svc,
+				       bool has_l4_header)
 {
 	ipv6_store_daddr(skb, new_dst->addr, l3_off);
 
+	/* Only the first fragment of a datagram carries the L4 header */
+	if (!has_l4_header)
+		return TC_ACT_OK;
+
 	if (csum_off) {
 		__be32 sum = csum_diff(key->address.addr, 16, new_dst->addr, 16, 0);
 		if (csum_l4_replace(skb, l4_off, csum_off, 0, sum, BPF_F_PSEUDO_HDR) < 0)
@@ -439,14 +481,16 @@ static inline int __inline__ lb6_xlate(struct __sk_buff *skb, union v6addr *new_
 static inline int __inline__ lb6_local(void *map, struct __sk_buff *skb, int l3_off, int l4_off,
 				       struct csum_offset *csum_off, struct lb6_key *key,
 				       struct ipv6_ct_tuple *tuple, struct lb6_service *svc,
-				       struct ct_state *state)
+				       struct ct_state *state,
+				       const struct ipv6_frag_info *frag)
 {
 	__u32 monitor; // Deliberately ignored; regular CT will determine monitoring.
 	union v6addr *addr;
 	__u8 flags = tuple->flags;
 	int ret;
 
-	ret = ct_lookup6(map, tuple, skb, l4_off, CT_SERVICE, state, &monitor);
+	ret = ct_lookup6(map, tuple, skb, l4_off, frag, CT_SERVICE, state,
+			 &monitor);
 	switch(ret) {
 	case CT_NEW:
 		state->slave = lb6_select_slave(skb, key, svc->count, svc->weight);
@@ -492,7 +536,7 @@ static inline int __inline__ lb6_local(void *map, struct __sk_buff *skb, int l3_
 		state->rev_nat_index = svc->rev_nat_index;
 
 	return lb6_xlate(skb, addr, tuple->nexthdr, l3_off, l4_off,
-			 csum_off, key, svc);
+			 csum_off, key, svc, frag->has_l4_header);
 }
 #endif /* ENABLE_IPV6 */
 
@@ -501,14 +545,14 @@ static inline int __inline__ __lb4_rev_nat(struct __sk_buff *skb, int l3_off, in
 					 struct csum_offset *csum_off,
 					 struct ipv4_ct_tuple *tuple, int flags,
 					 struct lb4_reverse_nat *nat,
-					 struct ct_state *ct_state)
+					 struct ct_state *ct_state, bool has_l4_header)
 {
 	__be32 old_sip, new_sip, sum = 0;
 	int ret;
 
 	cilium_dbg_lb(skb, DBG_LB4_REVERSE_NAT, nat->address, nat->port);
 
-	if (nat->port) {
+	if (nat->port && has_l4_header) {
 		ret = reverse_map_l4_port(skb, tuple->nexthdr, nat->port, l4_off, csum_off);
 		if (IS_ERR(ret))
 			return ret;
@@ -557,7 +601,7 @@ static inline int __inline__ __lb4_rev_nat(struct __sk_buff *skb, int l3_off, in
 	if (l3_csum_replace(skb, l3_off + offsetof(struct iphdr, check), 0, sum, 0) < 0)
 		return DROP_CSUM_L3;
 
-	if (csum_off->offset &&
+	if (csum_off->offset && has_l4_header &&
 	    csum_l4_replace(skb, l4_off, csum_off, 0, sum, BPF_F_PSEUDO_HDR) < 0)
 		return DROP_CSUM_L4;
 
@@ -573,11 +617,13 @@ static inline int __inline__ __lb4_rev_nat(struct __sk_buff *skb, int l3_off, in
  * @arg csum_flags	checksum flags
  * @arg index		reverse NAT index
  * @arg tuple		tuple
+ * @arg has_l4_header	false for non-first fragments, L4 is left untouched
  */
 static inline int __inline__ lb4_rev_nat(struct __sk_buff *skb, int l3_off, int l4_off,
 					 struct csum_offset *csum_off,
 					 struct ct_state *ct_state,
-					 struct ipv4_ct_tuple *tuple, int flags)
+					 struct ipv4_ct_tuple *tuple, int flags,
+					 bool has_l4_header)
 {
 	struct lb4_reverse_nat *nat;
 
@@ -587,7 +633,35 @@ static inline int __inline__ lb4_rev_nat(struct __sk_buff *skb, int l3_off, int
 		return 0;
 
 	return __lb4_rev_nat(skb, l3_off, l4_off, csum_off, tuple, flags, nat,
-			     ct_state);
+			     ct_state, has_l4_header);
+}
+
+/* Like extract_l4_port() but also resolves the destination port of non-first
+ * fragments if fragment tracking is enabled. Expects the IPv4 header at
+ * ETH_HLEN. See ipv4_load_l4_ports() for @track. */
+static inline int __inline__ ipv4_extract_l4_port(struct __sk_buff *skb, __u8 nexthdr,
+						  int l4_off, __be16 *port,
+						  bool track)
+{
+#ifdef ENABLE_IPV4_FRAGMENTS
+	if (nexthdr == IPPROTO_TCP || nexthdr == IPPROTO_UDP) {
+		struct ipv4_frag_l4ports ports = {};
+		void *data, *data_end;
+		struct iphdr *ip4;
+		int ret;
+
+		if (!revalidate_data(skb, &data, &data_end, &ip4))
+			return DROP_INVALID;
+
+		ret = ipv4_load_l4_ports(skb, ip4, l4_off, &ports, track);
+		if (IS_ERR(ret))
+			return ret;
+
+		*port = ports.dport;
+		return 0;
+	}
+#endif
+	return extract_l4_port(skb, nexthdr, l4_off, port);
 }
 
 /** Extract IPv4 LB key from packet
@@ -610,7 +684,10 @@ static inline int __inline__ lb4_extract_key(struct __sk_buff *skb, struct ipv4_
 	csum_l4_offset_and_flags(tuple->nexthdr, csum_off);
 
 #ifdef LB_L4
-	return extract_l4_port(skb, tuple->nexthdr, l4_off, &key->dport);
+	/* The conntrack lookup following the service lookup remembers the
+	 * ports of a first fragment. */
+	return ipv4_extract_l4_port(skb, tuple->nexthdr, l4_off, &key->dport,
+				    false);
 #else
 	return 0;
 #endif
@@ -676,7 +753,7 @@ static inline int __inline__
 lb4_xlate(struct __sk_buff *skb, __be32 *new_daddr, __be32 *new_saddr,
 	  __be32 *old_saddr, __u8 nexthdr, int l3_off, int l4_off,
 	  struct csum_offset *csum_off, struct lb4_key *key,
-	  struct lb4_service *svc)
+	  struct lb4_service *svc, bool has_l4_header)
 {
 	int ret;
 	__be32 sum;
@@ -699,6 +776,10 @@ lb4_xlate(struct __sk_buff *skb, __be32 *new_daddr, __be32 *new_saddr,
 	if (l3_csum_replace(skb, l3_off + offsetof(struct iphdr, check), 0, sum, 0) < 0)
 		return DROP_CSUM_L3;
 
+	/* Only the first fragment of a datagram carries the L4 header */
+	if (!has_l4_header)
+		return TC_ACT_OK;
+
 	if (csum_off->offset) {
 		if (csum_l4_replace(skb, l4_off, csum_off, 0, sum, BPF_F_PSEUDO_HDR) < 0)
 			return DROP_CSUM_L4;
@@ -722,7 +803,8 @@ static inline int __inline__ lb4_local(void *map, struct __sk_buff *skb,
 				       int l3_off, int l4_off,
 				       struct csum_offset *csum_off, struct lb4_key *key,
 				       struct ipv4_ct_tuple *tuple, struct lb4_service *svc,
-				       struct ct_state *state, __be32 saddr)
+				       struct ct_state *state, __be32 saddr,
+				       bool has_l4_header)
 {
 	__u32 monitor; // Deliberately ignored; regular CT will determine monitoring.
 	__be32 new_saddr = 0, new_daddr;
@@ -792,7 +874,7 @@ static inline int __inline__ lb4_local(void *map, struct __sk_buff *skb,
 
 	return lb4_xlate(skb, &new_daddr, &new_saddr, &saddr,
 			 tuple->nexthdr, l3_off, l4_off, csum_off, key,
-			 svc);
+			 svc, has_l4_header);
 }
 #endif /* ENABLE_IPV4 */
 
@@ -73,7 +73,8 @@ static inline int __inline__
 ipv4_redirect_to_host_port(struct __sk_buff *skb, struct csum_offset *csum,
 			  int l4_off, __be16 new_port, __be16 old_port, __be32 old_ip,
 			  struct ipv4_ct_tuple *tuple, __u32 identity,
-			  int forwarding_reason, __u32 monitor)
+			  int forwarding_reason, __u32 monitor,
+			  bool has_l4_header)
 {
 	__be32 host_ip = IPV4_GATEWAY;
 	struct proxy4_tbl_key key = {
@@ -93,7 +94,10 @@ ipv4_redirect_to_host_port(struct __sk_buff *skb, struct csum_offset *csum,
 	send_trace_notify(skb, TRACE_TO_PROXY, SECLABEL, 0, 0, HOST_IFINDEX,
 			  forwarding_reason, monitor);
 
-	if (l4_modify_port(skb, l4_off, TCP_DPORT_OFF, csum,
+	/* Non-first fragments carry no L4 header, the port rewrite in the
+	 * first fragment covers the whole datagram. */
+	if (has_l4_header &&
+	    l4_modify_port(skb, l4_off, TCP_DPORT_OFF, csum,
 			   new_port, old_port) < 0)
 		return DROP_WRITE_ERROR;
 
@@ -103,7 +107,7 @@ ipv4_redirect_to_host_port(struct __sk_buff *skb, struct csum_offset *csum,
 	if (l3_csum_replace(skb, ETH_HLEN + offsetof(struct iphdr, check), old_ip, host_ip, 4) < 0)
 		return DROP_CSUM_L3;
 
-	if (csum->offset &&
+	if (csum->offset && has_l4_header &&
 	    csum_l4_replace(skb, l4_off, csum, old_ip, host_ip, 4 | BPF_F_PSEUDO_HDR) < 0)
 		return DROP_CSUM_L4;
 
@@ -128,7 +132,8 @@ static inline int __inline__
 ipv6_redirect_to_host_port(struct __sk_buff *skb, struct csum_offset *csum,
 			  int l4_off, __be16 new_port, __be16 old_port,
 			  union v6addr old_ip, struct ipv6_ct_tuple *tuple, union v6addr *host_ip,
-			  __u32 identity, int forwarding_reason, __u32 monitor)
+			  __u32 identity, int forwarding_reason, __u32 monitor,
+			  bool has_l4_header)
 {
 	struct proxy6_tbl_key key = {
 		.saddr = tuple->daddr,
@@ -147,13 +152,14 @@ ipv6_redirect_to_host_port(struct __sk_buff *skb, struct csum_offset *csum,
 	send_trace_notify(skb, TRACE_TO_PROXY, SECLABEL, 0, 0, HOST_IFINDEX,
 			  forwarding_reason, monitor);
 
-	if (l4_modify_port(skb, l4_off, TCP_DPORT_OFF, csum, new_port, old_port) < 0)
+	if (has_l4_header &&
+	    l4_modify_port(skb, l4_off, TCP_DPORT_OFF, csum, new_port, old_port) < 0)
 		return DROP_WRITE_ERROR;
 
 	if (ipv6_store_daddr(skb, host_ip->addr, ETH_HLEN) > 0)
 		return DROP_WRITE_ERROR;
 
-	if (csum->offset) {
+	if (csum->offset && has_l4_header) {
 		__be32 sum = csum_diff(old_ip.addr, 16, host_ip->addr, 16, 0);
 
 		if (csum_l4_replace(skb, l4_off, csum, 0, sum, BPF_F_PSEUDO_HDR) < 0)
@@ -33,15 +33,57 @@ struct bpf_elf_map __section_maps ENDPOINTS_MAP = {
 	.flags		= CONDITIONAL_PREALLOC,
 };
 
+#ifdef ENABLE_ENDPOINT_TABLE
+/* Local endpoints indexed by endpoint ID, see lookup_ip4_endpoint() */
+struct bpf_elf_map __section_maps ENDPOINTS_TABLE_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct endpoint_info),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= ENDPOINTS_MAP_SIZE,
+};
+
+/* Map from local endpoint IPv4 address to endpoint ID */
+struct bpf_elf_map __section_maps ENDPOINTS4_ID_MAP = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(__be32),
+	.size_value	= sizeof(__u32),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= ENDPOINTS_MAP_SIZE,
+	.flags		= CONDITIONAL_PREALLOC,
+};
+
+/* Map from local endpoint IPv6 address to endpoint ID */
+struct bpf_elf_map __section_maps ENDPOINTS6_ID_MAP = {
+	.type		= BPF_MAP_TYPE_HASH,
+	.size_key	= sizeof(union v6addr),
+	.size_value	= sizeof(__u32),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= ENDPOINTS_MAP_SIZE,
+	.flags		= CONDITIONAL_PREALLOC,
+};
+#endif /* ENABLE_ENDPOINT_TABLE */
+
 struct bpf_elf_map __section_maps METRICS_MAP = {
-	.type		= BPF_MAP_TYPE_PERCPU_HASH,
-	.size_key	= sizeof(struct metrics_key),
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
 	.size_value	= sizeof(struct metrics_value),
 	.pinning	= PIN_GLOBAL_NS,
 	.max_elem	= METRICS_MAP_SIZE,
-	.flags		= CONDITIONAL_PREALLOC,
 };
 
+#if defined ENABLE_ENDPOINT_DROP_METRICS && defined EP_METRICS_MAP
+/* Per endpoint drop metrics, indexed like METRICS_MAP. Drops are rare
+ * enough for the counters to be shared between CPUs. */
+struct bpf_elf_map __section_maps EP_METRICS_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct metrics_value),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= METRICS_MAP_SIZE,
+};
+#endif
+
 /* Global map to jump into policy enforcement of receiving endpoint */
 struct bpf_elf_map __section_maps POLICY_CALL_MAP = {
 	.type		= BPF_MAP_TYPE_PROG_ARRAY,
@@ -63,6 +105,19 @@ struct bpf_elf_map __section_maps EP_POLICY_MAP = {
 };
 #endif
 
+#ifdef ENABLE_SHARED_POLICY_MAPS
+/* Map to link endpoint id to its policy enforcement map, which is shared by
+ * all endpoints with the same security identity unless the endpoint requires
+ * proxy redirection. */
+struct bpf_elf_map __section_maps EP_SHARED_POLICY_MAP = {
+	.type		= BPF_MAP_TYPE_HASH_OF_MAPS,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(int),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= ENDPOINTS_MAP_SIZE,
+};
+#endif
+
 #ifdef POLICY_MAP
 /* Per-endpoint policy enforcement map */
 struct bpf_elf_map __section_maps POLICY_MAP = {
@@ -179,6 +234,41 @@ struct ipcache_key {
 	};
 } __attribute__((packed));
 
+/* Compact keys of the family specific ipcache maps */
+struct ipcache4_key {
+	struct bpf_lpm_trie_key lpm_key;
+	__u32		ip4;
+} __attribute__((packed));
+
+struct ipcache6_key {
+	struct bpf_lpm_trie_key lpm_key;
+	union v6addr	ip6;
+} __attribute__((packed));
+
+#ifdef ENABLE_SPLIT_IPCACHE
+/* Global IPv4 -> Identity map for applying egress label-based policy */
+struct bpf_elf_map __section_maps IPCACHE4_MAP = {
+	.type		= LPM_MAP_TYPE,
+	.size_key	= sizeof(struct ipcache4_key),
+	.size_value	= sizeof(struct remote_endpoint_info),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= IPCACHE_MAP_SIZE,
+	.flags		= BPF_F_NO_PREALLOC,
+};
+
+/* Global IPv6 -> Identity map for applying egress label-based policy */
+struct bpf_elf_map __section_maps IPCACHE6_MAP = {
+	.type		= LPM_MAP_TYPE,
+	.size_key	= sizeof(struct ipcache6_key),
+	.size_value	= sizeof(struct remote_endpoint_info),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= IPCACHE_MAP_SIZE,
+	.flags		= BPF_F_NO_PREALLOC,
+};
+
+#define IPCACHE4_LOOKUP_MAP IPCACHE4_MAP
+#define IPCACHE6_LOOKUP_MAP IPCACHE6_MAP
+#else
 /* Global IP -> Identity map for applying egress label-based policy */
 struct bpf_elf_map __section_maps IPCACHE_MAP = {
 	.type		= LPM_MAP_TYPE,
@@ -189,6 +279,49 @@ struct bpf_elf_map __section_maps IPCACHE_MAP = {
 	.flags		= BPF_F_NO_PREALLOC,
 };
 
+#define IPCACHE4_LOOKUP_MAP IPCACHE_MAP
+#define IPCACHE6_LOOKUP_MAP IPCACHE_MAP
+#endif /* ENABLE_SPLIT_IPCACHE */
+
+#if !defined HAVE_LPM_MAP_TYPE && defined ENABLE_IPCACHE_PREFIXES_MAP
+/* Prefix lengths to probe in the hash based ipcache */
+struct bpf_elf_map __section_maps IPCACHE_PREFIXES_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct ipcache_prefixes_info),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+#endif
+
+#ifdef ENABLE_IPCACHE_FRONT_CACHE
+/* Per-CPU direct-mapped cache of IPCACHE_MAP lookups */
+struct bpf_elf_map __section_maps IPCACHE_FRONT_MAP = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct ipcache_front_entry),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= IPCACHE_FRONT_MAP_SIZE,
+};
+
+/* Generation of IPCACHE_MAP content, bumped by the agent on every change */
+struct bpf_elf_map __section_maps IPCACHE_FRONT_GEN_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(__u32),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+struct bpf_elf_map __section_maps IPCACHE_FRONT_STATS_MAP = {
+	.type		= BPF_MAP_TYPE_PERCPU_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct ipcache_front_stats),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+#endif /* ENABLE_IPCACHE_FRONT_CACHE */
+
 #ifndef SKIP_CALLS_MAP
 static __always_inline void ep_tail_call(struct __sk_buff *skb, uint32_t index)
 {
@@ -32,31 +32,47 @@
 #include <stdbool.h>
 
 
+/**
+ * metrics_key
+ * @direction:	1: Ingress 2: Egress
+ * @reason:	reason for forwarding or dropping packet.
+ *
+ * Returns the index of the metrics of the reason and direction.
+ */
+static inline __u32 metrics_key(__u8 direction, __u8 reason)
+{
+	return ((__u32)(direction & 0x3) << 8) | reason;
+}
+
 /**
  * update_metrics
  * @direction:	1: Ingress 2: Egress
  * @reason:	reason for forwarding or dropping packet.
             	reason is 0 if packet is being forwarded, else reason
             	is the drop error code.
- * Update the metrics map.
+ * Update the metrics map. With ENABLE_ENDPOINT_DROP_METRICS, drops are
+ * also accounted in the metrics map of the endpoint.
  */
 static inline void update_metrics(__u32 bytes, __u8 direction, __u8 reason)
 {
-    struct metrics_value *entry, newEntry = {};
-    struct metrics_key key = {};
-
-    key.reason = reason;
-    key.dir    = direction;
+	struct metrics_value *entry;
+	__u32 key = metrics_key(direction, reason);
 
+	entry = map_lookup_elem(&METRICS_MAP, &key);
+	if (entry) {
+		entry->count += 1;
+		entry->bytes += (__u64)bytes;
+	}
 
-    if ((entry = map_lookup_elem(&METRICS_MAP, &key))) {
-            entry->count += 1;
-            entry->bytes += (__u64)bytes;
-    } else {
-            newEntry.count = 1;
-            newEntry.bytes = (__u64)bytes;
-            map_update_elem(&METRICS_MAP, &key, &newEntry, 0);
-    }
+#if defined ENABLE_ENDPOINT_DROP_METRICS && defined EP_METRICS_MAP
+	if (reason) {
+		entry = map_lookup_elem(&EP_METRICS_MAP, &key);
+		if (entry) {
+			__sync_fetch_and_add(&entry->count, 1);
+			__sync_fetch_and_add(&entry->bytes, (__u64)bytes);
+		}
+	}
+#endif
 }
 
 #endif /* __LIB_METRICS__ */
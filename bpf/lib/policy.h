@@ -62,6 +62,7 @@ policy_sk_egress(__u32 identity, __u32 ip,  __u16 dport)
 	if (!map)
 		return 0;
 
+	/* Same precedence as __policy_can_access() */
 	policy = map_lookup_elem(map, &key);
 	if (likely(policy)) {
 		/* FIXME: Need byte counter */
@@ -76,6 +77,8 @@ policy_sk_egress(__u32 identity, __u32 ip,  __u16 dport)
 	if (likely(policy)) {
 		/* FIXME: Need byte counter */
 		__sync_fetch_and_add(&policy->packets, 1);
+		if (unlikely(policy->deny))
+			return DROP_POLICY_DENY;
 		return TC_ACT_OK;
 	}
 
@@ -91,16 +94,32 @@ policy_sk_egress(__u32 identity, __u32 ip,  __u16 dport)
 	return DROP_POLICY;
 get_proxy_port:
 	if (likely(policy)) {
+		if (unlikely(policy->deny))
+			return DROP_POLICY_DENY;
 		return policy->proxy_port;
 	}
 	return TC_ACT_OK;
 }
 #else
 
+/* Returns the policy map of the endpoint or NULL if it has not been set up
+ * yet, in which case all traffic subject to policy is dropped. Programs not
+ * attached to an endpoint are always compiled with their own POLICY_MAP. */
+static inline void *get_policy_map(void)
+{
+#if defined ENABLE_SHARED_POLICY_MAPS && defined LXC_ID
+	__u32 endpoint_id = LXC_ID;
+
+	return map_lookup_elem(&EP_SHARED_POLICY_MAP, &endpoint_id);
+#else
+	return &POLICY_MAP;
+#endif
+}
+
 static inline int __inline__
 __policy_can_access(void *map, struct __sk_buff *skb, __u32 identity,
 		    __u16 dport, __u8 proto, size_t cidr_addr_size,
-		    void *cidr_addr, int dir, bool is_fragment)
+		    void *cidr_addr, int dir, bool is_untracked_fragment)
 {
 	struct policy_entry *policy;
 
@@ -112,7 +131,15 @@ __policy_can_access(void *map, struct __sk_buff *skb, __u32 identity,
 		.pad = 0,
 	};
 
-	if (!is_fragment) {
+#ifdef ENABLE_SHARED_POLICY_MAPS
+	if (unlikely(!map))
+		goto no_match;
+#endif
+
+	/* Entries are looked up from the most to the least specific key and
+	 * the first match decides, whether it allows or denies. A deny entry
+	 * can therefore carve out a port or a peer from a broader allow. */
+	if (!is_untracked_fragment) {
 		policy = map_lookup_elem(map, &key);
 		if (likely(policy)) {
 			cilium_dbg3(skb, DBG_L4_CREATE, identity, SECLABEL,
@@ -133,10 +160,12 @@ __policy_can_access(void *map, struct __sk_buff *skb, __u32 identity,
 		/* FIXME: Use per cpu counters */
 		__sync_fetch_and_add(&policy->packets, 1);
 		__sync_fetch_and_add(&policy->bytes, skb->len);
+		if (unlikely(policy->deny))
+			goto deny;
 		return TC_ACT_OK;
 	}
 
-	if (!is_fragment) {
+	if (!is_untracked_fragment) {
 		key.sec_label = 0;
 		key.dport = dport;
 		key.protocol = proto;
@@ -149,14 +178,24 @@ __policy_can_access(void *map, struct __sk_buff *skb, __u32 identity,
 		}
 	}
 
+#ifdef ENABLE_SHARED_POLICY_MAPS
+no_match:
+#endif
 	if (skb->cb[CB_POLICY])
 		goto allow;
 
-	if (is_fragment)
+	if (is_untracked_fragment)
 		return DROP_FRAG_NOSUPPORT;
 	return DROP_POLICY;
+deny:
+	if (skb->cb[CB_POLICY])
+		goto allow;
+
+	return DROP_POLICY_DENY;
 get_proxy_port:
 	if (likely(policy)) {
+		if (unlikely(policy->deny))
+			goto deny;
 		return policy->proxy_port;
 	}
 allow:
@@ -171,6 +210,8 @@ allow:
  * @arg proto		L3 Protocol of this packet
  * @arg cidr_addr_size	Size of the destination CIDR of this packet
  * @arg cidr_addr	Destination CIDR of this packet
+ * @arg is_untracked_fragment	True if packet is a non-first fragment whose
+ *				L4 ports are unknown, only L3 policy applies
  *
  * Returns:
  *   - Positive integer indicating the proxy_port to handle this traffic
@@ -180,13 +221,13 @@ allow:
 static inline int __inline__
 policy_can_access_ingress(struct __sk_buff *skb, __u32 src_identity,
 			  __u16 dport, __u8 proto, size_t cidr_addr_size,
-			  void *cidr_addr, bool is_fragment)
+			  void *cidr_addr, bool is_untracked_fragment)
 {
 	int ret;
 
-	ret = __policy_can_access(&POLICY_MAP, skb, src_identity, dport,
+	ret = __policy_can_access(get_policy_map(), skb, src_identity, dport,
 				      proto, cidr_addr_size, cidr_addr,
-				      CT_INGRESS, is_fragment);
+				      CT_INGRESS, is_untracked_fragment);
 	if (ret >= TC_ACT_OK)
 		return ret;
 
@@ -202,7 +243,7 @@ policy_can_access_ingress(struct __sk_buff *skb, __u32 src_identity,
 static inline int __inline__
 policy_can_egress(struct __sk_buff *skb, __u32 identity, __u16 dport, __u8 proto)
 {
-	int ret = __policy_can_access(&POLICY_MAP, skb, identity, dport, proto,
+	int ret = __policy_can_access(get_policy_map(), skb, identity, dport, proto,
 				      0, NULL, CT_EGRESS, false);
 	if (ret >= 0)
 		return ret;
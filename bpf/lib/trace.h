@@ -22,6 +22,13 @@
  * void send_trace_notify(skb, obs_point, src, dst, dst_id, ifindex, reason, monitor)
  *
  * If TRACE_NOTIFY is not defined, the API will be compiled in as a NOP.
+ *
+ * Packets leaving at a TRACE_TO_* observation point are accounted in the
+ * flow summaries regardless of notifications, see <lib/flow.h>.
+ *
+ * Notifications can be sampled at runtime by writing the binary logarithm
+ * of the sampling rate into TRACE_CONFIG_MAP. Each sampled notification
+ * then carries the rate it was sampled at.
  */
 
 #ifndef __LIB_TRACE__
@@ -32,6 +39,7 @@
 #include "common.h"
 #include "utils.h"
 #include "metrics.h"
+#include "flow.h"
 
 /* Available observation points. */
 enum {
@@ -66,6 +74,23 @@ enum {
 #define MONITOR_AGGREGATION TRACE_AGGREGATE_NONE
 #endif
 
+/* Account packets in the flow summaries once per program, when they leave. */
+static inline void trace_flow_summary(struct __sk_buff *skb, __u8 obs_point,
+				      __u32 src, __u32 dst)
+{
+	switch (obs_point) {
+	case TRACE_TO_LXC:
+	case TRACE_TO_PROXY:
+	case TRACE_TO_HOST:
+	case TRACE_TO_STACK:
+	case TRACE_TO_OVERLAY:
+		flow_summary_update(skb, src, dst, FLOW_VERDICT_FORWARDED, obs_point);
+		break;
+	default:
+		break;
+	}
+}
+
 #ifdef TRACE_NOTIFY
 
 struct trace_notify {
@@ -76,10 +101,57 @@ struct trace_notify {
 	__u32		dst_label;
 	__u16		dst_id;
 	__u8		reason;
-	__u8		pad;
+	__u8		sample_shift;	/* Sampled 1 in 2^sample_shift */
 	__u32		ifindex;
 };
 
+#ifdef TRACE_CONFIG_MAP
+/* Runtime configuration of trace notifications, written by the agent */
+struct trace_config {
+	__u32		sample_shift;	/* Emit 1 in 2^sample_shift notifications */
+	__u32		pad;
+};
+
+#define TRACE_SAMPLE_SHIFT_MAX 31
+
+struct bpf_elf_map __section_maps TRACE_CONFIG_MAP = {
+	.type		= BPF_MAP_TYPE_ARRAY,
+	.size_key	= sizeof(__u32),
+	.size_value	= sizeof(struct trace_config),
+	.pinning	= PIN_GLOBAL_NS,
+	.max_elem	= 1,
+};
+
+/**
+ * trace_sample_shift
+ *
+ * Returns the configured sampling shift if this notification is to be sent
+ * or a negative value if it is to be skipped.
+ */
+static inline int trace_sample_shift(void)
+{
+	struct trace_config *cfg;
+	__u32 zero = 0, shift;
+
+	cfg = map_lookup_elem(&TRACE_CONFIG_MAP, &zero);
+	if (!cfg || !cfg->sample_shift)
+		return 0;
+
+	shift = cfg->sample_shift;
+	if (shift > TRACE_SAMPLE_SHIFT_MAX)
+		shift = TRACE_SAMPLE_SHIFT_MAX;
+	if (get_prandom_u32() & ((1U << shift) - 1))
+		return -1;
+
+	return shift;
+}
+#else
+static inline int trace_sample_shift(void)
+{
+	return 0;
+}
+#endif /* TRACE_CONFIG_MAP */
+
 /**
  * send_trace_notify
  * @skb:	socket buffer
@@ -116,6 +188,7 @@ send_trace_notify(struct __sk_buff *skb, __u8 obs_point, __u32 src, __u32 dst,
 		case TRACE_TO_OVERLAY:
 			update_metrics(skb->len, METRIC_EGRESS, REASON_FORWARDED);
 	}
+	trace_flow_summary(skb, obs_point, src, dst);
 	if (MONITOR_AGGREGATION >= TRACE_AGGREGATE_RX) {
 		switch (obs_point) {
 		case TRACE_FROM_LXC:
@@ -131,8 +204,13 @@ send_trace_notify(struct __sk_buff *skb, __u8 obs_point, __u32 src, __u32 dst,
 	if (MONITOR_AGGREGATION >= TRACE_AGGREGATE_ACTIVE_CT && !monitor)
 		return;
 
+	int shift = trace_sample_shift();
+	if (shift < 0)
+		return;
+
 	if (!monitor)
 		monitor = TRACE_PAYLOAD_LEN;
+	monitor = event_capture_len(CAPTURE_LEN_TRACE, obs_point, monitor);
 	uint64_t skb_len = (uint64_t)skb->len, cap_len = min((uint64_t)monitor, (uint64_t)skb_len);
 	uint32_t hash = get_hash_recalc(skb);
 	struct trace_notify msg = {
@@ -146,12 +224,10 @@ send_trace_notify(struct __sk_buff *skb, __u8 obs_point, __u32 src, __u32 dst,
 		.dst_label = dst,
 		.dst_id = dst_id,
 		.reason = reason,
-		.pad = 0,
+		.sample_shift = shift,
 		.ifindex = ifindex,
 	};
-	skb_event_output(skb, &EVENTS_MAP,
-			 (cap_len << 32) | BPF_F_CURRENT_CPU,
-			 &msg, sizeof(msg));
+	skb_event_emit(skb, &msg, sizeof(msg), cap_len);
 }
 
 #else
@@ -178,6 +254,7 @@ static inline void send_trace_notify(struct __sk_buff *skb, __u8 obs_point, __u3
 		case TRACE_TO_OVERLAY:
 			update_metrics(skb->len, METRIC_EGRESS, REASON_FORWARDED);
 	}
+	trace_flow_summary(skb, obs_point, src, dst);
 }
 
 #endif
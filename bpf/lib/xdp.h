@@ -35,6 +35,223 @@ struct lpm_val {
 	__u8 flags;
 };
 
+/* Key of the destination rule maps. The protocol and destination port
+ * precede the address so that they are always matched in full, the
+ * prefix length covers XDP_L4_KEY_PREFIX bits plus the address prefix.
+ * A destination port of 0 matches all ports of the protocol.
+ */
+#define XDP_L4_KEY_PREFIX	32
+
+struct lpm_v4_l4_key {
+	struct bpf_lpm_trie_key lpm;
+	__u8 nexthdr;
+	__u8 pad;
+	__be16 dport;
+	__u8 addr[4];
+};
+
+struct lpm_v6_l4_key {
+	struct bpf_lpm_trie_key lpm;
+	__u8 nexthdr;
+	__u8 pad;
+	__be16 dport;
+	__u8 addr[16];
+};
+
+/* Key of the allowed ports per local endpoint map. The entry with port
+ * and protocol 0 restricts the endpoint to its listed ports. */
+struct xdp_ep_port_key {
+	__u16 lxc_id;
+	__be16 dport;
+	__u8 nexthdr;
+	__u8 pad[3];
+};
+
+struct xdp_rule {
+	__u32 rule_id;
+};
+
+struct xdp_stats {
+	__u64 packets;
+	__u64 bytes;
+};
+
+/* Verdict reasons of the prefilter, accounted in a per-CPU array. Reasons
+ * passing the packet to the stack precede the ones transmitting it back
+ * out of the device, followed by the dropping ones.
+ */
+enum {
+	PREFILTER_PASS_ENDPOINT,	/* To local endpoint or host */
+	PREFILTER_PASS_NON_IP,		/* Neither IPv4 nor IPv6 */
+	PREFILTER_TX_SYNCOOKIE,		/* SYN answered with a cookie */
+	PREFILTER_DROP_INVALID,		/* Truncated headers */
+	PREFILTER_DROP_CIDR,		/* Source in CIDR hash map */
+	PREFILTER_DROP_CIDR_LPM,	/* Source in CIDR LPM map */
+	PREFILTER_DROP_DST,		/* Destination rule */
+	PREFILTER_DROP_EP_PORT,		/* Port not allowed on endpoint */
+	PREFILTER_DROP_NO_ENDPOINT,	/* No local endpoint or host */
+	PREFILTER_DROP_RATE,		/* Source over rate limit */
+	PREFILTER_DROP_SYNCOOKIE,	/* Unvalidated SYN carrying data */
+	PREFILTER_DROP_SYNCOOKIE_ACK,	/* Cookie echoed, source validated */
+	__PREFILTER_REASON_MAX,
+};
+
+static __always_inline bool prefilter_is_pass(int reason)
+{
+	return reason < PREFILTER_TX_SYNCOOKIE;
+}
+
+static __always_inline bool prefilter_is_drop(int reason)
+{
+	return reason >= PREFILTER_DROP_INVALID;
+}
+
+/* Source prefixes subject to rate limiting map to a rate class. */
+struct xdp_rate_rule {
+	__u32 class_id;
+};
+
+#define XDP_RATE_F_AGGREGATE	1
+
+/* Token bucket of a rate class, expressed in time rather than tokens so
+ * that the datapath neither multiplies nor divides: every packet costs
+ * interval_ns and the bucket holds up to burst_ns worth of packets. An
+ * interval of 0 disables the class. With XDP_RATE_F_AGGREGATE, all
+ * sources of the class share a single bucket.
+ */
+struct xdp_rate_class {
+	__u64 interval_ns;
+	__u64 burst_ns;
+	__u32 flags;
+	__u32 pad;
+};
+
+struct xdp_rate_key {
+	__u8 addr[16];
+	__u32 class_id;
+	__u8 family;
+	__u8 pad[3];
+};
+
+/* Theoretical arrival time of the next packet conforming to the rate. */
+struct xdp_rate_bucket {
+	__u64 tat;
+};
+
+struct xdp_rate_stats {
+	__u64 passed;
+	__u64 dropped;
+};
+
+/* Maximum number of stacked VLAN tags parsed, covering QinQ. */
+#define XDP_MAX_VLAN_TAGS	2
+
+struct xdp_vlan_hdr {
+	__be16 h_vlan_TCI;
+	__be16 h_vlan_encapsulated_proto;
+};
+
+#ifndef ETH_P_TEB
+#define ETH_P_TEB		0x6558
+#endif
+
+/* Common layout of the fixed VXLAN and Geneve headers. For Geneve, flags
+ * holds the version and the options length in 4 byte words and proto
+ * the protocol of the payload.
+ */
+struct xdp_tunnel_hdr {
+	__u8 flags;
+	__u8 reserved;
+	__be16 proto;
+	__be32 vni;
+};
+
+/* SYN cookies are keyed with a 64 bit secret and computed over the
+ * connection tuple and a time slot of XDP_SYNCOOKIE_SLOT_SHIFT bits of
+ * nanoseconds (~69s). Cookies of the current and previous slot are valid.
+ */
+#define XDP_SYNCOOKIE_SLOT_SHIFT	36
+
+struct xdp_syncookie_secret {
+	__u32 key[2];
+};
+
+struct xdp_syncookie_tuple {
+	__u32 saddr[4];
+	__u32 daddr[4];
+	__be16 sport;
+	__be16 dport;
+	__u32 slot;
+};
+
+/* Sources which echoed a valid cookie, keyed like the rate buckets with
+ * the class identifier unused. */
+struct xdp_syncookie_valid {
+	__u64 expires;
+};
+
+#define XDP_ROL32(x, b)		(((x) << (b)) | ((x) >> (32 - (b))))
+
+#define XDP_HSIPROUND(v0, v1, v2, v3)					\
+	do {								\
+		v0 += v1; v1 = XDP_ROL32(v1, 5); v1 ^= v0;		\
+		v0 = XDP_ROL32(v0, 16);					\
+		v2 += v3; v3 = XDP_ROL32(v3, 8); v3 ^= v2;		\
+		v0 += v3; v3 = XDP_ROL32(v3, 7); v3 ^= v0;		\
+		v2 += v1; v1 = XDP_ROL32(v1, 13); v1 ^= v2;		\
+		v2 = XDP_ROL32(v2, 16);					\
+	} while (0)
+
+/* HalfSipHash-1-3 over the given number of 32 bit words of data. */
+static __always_inline __u32 xdp_hsiphash(const __u32 key[2],
+					  const __u32 *data, const int words)
+{
+	__u32 v0 = key[0];
+	__u32 v1 = key[1];
+	__u32 v2 = key[0] ^ 0x6c796765;
+	__u32 v3 = key[1] ^ 0x74656462;
+	__u32 b = (words * 4) << 24;
+	int i;
+
+#pragma unroll
+	for (i = 0; i < words; i++) {
+		v3 ^= data[i];
+		XDP_HSIPROUND(v0, v1, v2, v3);
+		v0 ^= data[i];
+	}
+
+	v3 ^= b;
+	XDP_HSIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xff;
+	XDP_HSIPROUND(v0, v1, v2, v3);
+	XDP_HSIPROUND(v0, v1, v2, v3);
+	XDP_HSIPROUND(v0, v1, v2, v3);
+
+	return v1 ^ v3;
+}
+
+/* Incrementally updates a checksum for a 16 bit word changing from old to
+ * new, see RFC 1624. */
+static __always_inline void xdp_csum_replace2(__sum16 *sum, __be16 old,
+					      __be16 new)
+{
+	__u32 csum = (__u16)~*sum;
+
+	csum += (__u16)~old;
+	csum += new;
+	csum = (csum & 0xffff) + (csum >> 16);
+	csum = (csum & 0xffff) + (csum >> 16);
+	*sum = ~csum;
+}
+
+static __always_inline void xdp_csum_replace4(__sum16 *sum, __be32 old,
+					      __be32 new)
+{
+	xdp_csum_replace2(sum, old >> 16, new >> 16);
+	xdp_csum_replace2(sum, old & 0xffff, new & 0xffff);
+}
+
 static __always_inline void *xdp_data(const struct xdp_md *xdp)
 {
 	return (void *)(unsigned long)xdp->data;
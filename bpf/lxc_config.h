@@ -47,6 +47,7 @@
 #define CONNTRACK
 #define CONNTRACK_ACCOUNTING
 #define CONFIG_MAP test_cilium_ep_config_111
+#define EP_METRICS_MAP test_cilium_ep_metrics_111
 
 /* It appears that we can support around the below number of prefixes in an
  * unrolled loop for LPM CIDR handling in older kernels along with the rest of
@@ -47,21 +47,43 @@
 
 #define ENCAP_GENEVE 1
 #define ENDPOINTS_MAP test_cilium_lxc
+#define ENDPOINTS_TABLE_MAP test_cilium_lxc_table
+#define ENDPOINTS4_ID_MAP test_cilium_lxc_id4
+#define ENDPOINTS6_ID_MAP test_cilium_lxc_id6
 #define EVENTS_MAP test_cilium_events
+#define TRACE_CONFIG_MAP test_cilium_trace_config
+#define DEBUG_FILTER_MAP test_cilium_debug_filter
+#define DROP_NOTIFY_RATE_MAP test_cilium_drop_notify_rate
+#define DROP_NOTIFY_RATE 1000
+#define FLOW_SUMMARY_MAP test_cilium_flow_summary
+#define FLOW_SUMMARY_MAP_SIZE 65536
+#define LATENCY_MAP test_cilium_latency
+#define CAPTURE_LEN_MAP test_cilium_capture_len
+#define EVENTS_RINGBUF_MAP test_cilium_events_ring
+#define EVENTS_RINGBUF_LOST_MAP test_cilium_events_ring_lost
 #define METRICS_MAP test_cilium_metrics
 #define POLICY_CALL_MAP test_cilium_policy
 #define SOCK_OPS_MAP test_sock_ops_map
 #define IPCACHE_MAP test_cilium_ipcache
+#define IPCACHE4_MAP test_cilium_ipcache4
+#define IPCACHE6_MAP test_cilium_ipcache6
+#define IPCACHE_PREFIXES_MAP test_cilium_ipcache_prefixes
+#define IPCACHE_FRONT_MAP test_cilium_ipcache_front
+#define IPCACHE_FRONT_GEN_MAP test_cilium_ipcache_front_gen
+#define IPCACHE_FRONT_STATS_MAP test_cilium_ipcache_front_stats
 #define PROXY4_MAP test_cilium_proxy4
 #define PROXY6_MAP test_cilium_proxy6
 #define TUNNEL_MAP test_cilium_tunnel_map
 #define EP_POLICY_MAP test_cilium_ep_to_policy
+#define EP_SHARED_POLICY_MAP test_cilium_ep_shared_policy
 #define LB6_REVERSE_NAT_MAP test_cilium_lb6_reverse_nat
 #define LB6_SERVICES_MAP test_cilium_lb6_services
 #define LB6_RR_SEQ_MAP test_cilium_lb6_rr_seq
 #define LB4_REVERSE_NAT_MAP test_cilium_lb4_reverse_nat
 #define LB4_SERVICES_MAP test_cilium_lb4_services
 #define LB4_RR_SEQ_MAP test_cilium_lb4_rr_seq
+#define IPV4_FRAG_DATAGRAMS_MAP test_cilium_ipv4_frag_datagrams
+#define IPV6_FRAG_DATAGRAMS_MAP test_cilium_ipv6_frag_datagrams
 #define SECLABEL 2
 #define SECLABEL_NB 0xfffff
 #define ENABLE_ARP_RESPONDER
@@ -69,7 +91,7 @@
 #define LB_RR_MAX_SEQ 31
 #define TUNNEL_ENDPOINT_MAP_SIZE 65536
 #define ENDPOINTS_MAP_SIZE 65536
-#define METRICS_MAP_SIZE 65536
+#define METRICS_MAP_SIZE 1024
 #define CILIUM_NET_MAC  { .addr = { 0xce, 0x72, 0xa7, 0x03, 0x88, 0x57 } }
 #define LB_REDIRECT 1
 #define LB_DST_MAC { .addr = { 0xce, 0x72, 0xa7, 0x03, 0x88, 0x58 } }
@@ -77,6 +99,9 @@
 #define PROXY_MAP_SIZE 524288
 #define POLICY_MAP_SIZE 16384
 #define IPCACHE_MAP_SIZE 512000
+#define IPCACHE_FRONT_MAP_SIZE 256
+#define CILIUM_IPV4_FRAG_MAP_MAX_ENTRIES 8192
+#define CILIUM_IPV6_FRAG_MAP_MAX_ENTRIES 8192
 #define POLICY_PROG_MAP_SIZE ENDPOINTS_MAP_SIZE
 #ifndef SKIP_DEBUG
 #define LB_DEBUG
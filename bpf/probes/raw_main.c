@@ -37,6 +37,7 @@ struct bpf_map_fixup {
 	enum bpf_map_type type;
 	uint32_t size_key;
 	uint32_t size_val;
+	uint32_t max_elem;
 	uint32_t flags;
 };
 
@@ -255,12 +256,13 @@ static void bpf_run_test(struct bpf_test *test, int debug_mode)
 			.size_key	= map->size_key,
 			.size_value	= map->size_val,
 			.pinning	= 0,
-			.max_elem	= 1,
+			.max_elem	= map->max_elem ? : 1,
 			.flags		= map->flags,
 		};
 	  
 		fd = bpf_map_create(map->type, map->size_key,
-				    map->size_val, 1, map->flags);
+				    map->size_val, elf_map.max_elem,
+				    map->flags);
 		if (fd < 0) {
 			if (debug_mode) {
 				printf("#if 0\n");
@@ -0,0 +1,30 @@
+/* Tests for availability of kernel commits (5.8+):
+ *
+ * 457f44363a88 ("bpf: Implement BPF ring buffer and verifier support for it")
+ *
+ * The map type (27) and the bpf_ringbuf_query() helper (134) postdate the
+ * UAPI headers of this tree and are referenced by value.
+ */
+	{
+		.emits	= "HAVE_RINGBUF_MAP_TYPE",
+		.type	= BPF_PROG_TYPE_SCHED_CLS,
+		.insns	= {
+			BPF_MOV64_IMM(BPF_REG_2, 0),
+			BPF_LD_MAP_FD(BPF_REG_1, 0),
+			BPF_EMIT_CALL(134),
+			BPF_MOV64_IMM(BPF_REG_0, 0),
+			BPF_EXIT_INSN(),
+		},
+		.fixup_map = {
+			{
+				.off		= 1,
+				.type		= 27,
+				.size_key	= 0,
+				.size_val	= 0,
+				.max_elem	= 1 << 16,
+			},
+		},
+		.warn = "Your kernel doesn't support BPF ring buffers, thus "
+			"switching back to perf event arrays for datapath "
+			"events. Recommendation is to run 5.8+ kernels.",
+	},
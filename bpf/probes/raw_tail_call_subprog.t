@@ -0,0 +1,35 @@
+/* Tests for availability of kernel commits (5.10+ on x86_64):
+ *
+ * e411901c0b77 ("bpf: allow for tailcalls in BPF subprograms for x64 JIT")
+ *
+ * Older kernels reject programs mixing BPF-to-BPF calls with tail calls.
+ */
+	{
+		.emits	= "HAVE_TAIL_CALL_SUBPROG",
+		.type	= BPF_PROG_TYPE_SCHED_CLS,
+		.insns	= {
+			BPF_MOV64_REG(BPF_REG_6, BPF_REG_1),
+			BPF_RAW_INSN(BPF_JMP | BPF_CALL, 0, 1 /* BPF_PSEUDO_CALL */, 0, 7),
+			BPF_MOV64_REG(BPF_REG_1, BPF_REG_6),
+			BPF_LD_MAP_FD(BPF_REG_2, 0),
+			BPF_MOV64_IMM(BPF_REG_3, 0),
+			BPF_EMIT_CALL(BPF_FUNC_tail_call),
+			BPF_MOV64_IMM(BPF_REG_0, 0),
+			BPF_EXIT_INSN(),
+			/* Subprogram */
+			BPF_MOV64_IMM(BPF_REG_0, 0),
+			BPF_EXIT_INSN(),
+		},
+		.fixup_map = {
+			{
+				.off		= 3,
+				.type		= BPF_MAP_TYPE_PROG_ARRAY,
+				.size_key	= 4,
+				.size_val	= 4,
+			},
+		},
+		.warn = "Your kernel doesn't support BPF-to-BPF calls in programs "
+			"using tail calls, thus switching back to tail calls for "
+			"drop notifications. Recommendation is to run 5.10+ "
+			"kernels.",
+	},
@@ -43,7 +43,7 @@
 __section("sk_msg")
 int bpf_redir_proxy(struct sk_msg_md *msg)
 {
-	struct remote_endpoint_info *info;
+	struct remote_endpoint_info *info, buf;
 	__u64 flags = BPF_F_INGRESS;
 	struct sock_key key = {};
 	__u32 srcID, dstID = 0;
@@ -56,13 +56,13 @@ int bpf_redir_proxy(struct sk_msg_md *msg)
 	 * socket to avoid extra overhead. This would require the agent though
 	 * to flush the sock ops map on policy changes.
 	 */
-	info = lookup_ip4_remote_endpoint(key.dip4);
+	info = lookup_ip4_remote_endpoint(key.dip4, &buf);
 	if (info != NULL && info->sec_label)
 		dstID = info->sec_label;
 	else
 		dstID = WORLD_ID;
 
-	info = lookup_ip4_remote_endpoint(key.sip4);
+	info = lookup_ip4_remote_endpoint(key.sip4, &buf);
 	if (info != NULL && info->sec_label)
 		srcID = info->sec_label;
 	else
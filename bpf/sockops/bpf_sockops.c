@@ -59,9 +59,9 @@ static inline void bpf_sock_ops_ipv4(struct bpf_sock_ops *skops)
 
 	/* Policy lookup required to learn proxy port */
 	if (1) {
-		struct remote_endpoint_info *info;
+		struct remote_endpoint_info *info, buf;
 
-		info = lookup_ip4_remote_endpoint(key.dip4);
+		info = lookup_ip4_remote_endpoint(key.dip4, &buf);
 		if (info != NULL && info->sec_label)
 			dstID = info->sec_label;
 		else
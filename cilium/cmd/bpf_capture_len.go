@@ -0,0 +1,69 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"strconv"
+
+	"github.com/cilium/cilium/pkg/maps/capturemap"
+	"github.com/cilium/cilium/pkg/monitor"
+	monitorAPI "github.com/cilium/cilium/pkg/monitor/api"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfCaptureLenCmd represents the bpf_capture_len command
+var bpfCaptureLenCmd = &cobra.Command{
+	Use:   "capture-len",
+	Short: "Packet capture length of trace and drop notifications",
+}
+
+// captureSubtypeName returns the name of an observation point or drop reason
+func captureSubtypeName(t capturemap.Type, subtype uint8) string {
+	if t == capturemap.TypeDrop {
+		return monitorAPI.DropReason(subtype)
+	}
+	return monitor.ObsPoint(subtype)
+}
+
+// parseCaptureSubtypes parses an observation point or drop reason given by
+// number or name, or "all" for every subtype of the notification type.
+func parseCaptureSubtypes(t capturemap.Type, arg string) ([]uint8, error) {
+	subtypes := []uint8{}
+
+	if arg == "all" {
+		for i := 0; i <= 0xff; i++ {
+			subtypes = append(subtypes, uint8(i))
+		}
+		return subtypes, nil
+	}
+
+	if n, err := strconv.ParseUint(arg, 10, 8); err == nil {
+		return append(subtypes, uint8(n)), nil
+	}
+
+	for i := 0; i <= 0xff; i++ {
+		if captureSubtypeName(t, uint8(i)) == arg {
+			return append(subtypes, uint8(i)), nil
+		}
+	}
+
+	return nil, fmt.Errorf("unknown %s subtype %q", t, arg)
+}
+
+func init() {
+	bpfCmd.AddCommand(bpfCaptureLenCmd)
+}
@@ -0,0 +1,67 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/capturemap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfCaptureLenListCmd represents the bpf_capture_len_list command
+var bpfCaptureLenListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List capture lengths overriding the default",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf capture-len list")
+
+		entries, err := capturemap.Dump()
+		if err != nil {
+			Fatalf("Unable to dump capture lengths: %s", err)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(entries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(entries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "TYPE\tSUBTYPE\tLENGTH\n")
+		for _, e := range entries {
+			fmt.Fprintf(w, "%s\t%d (%s)\t%d\n", e.Type, e.Subtype,
+				captureSubtypeName(e.Type, e.Subtype), e.Len)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfCaptureLenCmd.AddCommand(bpfCaptureLenListCmd)
+	command.AddJSONOutput(bpfCaptureLenListCmd)
+}
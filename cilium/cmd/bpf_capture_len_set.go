@@ -0,0 +1,113 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"strconv"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/capturemap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	captureLenSetUsage = `Set the number of packet bytes captured by trace or drop notifications.
+
+The subtype is the observation point of trace notifications or the drop reason
+of drop notifications, given by number or name, or "all". A length of 0 only
+emits the notification header. Drop notifications default to the
+--trace-payloadlen of the agent, trace notifications additionally capture
+complete DNS packets. The setting takes effect immediately and is kept across
+agent restarts.
+
+Lengths are limited to 65484 bytes when notifications are emitted through perf
+events and to 65535 bytes with the BPF ring buffer.
+
+Examples:
+  cilium bpf capture-len set drop "Policy denied (L3)" 0
+  cilium bpf capture-len set drop all 1500
+  cilium bpf capture-len set trace to-stack 64
+`
+)
+
+// bpfCaptureLenSetCmd represents the bpf_capture_len_set command
+var bpfCaptureLenSetCmd = &cobra.Command{
+	Use:   "set <trace|drop> <subtype|all> <length>",
+	Short: "Set the capture length of notifications",
+	Long:  captureLenSetUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf capture-len set")
+
+		if len(args) != 3 {
+			Usagef(cmd, "Expected notification type, subtype and length")
+		}
+
+		t, err := capturemap.ParseType(args[0])
+		if err != nil {
+			Fatalf("%s", err)
+		}
+
+		subtypes, err := parseCaptureSubtypes(t, args[1])
+		if err != nil {
+			Fatalf("%s", err)
+		}
+
+		length, err := strconv.Atoi(args[2])
+		if err != nil {
+			Fatalf("Invalid capture length %q: %s", args[2], err)
+		}
+
+		for _, subtype := range subtypes {
+			if err := capturemap.SetLen(t, subtype, length); err != nil {
+				Fatalf("Unable to set capture length: %s", err)
+			}
+		}
+	},
+}
+
+// bpfCaptureLenUnsetCmd represents the bpf_capture_len_unset command
+var bpfCaptureLenUnsetCmd = &cobra.Command{
+	Use:   "unset <trace|drop> <subtype|all>",
+	Short: "Restore the default capture length of notifications",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf capture-len unset")
+
+		if len(args) != 2 {
+			Usagef(cmd, "Expected notification type and subtype")
+		}
+
+		t, err := capturemap.ParseType(args[0])
+		if err != nil {
+			Fatalf("%s", err)
+		}
+
+		subtypes, err := parseCaptureSubtypes(t, args[1])
+		if err != nil {
+			Fatalf("%s", err)
+		}
+
+		for _, subtype := range subtypes {
+			if err := capturemap.UnsetLen(t, subtype); err != nil {
+				Fatalf("Unable to unset capture length: %s", err)
+			}
+		}
+	},
+}
+
+func init() {
+	bpfCaptureLenCmd.AddCommand(bpfCaptureLenSetCmd)
+	bpfCaptureLenCmd.AddCommand(bpfCaptureLenUnsetCmd)
+}
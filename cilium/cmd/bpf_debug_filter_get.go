@@ -0,0 +1,54 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/debugmap"
+
+	"github.com/spf13/cobra"
+)
+
+var bpfDebugFilterGetCmd = &cobra.Command{
+	Use:   "get",
+	Short: "Show the filter of datapath debug events",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf debug-filter get")
+
+		filter, err := debugmap.GetFilter()
+		if err != nil {
+			Fatalf("Unable to get debug filter: %s", err)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(filter); err != nil {
+				fmt.Fprintf(os.Stderr, "error getting output of map in JSON: %s\n", err)
+				os.Exit(1)
+			}
+			return
+		}
+
+		fmt.Println(filter.String())
+	},
+}
+
+func init() {
+	bpfDebugFilterCmd.AddCommand(bpfDebugFilterGetCmd)
+	command.AddJSONOutput(bpfDebugFilterGetCmd)
+}
@@ -0,0 +1,54 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/debugmap"
+
+	"github.com/spf13/cobra"
+)
+
+func setDebugFilterMode(mode uint8) {
+	if err := debugmap.SetFilter(&debugmap.Filter{Mode: mode}); err != nil {
+		Fatalf("Unable to set debug filter: %s", err)
+	}
+}
+
+var bpfDebugFilterOffCmd = &cobra.Command{
+	Use:   "off",
+	Short: "Emit no datapath debug events",
+	Long: `Suppress all debug events of datapath programs compiled with debugging
+enabled. Suppressed events are dropped before they are built.
+`,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf debug-filter off")
+		setDebugFilterMode(debugmap.ModeNone)
+	},
+}
+
+var bpfDebugFilterResetCmd = &cobra.Command{
+	Use:   "reset",
+	Short: "Emit all datapath debug events",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf debug-filter reset")
+		setDebugFilterMode(debugmap.ModeAll)
+	},
+}
+
+func init() {
+	bpfDebugFilterCmd.AddCommand(bpfDebugFilterOffCmd)
+	bpfDebugFilterCmd.AddCommand(bpfDebugFilterResetCmd)
+}
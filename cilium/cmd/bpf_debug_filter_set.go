@@ -0,0 +1,135 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"net"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/debugmap"
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	debugFilterSetUsage = `Restrict the debug events emitted by datapath programs compiled with debugging
+enabled to those matching all given criteria. The filter takes effect
+immediately and replaces any previous filter.
+
+Subtypes are the numeric DBG_* and DBG_CAPTURE_* values of bpf/lib/dbg.h. The
+tuple matches packets in either direction, omitted addresses, ports and
+protocol match any value.
+`
+)
+
+var (
+	debugFilterEndpoint     uint16
+	debugFilterIdentity     uint32
+	debugFilterTypes        []uint
+	debugFilterCaptureTypes []uint
+	debugFilterSrcIP        string
+	debugFilterDstIP        string
+	debugFilterSport        uint16
+	debugFilterDport        uint16
+	debugFilterProtocol     string
+)
+
+func parseDebugFilterIP(flag, value string) net.IP {
+	if value == "" {
+		return nil
+	}
+	ip := net.ParseIP(value)
+	if ip == nil {
+		Fatalf("Invalid --%s %q", flag, value)
+	}
+	return ip
+}
+
+var bpfDebugFilterSetCmd = &cobra.Command{
+	Use:   "set",
+	Short: "Emit only datapath debug events matching the filter",
+	Long:  debugFilterSetUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf debug-filter set")
+
+		flags := cmd.Flags()
+		filter := debugmap.Filter{Mode: debugmap.ModeMatch}
+
+		if flags.Changed("endpoint") {
+			filter.Flags |= debugmap.FilterEndpoint
+			filter.Endpoint = debugFilterEndpoint
+		}
+
+		if flags.Changed("identity") {
+			filter.Flags |= debugmap.FilterIdentity
+			filter.Identity = debugFilterIdentity
+		}
+
+		for _, t := range debugFilterTypes {
+			if t > debugmap.MaxSubtype {
+				Fatalf("Invalid debug subtype %d", t)
+			}
+			filter.AddMsgType(uint8(t))
+		}
+		for _, t := range debugFilterCaptureTypes {
+			if t > debugmap.MaxSubtype {
+				Fatalf("Invalid capture subtype %d", t)
+			}
+			filter.AddCaptureType(uint8(t))
+		}
+
+		if debugFilterSrcIP != "" || debugFilterDstIP != "" {
+			src := parseDebugFilterIP("src-ip", debugFilterSrcIP)
+			dst := parseDebugFilterIP("dst-ip", debugFilterDstIP)
+			if err := filter.SetAddrs(src, dst); err != nil {
+				Fatalf("Invalid tuple: %s", err)
+			}
+		}
+
+		if debugFilterProtocol != "" || debugFilterSport != 0 || debugFilterDport != 0 {
+			proto := u8proto.U8proto(0)
+			if debugFilterProtocol != "" {
+				var err error
+				if proto, err = u8proto.ParseProtocol(debugFilterProtocol); err != nil {
+					Fatalf("Invalid --protocol: %s", err)
+				}
+			}
+			filter.SetPorts(proto, debugFilterSport, debugFilterDport)
+		}
+
+		if filter.Flags == 0 {
+			Usagef(cmd, "at least one filter criterion required")
+		}
+
+		if err := debugmap.SetFilter(&filter); err != nil {
+			Fatalf("Unable to set debug filter: %s", err)
+		}
+	},
+}
+
+func init() {
+	bpfDebugFilterCmd.AddCommand(bpfDebugFilterSetCmd)
+	flags := bpfDebugFilterSetCmd.Flags()
+	flags.Uint16Var(&debugFilterEndpoint, "endpoint", 0, "Endpoint ID of the emitting program")
+	flags.Uint32Var(&debugFilterIdentity, "identity", 0, "Security identity of the emitting program")
+	flags.UintSliceVar(&debugFilterTypes, "type", nil, "Debug message subtypes")
+	flags.UintSliceVar(&debugFilterCaptureTypes, "capture-type", nil, "Debug capture subtypes")
+	flags.StringVar(&debugFilterSrcIP, "src-ip", "", "Source address of the tuple")
+	flags.StringVar(&debugFilterDstIP, "dst-ip", "", "Destination address of the tuple")
+	flags.Uint16Var(&debugFilterSport, "sport", 0, "Source port of the tuple")
+	flags.Uint16Var(&debugFilterDport, "dport", 0, "Destination port of the tuple")
+	flags.StringVar(&debugFilterProtocol, "protocol", "", "L4 protocol of the tuple")
+}
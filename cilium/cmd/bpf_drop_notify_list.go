@@ -0,0 +1,86 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/dropnotifymap"
+	monitorAPI "github.com/cilium/cilium/pkg/monitor/api"
+
+	"github.com/spf13/cobra"
+)
+
+// dropNotifySummary is the printable form of a drop notification bucket
+type dropNotifySummary struct {
+	Reason     string `json:"reason"`
+	Suppressed uint64 `json:"suppressed"`
+}
+
+// bpfDropNotifyListCmd represents the bpf_drop_notify_list command
+var bpfDropNotifyListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List drop notifications suppressed by the rate limit",
+	Long: `List drop notifications suppressed by the rate limit.
+
+Drop notifications are limited per drop reason and CPU, see the
+--drop-notify-rate option of the agent. Suppressed drops are still
+accounted in "cilium bpf metrics list", but do not show up in
+"cilium monitor".`,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf drop-notify list")
+
+		entries, err := dropnotifymap.Dump()
+		if err != nil {
+			Fatalf("Unable to dump drop notification rate limit: %s", err)
+		}
+
+		summaries := make([]dropNotifySummary, 0, len(entries))
+		for _, e := range entries {
+			summaries = append(summaries, dropNotifySummary{
+				Reason:     monitorAPI.DropReason(e.Reason),
+				Suppressed: e.Suppressed,
+			})
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(summaries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(summaries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "REASON\tSUPPRESSED\n")
+		for _, s := range summaries {
+			fmt.Fprintf(w, "%s\t%d\n", s.Reason, s.Suppressed)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfDropNotifyCmd.AddCommand(bpfDropNotifyListCmd)
+	command.AddJSONOutput(bpfDropNotifyListCmd)
+}
@@ -0,0 +1,138 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"net"
+	"os"
+	"sort"
+	"text/tabwriter"
+	"time"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/flowmap"
+	"github.com/cilium/cilium/pkg/monitor"
+	monitorAPI "github.com/cilium/cilium/pkg/monitor/api"
+
+	"github.com/spf13/cobra"
+)
+
+// flowSummary is the printable form of a flow summary
+type flowSummary struct {
+	Protocol            string        `json:"protocol"`
+	Source              string        `json:"source"`
+	Destination         string        `json:"destination"`
+	SourceIdentity      uint32        `json:"source-identity"`
+	DestinationIdentity uint32        `json:"destination-identity"`
+	Packets             uint64        `json:"packets"`
+	Bytes               uint64        `json:"bytes"`
+	Duration            time.Duration `json:"duration"`
+	LastSeen            time.Duration `json:"last-seen"`
+	Verdict             string        `json:"verdict"`
+	Reason              string        `json:"reason"`
+}
+
+// bpfFlowListCmd represents the bpf_flow_list command
+var bpfFlowListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List flow summaries aggregated by the datapath",
+	Long: `List flow summaries aggregated by the datapath.
+
+Flows are keyed by their 5-tuple and security identities only. A packet
+passing more than one observation point on this node, e.g. one delivered
+to a local endpoint after passing through the host stack or the proxy, is
+counted once at each of them, and the verdict shows the last observation
+point seen.`,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf flow list")
+
+		flows, err := flowmap.Dump()
+		if err != nil {
+			Fatalf("Unable to dump flow summaries: %s", err)
+		}
+
+		now, err := bpf.GetMtime()
+		if err != nil {
+			Fatalf("Unable to get monotonic time: %s", err)
+		}
+
+		summaries := make([]flowSummary, 0, len(flows))
+		for _, f := range flows {
+			summaries = append(summaries, newFlowSummary(&f, now))
+		}
+		sort.Slice(summaries, func(i, j int) bool {
+			return summaries[i].LastSeen < summaries[j].LastSeen
+		})
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(summaries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(summaries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "PROTO\tSOURCE\tDESTINATION\tIDENTITIES\tPACKETS\tBYTES\tDURATION\tLAST SEEN\tVERDICT\n")
+		for _, s := range summaries {
+			fmt.Fprintf(w, "%s\t%s\t%s\t%d -> %d\t%d\t%d\t%s\t%s ago\t%s (%s)\n",
+				s.Protocol, s.Source, s.Destination,
+				s.SourceIdentity, s.DestinationIdentity,
+				s.Packets, s.Bytes, s.Duration, s.LastSeen,
+				s.Verdict, s.Reason)
+		}
+		w.Flush()
+	},
+}
+
+func newFlowSummary(f *flowmap.Flow, now uint64) flowSummary {
+	k, v := &f.Key, &f.Value
+	s := flowSummary{
+		Protocol:            k.NextHeader.String(),
+		Source:              net.JoinHostPort(k.SourceIP().String(), fmt.Sprintf("%d", k.SourcePortHost())),
+		Destination:         net.JoinHostPort(k.DestIP().String(), fmt.Sprintf("%d", k.DestPortHost())),
+		SourceIdentity:      k.SourceID,
+		DestinationIdentity: k.DestID,
+		Packets:             v.Packets,
+		Bytes:               v.Bytes,
+		Duration:            time.Duration(v.LastSeen - v.FirstSeen),
+	}
+	if now > v.LastSeen {
+		s.LastSeen = time.Duration(now - v.LastSeen).Round(time.Second)
+	}
+
+	if v.IsDrop() {
+		s.Verdict = "dropped"
+		s.Reason = monitorAPI.DropReason(v.DropReason)
+	} else {
+		s.Verdict = "forwarded"
+		s.Reason = monitor.ObsPoint(v.ObsPoint)
+	}
+
+	return s
+}
+
+func init() {
+	bpfFlowCmd.AddCommand(bpfFlowListCmd)
+	command.AddJSONOutput(bpfFlowListCmd)
+}
@@ -46,7 +46,7 @@ var bpfIPCacheListCmd = &cobra.Command{
 		common.RequireRootPrivilege("cilium bpf ipcache list")
 
 		bpfIPCacheList := make(map[string][]string)
-		if err := ipcache.IPCache.Dump(bpfIPCacheList); err != nil {
+		if err := ipcache.DumpAll(bpfIPCacheList); err != nil {
 			fmt.Fprintf(os.Stderr, "error dumping contents of map: %s\n", err)
 			os.Exit(1)
 		}
@@ -0,0 +1,68 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/ipcache"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	ipCacheStatsUsage = `Show hit and miss counters of the per-CPU datapath cache in front of the
+IPCache, summed over all CPUs.
+
+The cache is only present if the agent runs with --enable-ipcache-front-cache.
+`
+)
+
+var bpfIPCacheStatsCmd = &cobra.Command{
+	Use:   "stats",
+	Short: "Show statistics of the datapath IPCache front cache",
+	Long:  ipCacheStatsUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf ipcache stats")
+
+		stats, err := ipcache.DumpFrontStats()
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "error reading front cache statistics: %s\n", err)
+			os.Exit(1)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(stats); err != nil {
+				fmt.Fprintf(os.Stderr, "error getting output of map in JSON: %s\n", err)
+				os.Exit(1)
+			}
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "HITS\tMISSES\tHIT RATIO\n")
+		fmt.Fprintf(w, "%d\t%d\t%.2f%%\n", stats.Hits, stats.Misses, stats.HitRatio()*100)
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfIPCacheCmd.AddCommand(bpfIPCacheStatsCmd)
+	command.AddJSONOutput(bpfIPCacheStatsCmd)
+}
@@ -0,0 +1,99 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"text/tabwriter"
+	"time"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/latencymap"
+
+	"github.com/spf13/cobra"
+)
+
+// latencySummary is the printable form of a latency histogram
+type latencySummary struct {
+	Program string        `json:"program"`
+	Stage   string        `json:"stage"`
+	Samples uint64        `json:"samples"`
+	P50     time.Duration `json:"p50"`
+	P90     time.Duration `json:"p90"`
+	P99     time.Duration `json:"p99"`
+	Max     time.Duration `json:"max"`
+	Buckets []uint64      `json:"buckets"`
+}
+
+// bpfLatencyListCmd represents the bpf_latency_list command
+var bpfLatencyListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List latency percentiles of datapath programs and stages",
+	Long: `List latency percentiles of datapath programs and stages.
+
+Samples are accounted in log2 buckets, percentiles are reported as the
+upper bound of the bucket they fall into.`,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf latency list")
+
+		entries, err := latencymap.Dump()
+		if err != nil {
+			Fatalf("Unable to dump latency histograms: %s", err)
+		}
+
+		summaries := make([]latencySummary, 0, len(entries))
+		for _, e := range entries {
+			h := &e.Histogram
+			summaries = append(summaries, latencySummary{
+				Program: e.Program,
+				Stage:   e.Stage,
+				Samples: h.Samples(),
+				P50:     h.Percentile(50),
+				P90:     h.Percentile(90),
+				P99:     h.Percentile(99),
+				Max:     h.Max(),
+				Buckets: h.Buckets[:],
+			})
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(summaries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(summaries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "PROGRAM\tSTAGE\tSAMPLES\tP50\tP90\tP99\tMAX\n")
+		for _, s := range summaries {
+			fmt.Fprintf(w, "%s\t%s\t%d\t<%s\t<%s\t<%s\t<%s\n", s.Program, s.Stage,
+				s.Samples, s.P50, s.P90, s.P99, s.Max)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfLatencyCmd.AddCommand(bpfLatencyListCmd)
+	command.AddJSONOutput(bpfLatencyListCmd)
+}
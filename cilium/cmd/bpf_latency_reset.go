@@ -0,0 +1,39 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/latencymap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfLatencyResetCmd represents the bpf_latency_reset command
+var bpfLatencyResetCmd = &cobra.Command{
+	Use:   "reset",
+	Short: "Clear all latency histograms",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf latency reset")
+
+		if err := latencymap.Reset(); err != nil {
+			Fatalf("Unable to reset latency histograms: %s", err)
+		}
+	},
+}
+
+func init() {
+	bpfLatencyCmd.AddCommand(bpfLatencyResetCmd)
+}
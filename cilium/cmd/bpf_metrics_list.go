@@ -38,18 +38,33 @@ const (
 	bytesTitle     = "BYTES"
 )
 
+var metricsEndpointID uint16
+
 var bpfMetricsListCmd = &cobra.Command{
 	Use:   "list",
 	Short: "List BPF datapath traffic metrics",
 	Run: func(cmd *cobra.Command, args []string) {
 		common.RequireRootPrivilege("cilium bpf metrics list")
 
-		bpfMetricsList := make(map[string][]string)
-		if err := metricsmap.Metrics.Dump(bpfMetricsList); err != nil {
+		var (
+			entries map[metricsmap.Key]metricsmap.Value
+			err     error
+		)
+		if metricsEndpointID != 0 {
+			entries, err = metricsmap.DumpEndpoint(metricsEndpointID)
+		} else {
+			entries, err = metricsmap.Dump()
+		}
+		if err != nil {
 			fmt.Fprintf(os.Stderr, "error dumping contents of map: %s\n", err)
 			os.Exit(1)
 		}
 
+		bpfMetricsList := make(map[string][]string, len(entries))
+		for key, value := range entries {
+			bpfMetricsList[key.String()] = []string{value.String()}
+		}
+
 		if command.OutputJSON() {
 			if err := command.PrintOutput(bpfMetricsList); err != nil {
 				fmt.Fprintf(os.Stderr, "error getting output of map in JSON: %s\n", err)
@@ -151,5 +166,6 @@ func extractTwoValues(str string) (string, string, bool) {
 
 func init() {
 	bpfMetricsCmd.AddCommand(bpfMetricsListCmd)
+	bpfMetricsListCmd.Flags().Uint16VarP(&metricsEndpointID, "endpoint", "e", 0, "List the drop metrics of the given endpoint (requires --enable-endpoint-drop-metrics)")
 	command.AddJSONOutput(bpfMetricsListCmd)
 }
@@ -0,0 +1,96 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"strconv"
+
+	"github.com/cilium/cilium/api/v1/models"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterCmd represents the bpf_prefilter command
+var bpfPrefilterCmd = &cobra.Command{
+	Use:   "prefilter",
+	Short: "Manage XDP prefilter rules and statistics",
+}
+
+func init() {
+	bpfCmd.AddCommand(bpfPrefilterCmd)
+}
+
+// parsePrefilterRuleID parses the rule ID selecting the drop counter of a
+// prefilter rule.
+func parsePrefilterRuleID(arg string) uint32 {
+	id, err := strconv.ParseUint(arg, 10, 32)
+	if err != nil || id >= prefiltermap.MaxRules {
+		Fatalf("Invalid rule ID %q, must be lower than %d", arg, prefiltermap.MaxRules)
+	}
+	return uint32(id)
+}
+
+// parsePrefilterPorts parses a list of <port>[/<protocol>], a port without
+// protocol or with protocol "any" matches both TCP and UDP.
+func parsePrefilterPorts(args []string) ([]prefiltermap.Port, error) {
+	l4, err := parseL4PortsSlice(args)
+	if err != nil {
+		return nil, err
+	}
+
+	ports := []prefiltermap.Port{}
+	for _, p := range l4 {
+		switch p.Protocol {
+		case models.PortProtocolANY:
+			ports = append(ports,
+				prefiltermap.Port{Port: p.Port, Protocol: u8proto.TCP},
+				prefiltermap.Port{Port: p.Port, Protocol: u8proto.UDP})
+		default:
+			proto, err := u8proto.ParseProtocol(p.Protocol)
+			if err != nil {
+				return nil, err
+			}
+			ports = append(ports, prefiltermap.Port{Port: p.Port, Protocol: proto})
+		}
+	}
+
+	return ports, nil
+}
+
+// parsePrefilterDstPorts parses the optional port of a destination rule. A
+// rule without port matches all traffic to the destination.
+func parsePrefilterDstPorts(args []string) []prefiltermap.Port {
+	if len(args) == 0 {
+		return []prefiltermap.Port{
+			{Protocol: u8proto.TCP},
+			{Protocol: u8proto.UDP},
+			{Protocol: u8proto.ICMP},
+			{Protocol: u8proto.ICMPv6},
+		}
+	}
+
+	ports, err := parsePrefilterPorts(args)
+	if err != nil {
+		Fatalf("Unable to parse port: %s", err)
+	}
+	return ports
+}
+
+func prefilterTargetString(entry *prefiltermap.RuleEntry) string {
+	return fmt.Sprintf("%s %s", entry.Action, entry.Target)
+}
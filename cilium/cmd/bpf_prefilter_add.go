@@ -0,0 +1,65 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"net"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	prefilterAddUsage = `Drop all packets destined to the prefix and port in the XDP prefilter.
+
+Dropped packets are accounted to the drop counters of the rule ID, which
+can be shared by several rules. Without port, all TCP, UDP, ICMP and ICMPv6
+packets to the prefix are dropped. A port of 0 matches all ports.
+
+The rule is only enforced if the agent runs with --prefilter-destinations.
+`
+)
+
+// bpfPrefilterAddCmd represents the bpf_prefilter_add command
+var bpfPrefilterAddCmd = &cobra.Command{
+	Use:   "add <rule id> <cidr> [<port>[/<protocol>]]",
+	Short: "Add destination deny rule",
+	Long:  prefilterAddUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter add")
+
+		if len(args) < 2 {
+			Usagef(cmd, "<rule id> and <cidr> required")
+		}
+
+		ruleID := parsePrefilterRuleID(args[0])
+		_, cidr, err := net.ParseCIDR(args[1])
+		if err != nil {
+			Fatalf("Unable to parse CIDR %q: %s", args[1], err)
+		}
+
+		for _, port := range parsePrefilterDstPorts(args[2:]) {
+			if err := prefiltermap.AddDenyRule(ruleID, cidr, port); err != nil {
+				Fatalf("Unable to add rule for %s %s: %s", cidr, port, err)
+			}
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterAddCmd)
+}
@@ -0,0 +1,69 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"strings"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterListCmd represents the bpf_prefilter_list command
+var bpfPrefilterListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List destination and endpoint port rules with drop counters",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter list")
+
+		entries, err := prefiltermap.DumpRules()
+		if err != nil {
+			Fatalf("Unable to dump prefilter rules: %s", err)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(entries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(entries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "RULE\tTARGET\tPORTS\tPACKETS\tBYTES\n")
+		for _, entry := range entries {
+			fmt.Fprintf(w, "%d\t%s\t%s\t%d\t%d\n", entry.RuleID,
+				prefilterTargetString(entry), strings.Join(entry.Ports, ","),
+				entry.Packets, entry.Bytes)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterListCmd)
+	command.AddJSONOutput(bpfPrefilterListCmd)
+}
@@ -0,0 +1,79 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"strconv"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	prefilterPortsUsage = `Restrict packets to the local endpoint to the listed ports in the XDP
+prefilter, replacing any previously allowed ports. Other TCP and UDP packets
+to the endpoint are dropped and accounted to the drop counters of the rule ID.
+Without ports, the restriction of the endpoint is lifted.
+
+The restriction is only enforced if the agent runs with
+--prefilter-endpoint-ports.
+`
+)
+
+// bpfPrefilterPortsCmd represents the bpf_prefilter_ports command
+var bpfPrefilterPortsCmd = &cobra.Command{
+	Use:   "ports <endpoint id> [<rule id> <port>[/<protocol>]...]",
+	Short: "Set allowed ports of local endpoint",
+	Long:  prefilterPortsUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter ports")
+
+		if len(args) < 1 {
+			Usagef(cmd, "<endpoint id> required")
+		}
+
+		epID, err := strconv.ParseUint(args[0], 10, 16)
+		if err != nil {
+			Fatalf("Invalid endpoint ID %q: %s", args[0], err)
+		}
+
+		if len(args) == 1 {
+			if err := prefiltermap.ClearEndpointPorts(uint16(epID)); err != nil {
+				Fatalf("Unable to clear ports of endpoint %d: %s", epID, err)
+			}
+			return
+		}
+
+		if len(args) < 3 {
+			Usagef(cmd, "<rule id> and at least one port required")
+		}
+
+		ruleID := parsePrefilterRuleID(args[1])
+		ports, err := parsePrefilterPorts(args[2:])
+		if err != nil {
+			Fatalf("Unable to parse ports: %s", err)
+		}
+
+		if err := prefiltermap.SetEndpointPorts(ruleID, uint16(epID), ports); err != nil {
+			Fatalf("Unable to set ports of endpoint %d: %s", epID, err)
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterPortsCmd)
+}
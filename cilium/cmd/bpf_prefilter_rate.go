@@ -0,0 +1,41 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"strconv"
+
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterRateCmd represents the bpf_prefilter_rate command
+var bpfPrefilterRateCmd = &cobra.Command{
+	Use:   "rate",
+	Short: "Manage XDP prefilter rate limits of source prefixes",
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterRateCmd)
+}
+
+// parseRateClassID parses the ID of a prefilter rate class.
+func parseRateClassID(arg string) uint32 {
+	id, err := strconv.ParseUint(arg, 10, 32)
+	if err != nil || id >= prefiltermap.MaxRateClasses {
+		Fatalf("Invalid class ID %q, must be lower than %d", arg, prefiltermap.MaxRateClasses)
+	}
+	return uint32(id)
+}
@@ -0,0 +1,51 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"net"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterRateAddCmd represents the bpf_prefilter_rate_add command
+var bpfPrefilterRateAddCmd = &cobra.Command{
+	Use:   "add <class id> <cidr>",
+	Short: "Rate limit source prefix",
+	Long:  "Rate limit packets from the source prefix according to the rate class. The most specific prefix of a source selects its class.",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter rate add")
+
+		if len(args) < 2 {
+			Usagef(cmd, "<class id> and <cidr> required")
+		}
+
+		classID := parseRateClassID(args[0])
+		_, cidr, err := net.ParseCIDR(args[1])
+		if err != nil {
+			Fatalf("Unable to parse CIDR %q: %s", args[1], err)
+		}
+
+		if err := prefiltermap.AddRateRule(classID, cidr); err != nil {
+			Fatalf("Unable to rate limit %s: %s", cidr, err)
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterRateCmd.AddCommand(bpfPrefilterRateAddCmd)
+}
@@ -0,0 +1,49 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"net"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterRateDeleteCmd represents the bpf_prefilter_rate_delete command
+var bpfPrefilterRateDeleteCmd = &cobra.Command{
+	Use:   "delete <cidr>",
+	Short: "Remove rate limit of source prefix",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter rate delete")
+
+		if len(args) < 1 {
+			Usagef(cmd, "<cidr> required")
+		}
+
+		_, cidr, err := net.ParseCIDR(args[0])
+		if err != nil {
+			Fatalf("Unable to parse CIDR %q: %s", args[0], err)
+		}
+
+		if err := prefiltermap.DeleteRateRule(cidr); err != nil {
+			Fatalf("Unable to remove rate limit of %s: %s", cidr, err)
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterRateCmd.AddCommand(bpfPrefilterRateDeleteCmd)
+}
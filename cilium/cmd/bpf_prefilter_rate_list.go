@@ -0,0 +1,75 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"strings"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterRateListCmd represents the bpf_prefilter_rate_list command
+var bpfPrefilterRateListCmd = &cobra.Command{
+	Use:     "list",
+	Aliases: []string{"ls"},
+	Short:   "List rate classes with their source prefixes and counters",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter rate list")
+
+		entries, err := prefiltermap.DumpRateClasses()
+		if err != nil {
+			Fatalf("Unable to dump rate classes: %s", err)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(entries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		if len(entries) == 0 {
+			fmt.Fprintf(os.Stderr, "No entries found.\n")
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "CLASS\tRATE\tBURST\tPREFIXES\tPASSED\tDROPPED\n")
+		for _, entry := range entries {
+			rate := "disabled"
+			if entry.Rate != 0 {
+				rate = fmt.Sprintf("%d/s", entry.Rate)
+				if entry.Aggregate {
+					rate += " (aggregate)"
+				}
+			}
+			fmt.Fprintf(w, "%d\t%s\t%d\t%s\t%d\t%d\n", entry.ClassID, rate,
+				entry.Burst, strings.Join(entry.Prefixes, ","),
+				entry.Passed, entry.Dropped)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfPrefilterRateCmd.AddCommand(bpfPrefilterRateListCmd)
+	command.AddJSONOutput(bpfPrefilterRateListCmd)
+}
@@ -0,0 +1,83 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package cmd
+
+import (
+	"strconv"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	prefilterRateSetUsage = `Configure the token bucket of a rate class.
+
+Packets from each source in the prefixes of the class are limited to <rate>
+packets per second, allowing bursts of up to <burst> packets. With
+--aggregate, all sources of the class share a single bucket instead. A rate
+of 0 disables the class.
+`
+)
+
+var rateAggregate bool
+
+// bpfPrefilterRateSetCmd represents the bpf_prefilter_rate_set command
+var bpfPrefilterRateSetCmd = &cobra.Command{
+	Use:   "set <class id> <rate> [<burst>]",
+	Short: "Configure rate class",
+	Long:  prefilterRateSetUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter rate set")
+
+		if len(args) < 2 {
+			Usagef(cmd, "<class id> and <rate> required")
+		}
+
+		classID := parseRateClassID(args[0])
+		rate, err := strconv.ParseUint(args[1], 10, 64)
+		if err != nil {
+			Fatalf("Invalid rate %q: %s", args[1], err)
+		}
+
+		if rate == 0 {
+			if err := prefiltermap.DisableRateClass(classID); err != nil {
+				Fatalf("Unable to disable class %d: %s", classID, err)
+			}
+			return
+		}
+
+		burst := rate
+		if len(args) > 2 {
+			if burst, err = strconv.ParseUint(args[2], 10, 64); err != nil {
+				Fatalf("Invalid burst %q: %s", args[2], err)
+			}
+		}
+
+		class, err := prefiltermap.NewRateClass(rate, burst, rateAggregate)
+		if err != nil {
+			Fatalf("Invalid class parameters: %s", err)
+		}
+
+		if err := prefiltermap.SetRateClass(classID, class); err != nil {
+			Fatalf("Unable to configure class %d: %s", classID, err)
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterRateCmd.AddCommand(bpfPrefilterRateSetCmd)
+	bpfPrefilterRateSetCmd.Flags().BoolVar(&rateAggregate, "aggregate", false, "Share a single bucket between all sources of the class")
+}
@@ -0,0 +1,61 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"os"
+	"text/tabwriter"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/command"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+// bpfPrefilterStatsCmd represents the bpf_prefilter_stats command
+var bpfPrefilterStatsCmd = &cobra.Command{
+	Use:   "stats",
+	Short: "Show XDP prefilter packet and byte counters per verdict reason",
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter stats")
+
+		entries, err := prefiltermap.DumpStats()
+		if err != nil {
+			Fatalf("Unable to dump prefilter statistics: %s", err)
+		}
+
+		if command.OutputJSON() {
+			if err := command.PrintOutput(entries); err != nil {
+				Fatalf("Unable to generate JSON output: %s", err)
+			}
+			return
+		}
+
+		w := tabwriter.NewWriter(os.Stdout, 5, 0, 3, ' ', 0)
+		fmt.Fprintf(w, "VERDICT\tREASON\tPACKETS\tBYTES\n")
+		for _, entry := range entries {
+			fmt.Fprintf(w, "%s\t%s\t%d\t%d\n", entry.Verdict, entry.Reason,
+				entry.Packets, entry.Bytes)
+		}
+		w.Flush()
+	},
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterStatsCmd)
+	command.AddJSONOutput(bpfPrefilterStatsCmd)
+}
@@ -0,0 +1,83 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"strconv"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	prefilterSyncookieUsage = `Protect the listed TCP ports of the local endpoint with SYN cookies in the XDP
+prefilter, replacing any previously protected ports. Connection attempts from
+sources which have not echoed a valid cookie recently are answered by the
+prefilter and accounted to the counters of the rule ID. Without ports, the
+protection of the endpoint is lifted.
+
+The protection is only enforced if the agent runs with --prefilter-syncookies.
+`
+)
+
+// bpfPrefilterSyncookieCmd represents the bpf_prefilter_syncookie command
+var bpfPrefilterSyncookieCmd = &cobra.Command{
+	Use:   "syncookie <endpoint id> [<rule id> <port>...]",
+	Short: "Set ports of local endpoint protected with SYN cookies",
+	Long:  prefilterSyncookieUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf prefilter syncookie")
+
+		if len(args) < 1 {
+			Usagef(cmd, "<endpoint id> required")
+		}
+
+		epID, err := strconv.ParseUint(args[0], 10, 16)
+		if err != nil {
+			Fatalf("Invalid endpoint ID %q: %s", args[0], err)
+		}
+
+		if len(args) == 1 {
+			if err := prefiltermap.ClearSyncookiePorts(uint16(epID)); err != nil {
+				Fatalf("Unable to clear SYN cookie ports of endpoint %d: %s", epID, err)
+			}
+			return
+		}
+
+		if len(args) < 3 {
+			Usagef(cmd, "<rule id> and at least one port required")
+		}
+
+		ruleID := parsePrefilterRuleID(args[1])
+		ports := make([]uint16, 0, len(args)-2)
+		for _, arg := range args[2:] {
+			port, err := strconv.ParseUint(arg, 10, 16)
+			if err != nil || port == 0 {
+				Fatalf("Invalid port %q", arg)
+			}
+			ports = append(ports, uint16(port))
+		}
+
+		if err := prefiltermap.SetSyncookiePorts(ruleID, uint16(epID), ports); err != nil {
+			Fatalf("Unable to set SYN cookie ports of endpoint %d: %s", epID, err)
+		}
+	},
+}
+
+func init() {
+	bpfPrefilterCmd.AddCommand(bpfPrefilterSyncookieCmd)
+}
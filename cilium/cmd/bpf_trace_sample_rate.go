@@ -0,0 +1,67 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package cmd
+
+import (
+	"fmt"
+	"strconv"
+
+	"github.com/cilium/cilium/common"
+	"github.com/cilium/cilium/pkg/maps/tracemap"
+
+	"github.com/spf13/cobra"
+)
+
+const (
+	traceSampleRateUsage = `Show or set the rate at which the datapath samples trace notifications.
+
+With a rate of N, only one in N trace notifications is emitted and carries
+the rate it was sampled at, so that consumers can extrapolate the number of
+forwarded packets. The rate must be a power of two, a rate of 1 disables
+sampling. The setting takes effect immediately and is reset to the value of
+--trace-sample-rate when the agent restarts.
+`
+)
+
+var bpfTraceSampleRateCmd = &cobra.Command{
+	Use:   "sample-rate [<rate>]",
+	Short: "Show or set the sampling rate of trace notifications",
+	Long:  traceSampleRateUsage,
+	Run: func(cmd *cobra.Command, args []string) {
+		common.RequireRootPrivilege("cilium bpf trace sample-rate")
+
+		if len(args) == 0 {
+			rate, err := tracemap.GetSampleRate()
+			if err != nil {
+				Fatalf("Unable to get sampling rate: %s", err)
+			}
+			fmt.Println(rate)
+			return
+		}
+
+		rate, err := strconv.ParseUint(args[0], 10, 64)
+		if err != nil {
+			Fatalf("Invalid sampling rate %q: %s", args[0], err)
+		}
+
+		if err := tracemap.SetSampleRate(rate); err != nil {
+			Fatalf("Unable to set sampling rate: %s", err)
+		}
+	},
+}
+
+func init() {
+	bpfTraceCmd.AddCommand(bpfTraceSampleRateCmd)
+}
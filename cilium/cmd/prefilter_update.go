@@ -26,6 +26,7 @@ import (
 var (
 	revision uint64
 	cidrs    []string
+	replace  bool
 )
 
 var preFilterUpdateCmd = &cobra.Command{
@@ -40,12 +41,14 @@ func init() {
 	preFilterCmd.AddCommand(preFilterUpdateCmd)
 	preFilterUpdateCmd.Flags().Uint64VarP(&revision, "revision", "", 0, "Update revision")
 	preFilterUpdateCmd.Flags().StringSliceVarP(&cidrs, "cidr", "", []string{}, "List of CIDR prefixes to block")
+	preFilterUpdateCmd.Flags().BoolVarP(&replace, "replace", "", false, "Atomically replace all CIDR prefixes with the given list")
 }
 
 func updateFilters(cmd *cobra.Command, args []string) {
 	spec := &models.PrefilterSpec{
 		Revision: int64(revision),
 		Deny:     cidrs,
+		Replace:  replace,
 	}
 	for _, cidr := range cidrs {
 		_, _, err := net.ParseCIDR(cidr)
@@ -61,13 +61,16 @@ import (
 	"github.com/cilium/cilium/pkg/lock"
 	"github.com/cilium/cilium/pkg/logging"
 	"github.com/cilium/cilium/pkg/logging/logfields"
+	"github.com/cilium/cilium/pkg/maps/capturemap"
 	"github.com/cilium/cilium/pkg/maps/ctmap"
 	"github.com/cilium/cilium/pkg/maps/eppolicymap"
 	ipcachemap "github.com/cilium/cilium/pkg/maps/ipcache"
 	"github.com/cilium/cilium/pkg/maps/lbmap"
 	"github.com/cilium/cilium/pkg/maps/lxcmap"
 	"github.com/cilium/cilium/pkg/maps/metricsmap"
+	"github.com/cilium/cilium/pkg/maps/sharedpolicymap"
 	"github.com/cilium/cilium/pkg/maps/sockmap"
+	"github.com/cilium/cilium/pkg/maps/tracemap"
 	"github.com/cilium/cilium/pkg/maps/tunnel"
 	monitorAPI "github.com/cilium/cilium/pkg/monitor/api"
 	"github.com/cilium/cilium/pkg/mtu"
@@ -330,12 +333,6 @@ func (d *Daemon) writeNetdevHeader(dir string) error {
 	return nil
 }
 
-// GetCIDRPrefixLengths returns the sorted list of unique prefix lengths used
-// by CIDR policies.
-func (d *Daemon) GetCIDRPrefixLengths() (s6, s4 []int) {
-	return d.prefixLengths.ToBPFData()
-}
-
 // Must be called with option.Config.EnablePolicyMU locked.
 func (d *Daemon) writePreFilterHeader(dir string) error {
 	headerPath := filepath.Join(dir, common.PreFilterHeaderFileName)
@@ -437,6 +434,15 @@ func (d *Daemon) compileBase() error {
 			scopedLog.WithError(ret).Warn("Unable to init prefilter")
 			return ret
 		}
+		if option.Config.DstPreFilter && !d.preFilter.DestinationsEnabled() {
+			scopedLog.Warn("Kernel lacks LPM map support, prefilter destination rules disabled")
+		}
+		if option.Config.RatePreFilter && !d.preFilter.RateLimitEnabled() {
+			scopedLog.Warn("Kernel lacks LPM or LRU map support, prefilter rate limiting disabled")
+		}
+		if option.Config.CookiePreFilter && !d.preFilter.SyncookiesEnabled() {
+			scopedLog.Warn("Kernel lacks LRU map support, prefilter SYN cookies disabled")
+		}
 
 		if err := d.writePreFilterHeader("./"); err != nil {
 			scopedLog.WithError(err).Warn("Unable to write prefilter header")
@@ -558,7 +564,46 @@ func (d *Daemon) initMaps() error {
 		return err
 	}
 
-	if _, err := ipcachemap.IPCache.OpenOrCreate(); err != nil {
+	if option.Config.EnableEndpointTable {
+		for _, m := range lxcmap.TableMaps() {
+			if _, err := m.OpenOrCreate(); err != nil {
+				return err
+			}
+		}
+	}
+
+	for _, m := range ipcachemap.Maps() {
+		if _, err := m.OpenOrCreate(); err != nil {
+			return err
+		}
+	}
+
+	if !ipcachemap.BackedByLPM() {
+		if _, err := ipcachemap.PrefixesMap.OpenOrCreate(); err != nil {
+			return err
+		}
+		if err := d.updateIPCachePrefixes(); err != nil {
+			return err
+		}
+	}
+
+	if option.Config.EnableIPCacheFrontCache {
+		if _, err := ipcachemap.FrontGenerationMap.OpenOrCreate(); err != nil {
+			return err
+		}
+		// Entries cached by a previous instance may refer to ipcache
+		// content which changed while the agent was down.
+		if err := ipcachemap.BumpFrontGeneration(); err != nil {
+			return err
+		}
+	}
+
+	if err := tracemap.SetSampleRate(uint64(option.Config.TraceSampleRate)); err != nil {
+		return fmt.Errorf("invalid --%s: %s", option.TraceSampleRate, err)
+	}
+
+	// Capture lengths configured at runtime are kept across restarts.
+	if _, err := capturemap.Map.OpenOrCreate(); err != nil {
 		return err
 	}
 
@@ -570,6 +615,12 @@ func (d *Daemon) initMaps() error {
 		return err
 	}
 
+	if option.Config.EnableSharedPolicyMaps {
+		if err := sharedpolicymap.CreateMap(); err != nil {
+			return err
+		}
+	}
+
 	if err := openServiceMaps(); err != nil {
 		log.WithError(err).Fatal("Unable to open service maps")
 	}
@@ -635,7 +686,7 @@ func (d *Daemon) initMaps() error {
 
 		// If we are not restoring state, all endpoints can be
 		// deleted. Entries will be re-populated.
-		lxcmap.LXCMap.DeleteAll()
+		lxcmap.DeleteAll()
 	}
 
 	return nil
@@ -801,6 +852,16 @@ func createIPNet(ones, bits int) *net.IPNet {
 	}
 }
 
+// updateIPCachePrefixes writes the prefix lengths currently in use into the
+// map read by the datapath to lookup the IPCache when it isn't backed by LPM.
+func (d *Daemon) updateIPCachePrefixes() error {
+	s6, s4 := d.prefixLengths.ToBPFData()
+	if err := ipcachemap.UpdatePrefixes(s6, s4); err != nil {
+		return fmt.Errorf("unable to update ipcache prefix lengths: %s", err)
+	}
+	return nil
+}
+
 // createPrefixLengthCounter wraps around the counter library, providing
 // references to prefix lengths that will always be present.
 func createPrefixLengthCounter() *counter.PrefixLengthCounter {
@@ -437,6 +437,33 @@ func init() {
 
 	flags.StringVar(&option.Config.IPSecKeyFile, option.IPSecKeyFileName, "", "Path to IPSec key file")
 
+	flags.Bool(option.EnableIPv4FragmentsTrackingName, defaults.EnableIPv4FragmentsTracking, "Enable IPv4 fragments tracking for L4-based lookups, drops fragments received before the first fragment of their datagram")
+	option.BindEnv(option.EnableIPv4FragmentsTrackingName)
+
+	flags.Bool(option.EnableIPv6FragmentsTrackingName, defaults.EnableIPv6FragmentsTracking, "Enable IPv6 fragments tracking for L4-based lookups, drops fragments received before the first fragment of their datagram")
+	option.BindEnv(option.EnableIPv6FragmentsTrackingName)
+
+	flags.Bool(option.EnableSharedPolicyMapsName, defaults.EnableSharedPolicyMaps, "Share policy maps between endpoints with the same security identity")
+	option.BindEnv(option.EnableSharedPolicyMapsName)
+
+	flags.Bool(option.EnableIPCacheFrontCacheName, defaults.EnableIPCacheFrontCache, "Enable per-CPU datapath cache in front of ipcache lookups")
+	option.BindEnv(option.EnableIPCacheFrontCacheName)
+
+	flags.Bool(option.EnableSplitIPCacheName, defaults.EnableSplitIPCache, "Split the ipcache into separate BPF maps per address family")
+	option.BindEnv(option.EnableSplitIPCacheName)
+
+	flags.Bool(option.EnableEndpointTableName, defaults.EnableEndpointTable, "Look up local endpoints in an array indexed by endpoint ID")
+	option.BindEnv(option.EnableEndpointTableName)
+
+	flags.Bool(option.EnableEndpointDropMetricsName, defaults.EnableEndpointDropMetrics, "Account drops by reason and direction for each endpoint")
+	option.BindEnv(option.EnableEndpointDropMetricsName)
+
+	flags.Bool(option.EnableFlowSummaryName, defaults.EnableFlowSummary, "Aggregate forwarded and dropped packets into flow summaries in the datapath")
+	option.BindEnv(option.EnableFlowSummaryName)
+
+	flags.Bool(option.EnableLatencyHistogramsName, defaults.EnableLatencyHistograms, "Record latency histograms of datapath programs and stages")
+	option.BindEnv(option.EnableLatencyHistogramsName)
+
 	flags.String(option.HTTP403Message, "", "Message returned in proxy L7 403 body")
 	flags.MarkHidden(option.HTTP403Message)
 	option.BindEnv(option.HTTP403Message)
@@ -607,6 +634,12 @@ func init() {
 	flags.Int(option.TracePayloadlen, 128, "Length of payload to capture when tracing")
 	option.BindEnv(option.TracePayloadlen)
 
+	flags.Int(option.TraceSampleRate, 1, "Emit only one in the given number of trace notifications, must be a power of two")
+	option.BindEnv(option.TraceSampleRate)
+
+	flags.Int(option.DropNotifyRate, defaults.DropNotifyRate, "Maximum number of drop notifications per second, drop reason and CPU, 0 for unlimited")
+	option.BindEnv(option.DropNotifyRate)
+
 	flags.Bool(option.Version, false, "Print version information")
 	option.BindEnv(option.Version)
 
@@ -634,6 +667,21 @@ func init() {
 	flags.String(option.PrefilterMode, option.ModePreFilterNative, "Prefilter mode { "+option.ModePreFilterNative+" | "+option.ModePreFilterGeneric+" } (default: "+option.ModePreFilterNative+")")
 	option.BindEnv(option.PrefilterMode)
 
+	flags.Bool(option.PrefilterEndpointPorts, false, "Restrict XDP prefiltered traffic to local endpoints to their allowed ports")
+	option.BindEnv(option.PrefilterEndpointPorts)
+
+	flags.Bool(option.PrefilterDestinations, false, "Apply destination prefix and port rules to XDP prefiltered traffic")
+	option.BindEnv(option.PrefilterDestinations)
+
+	flags.Bool(option.PrefilterRateLimit, false, "Rate limit XDP prefiltered traffic from configured source prefixes")
+	option.BindEnv(option.PrefilterRateLimit)
+
+	flags.Bool(option.PrefilterEncap, false, "Apply XDP prefilter to inner headers of VXLAN and Geneve traffic")
+	option.BindEnv(option.PrefilterEncap)
+
+	flags.Bool(option.PrefilterSyncookies, false, "Challenge connection attempts to configured endpoint ports with SYN cookies in the XDP prefilter")
+	option.BindEnv(option.PrefilterSyncookies)
+
 	flags.Bool(option.PreAllocateMapsName, defaults.PreAllocateMaps, "Enable BPF map pre-allocation")
 	option.BindEnv(option.PreAllocateMapsName)
 
@@ -197,14 +197,15 @@ func (d *Daemon) PolicyAdd(rules policyAPI.Rules, opts *AddOptions) (uint64, err
 		return 0, api.Error(PutPolicyFailureCode, err)
 	}
 	if newPrefixLengths && !bpfIPCache.BackedByLPM() {
-		// Only recompile if configuration has changed.
-		log.Debug("CIDR policy has changed; recompiling base programs")
-		if err := d.compileBase(); err != nil {
+		// Only update the datapath if configuration has changed. The
+		// new prefix lengths must be probed before the CIDR identities
+		// are inserted into the ipcache.
+		log.Debug("CIDR policy has changed; updating ipcache prefix lengths")
+		if err := d.updateIPCachePrefixes(); err != nil {
 			_ = d.prefixLengths.Delete(prefixes)
 			metrics.PolicyImportErrors.Inc()
-			err2 := fmt.Errorf("Unable to recompile base programs: %s", err)
-			log.WithError(err2).WithField("prefixes", prefixes).Warn(
-				"Failed to recompile base programs due to prefix length count change")
+			log.WithError(err).WithField("prefixes", prefixes).Warn(
+				"Failed to update ipcache prefix lengths")
 			return 0, api.Error(PutPolicyFailureCode, err)
 		}
 	}
@@ -318,10 +319,10 @@ func (d *Daemon) PolicyDelete(labels labels.LabelArray) (uint64, error) {
 
 	prefixesChanged := d.prefixLengths.Delete(prefixes)
 	if !bpfIPCache.BackedByLPM() && prefixesChanged {
-		// Only recompile if configuration has changed.
-		log.Debug("CIDR policy has changed; recompiling base programs")
-		if err := d.compileBase(); err != nil {
-			log.WithError(err).Error("Unable to recompile base programs")
+		// Only update the datapath if configuration has changed.
+		log.Debug("CIDR policy has changed; updating ipcache prefix lengths")
+		if err := d.updateIPCachePrefixes(); err != nil {
+			log.WithError(err).Error("Unable to update ipcache prefix lengths")
 		}
 	}
 
@@ -78,7 +78,12 @@ func (h *patchPrefilter) Handle(params PatchPrefilterParams) middleware.Responde
 		}
 		list = append(list, *cidr)
 	}
-	err := h.d.preFilter.Insert(spec.Revision, list)
+	var err error
+	if spec.Replace {
+		err = h.d.preFilter.Replace(spec.Revision, list)
+	} else {
+		err = h.d.preFilter.Insert(spec.Revision, list)
+	}
 	if err != nil {
 		return api.Error(PatchPrefilterFailureCode, err)
 	}
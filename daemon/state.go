@@ -149,6 +149,10 @@ func (d *Daemon) restoreOldEndpoints(dir string, clean bool) (*endpointRestoreSt
 			ep.SetDesiredEgressPolicyEnabledLocked(alwaysEnforce)
 		}
 
+		if option.Config.EnableSharedPolicyMaps {
+			ep.RestoreSharedPolicyMapLocked()
+		}
+
 		ep.Unlock()
 
 		ep.SkipStateClean()
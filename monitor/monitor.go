@@ -21,6 +21,7 @@ import (
 	"io"
 	"io/ioutil"
 	"net"
+	"os"
 	"path"
 	"syscall"
 	"time"
@@ -38,6 +39,10 @@ import (
 const (
 	pollTimeout = 5000
 
+	// ringPollTimeout bounds the delay of events in the ring buffer, the
+	// datapath only wakes up the reader once enough events are pending
+	ringPollTimeout = 100
+
 	// queueSize is the size of the message queue
 	queueSize = 65536
 )
@@ -72,6 +77,7 @@ type Monitor struct {
 	listeners        map[listener.MonitorListener]struct{}
 	nPages           int
 	monitorEvents    *bpf.PerCpuEvents
+	ringEvents       *bpf.RingBufEvents
 }
 
 // agentPipeReader reads agent events from the agentPipe and distributes to all listeners
@@ -135,7 +141,11 @@ func (m *Monitor) registerNewListener(parentCtx context.Context, conn net.Conn,
 		m.perfReaderCancel() // don't leak any old readers, just in case.
 		perfEventReaderCtx, cancel := context.WithCancel(parentCtx)
 		m.perfReaderCancel = cancel
-		go m.perfEventReader(perfEventReaderCtx, m.nPages)
+		if _, err := os.Stat(bpf.MapPath(bpf.EventsRingMapName)); err == nil {
+			go m.ringBufferReader(perfEventReaderCtx)
+		} else {
+			go m.perfEventReader(perfEventReaderCtx, m.nPages)
+		}
 	}
 
 	switch version {
@@ -203,6 +213,7 @@ func (m *Monitor) perfEventReader(stopCtx context.Context, nPages int) {
 	// also grab the callbacks we need to avoid locking again. These methods never change.
 	m.Lock()
 	m.monitorEvents = monitorEvents
+	m.ringEvents = nil
 	receiveEvent := m.receiveEvent
 	lostEvent := m.lostEvent
 	errorEvent := m.errorEvent
@@ -236,16 +247,83 @@ func (m *Monitor) perfEventReader(stopCtx context.Context, nPages int) {
 	}
 }
 
+// ringBufferReader is a goroutine that reads events from the ring buffer
+// shared by all CPUs, used instead of perfEventReader if the datapath emits
+// events to it. It will exit when stopCtx is done.
+func (m *Monitor) ringBufferReader(stopCtx context.Context) {
+	scopedLog := log.WithField(logfields.StartTime, time.Now())
+	scopedLog.Info("Beginning to read ring buffer")
+	defer scopedLog.Info("Stopped reading ring buffer")
+
+	ringEvents, err := bpf.NewRingBufEvents(bpf.EventsRingMapName, bpf.EventsRingLostMapName)
+	if err != nil {
+		scopedLog.WithError(err).Fatal("Cannot initialise BPF ring buffer")
+	}
+	defer ringEvents.Close()
+
+	m.Lock()
+	m.ringEvents = ringEvents
+	m.monitorEvents = nil
+	m.Unlock()
+
+	receiveEvent := func(data []byte, cpu int) {
+		pl := payload.Payload{Data: append([]byte{}, data...), CPU: cpu, Lost: 0, Type: payload.EventSample}
+		m.send(&pl)
+	}
+
+	last := time.Now()
+	for !isCtxDone(stopCtx) {
+		_, err := ringEvents.Poll(ringPollTimeout)
+		switch {
+		case isCtxDone(stopCtx):
+			return
+
+		case err == syscall.EBADF:
+			return
+
+		case err != nil && err != syscall.EINTR:
+			scopedLog.WithError(err).Error("Error in Poll")
+			continue
+		}
+
+		ringEvents.ReadAll(receiveEvent)
+
+		if lost, err := ringEvents.LostEvents(); err != nil {
+			scopedLog.WithError(err).Warn("Unable to read lost events of ring buffer")
+		} else if lost > 0 {
+			pl := payload.Payload{Data: []byte{}, CPU: 0, Lost: lost, Type: payload.RecordLost}
+			m.send(&pl)
+		}
+
+		if time.Since(last) > 5*time.Second {
+			last = time.Now()
+			m.dumpStat()
+		}
+	}
+}
+
 // dumpStat prints out the monitor status in JSON.
 func (m *Monitor) dumpStat() {
 	m.Lock()
 	defer m.Unlock()
 
-	c := int64(m.monitorEvents.Cpus)
-	n := int64(m.monitorEvents.Npages)
-	p := int64(m.monitorEvents.Pagesize)
-	l, _, u := m.monitorEvents.Stats()
-	ms := models.MonitorStatus{Cpus: c, Npages: n, Pagesize: p, Lost: int64(l), Unknown: int64(u)}
+	var ms models.MonitorStatus
+	if m.ringEvents != nil {
+		l, _, u := m.ringEvents.Stats()
+		ms = models.MonitorStatus{
+			Cpus:     1,
+			Npages:   int64(m.ringEvents.Size / m.ringEvents.Pagesize),
+			Pagesize: int64(m.ringEvents.Pagesize),
+			Lost:     int64(l),
+			Unknown:  int64(u),
+		}
+	} else {
+		c := int64(m.monitorEvents.Cpus)
+		n := int64(m.monitorEvents.Npages)
+		p := int64(m.monitorEvents.Pagesize)
+		l, _, u := m.monitorEvents.Stats()
+		ms = models.MonitorStatus{Cpus: c, Npages: n, Pagesize: p, Lost: int64(l), Unknown: int64(u)}
+	}
 
 	mp, err := json.Marshal(ms)
 	if err != nil {
@@ -92,10 +92,30 @@ var cToGO = map[reflect.Type]valueToCheck{
 		sizeOfC:  C.sizeof_struct_ipcache_key,
 		goStruct: reflect.TypeOf(ipcache.Key{}),
 	},
+	reflect.TypeOf(C.struct_ipcache4_key{}): {
+		sizeOfC:  C.sizeof_struct_ipcache4_key,
+		goStruct: reflect.TypeOf(ipcache.Key4{}),
+	},
+	reflect.TypeOf(C.struct_ipcache6_key{}): {
+		sizeOfC:  C.sizeof_struct_ipcache6_key,
+		goStruct: reflect.TypeOf(ipcache.Key6{}),
+	},
 	reflect.TypeOf(C.struct_remote_endpoint_info{}): {
 		sizeOfC:  C.sizeof_struct_remote_endpoint_info,
 		goStruct: reflect.TypeOf(ipcache.RemoteEndpointInfo{}),
 	},
+	reflect.TypeOf(C.struct_ipcache_prefixes{}): {
+		sizeOfC:  C.sizeof_struct_ipcache_prefixes,
+		goStruct: reflect.TypeOf(ipcache.Prefixes{}),
+	},
+	reflect.TypeOf(C.struct_ipcache_prefixes_info{}): {
+		sizeOfC:  C.sizeof_struct_ipcache_prefixes_info,
+		goStruct: reflect.TypeOf(ipcache.PrefixesInfo{}),
+	},
+	reflect.TypeOf(C.struct_ipcache_front_stats{}): {
+		sizeOfC:  C.sizeof_struct_ipcache_front_stats,
+		goStruct: reflect.TypeOf(ipcache.FrontStats{}),
+	},
 	reflect.TypeOf(C.struct_lb4_key{}): {
 		sizeOfC:  C.sizeof_struct_lb4_key,
 		goStruct: reflect.TypeOf(lbmap.Service4Key{}),
@@ -120,10 +140,6 @@ var cToGO = map[reflect.Type]valueToCheck{
 		sizeOfC:  C.sizeof_struct_endpoint_info,
 		goStruct: reflect.TypeOf(lxcmap.EndpointInfo{}),
 	},
-	reflect.TypeOf(C.struct_metrics_key{}): {
-		sizeOfC:  C.sizeof_struct_metrics_key,
-		goStruct: reflect.TypeOf(metricsmap.Key{}),
-	},
 	reflect.TypeOf(C.struct_metrics_value{}): {
 		sizeOfC:  C.sizeof_struct_metrics_value,
 		goStruct: reflect.TypeOf(metricsmap.Value{}),
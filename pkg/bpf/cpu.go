@@ -0,0 +1,85 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package bpf
+
+import (
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"strings"
+	"sync"
+)
+
+const (
+	possibleCPUSysfsPath = "/sys/devices/system/cpu/possible"
+)
+
+var (
+	possibleCPUsOnce sync.Once
+	possibleCPUs     int
+)
+
+// GetNumPossibleCPUs returns a total number of possible CPUS, i.e. CPUs that
+// have been allocated resources and can be brought online if they are present.
+// The number is retrieved by parsing /sys/device/system/cpu/possible.
+//
+// Values of per-CPU maps are laid out as an array of this many elements.
+//
+// See https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/include/linux/cpumask.h?h=v4.19#n50
+// for more details.
+func GetNumPossibleCPUs() int {
+	possibleCPUsOnce.Do(func() {
+		f, err := os.Open(possibleCPUSysfsPath)
+		if err != nil {
+			log.WithError(err).Errorf("unable to open %q", possibleCPUSysfsPath)
+			return
+		}
+		defer f.Close()
+
+		possibleCPUs = getNumPossibleCPUsFromReader(f)
+	})
+
+	return possibleCPUs
+}
+
+func getNumPossibleCPUsFromReader(r io.Reader) int {
+	out, err := ioutil.ReadAll(r)
+	if err != nil {
+		log.WithError(err).Errorf("unable to read %q to get CPU count", possibleCPUSysfsPath)
+		return 0
+	}
+
+	var start, end int
+	count := 0
+	for _, s := range strings.Split(string(out), ",") {
+		// Go's scanf will return an error if a format cannot be fully matched.
+		// So, just ignore it, as a partial match (e.g. when there is only one
+		// CPU) is expected.
+		n, err := fmt.Sscanf(s, "%d-%d", &start, &end)
+
+		switch n {
+		case 0:
+			log.WithError(err).Errorf("failed to scan %q to retrieve number of possible CPUs!", s)
+			return 0
+		case 1:
+			count++
+		default:
+			count += (end - start + 1)
+		}
+	}
+
+	return count
+}
@@ -0,0 +1,40 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package bpf
+
+import (
+	"strings"
+
+	. "gopkg.in/check.v1"
+)
+
+func (s *BPFTestSuite) TestGetNumPossibleCPUsFromReader(c *C) {
+	tests := []struct {
+		in       string
+		expected int
+	}{
+		{"0", 1},
+		{"0-7", 8},
+		{"0,2-3", 3},
+		{"", 0},
+		{"foobar", 0},
+	}
+
+	for _, t := range tests {
+		c.Assert(getNumPossibleCPUsFromReader(strings.NewReader(t.in)), Equals, t.expected)
+	}
+}
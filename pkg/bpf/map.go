@@ -52,6 +52,15 @@ const (
 	MapTypeCPUMap
 	MapTypeXSKMap
 	MapTypeSockHash
+	MapTypeCgroupStorage
+	MapTypeReuseportSockArray
+	MapTypePerCPUCgroupStorage
+	MapTypeQueue
+	MapTypeStack
+	MapTypeSkStorage
+	MapTypeDevMapHash
+	MapTypeStructOps
+	MapTypeRingBuf
 	// MapTypeMaximum is the maximum supported known map type.
 	MapTypeMaximum
 
@@ -114,6 +123,24 @@ func (t MapType) String() string {
 		return "CPU Redirect Map"
 	case MapTypeSockHash:
 		return "Socket Hash"
+	case MapTypeCgroupStorage:
+		return "Cgroup storage"
+	case MapTypeReuseportSockArray:
+		return "Reuseport socket array"
+	case MapTypePerCPUCgroupStorage:
+		return "Per-CPU cgroup storage"
+	case MapTypeQueue:
+		return "Queue"
+	case MapTypeStack:
+		return "Stack"
+	case MapTypeSkStorage:
+		return "Socket storage"
+	case MapTypeDevMapHash:
+		return "Device Map hash"
+	case MapTypeStructOps:
+		return "Struct ops"
+	case MapTypeRingBuf:
+		return "Ring buffer"
 	}
 
 	return "Unknown"
@@ -170,6 +197,8 @@ func mapTypeToFeatureString(mt MapType) string {
 		featureString = fmt.Sprintf("#define HAVE_LPM_MAP_TYPE")
 	case MapTypeLRUHash:
 		featureString = fmt.Sprintf("#define HAVE_LRU_MAP_TYPE")
+	case MapTypeRingBuf:
+		featureString = fmt.Sprintf("#define HAVE_RINGBUF_MAP_TYPE")
 	default:
 		break
 	}
@@ -222,6 +251,10 @@ func GetMapType(t MapType) MapType {
 		if !supportedMapTypes[t] {
 			return MapTypeHash
 		}
+	case MapTypeRingBuf:
+		if !supportedMapTypes[t] {
+			return MapTypePerfEventArray
+		}
 	}
 	return t
 }
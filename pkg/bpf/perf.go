@@ -17,6 +17,22 @@ package bpf
 const (
 	EventsMapName = "cilium_events"
 
+	// EventsRingMapName is the name of the ring buffer the datapath emits
+	// events to instead of EventsMapName if the kernel supports it
+	EventsRingMapName = "cilium_events_ring"
+
+	// EventsRingLostMapName is the name of the per-CPU counter of events
+	// which did not fit into the ring buffer
+	EventsRingLostMapName = "cilium_events_ring_lost"
+
+	// EventsRingSize is the size of the events ring buffer in bytes, it is
+	// shared by all CPUs
+	EventsRingSize = 4 << 20
+
+	// DropNotifyRateMapName is the name of the per-CPU map holding the
+	// token buckets limiting drop notifications per drop reason
+	DropNotifyRateMapName = "cilium_drop_notify_rate"
+
 	PERF_TYPE_HARDWARE   = 0
 	PERF_TYPE_SOFTWARE   = 1
 	PERF_TYPE_TRACEPOINT = 2
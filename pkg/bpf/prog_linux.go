@@ -120,3 +120,65 @@ func GetProgInfoByFD(fd int) (ProgInfo, error) {
 
 	return info, nil
 }
+
+// attrTestRun holds values from the upstream struct union for BPF_PROG_TEST_RUN.
+// From: https://github.com/torvalds/linux/blob/v4.19-rc2/include/uapi/linux/bpf.h
+type attrTestRun struct {
+	progFD      uint32
+	retval      uint32
+	dataSizeIn  uint32
+	dataSizeOut uint32
+	dataIn      uint64
+	dataOut     uint64
+	repeat      uint32
+	duration    uint32
+}
+
+// TestRunResult is the result of running a program with TestRunProgram.
+type TestRunResult struct {
+	// Retval is the return value of the program in the last run
+	Retval uint32
+
+	// Duration is the average run time of the program in ns
+	Duration uint32
+
+	// Data is the packet after the last run
+	Data []byte
+}
+
+// TestRunProgram runs the program referred to by fd on the packet data the
+// given number of times without attaching it, as done by BPF_PROG_TEST_RUN.
+// Map updates of the program persist across the runs. The packet returned
+// in the result may grow up to maxOut bytes, e.g. for encapsulation.
+func TestRunProgram(fd int, data []byte, repeat uint32, maxOut int) (*TestRunResult, error) {
+	if len(data) == 0 {
+		return nil, fmt.Errorf("Unable to test run program: empty packet")
+	}
+
+	out := make([]byte, maxOut)
+	attr := attrTestRun{
+		progFD:      uint32(fd),
+		dataSizeIn:  uint32(len(data)),
+		dataSizeOut: uint32(len(out)),
+		dataIn:      uint64(uintptr(unsafe.Pointer(&data[0]))),
+		repeat:      repeat,
+	}
+	if len(out) > 0 {
+		attr.dataOut = uint64(uintptr(unsafe.Pointer(&out[0])))
+	}
+
+	ret, _, err := unix.Syscall(unix.SYS_BPF, BPF_PROG_TEST_RUN, uintptr(unsafe.Pointer(&attr)), unsafe.Sizeof(attr))
+	if ret != 0 || err != 0 {
+		return nil, fmt.Errorf("Unable to test run program: %v", err)
+	}
+
+	if int(attr.dataSizeOut) < len(out) {
+		out = out[:attr.dataSizeOut]
+	}
+
+	return &TestRunResult{
+		Retval:   attr.retval,
+		Duration: attr.duration,
+		Data:     out,
+	}, nil
+}
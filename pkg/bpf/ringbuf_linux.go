@@ -0,0 +1,240 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build linux
+
+package bpf
+
+import (
+	"fmt"
+	"os"
+	"path"
+	"sync/atomic"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+const (
+	// ringBufBusyBit and ringBufDiscardBit are set in the length of a
+	// record which is still being written or was discarded by the
+	// datapath, see include/uapi/linux/bpf.h
+	ringBufBusyBit    = 1 << 31
+	ringBufDiscardBit = 1 << 30
+
+	// ringBufHdrLen is the length of the kernel's record header
+	ringBufHdrLen = 8
+
+	// eventHdrLen is the length of the header the datapath prepends to
+	// every event, see struct event_ringbuf_hdr in <bpf/lib/events.h>
+	eventHdrLen = 8
+)
+
+// RingBufReceiveFunc is called for each event read from the ring buffer
+// with the CPU which emitted it. The data is only valid during the call.
+type RingBufReceiveFunc func(data []byte, cpu int)
+
+// RingBufEvents reads the events the datapath emits into a BPF ring buffer
+// shared by all CPUs.
+type RingBufEvents struct {
+	Size     int
+	Pagesize int
+
+	fd       int
+	lostFd   int
+	consumer []byte
+	producer []byte
+	data     []byte
+	poll     EPoll
+
+	lost    uint64
+	trunc   uint64
+	unknown uint64
+}
+
+// NewRingBufEvents maps the pinned ring buffer mapName. The per-CPU counter
+// map lostMapName accounts events which did not fit into the buffer.
+func NewRingBufEvents(mapName, lostMapName string) (*RingBufEvents, error) {
+	var err error
+
+	e := &RingBufEvents{
+		Pagesize: os.Getpagesize(),
+		fd:       -1,
+		lostFd:   -1,
+	}
+
+	defer func() {
+		if err != nil {
+			e.Close()
+		}
+	}()
+
+	if !path.IsAbs(mapName) {
+		mapName = MapPath(mapName)
+	}
+	if e.fd, err = ObjGet(mapName); err != nil {
+		return nil, err
+	}
+
+	info, err := GetMapInfo(os.Getpid(), e.fd)
+	if err != nil {
+		return nil, err
+	}
+	if info.MapType != MapTypeRingBuf {
+		err = fmt.Errorf("%s is a %s map", mapName, info.MapType)
+		return nil, err
+	}
+	e.Size = int(info.MaxEntries)
+
+	if !path.IsAbs(lostMapName) {
+		lostMapName = MapPath(lostMapName)
+	}
+	if e.lostFd, err = ObjGet(lostMapName); err != nil {
+		return nil, err
+	}
+
+	e.consumer, err = unix.Mmap(e.fd, 0, e.Pagesize,
+		unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED)
+	if err != nil {
+		err = fmt.Errorf("unable to mmap ring buffer consumer page: %s", err)
+		return nil, err
+	}
+
+	// The data pages are mapped twice in a row so that records wrapping
+	// around the end of the buffer can be read in one piece.
+	e.producer, err = unix.Mmap(e.fd, int64(e.Pagesize), e.Pagesize+2*e.Size,
+		unix.PROT_READ, unix.MAP_SHARED)
+	if err != nil {
+		err = fmt.Errorf("unable to mmap ring buffer data pages: %s", err)
+		return nil, err
+	}
+	e.data = e.producer[e.Pagesize:]
+
+	if e.poll.fd, err = unix.EpollCreate1(0); err != nil {
+		return nil, err
+	}
+	if err = e.poll.AddFD(e.fd, unix.EPOLLIN); err != nil {
+		return nil, err
+	}
+
+	return e, nil
+}
+
+// Poll waits up to timeout milliseconds for the datapath to signal pending
+// events. The datapath batches wakeups, so callers must read after the
+// timeout expired as well.
+func (e *RingBufEvents) Poll(timeout int) (int, error) {
+	return e.poll.Poll(timeout)
+}
+
+// ReadAll reads all events committed so far and returns their number.
+func (e *RingBufEvents) ReadAll(receive RingBufReceiveFunc) int {
+	consumerPos := (*uint64)(unsafe.Pointer(&e.consumer[0]))
+	producerPos := (*uint64)(unsafe.Pointer(&e.producer[0]))
+	mask := uint64(e.Size - 1)
+	n := 0
+
+	cons := atomic.LoadUint64(consumerPos)
+	prod := atomic.LoadUint64(producerPos)
+	for cons < prod {
+		off := cons & mask
+		length := atomic.LoadUint32((*uint32)(unsafe.Pointer(&e.data[off])))
+		if length&ringBufBusyBit != 0 {
+			break
+		}
+
+		recLen := uint64(length &^ ringBufDiscardBit)
+		if length&ringBufDiscardBit == 0 {
+			e.receive(e.data[off+ringBufHdrLen:off+ringBufHdrLen+recLen], receive)
+			n++
+		}
+
+		cons += (ringBufHdrLen + recLen + 7) &^ 7
+		atomic.StoreUint64(consumerPos, cons)
+	}
+
+	return n
+}
+
+func (e *RingBufEvents) receive(record []byte, receive RingBufReceiveFunc) {
+	if len(record) < eventHdrLen {
+		e.unknown++
+		return
+	}
+
+	length := *(*uint32)(unsafe.Pointer(&record[0]))
+	cpu := *(*uint32)(unsafe.Pointer(&record[4]))
+	event := record[eventHdrLen:]
+	if int(length) > len(event) {
+		e.trunc++
+	} else {
+		event = event[:length]
+	}
+
+	receive(event, int(cpu))
+}
+
+// LostEvents returns the number of events which did not fit into the ring
+// buffer since the last call.
+func (e *RingBufEvents) LostEvents() (uint64, error) {
+	possibleCPUs := GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return 0, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	key := uint32(0)
+	values := make([]uint64, possibleCPUs)
+	if err := LookupElement(e.lostFd, unsafe.Pointer(&key), unsafe.Pointer(&values[0])); err != nil {
+		return 0, err
+	}
+
+	total := uint64(0)
+	for _, v := range values {
+		total += v
+	}
+
+	lost := total - e.lost
+	e.lost = total
+	return lost, nil
+}
+
+// Stats returns the number of lost, truncated and unknown events.
+func (e *RingBufEvents) Stats() (uint64, uint64, uint64) {
+	return e.lost, e.trunc, e.unknown
+}
+
+// Close unmaps the ring buffer and releases all file descriptors.
+func (e *RingBufEvents) Close() error {
+	var retErr error
+
+	e.poll.Close()
+	if e.producer != nil {
+		if err := unix.Munmap(e.producer); err != nil {
+			retErr = err
+		}
+	}
+	if e.consumer != nil {
+		if err := unix.Munmap(e.consumer); err != nil {
+			retErr = err
+		}
+	}
+	if e.lostFd >= 0 {
+		unix.Close(e.lostFd)
+	}
+	if e.fd >= 0 {
+		unix.Close(e.fd)
+	}
+
+	return retErr
+}
@@ -0,0 +1,219 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build linux,!privileged_tests
+
+package bpf
+
+import (
+	"encoding/binary"
+	"os"
+
+	"golang.org/x/sys/unix"
+	. "gopkg.in/check.v1"
+)
+
+// testRingBuf emulates the kernel side of a ring buffer on anonymous
+// memory. The data pages are written twice, like the double mapping of the
+// kernel, so that records wrapping around the end can be read in one piece.
+type testRingBuf struct {
+	*RingBufEvents
+	prod uint64
+}
+
+func newTestRingBuf(c *C, size int) *testRingBuf {
+	var err error
+
+	e := &RingBufEvents{
+		Size:     size,
+		Pagesize: os.Getpagesize(),
+		fd:       -1,
+		lostFd:   -1,
+	}
+	e.consumer, err = unix.Mmap(-1, 0, e.Pagesize,
+		unix.PROT_READ|unix.PROT_WRITE, unix.MAP_PRIVATE|unix.MAP_ANON)
+	c.Assert(err, IsNil)
+	e.producer, err = unix.Mmap(-1, 0, e.Pagesize+2*size,
+		unix.PROT_READ|unix.PROT_WRITE, unix.MAP_PRIVATE|unix.MAP_ANON)
+	c.Assert(err, IsNil)
+	e.data = e.producer[e.Pagesize:]
+
+	return &testRingBuf{RingBufEvents: e}
+}
+
+// setPos moves the consumer and producer positions to pos
+func (r *testRingBuf) setPos(pos uint64) {
+	binary.LittleEndian.PutUint64(r.consumer, pos)
+	binary.LittleEndian.PutUint64(r.producer, pos)
+	r.prod = pos
+}
+
+func (r *testRingBuf) consumerPos() uint64 {
+	return binary.LittleEndian.Uint64(r.consumer)
+}
+
+func (r *testRingBuf) write(pos uint64, b []byte) {
+	mask := uint64(r.Size - 1)
+	for i, v := range b {
+		off := (pos + uint64(i)) & mask
+		r.data[off] = v
+		r.data[off+uint64(r.Size)] = v
+	}
+}
+
+// reserve writes a record holding event emitted by cpu with the given flags
+// in the length of the record header, and returns its position.
+func (r *testRingBuf) reserve(event []byte, cpu uint32, flags uint32) uint64 {
+	record := make([]byte, ringBufHdrLen+eventHdrLen+len(event))
+	binary.LittleEndian.PutUint32(record[0:], uint32(eventHdrLen+len(event))|flags)
+	binary.LittleEndian.PutUint32(record[ringBufHdrLen:], uint32(len(event)))
+	binary.LittleEndian.PutUint32(record[ringBufHdrLen+4:], cpu)
+	copy(record[ringBufHdrLen+eventHdrLen:], event)
+
+	pos := r.prod
+	r.write(pos, record)
+	r.prod += uint64(len(record)+7) &^ 7
+	binary.LittleEndian.PutUint64(r.producer, r.prod)
+	return pos
+}
+
+// commit clears the busy bit of the record at pos
+func (r *testRingBuf) commit(pos uint64) {
+	hdr := make([]byte, 4)
+	off := pos & uint64(r.Size-1)
+	length := binary.LittleEndian.Uint32(r.data[off:]) &^ ringBufBusyBit
+	binary.LittleEndian.PutUint32(hdr, length)
+	r.write(pos, hdr)
+}
+
+type ringBufEvent struct {
+	data string
+	cpu  int
+}
+
+func (r *testRingBuf) readAll() (int, []ringBufEvent) {
+	events := []ringBufEvent{}
+	n := r.ReadAll(func(data []byte, cpu int) {
+		events = append(events, ringBufEvent{string(data), cpu})
+	})
+	return n, events
+}
+
+func (s *BPFTestSuite) TestRingBufReadAll(c *C) {
+	r := newTestRingBuf(c, os.Getpagesize())
+	defer r.Close()
+
+	n, events := r.readAll()
+	c.Assert(n, Equals, 0)
+	c.Assert(events, HasLen, 0)
+
+	r.reserve([]byte("first"), 1, 0)
+	r.reserve([]byte("second event"), 3, 0)
+	n, events = r.readAll()
+	c.Assert(n, Equals, 2)
+	c.Assert(events, DeepEquals, []ringBufEvent{{"first", 1}, {"second event", 3}})
+	c.Assert(r.consumerPos(), Equals, r.prod)
+
+	// Nothing is read twice
+	n, _ = r.readAll()
+	c.Assert(n, Equals, 0)
+}
+
+func (s *BPFTestSuite) TestRingBufBusy(c *C) {
+	r := newTestRingBuf(c, os.Getpagesize())
+	defer r.Close()
+
+	// Reading stops at a record still being written, even if records
+	// after it were already committed.
+	r.reserve([]byte("a"), 0, 0)
+	busy := r.reserve([]byte("b"), 0, ringBufBusyBit)
+	r.reserve([]byte("c"), 0, 0)
+
+	n, events := r.readAll()
+	c.Assert(n, Equals, 1)
+	c.Assert(events, DeepEquals, []ringBufEvent{{"a", 0}})
+	c.Assert(r.consumerPos(), Equals, busy)
+
+	r.commit(busy)
+	n, events = r.readAll()
+	c.Assert(n, Equals, 2)
+	c.Assert(events, DeepEquals, []ringBufEvent{{"b", 0}, {"c", 0}})
+	c.Assert(r.consumerPos(), Equals, r.prod)
+}
+
+func (s *BPFTestSuite) TestRingBufDiscard(c *C) {
+	r := newTestRingBuf(c, os.Getpagesize())
+	defer r.Close()
+
+	// Discarded records are consumed without being passed on
+	r.reserve([]byte("dropped"), 0, ringBufDiscardBit)
+	r.reserve([]byte("kept"), 2, 0)
+	r.reserve([]byte("dropped too"), 0, ringBufDiscardBit)
+
+	n, events := r.readAll()
+	c.Assert(n, Equals, 1)
+	c.Assert(events, DeepEquals, []ringBufEvent{{"kept", 2}})
+	c.Assert(r.consumerPos(), Equals, r.prod)
+}
+
+func (s *BPFTestSuite) TestRingBufWraparound(c *C) {
+	size := os.Getpagesize()
+	r := newTestRingBuf(c, size)
+	defer r.Close()
+
+	// Start shortly before the end of the data pages, such that the
+	// second record wraps around, after several rounds through the
+	// buffer.
+	r.setPos(uint64(3*size - 32))
+
+	r.reserve([]byte("before"), 0, 0)
+	wrapped := r.reserve([]byte("across the end"), 1, 0)
+	r.reserve([]byte("after"), 2, 0)
+	c.Assert(wrapped&uint64(size-1)+ringBufHdrLen <= uint64(size), Equals, true)
+	c.Assert(wrapped&uint64(size-1)+32 > uint64(size), Equals, true)
+
+	n, events := r.readAll()
+	c.Assert(n, Equals, 3)
+	c.Assert(events, DeepEquals, []ringBufEvent{
+		{"before", 0}, {"across the end", 1}, {"after", 2},
+	})
+	c.Assert(r.consumerPos(), Equals, r.prod)
+}
+
+func (s *BPFTestSuite) TestRingBufTruncated(c *C) {
+	r := newTestRingBuf(c, os.Getpagesize())
+	defer r.Close()
+
+	// An event header claiming more data than the record holds is
+	// passed on in full and accounted as truncated. A record too short
+	// to hold the event header is accounted as unknown.
+	pos := r.reserve([]byte("short"), 0, 0)
+	length := make([]byte, 4)
+	binary.LittleEndian.PutUint32(length, 100)
+	r.write(pos+ringBufHdrLen, length)
+
+	record := make([]byte, ringBufHdrLen+4)
+	binary.LittleEndian.PutUint32(record, 4)
+	r.write(r.prod, record)
+	r.prod += uint64(len(record)+7) &^ 7
+	binary.LittleEndian.PutUint64(r.producer, r.prod)
+
+	n, events := r.readAll()
+	c.Assert(n, Equals, 2)
+	c.Assert(events, DeepEquals, []ringBufEvent{{"short", 0}})
+
+	_, trunc, unknown := r.Stats()
+	c.Assert(trunc, Equals, uint64(1))
+	c.Assert(unknown, Equals, uint64(1))
+}
@@ -18,6 +18,7 @@ import (
 	"fmt"
 	"net"
 	"os"
+	"path/filepath"
 	"sync"
 	"time"
 
@@ -29,6 +30,7 @@ import (
 	"github.com/cilium/cilium/pkg/logging/logfields"
 	ipcacheMap "github.com/cilium/cilium/pkg/maps/ipcache"
 	"github.com/cilium/cilium/pkg/node"
+	"github.com/cilium/cilium/pkg/option"
 
 	"github.com/sirupsen/logrus"
 )
@@ -48,24 +50,25 @@ type datapath interface {
 // controller launched from OnIPIdentityCacheGC(). However, The listener is not
 // updated after initialization so no locking is provided for access.
 type BPFListener struct {
-	// bpfMap is the BPF map that this listener will update when events are
-	// received from the IPCache.
-	bpfMap *ipcacheMap.Map
+	// bpfMaps are the BPF maps that this listener will update when events
+	// are received from the IPCache. Each entry is written to the maps
+	// which handle its address family.
+	bpfMaps []*ipcacheMap.Map
 
 	// datapath allows this listener to trigger BPF program regeneration.
 	datapath datapath
 }
 
-func newListener(m *ipcacheMap.Map, d datapath) *BPFListener {
+func newListener(m []*ipcacheMap.Map, d datapath) *BPFListener {
 	return &BPFListener{
-		bpfMap:   m,
+		bpfMaps:  m,
 		datapath: d,
 	}
 }
 
 // NewListener returns a new listener to push IPCache entries into BPF maps.
 func NewListener(d datapath) *BPFListener {
-	return newListener(ipcacheMap.IPCache, d)
+	return newListener(ipcacheMap.Maps(), d)
 }
 
 // OnIPIdentityCacheChange is called whenever there is a change of state in the
@@ -91,38 +94,60 @@ func (l *BPFListener) OnIPIdentityCacheChange(modType ipcache.CacheModification,
 
 	// Update BPF Maps.
 
-	key := ipcacheMap.NewKey(cidr.IP, cidr.Mask)
-
-	switch modType {
-	case ipcache.Upsert:
-		value := ipcacheMap.RemoteEndpointInfo{
-			SecurityIdentity: uint32(newID),
+	for _, bpfMap := range l.bpfMaps {
+		if !bpfMap.Handles(cidr.IP) {
+			continue
 		}
 
-		if newHostIP != nil {
-			// If the hostIP is specified and it doesn't point to
-			// the local host, then the ipcache should be populated
-			// with the hostIP so that this traffic can be guided
-			// to a tunnel endpoint destination.
-			externalIP := node.GetExternalIPv4()
-			if ip4 := newHostIP.To4(); ip4 != nil && !ip4.Equal(externalIP) {
-				copy(value.TunnelEndpoint[:], ip4)
+		key := bpfMap.NewKey(cidr.IP, cidr.Mask)
+
+		switch modType {
+		case ipcache.Upsert:
+			value := ipcacheMap.RemoteEndpointInfo{
+				SecurityIdentity: uint32(newID),
 			}
+
+			if newHostIP != nil {
+				// If the hostIP is specified and it doesn't point to
+				// the local host, then the ipcache should be populated
+				// with the hostIP so that this traffic can be guided
+				// to a tunnel endpoint destination.
+				externalIP := node.GetExternalIPv4()
+				if ip4 := newHostIP.To4(); ip4 != nil && !ip4.Equal(externalIP) {
+					copy(value.TunnelEndpoint[:], ip4)
+				}
+			}
+			err := bpfMap.Update(key, &value)
+			if err != nil {
+				scopedLog.WithError(err).WithFields(logrus.Fields{"key": key.String(),
+					"value": value.String()}).
+					Warning("unable to update bpf map")
+			}
+		case ipcache.Delete:
+			err := bpfMap.Delete(key)
+			if err != nil {
+				scopedLog.WithError(err).WithFields(logrus.Fields{"key": key.String()}).
+					Warning("unable to delete from bpf map")
+			}
+		default:
+			scopedLog.Warning("cache modification type not supported")
+			return
 		}
-		err := l.bpfMap.Update(&key, &value)
-		if err != nil {
-			scopedLog.WithError(err).WithFields(logrus.Fields{"key": key.String(),
-				"value": value.String()}).
-				Warning("unable to update bpf map")
-		}
-	case ipcache.Delete:
-		err := l.bpfMap.Delete(&key)
-		if err != nil {
-			scopedLog.WithError(err).WithFields(logrus.Fields{"key": key.String()}).
-				Warning("unable to delete from bpf map")
-		}
-	default:
-		scopedLog.Warning("cache modification type not supported")
+	}
+
+	invalidateFrontCache()
+}
+
+// invalidateFrontCache bumps the generation of the datapath front cache of
+// the ipcache so that entries cached before the last modification of the BPF
+// map are no longer used.
+func invalidateFrontCache() {
+	if !option.Config.EnableIPCacheFrontCache {
+		return
+	}
+
+	if err := ipcacheMap.BumpFrontGeneration(); err != nil {
+		log.WithError(err).Warning("Unable to invalidate ipcache front cache")
 	}
 }
 
@@ -131,9 +156,8 @@ func (l *BPFListener) OnIPIdentityCacheChange(modType ipcache.CacheModification,
 // do not exist in the in-memory ipcache.
 //
 // Must be called while holding ipcache.IPIdentityCache.Lock for reading.
-func updateStaleEntriesFunction(keysToRemove map[string]*ipcacheMap.Key) bpf.DumpCallback {
-	return func(key bpf.MapKey, value bpf.MapValue) {
-		k := key.(*ipcacheMap.Key)
+func updateStaleEntriesFunction(keysToRemove map[string]bpf.MapKey) bpf.DumpCallback {
+	return func(k bpf.MapKey, value bpf.MapValue) {
 		keyToIP := k.String()
 
 		// Don't RLock as part of the same goroutine.
@@ -203,57 +227,86 @@ func (l *BPFListener) garbageCollect() error {
 	defer ipcache.IPIdentityCache.RUnlock()
 
 	if ipcacheMap.SupportsDelete() {
-		keysToRemove := map[string]*ipcacheMap.Key{}
-		if err := l.bpfMap.DumpWithCallback(updateStaleEntriesFunction(keysToRemove)); err != nil {
-			return fmt.Errorf("error dumping ipcache BPF map: %s", err)
-		}
+		removed := false
+		for _, bpfMap := range l.bpfMaps {
+			keysToRemove := map[string]bpf.MapKey{}
+			if err := bpfMap.DumpWithCallback(updateStaleEntriesFunction(keysToRemove)); err != nil {
+				return fmt.Errorf("error dumping ipcache BPF map: %s", err)
+			}
 
-		// Remove all keys which are not in in-memory cache from BPF map
-		// for consistency.
-		for _, k := range keysToRemove {
-			log.WithFields(logrus.Fields{logfields.BPFMapKey: k}).
-				Debug("deleting from ipcache BPF map")
-			if err := l.bpfMap.Delete(k); err != nil {
-				return fmt.Errorf("error deleting key %s from ipcache BPF map: %s", k, err)
+			// Remove all keys which are not in in-memory cache from BPF map
+			// for consistency.
+			for _, k := range keysToRemove {
+				log.WithFields(logrus.Fields{logfields.BPFMapKey: k}).
+					Debug("deleting from ipcache BPF map")
+				if err := bpfMap.Delete(k); err != nil {
+					return fmt.Errorf("error deleting key %s from ipcache BPF map: %s", k, err)
+				}
 			}
+			removed = removed || len(keysToRemove) > 0
+		}
+		if removed {
+			invalidateFrontCache()
 		}
 	} else {
-		// Populate the map at the new path
-		pendingMapName := fmt.Sprintf("%s_pending", ipcacheMap.Name)
-		pendingMap := ipcacheMap.NewMap(pendingMapName)
-		if _, err := pendingMap.OpenOrCreate(); err != nil {
-			return fmt.Errorf("Unable to create %s map: %s", pendingMapName, err)
+		// Populate the maps at the new paths
+		mapNames := make([]string, 0, len(l.bpfMaps))
+		pendingMaps := make([]*ipcacheMap.Map, 0, len(l.bpfMaps))
+		for _, bpfMap := range l.bpfMaps {
+			mapPath, err := bpfMap.Path()
+			if err != nil {
+				return err
+			}
+			mapName := filepath.Base(mapPath)
+			pendingMapName := fmt.Sprintf("%s_pending", mapName)
+			pendingMap := ipcacheMap.NewMapLike(bpfMap, pendingMapName)
+			if _, err := pendingMap.OpenOrCreate(); err != nil {
+				return fmt.Errorf("Unable to create %s map: %s", pendingMapName, err)
+			}
+			mapNames = append(mapNames, mapName)
+			pendingMaps = append(pendingMaps, pendingMap)
 		}
-		pendingListener := newListener(pendingMap, l.datapath)
+		pendingListener := newListener(pendingMaps, l.datapath)
 		ipcache.IPIdentityCache.DumpToListenerLocked(pendingListener)
-		err := pendingMap.Close()
-		if err != nil {
-			log.WithError(err).WithField("map-name", pendingMapName).Warning("unable to close map")
+		for i, pendingMap := range pendingMaps {
+			if err := pendingMap.Close(); err != nil {
+				log.WithError(err).WithField("map-name", mapNames[i]+"_pending").Warning("unable to close map")
+			}
 		}
 
 		// Move the maps around on the filesystem so that BPF reload
 		// will pick up the new paths without requiring recompilation.
-		backupMapName := fmt.Sprintf("%s_old", ipcacheMap.Name)
-		if err := shuffleMaps(ipcacheMap.Name, backupMapName, pendingMapName); err != nil {
-			return err
+		for i, mapName := range mapNames {
+			backupMapName := fmt.Sprintf("%s_old", mapName)
+			if err := shuffleMaps(mapName, backupMapName, mapName+"_pending"); err != nil {
+				for _, shuffled := range mapNames[:i] {
+					handleMapShuffleFailure(shuffled+"_old", shuffled)
+				}
+				return err
+			}
 		}
 
 		wg, err := l.datapath.TriggerReloadWithoutCompile("datapath ipcache")
 		if err != nil {
-			handleMapShuffleFailure(backupMapName, ipcacheMap.Name)
+			for _, mapName := range mapNames {
+				handleMapShuffleFailure(mapName+"_old", mapName)
+			}
 			return err
 		}
 
 		// If the base programs successfully compiled, then the maps
 		// should be OK so let's update all references to the IPCache
 		// so that they point to the new version.
-		_ = os.RemoveAll(bpf.MapPath(backupMapName))
+		for _, mapName := range mapNames {
+			_ = os.RemoveAll(bpf.MapPath(mapName + "_old"))
+		}
 		if err := ipcacheMap.Reopen(); err != nil {
 			// Very unlikely; base program compilation succeeded.
 			log.WithError(err).Warning("Failed to reopen BPF ipcache map")
 			return err
 		}
 		wg.Wait()
+		invalidateFrontCache()
 	}
 	return nil
 }
@@ -25,17 +25,24 @@ import (
 	"github.com/cilium/cilium/pkg/datapath"
 	"github.com/cilium/cilium/pkg/identity"
 	"github.com/cilium/cilium/pkg/labels"
+	"github.com/cilium/cilium/pkg/maps/capturemap"
 	bpfconfig "github.com/cilium/cilium/pkg/maps/configmap"
 	"github.com/cilium/cilium/pkg/maps/ctmap"
+	"github.com/cilium/cilium/pkg/maps/debugmap"
 	"github.com/cilium/cilium/pkg/maps/eppolicymap"
+	"github.com/cilium/cilium/pkg/maps/flowmap"
+	"github.com/cilium/cilium/pkg/maps/fragmap"
 	"github.com/cilium/cilium/pkg/maps/ipcache"
 	ipcachemap "github.com/cilium/cilium/pkg/maps/ipcache"
+	"github.com/cilium/cilium/pkg/maps/latencymap"
 	"github.com/cilium/cilium/pkg/maps/lbmap"
 	"github.com/cilium/cilium/pkg/maps/lxcmap"
 	"github.com/cilium/cilium/pkg/maps/metricsmap"
 	"github.com/cilium/cilium/pkg/maps/policymap"
 	"github.com/cilium/cilium/pkg/maps/proxymap"
+	"github.com/cilium/cilium/pkg/maps/sharedpolicymap"
 	"github.com/cilium/cilium/pkg/maps/sockmap"
+	"github.com/cilium/cilium/pkg/maps/tracemap"
 	"github.com/cilium/cilium/pkg/maps/tunnel"
 	"github.com/cilium/cilium/pkg/node"
 	"github.com/cilium/cilium/pkg/option"
@@ -87,11 +94,29 @@ func (l *linuxDatapath) WriteNodeConfig(w io.Writer, cfg *datapath.LocalNodeConf
 	fmt.Fprintf(fw, "#define PROXY_MAP_SIZE %d\n", proxymap.MaxEntries)
 	fmt.Fprintf(fw, "#define ENDPOINTS_MAP %s\n", lxcmap.MapName)
 	fmt.Fprintf(fw, "#define ENDPOINTS_MAP_SIZE %d\n", lxcmap.MaxEntries)
+	if option.Config.EnableEndpointTable {
+		fmt.Fprintf(fw, "#define ENABLE_ENDPOINT_TABLE 1\n")
+		fmt.Fprintf(fw, "#define ENDPOINTS_TABLE_MAP %s\n", lxcmap.TableMapName)
+		fmt.Fprintf(fw, "#define ENDPOINTS4_ID_MAP %s\n", lxcmap.ID4MapName)
+		fmt.Fprintf(fw, "#define ENDPOINTS6_ID_MAP %s\n", lxcmap.ID6MapName)
+	}
 	fmt.Fprintf(fw, "#define METRICS_MAP %s\n", metricsmap.MapName)
 	fmt.Fprintf(fw, "#define METRICS_MAP_SIZE %d\n", metricsmap.MaxEntries)
 	fmt.Fprintf(fw, "#define POLICY_MAP_SIZE %d\n", policymap.MaxEntries)
 	fmt.Fprintf(fw, "#define IPCACHE_MAP %s\n", ipcachemap.Name)
+	if option.Config.EnableSplitIPCache {
+		fmt.Fprintf(fw, "#define ENABLE_SPLIT_IPCACHE 1\n")
+		fmt.Fprintf(fw, "#define IPCACHE4_MAP %s\n", ipcachemap.Name4)
+		fmt.Fprintf(fw, "#define IPCACHE6_MAP %s\n", ipcachemap.Name6)
+	}
 	fmt.Fprintf(fw, "#define IPCACHE_MAP_SIZE %d\n", ipcachemap.MaxEntries)
+	if option.Config.EnableIPCacheFrontCache {
+		fmt.Fprintf(fw, "#define ENABLE_IPCACHE_FRONT_CACHE 1\n")
+		fmt.Fprintf(fw, "#define IPCACHE_FRONT_MAP %s\n", ipcachemap.FrontMapName)
+		fmt.Fprintf(fw, "#define IPCACHE_FRONT_MAP_SIZE %d\n", ipcachemap.FrontMapSize)
+		fmt.Fprintf(fw, "#define IPCACHE_FRONT_GEN_MAP %s\n", ipcachemap.FrontGenMapName)
+		fmt.Fprintf(fw, "#define IPCACHE_FRONT_STATS_MAP %s\n", ipcachemap.FrontStatsMapName)
+	}
 	fmt.Fprintf(fw, "#define POLICY_PROG_MAP_SIZE %d\n", policymap.ProgArrayMaxEntries)
 	fmt.Fprintf(fw, "#define SOCKOPS_MAP_SIZE %d\n", sockmap.MaxEntries)
 
@@ -104,10 +129,35 @@ func (l *linuxDatapath) WriteNodeConfig(w io.Writer, cfg *datapath.LocalNodeConf
 	}
 
 	fmt.Fprintf(fw, "#define EVENTS_MAP %s\n", "cilium_events")
+	fmt.Fprintf(fw, "#define TRACE_CONFIG_MAP %s\n", tracemap.MapName)
+	fmt.Fprintf(fw, "#define CAPTURE_LEN_MAP %s\n", capturemap.MapName)
+	fmt.Fprintf(fw, "#define DEBUG_FILTER_MAP %s\n", debugmap.MapName)
+	if option.Config.DropNotifyRate > 0 {
+		fmt.Fprintf(fw, "#define DROP_NOTIFY_RATE %d\n", option.Config.DropNotifyRate)
+		fmt.Fprintf(fw, "#define DROP_NOTIFY_RATE_MAP %s\n", bpf.DropNotifyRateMapName)
+	}
+	if option.Config.EnableFlowSummary {
+		fmt.Fprint(fw, "#define ENABLE_FLOW_SUMMARY 1\n")
+		fmt.Fprintf(fw, "#define FLOW_SUMMARY_MAP %s\n", flowmap.MapName)
+		fmt.Fprintf(fw, "#define FLOW_SUMMARY_MAP_SIZE %d\n", flowmap.MaxEntries)
+	}
+	if option.Config.EnableLatencyHistograms {
+		fmt.Fprint(fw, "#define ENABLE_LATENCY_HISTOGRAMS 1\n")
+		fmt.Fprintf(fw, "#define LATENCY_MAP %s\n", latencymap.MapName)
+	}
+	if bpf.GetMapType(bpf.MapTypeRingBuf) == bpf.MapTypeRingBuf {
+		fmt.Fprintf(fw, "#define EVENTS_RINGBUF_MAP %s\n", bpf.EventsRingMapName)
+		fmt.Fprintf(fw, "#define EVENTS_RINGBUF_LOST_MAP %s\n", bpf.EventsRingLostMapName)
+		fmt.Fprintf(fw, "#define EVENTS_RINGBUF_SIZE %d\n", bpf.EventsRingSize)
+	}
 	fmt.Fprintf(fw, "#define POLICY_CALL_MAP %s\n", policymap.CallMapName)
 	fmt.Fprintf(fw, "#define PROXY4_MAP cilium_proxy4\n")
 	fmt.Fprintf(fw, "#define PROXY6_MAP cilium_proxy6\n")
 	fmt.Fprintf(fw, "#define EP_POLICY_MAP %s\n", eppolicymap.MapName)
+	if option.Config.EnableSharedPolicyMaps {
+		fmt.Fprintf(fw, "#define ENABLE_SHARED_POLICY_MAPS 1\n")
+		fmt.Fprintf(fw, "#define EP_SHARED_POLICY_MAP %s\n", sharedpolicymap.MapName)
+	}
 	fmt.Fprintf(fw, "#define LB6_REVERSE_NAT_MAP cilium_lb6_reverse_nat\n")
 	fmt.Fprintf(fw, "#define LB6_SERVICES_MAP cilium_lb6_services\n")
 	fmt.Fprintf(fw, "#define LB6_RR_SEQ_MAP cilium_lb6_rr_seq\n")
@@ -127,6 +177,17 @@ func (l *linuxDatapath) WriteNodeConfig(w io.Writer, cfg *datapath.LocalNodeConf
 	if option.Config.EnableIPSec {
 		fmt.Fprintf(fw, "#define ENABLE_IPSEC 1\n")
 	}
+	if option.Config.EnableIPv4 && option.Config.EnableIPv4FragmentsTracking {
+		fmt.Fprintf(fw, "#define ENABLE_IPV4_FRAGMENTS 1\n")
+		fmt.Fprintf(fw, "#define IPV4_FRAG_DATAGRAMS_MAP %s\n", fragmap.MapName)
+		fmt.Fprintf(fw, "#define CILIUM_IPV4_FRAG_MAP_MAX_ENTRIES %d\n", fragmap.MaxEntries)
+	}
+
+	if option.Config.EnableIPv6 && option.Config.EnableIPv6FragmentsTracking {
+		fmt.Fprintf(fw, "#define ENABLE_IPV6_FRAGMENTS 1\n")
+		fmt.Fprintf(fw, "#define IPV6_FRAG_DATAGRAMS_MAP %s\n", fragmap.MapName6)
+		fmt.Fprintf(fw, "#define CILIUM_IPV6_FRAG_MAP_MAX_ENTRIES %d\n", fragmap.MaxEntries)
+	}
 
 	return fw.Flush()
 }
@@ -137,21 +198,12 @@ func (l *linuxDatapath) writeNetdevConfig(w io.Writer, cfg datapath.DeviceConfig
 		fmt.Fprint(w, "#define HOST_REDIRECT_TO_INGRESS 1\n")
 	}
 
-	// In case the Linux kernel doesn't support LPM map type, pass the set
-	// of prefix length for the datapath to lookup the map.
-	if ipcache.IPCache.MapType != bpf.BPF_MAP_TYPE_LPM_TRIE {
-		ipcachePrefixes6, ipcachePrefixes4 := cfg.GetCIDRPrefixLengths()
-
-		fmt.Fprint(w, "#define IPCACHE6_PREFIXES ")
-		for _, prefix := range ipcachePrefixes6 {
-			fmt.Fprintf(w, "%d,", prefix)
-		}
-		fmt.Fprint(w, "\n")
-		fmt.Fprint(w, "#define IPCACHE4_PREFIXES ")
-		for _, prefix := range ipcachePrefixes4 {
-			fmt.Fprintf(w, "%d,", prefix)
-		}
-		fmt.Fprint(w, "\n")
+	// In case the Linux kernel doesn't support LPM map type, the datapath
+	// reads the set of prefix lengths to lookup the map from a map kept up
+	// to date by the agent.
+	if !ipcache.BackedByLPM() {
+		fmt.Fprint(w, "#define ENABLE_IPCACHE_PREFIXES_MAP 1\n")
+		fmt.Fprintf(w, "#define IPCACHE_PREFIXES_MAP %s\n", ipcache.PrefixesMapName)
 	}
 }
 
@@ -185,9 +237,17 @@ func (l *linuxDatapath) WriteEndpointConfig(w io.Writer, e datapath.EndpointConf
 	fmt.Fprintf(fw, defineUint32("SECLABEL_NB", byteorder.HostToNetwork(secID).(uint32)))
 
 	epID := uint16(e.GetID())
-	fmt.Fprintf(fw, "#define POLICY_MAP %s\n", bpf.LocalMapName(policymap.MapName, epID))
+	// With shared policy maps, the policy map is looked up by endpoint ID
+	// in EP_SHARED_POLICY_MAP instead.
+	if !option.Config.EnableSharedPolicyMaps {
+		fmt.Fprintf(fw, "#define POLICY_MAP %s\n", bpf.LocalMapName(policymap.MapName, epID))
+	}
 	fmt.Fprintf(fw, "#define CALLS_MAP %s\n", bpf.LocalMapName("cilium_calls_", epID))
 	fmt.Fprintf(fw, "#define CONFIG_MAP %s\n", bpf.LocalMapName(bpfconfig.MapNamePrefix, epID))
+	if option.Config.EnableEndpointDropMetrics {
+		fmt.Fprint(fw, "#define ENABLE_ENDPOINT_DROP_METRICS 1\n")
+		fmt.Fprintf(fw, "#define EP_METRICS_MAP %s\n", metricsmap.EndpointMapName(epID))
+	}
 
 	if e.ConntrackLocalLocked() {
 		ctmap.WriteBPFMacros(fw, e)
@@ -28,7 +28,13 @@ import (
 	"github.com/cilium/cilium/pkg/logging/logfields"
 	bpfconfig "github.com/cilium/cilium/pkg/maps/configmap"
 	"github.com/cilium/cilium/pkg/maps/ctmap"
+	"github.com/cilium/cilium/pkg/maps/flowmap"
+	ipcachemap "github.com/cilium/cilium/pkg/maps/ipcache"
+	"github.com/cilium/cilium/pkg/maps/latencymap"
+	"github.com/cilium/cilium/pkg/maps/lxcmap"
+	"github.com/cilium/cilium/pkg/maps/metricsmap"
 	"github.com/cilium/cilium/pkg/maps/policymap"
+	"github.com/cilium/cilium/pkg/maps/sharedpolicymap"
 	"github.com/cilium/cilium/pkg/option"
 )
 
@@ -79,6 +85,25 @@ func checkStaleGlobalMap(path string, filename string) {
 	}
 }
 
+// checkStaleSharedPolicyMap removes per-identity policy maps if shared policy
+// maps are disabled or no endpoint with the identity exists anymore.
+func checkStaleSharedPolicyMap(path string, filename string) {
+	identity, ok := sharedpolicymap.IdentityFromMapName(filename)
+	if !ok {
+		return
+	}
+
+	if option.Config.EnableSharedPolicyMaps {
+		for _, ep := range endpointmanager.GetEndpoints() {
+			if ep.GetIdentity().Uint32() == identity {
+				return
+			}
+		}
+	}
+
+	removeStaleMap(path)
+}
+
 func staleMapWalker(path string) error {
 	filename := filepath.Base(path)
 
@@ -91,9 +116,11 @@ func staleMapWalker(path string) error {
 		endpoint.CallsMapName,
 		bpfconfig.MapNamePrefix,
 		endpoint.IpvlanMapName,
+		metricsmap.EndpointMapPrefix,
 	}
 
 	checkStaleGlobalMap(path, filename)
+	checkStaleSharedPolicyMap(path, filename)
 
 	for _, m := range mapPrefix {
 		if strings.HasPrefix(filename, m) {
@@ -132,6 +159,46 @@ func RemoveDisabledMaps() {
 			"cilium_proxy4"}...)
 	}
 
+	if !option.Config.EnableSharedPolicyMaps {
+		maps = append(maps, sharedpolicymap.MapName)
+	}
+
+	if !option.Config.EnableIPCacheFrontCache {
+		maps = append(maps, []string{
+			ipcachemap.FrontMapName,
+			ipcachemap.FrontGenMapName,
+			ipcachemap.FrontStatsMapName}...)
+	}
+
+	if !option.Config.EnableFlowSummary {
+		maps = append(maps, flowmap.MapName)
+	}
+
+	if !option.Config.EnableLatencyHistograms {
+		maps = append(maps, latencymap.MapName)
+	}
+
+	if option.Config.DropNotifyRate <= 0 {
+		maps = append(maps, bpf.DropNotifyRateMapName)
+	}
+
+	if !option.Config.EnableEndpointTable {
+		maps = append(maps, []string{
+			lxcmap.TableMapName,
+			lxcmap.ID4MapName,
+			lxcmap.ID6MapName}...)
+	}
+
+	if ipcachemap.BackedByLPM() {
+		maps = append(maps, ipcachemap.PrefixesMapName)
+	}
+
+	if option.Config.EnableSplitIPCache {
+		maps = append(maps, ipcachemap.Name)
+	} else {
+		maps = append(maps, ipcachemap.Name4, ipcachemap.Name6)
+	}
+
 	for _, m := range maps {
 		p := path.Join(bpf.MapPrefixPath(), m)
 		if _, err := os.Stat(p); !os.IsNotExist(err) {
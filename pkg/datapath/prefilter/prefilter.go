@@ -21,12 +21,22 @@ import (
 	"os/exec"
 	"path"
 	"syscall"
+	"time"
+	"unsafe"
 
 	"github.com/cilium/cilium/pkg/bpf"
 	"github.com/cilium/cilium/pkg/lock"
+	"github.com/cilium/cilium/pkg/logging"
+	"github.com/cilium/cilium/pkg/logging/logfields"
 	"github.com/cilium/cilium/pkg/maps/cidrmap"
+	"github.com/cilium/cilium/pkg/maps/prefiltermap"
+	"github.com/cilium/cilium/pkg/option"
+
+	"github.com/sirupsen/logrus"
 )
 
+var log = logging.DefaultLogger.WithField(logfields.LogSubsys, "prefilter")
+
 type preFilterMapType int
 
 const (
@@ -42,6 +52,22 @@ const (
 	// so we could bump the limit if needed later on.
 	maxLKeys = 1024 * 64
 	maxHKeys = 1024 * 1024 * 20
+
+	// The CIDR maps are double buffered, a full reload fills the maps of
+	// the standby slot and then switches the datapath over to them.
+	slotCount   = 2
+	slotMapName = cidrmap.MapName + "slot"
+
+	// XDP programs may still run on the maps of the previous slot right
+	// after a switch. The maps of a slot are only flushed once this long
+	// has passed since the datapath switched away from it, which is ample
+	// for any program run to complete.
+	slotGracePeriod = 100 * time.Millisecond
+
+	// Default destination ports of the tunnel devices, which are
+	// created without explicit port.
+	vxlanPort  = 8472
+	genevePort = 6081
 )
 
 type preFilterMaps [mapCount]*cidrmap.CIDRMap
@@ -51,16 +77,35 @@ type preFilterConfig struct {
 	dyn6Enabled bool
 	fix4Enabled bool
 	fix6Enabled bool
+
+	// dstEnabled enables the destination prefix and port rules
+	dstEnabled bool
+	// portsEnabled enables the allowed ports per local endpoint
+	portsEnabled bool
+	// rateEnabled enables rate limiting of source prefixes
+	rateEnabled bool
+	// encapEnabled enables filtering of inner headers of tunnel traffic
+	encapEnabled bool
+	// syncookieEnabled enables SYN cookies for protected endpoint ports
+	syncookieEnabled bool
 }
 
 // PreFilter holds global info on related CIDR maps participating in prefilter
 type PreFilter struct {
-	maps     preFilterMaps
+	slots    [slotCount]preFilterMaps
+	slot     uint32
+	slotFd   int
+	switched time.Time
 	config   preFilterConfig
 	revision int64
 	mutex    lock.RWMutex
 }
 
+// maps returns the CIDR maps of the slot in use by the datapath
+func (p *PreFilter) maps() *preFilterMaps {
+	return &p.slots[p.slot]
+}
+
 // WriteConfig dumps the configuration for the corresponding header file
 func (p *PreFilter) WriteConfig(fw io.Writer) {
 	p.mutex.RLock()
@@ -69,10 +114,15 @@ func (p *PreFilter) WriteConfig(fw io.Writer) {
 	fmt.Fprintf(fw, "#define CIDR4_HMAP_ELEMS %d\n", maxHKeys)
 	fmt.Fprintf(fw, "#define CIDR4_LMAP_ELEMS %d\n", maxLKeys)
 
-	fmt.Fprintf(fw, "#define CIDR4_HMAP_NAME %s\n", path.Base(p.maps[prefixesV4Fix].String()))
-	fmt.Fprintf(fw, "#define CIDR4_LMAP_NAME %s\n", path.Base(p.maps[prefixesV4Dyn].String()))
-	fmt.Fprintf(fw, "#define CIDR6_HMAP_NAME %s\n", path.Base(p.maps[prefixesV6Fix].String()))
-	fmt.Fprintf(fw, "#define CIDR6_LMAP_NAME %s\n", path.Base(p.maps[prefixesV6Dyn].String()))
+	fmt.Fprintf(fw, "#define CIDR4_HMAP_NAME %s\n", path.Base(p.slots[0][prefixesV4Fix].String()))
+	fmt.Fprintf(fw, "#define CIDR4_LMAP_NAME %s\n", path.Base(p.slots[0][prefixesV4Dyn].String()))
+	fmt.Fprintf(fw, "#define CIDR6_HMAP_NAME %s\n", path.Base(p.slots[0][prefixesV6Fix].String()))
+	fmt.Fprintf(fw, "#define CIDR6_LMAP_NAME %s\n", path.Base(p.slots[0][prefixesV6Dyn].String()))
+	fmt.Fprintf(fw, "#define CIDR4_HMAP1_NAME %s\n", path.Base(p.slots[1][prefixesV4Fix].String()))
+	fmt.Fprintf(fw, "#define CIDR4_LMAP1_NAME %s\n", path.Base(p.slots[1][prefixesV4Dyn].String()))
+	fmt.Fprintf(fw, "#define CIDR6_HMAP1_NAME %s\n", path.Base(p.slots[1][prefixesV6Fix].String()))
+	fmt.Fprintf(fw, "#define CIDR6_LMAP1_NAME %s\n", path.Base(p.slots[1][prefixesV6Dyn].String()))
+	fmt.Fprintf(fw, "#define CIDR_SLOT_MAP_NAME %s\n", slotMapName)
 
 	if p.config.fix4Enabled {
 		fmt.Fprintf(fw, "#define CIDR4_FILTER\n")
@@ -86,13 +136,82 @@ func (p *PreFilter) WriteConfig(fw io.Writer) {
 			fmt.Fprintf(fw, "#define CIDR6_LPM_PREFILTER\n")
 		}
 	}
+
+	fmt.Fprintf(fw, "#define PREFILTER_STATS_MAP_NAME %s\n", prefiltermap.StatsMapName)
+	fmt.Fprintf(fw, "#define PREFILTER_MAX_RULES %d\n", prefiltermap.MaxRules)
+	fmt.Fprintf(fw, "#define RULE_STATS_MAP_NAME %s\n", prefiltermap.RuleStatsMapName)
+	fmt.Fprintf(fw, "#define DST_MAP_ELEMS %d\n", prefiltermap.MaxEntries)
+	fmt.Fprintf(fw, "#define DST4_MAP_NAME %s\n", prefiltermap.Dst4MapName)
+	fmt.Fprintf(fw, "#define DST6_MAP_NAME %s\n", prefiltermap.Dst6MapName)
+	fmt.Fprintf(fw, "#define EP_PORTS_MAP_ELEMS %d\n", prefiltermap.MaxEntries)
+	fmt.Fprintf(fw, "#define EP_PORTS_MAP_NAME %s\n", prefiltermap.EndpointPortsMapName)
+
+	if p.config.dstEnabled {
+		fmt.Fprintf(fw, "#define DST4_FILTER\n")
+		fmt.Fprintf(fw, "#define DST6_FILTER\n")
+	}
+	if p.config.portsEnabled {
+		fmt.Fprintf(fw, "#define EP_PORTS_FILTER\n")
+	}
+
+	fmt.Fprintf(fw, "#define PREFILTER_MAX_RATE_CLASSES %d\n", prefiltermap.MaxRateClasses)
+	fmt.Fprintf(fw, "#define RATE_MAP_ELEMS %d\n", prefiltermap.MaxEntries)
+	fmt.Fprintf(fw, "#define RATE4_MAP_NAME %s\n", prefiltermap.Rate4MapName)
+	fmt.Fprintf(fw, "#define RATE6_MAP_NAME %s\n", prefiltermap.Rate6MapName)
+	fmt.Fprintf(fw, "#define RATE_CLASS_MAP_NAME %s\n", prefiltermap.RateClassMapName)
+	fmt.Fprintf(fw, "#define RATE_STATS_MAP_NAME %s\n", prefiltermap.RateStatsMapName)
+	fmt.Fprintf(fw, "#define RATE_BUCKETS_MAP_NAME %s\n", prefiltermap.RateBucketsMapName)
+	fmt.Fprintf(fw, "#define RATE_BUCKETS_MAP_ELEMS %d\n", prefiltermap.RateBucketsMaxEntries)
+
+	if p.config.rateEnabled {
+		fmt.Fprintf(fw, "#define RATE4_FILTER\n")
+		fmt.Fprintf(fw, "#define RATE6_FILTER\n")
+	}
+
+	fmt.Fprintf(fw, "#define PREFILTER_VXLAN_PORT %d\n", vxlanPort)
+	fmt.Fprintf(fw, "#define PREFILTER_GENEVE_PORT %d\n", genevePort)
+	if p.config.encapEnabled {
+		fmt.Fprintf(fw, "#define ENABLE_PREFILTER_ENCAP\n")
+	}
+
+	fmt.Fprintf(fw, "#define SYNCOOKIE_PORTS_MAP_NAME %s\n", prefiltermap.SyncookiePortsMapName)
+	fmt.Fprintf(fw, "#define SYNCOOKIE_SECRET_MAP_NAME %s\n", prefiltermap.SyncookieSecretMapName)
+	fmt.Fprintf(fw, "#define SYNCOOKIE_VALID_MAP_NAME %s\n", prefiltermap.SyncookieValidMapName)
+	fmt.Fprintf(fw, "#define SYNCOOKIE_VALID_MAP_ELEMS %d\n", prefiltermap.SyncookieValidMaxEntries)
+	fmt.Fprintf(fw, "#define SYNCOOKIE_LIFETIME %d\n", prefiltermap.SyncookieLifetime)
+	if p.config.syncookieEnabled {
+		fmt.Fprintf(fw, "#define SYNCOOKIE_FILTER\n")
+	}
+}
+
+// DestinationsEnabled returns true if the prefilter applies destination
+// prefix and port rules
+func (p *PreFilter) DestinationsEnabled() bool {
+	p.mutex.RLock()
+	defer p.mutex.RUnlock()
+	return p.config.dstEnabled
+}
+
+// RateLimitEnabled returns true if the prefilter rate limits source prefixes
+func (p *PreFilter) RateLimitEnabled() bool {
+	p.mutex.RLock()
+	defer p.mutex.RUnlock()
+	return p.config.rateEnabled
+}
+
+// SyncookiesEnabled returns true if the prefilter protects endpoint ports
+// with SYN cookies
+func (p *PreFilter) SyncookiesEnabled() bool {
+	p.mutex.RLock()
+	defer p.mutex.RUnlock()
+	return p.config.syncookieEnabled
 }
 
 func (p *PreFilter) dumpOneMap(which preFilterMapType, to []string) []string {
-	if p.maps[which] == nil {
+	if p.maps()[which] == nil {
 		return to
 	}
-	return p.maps[which].CIDRDump(to)
+	return p.maps()[which].CIDRDump(to)
 }
 
 // Dump dumps revision and CIDRs as string slice of all participating maps
@@ -134,11 +253,11 @@ func (p *PreFilter) Insert(revision int64, cidrs []net.IPNet) error {
 	for _, cidr := range cidrs {
 		ones, bits := cidr.Mask.Size()
 		which := p.selectMap(ones, bits)
-		if which == mapCount || p.maps[which] == nil {
+		if which == mapCount || p.maps()[which] == nil {
 			ret = fmt.Errorf("No map enabled for CIDR string %s", cidr.String())
 			break
 		}
-		err := p.maps[which].InsertCIDR(cidr)
+		err := p.maps()[which].InsertCIDR(cidr)
 		if err != nil {
 			ret = fmt.Errorf("Error inserting CIDR string %s: %s", cidr.String(), err)
 			break
@@ -153,7 +272,7 @@ func (p *PreFilter) Insert(revision int64, cidrs []net.IPNet) error {
 	for _, cidr := range undoQueue {
 		ones, bits := cidr.Mask.Size()
 		which := p.selectMap(ones, bits)
-		p.maps[which].DeleteCIDR(cidr)
+		p.maps()[which].DeleteCIDR(cidr)
 	}
 	return ret
 }
@@ -171,18 +290,18 @@ func (p *PreFilter) Delete(revision int64, cidrs []net.IPNet) error {
 	for _, cidr := range cidrs {
 		ones, bits := cidr.Mask.Size()
 		which := p.selectMap(ones, bits)
-		if which == mapCount || p.maps[which] == nil {
+		if which == mapCount || p.maps()[which] == nil {
 			return fmt.Errorf("No map enabled for CIDR string %s", cidr.String())
 		}
 		// Lets check obvious cases first, so we don't need to painfully unroll
-		if p.maps[which].CIDRExists(cidr) == false {
+		if p.maps()[which].CIDRExists(cidr) == false {
 			return fmt.Errorf("No map entry for CIDR string %s", cidr.String())
 		}
 	}
 	for _, cidr := range cidrs {
 		ones, bits := cidr.Mask.Size()
 		which := p.selectMap(ones, bits)
-		err := p.maps[which].DeleteCIDR(cidr)
+		err := p.maps()[which].DeleteCIDR(cidr)
 		if err != nil {
 			ret = fmt.Errorf("Error deleting CIDR string %s: %s", cidr.String(), err)
 			break
@@ -197,12 +316,84 @@ func (p *PreFilter) Delete(revision int64, cidrs []net.IPNet) error {
 	for _, cidr := range undoQueue {
 		ones, bits := cidr.Mask.Size()
 		which := p.selectMap(ones, bits)
-		p.maps[which].InsertCIDR(cidr)
+		p.maps()[which].InsertCIDR(cidr)
 	}
 	return ret
 }
 
-func (p *PreFilter) initOneMap(which preFilterMapType) error {
+// flushSlot removes all CIDRs from the maps of the slot
+func (p *PreFilter) flushSlot(slot uint32) error {
+	for _, m := range p.slots[slot] {
+		if m == nil {
+			continue
+		}
+		if err := m.DeleteAll(); err != nil {
+			return fmt.Errorf("Error flushing %s: %s", m, err)
+		}
+	}
+	return nil
+}
+
+// Replace replaces all CIDRs with the slice of CIDRs (doh!) for the latest
+// revision. The new set is built in the standby maps and then switched to
+// in a single update, so the datapath never sees a partial set.
+func (p *PreFilter) Replace(revision int64, cidrs []net.IPNet) error {
+	p.mutex.Lock()
+	defer p.mutex.Unlock()
+	if revision != 0 && p.revision != revision {
+		return fmt.Errorf("Latest revision is %d not %d", p.revision, revision)
+	}
+
+	start := time.Now()
+	standby := (p.slot + 1) % slotCount
+
+	// The standby maps still hold the set replaced by the previous
+	// switch, they are flushed once the datapath is done with them.
+	if wait := slotGracePeriod - time.Since(p.switched); wait > 0 {
+		time.Sleep(wait)
+	}
+	if err := p.flushSlot(standby); err != nil {
+		return err
+	}
+
+	var ret error
+	for _, cidr := range cidrs {
+		ones, bits := cidr.Mask.Size()
+		which := p.selectMap(ones, bits)
+		if which == mapCount || p.slots[standby][which] == nil {
+			ret = fmt.Errorf("No map enabled for CIDR string %s", cidr.String())
+			break
+		}
+		if err := p.slots[standby][which].InsertCIDR(cidr); err != nil {
+			ret = fmt.Errorf("Error inserting CIDR string %s: %s", cidr.String(), err)
+			break
+		}
+	}
+	if ret == nil {
+		key := uint32(0)
+		if err := bpf.UpdateElement(p.slotFd, unsafe.Pointer(&key), unsafe.Pointer(&standby), 0); err != nil {
+			ret = fmt.Errorf("Error switching to CIDR maps of slot %d: %s", standby, err)
+		}
+	}
+	if ret != nil {
+		p.flushSlot(standby)
+		return ret
+	}
+
+	p.slot = standby
+	p.switched = time.Now()
+	p.revision++
+
+	log.WithFields(logrus.Fields{
+		"count":    len(cidrs),
+		"slot":     standby,
+		"duration": time.Since(start),
+	}).Info("Replaced prefilter CIDRs")
+
+	return nil
+}
+
+func (p *PreFilter) initOneMap(slot int, which preFilterMapType) error {
 	var prefixdyn bool
 	var prefixlen int
 	var maxelems uint32
@@ -215,29 +406,29 @@ func (p *PreFilter) initOneMap(which preFilterMapType) error {
 		prefixlen = net.IPv4len * 8
 		prefixdyn = true
 		maxelems = maxLKeys
-		path = bpf.MapPath(cidrmap.MapName + "v4_dyn")
+		path = bpf.MapPath(cidrmap.MapName + "v4_dyn" + slotSuffix(slot))
 		skip = p.config.dyn4Enabled == false
 	case prefixesV4Fix:
 		prefixlen = net.IPv4len * 8
 		prefixdyn = false
 		maxelems = maxHKeys
-		path = bpf.MapPath(cidrmap.MapName + "v4_fix")
+		path = bpf.MapPath(cidrmap.MapName + "v4_fix" + slotSuffix(slot))
 		skip = p.config.fix4Enabled == false
 	case prefixesV6Dyn:
 		prefixlen = net.IPv6len * 8
 		prefixdyn = true
 		maxelems = maxLKeys
-		path = bpf.MapPath(cidrmap.MapName + "v6_dyn")
+		path = bpf.MapPath(cidrmap.MapName + "v6_dyn" + slotSuffix(slot))
 		skip = p.config.dyn6Enabled == false
 	case prefixesV6Fix:
 		prefixlen = net.IPv6len * 8
 		prefixdyn = false
 		maxelems = maxHKeys
-		path = bpf.MapPath(cidrmap.MapName + "v6_fix")
+		path = bpf.MapPath(cidrmap.MapName + "v6_fix" + slotSuffix(slot))
 		skip = p.config.fix4Enabled == false
 	}
 	if skip == false {
-		p.maps[which], _, err = cidrmap.OpenMapElems(path, prefixlen, prefixdyn, maxelems)
+		p.slots[slot][which], _, err = cidrmap.OpenMapElems(path, prefixlen, prefixdyn, maxelems)
 		if err != nil {
 			return err
 		}
@@ -245,12 +436,83 @@ func (p *PreFilter) initOneMap(which preFilterMapType) error {
 	return nil
 }
 
+func (p *PreFilter) initRuleMaps() error {
+	maps := []*bpf.Map{}
+	if p.config.dstEnabled {
+		maps = append(maps, prefiltermap.Dst4Map, prefiltermap.Dst6Map)
+	}
+	if p.config.portsEnabled {
+		maps = append(maps, prefiltermap.EndpointPortsMap)
+	}
+	if p.config.syncookieEnabled {
+		maps = append(maps, prefiltermap.SyncookieMaps()...)
+	}
+	if len(maps) != 0 {
+		maps = append(maps, prefiltermap.RuleStatsMap)
+	}
+	if p.config.rateEnabled {
+		maps = append(maps, prefiltermap.RateMaps()...)
+	}
+	maps = append(maps, prefiltermap.StatsMap)
+
+	for _, m := range maps {
+		if _, err := m.OpenOrCreate(); err != nil {
+			return err
+		}
+	}
+	if p.config.syncookieEnabled {
+		return prefiltermap.InitSyncookieSecret()
+	}
+	return nil
+}
+
+// slotSuffix returns the map name suffix of the slot, the maps of the
+// first slot keep their original names.
+func slotSuffix(slot int) string {
+	if slot == 0 {
+		return ""
+	}
+	return fmt.Sprintf("_%d", slot)
+}
+
+// initSlotMap opens the map selecting the slot in use by the datapath and
+// restores the slot from it.
+func (p *PreFilter) initSlotMap() error {
+	var err error
+
+	p.slotFd, _, err = bpf.OpenOrCreateMap(bpf.MapPath(slotMapName),
+		bpf.BPF_MAP_TYPE_ARRAY,
+		uint32(unsafe.Sizeof(uint32(0))),
+		uint32(unsafe.Sizeof(p.slot)),
+		1, 0, 0)
+	if err != nil {
+		return err
+	}
+
+	key := uint32(0)
+	if err = bpf.LookupElement(p.slotFd, unsafe.Pointer(&key), unsafe.Pointer(&p.slot)); err != nil {
+		return err
+	}
+	if p.slot >= slotCount {
+		p.slot = 0
+	}
+	return nil
+}
+
 func (p *PreFilter) init() (*PreFilter, error) {
-	for i := prefixesV4Dyn; i < mapCount; i++ {
-		if err := p.initOneMap(i); err != nil {
-			return nil, err
+	for slot := 0; slot < slotCount; slot++ {
+		for i := prefixesV4Dyn; i < mapCount; i++ {
+			if err := p.initOneMap(slot, i); err != nil {
+				return nil, err
+			}
 		}
 	}
+	if err := p.initSlotMap(); err != nil {
+		return nil, err
+	}
+	if err := p.initRuleMaps(); err != nil {
+		return nil, err
+	}
 	return p, nil
 }
 
@@ -281,12 +543,22 @@ func ProbePreFilter(device, mode string) error {
 func NewPreFilter() (*PreFilter, error) {
 	// dyn{4,6} officially disabled for now due to missing
 	// dump (get_next_key) from kernel side.
+	// Destination rules and rate limits require LPM support, which
+	// was only added to the kernel after XDP. Rate limits also need
+	// LRU support to track sources, as do SYN cookies.
+	lpmEnabled := bpf.GetMapType(bpf.MapTypeLPMTrie) == bpf.MapTypeLPMTrie
+	lruEnabled := bpf.GetMapType(bpf.MapTypeLRUHash) == bpf.MapTypeLRUHash
 	c := preFilterConfig{
-		dyn4Enabled: false,
-		dyn6Enabled: false,
-		fix4Enabled: true,
-		fix6Enabled: true,
+		dyn4Enabled:  false,
+		dyn6Enabled:  false,
+		fix4Enabled:  true,
+		fix6Enabled:  true,
+		portsEnabled: option.Config.PortsPreFilter,
+		encapEnabled: option.Config.EncapPreFilter,
 	}
+	c.dstEnabled = option.Config.DstPreFilter && lpmEnabled
+	c.rateEnabled = option.Config.RatePreFilter && lpmEnabled && lruEnabled
+	c.syncookieEnabled = option.Config.CookiePreFilter && lruEnabled
 	p := &PreFilter{
 		revision: 1,
 		config:   c,
@@ -136,6 +136,49 @@ const (
 	// EnableIPSec is the default value for IPSec enablement
 	EnableIPSec = false
 
+	// EnableIPv4FragmentsTracking enables tracking of IPv4 fragments so
+	// that L4 policy, conntrack and load-balancing apply to them. Off by
+	// default as fragments arriving ahead of the first fragment of their
+	// datagram are dropped when enabled.
+	EnableIPv4FragmentsTracking = false
+
+	// EnableIPv6FragmentsTracking enables tracking of IPv6 fragments so
+	// that L4 policy, conntrack and load-balancing apply to them. Off by
+	// default for the same reason as EnableIPv4FragmentsTracking.
+	EnableIPv6FragmentsTracking = false
+
+	// EnableSharedPolicyMaps enables sharing of policy maps between
+	// endpoints with the same security identity
+	EnableSharedPolicyMaps = false
+
+	// EnableIPCacheFrontCache enables the per-CPU datapath cache in front
+	// of ipcache lookups
+	EnableIPCacheFrontCache = false
+
+	// DropNotifyRate is the maximum number of drop notifications per
+	// second, drop reason and CPU
+	DropNotifyRate = 1000
+
+	// EnableSplitIPCache splits the ipcache into separate maps per address
+	// family with compact keys
+	EnableSplitIPCache = false
+
+	// EnableEndpointTable looks up local endpoints in an array indexed by
+	// endpoint ID instead of the endpoint hash map
+	EnableEndpointTable = false
+
+	// EnableEndpointDropMetrics accounts drops by reason and direction in a
+	// metrics map of each endpoint
+	EnableEndpointDropMetrics = false
+
+	// EnableFlowSummary aggregates forwarded and dropped packets into flow
+	// summaries in the datapath
+	EnableFlowSummary = false
+
+	// EnableLatencyHistograms compiles latency instrumentation into the
+	// datapath programs
+	EnableLatencyHistograms = false
+
 	// MonitorQueueSize is the default value for the monitor queue size
 	MonitorQueueSize = 32768
 
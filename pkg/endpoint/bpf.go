@@ -30,6 +30,7 @@ import (
 	"github.com/cilium/cilium/api/v1/models"
 	"github.com/cilium/cilium/common"
 	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
 	"github.com/cilium/cilium/pkg/completion"
 	"github.com/cilium/cilium/pkg/controller"
 	"github.com/cilium/cilium/pkg/datapath/loader"
@@ -39,7 +40,9 @@ import (
 	"github.com/cilium/cilium/pkg/maps/ctmap"
 	"github.com/cilium/cilium/pkg/maps/eppolicymap"
 	"github.com/cilium/cilium/pkg/maps/lxcmap"
+	"github.com/cilium/cilium/pkg/maps/metricsmap"
 	"github.com/cilium/cilium/pkg/maps/policymap"
+	"github.com/cilium/cilium/pkg/maps/sharedpolicymap"
 	"github.com/cilium/cilium/pkg/option"
 	"github.com/cilium/cilium/pkg/policy"
 	"github.com/cilium/cilium/pkg/policy/trafficdirection"
@@ -59,6 +62,103 @@ func (e *Endpoint) PolicyMapPathLocked() string {
 	return bpf.LocalMapPath(policymap.MapName, e.ID)
 }
 
+// policyMapPathLocked returns the path to the policy map currently used by
+// the endpoint, which may be shared with other endpoints of the same
+// identity.
+func (e *Endpoint) policyMapPathLocked() string {
+	if e.sharedPolicyMapIdentity != 0 {
+		return sharedpolicymap.IdentityMapPath(e.sharedPolicyMapIdentity)
+	}
+	return e.PolicyMapPathLocked()
+}
+
+// selectPolicyMapLocked attaches the endpoint to the policy map of its
+// security identity, or to its own policy map if it has no identity yet or
+// its policy requires proxy redirects, whose ports are allocated per
+// endpoint. The map of an identity is only shared by endpoints whose desired
+// policy is at least as recent as the policy the map holds, so that an
+// endpoint lagging behind never overwrites the policy of the others. The
+// selected map is filled with the desired policy before the datapath is
+// pointed to it via the shared policy map. Must only be called if shared
+// policy maps are enabled.
+func (e *Endpoint) selectPolicyMapLocked() error {
+	var identity uint32
+	if e.SecurityIdentity != nil && e.desiredPolicy != nil && !e.desiredPolicy.L4Policy.HasRedirect() {
+		id := e.SecurityIdentity.ID.Uint32()
+		if e.nextPolicyRevision >= sharedpolicymap.Revision(id) {
+			identity = id
+		}
+	}
+
+	if e.PolicyMap != nil && identity == e.sharedPolicyMapIdentity {
+		return nil
+	}
+
+	var (
+		m   *policymap.PolicyMap
+		err error
+	)
+	if identity != 0 {
+		m, err = sharedpolicymap.Acquire(identity, e.ID)
+	} else {
+		m, _, err = policymap.OpenOrCreate(e.PolicyMapPathLocked())
+		if err == nil {
+			// The private map may be a leftover of a previous
+			// incarnation of the endpoint
+			err = m.DeleteAll()
+		}
+	}
+	if err != nil {
+		return err
+	}
+
+	prevMap, prevIdentity := e.PolicyMap, e.sharedPolicyMapIdentity
+	e.PolicyMap = m
+	e.sharedPolicyMapIdentity = identity
+
+	// The realized state is recovered from the map content by
+	// syncPolicyMap().
+	e.realizedPolicy.PolicyMapState = make(policy.MapState)
+
+	if err = sharedpolicymap.Attach(e.ID, m, e.syncPolicyMap); err != nil {
+		m.Close()
+		if identity != 0 && identity != prevIdentity {
+			sharedpolicymap.Release(identity, e.ID)
+		}
+		e.PolicyMap = prevMap
+		e.sharedPolicyMapIdentity = prevIdentity
+		e.realizedPolicy.PolicyMapState = make(policy.MapState)
+		return fmt.Errorf("unable to attach policy map %s: %s", m.String(), err)
+	}
+
+	e.getLogger().WithField(logfields.Identity, identity).Debug("Attached endpoint to new PolicyMap")
+
+	if prevMap != nil {
+		if err := prevMap.Close(); err != nil {
+			e.getLogger().WithError(err).Warning("Unable to close previous PolicyMap")
+		}
+	}
+	if prevIdentity != 0 && prevIdentity != identity {
+		sharedpolicymap.Release(prevIdentity, e.ID)
+	}
+
+	return nil
+}
+
+// RestoreSharedPolicyMapLocked registers the endpoint as a user of the policy
+// map of its identity after a restart of the agent, in case it is still
+// attached to it. Must only be called if shared policy maps are enabled.
+func (e *Endpoint) RestoreSharedPolicyMapLocked() {
+	if e.SecurityIdentity == nil {
+		return
+	}
+
+	identity := e.SecurityIdentity.ID.Uint32()
+	if sharedpolicymap.Restore(identity, e.ID) {
+		e.sharedPolicyMapIdentity = identity
+	}
+}
+
 // CallsMapPathLocked returns the path to cilium tail calls map of an endpoint.
 func (e *Endpoint) CallsMapPathLocked() string {
 	return bpf.LocalMapPath(CallsMapName, e.ID)
@@ -112,7 +212,7 @@ func (e *Endpoint) writeInformationalComments(w io.Writer, owner Owner) error {
 		" * NodeMAC: %s\n"+
 		" */\n\n",
 		e.IPv6.String(), e.IPv4.String(),
-		e.GetIdentity(), path.Base(e.PolicyMapPathLocked()),
+		e.GetIdentity(), path.Base(e.policyMapPathLocked()),
 		e.NodeMAC)
 
 	fw.WriteString("/*\n")
@@ -637,7 +737,16 @@ func (e *Endpoint) runPreCompilationSteps(owner Owner, regenContext *regeneratio
 		return nil
 	}
 
-	if e.PolicyMap == nil {
+	if option.Config.EnableSharedPolicyMaps {
+		// Without an identity there is no policy and the endpoint is
+		// attached to its own empty map. Otherwise the map is selected
+		// once the policy has been computed below.
+		if e.SecurityIdentity == nil {
+			if err = e.selectPolicyMapLocked(); err != nil {
+				return err
+			}
+		}
+	} else if e.PolicyMap == nil {
 		e.PolicyMap, _, err = policymap.OpenOrCreate(e.PolicyMapPathLocked())
 		if err != nil {
 			return err
@@ -671,7 +780,15 @@ func (e *Endpoint) runPreCompilationSteps(owner Owner, regenContext *regeneratio
 		err = e.regeneratePolicy(owner)
 		stats.policyCalculation.End(err == nil)
 		if err != nil {
-			return fmt.Errorf("unable to regenerate policy for '%s': %s", e.PolicyMap.String(), err)
+			return fmt.Errorf("unable to regenerate policy for '%s': %s", path.Base(e.policyMapPathLocked()), err)
+		}
+
+		// The new policy may have added or removed proxy redirects,
+		// which determines whether the policy map can be shared.
+		if option.Config.EnableSharedPolicyMaps {
+			if err = e.selectPolicyMapLocked(); err != nil {
+				return err
+			}
 		}
 
 		_ = e.updateAndOverrideEndpointOptions(nil)
@@ -814,10 +931,11 @@ func (e *Endpoint) DeleteMapsLocked() []error {
 	var errors []error
 
 	maps := map[string]string{
-		"config": e.BPFConfigMapPath(),
-		"policy": e.PolicyMapPathLocked(),
-		"calls":  e.CallsMapPathLocked(),
-		"egress": e.BPFIpvlanMapPath(),
+		"config":  e.BPFConfigMapPath(),
+		"policy":  e.PolicyMapPathLocked(),
+		"calls":   e.CallsMapPathLocked(),
+		"egress":  e.BPFIpvlanMapPath(),
+		"metrics": bpf.MapPath(metricsmap.EndpointMapName(e.ID)),
 	}
 	for name, path := range maps {
 		if err := os.RemoveAll(path); err != nil {
@@ -838,6 +956,16 @@ func (e *Endpoint) DeleteMapsLocked() []error {
 		}
 	}
 
+	if option.Config.EnableSharedPolicyMaps {
+		if err := sharedpolicymap.DeleteEndpoint(e.ID); err != nil {
+			errors = append(errors, fmt.Errorf("unable to remove endpoint from shared policy map: %s", err))
+		}
+		if e.sharedPolicyMapIdentity != 0 {
+			sharedpolicymap.Release(e.sharedPolicyMapIdentity, e.ID)
+			e.sharedPolicyMapIdentity = 0
+		}
+	}
+
 	// Remove handle_policy() tail call entry for EP
 	if err := policymap.RemoveGlobalMapping(uint32(e.ID)); err != nil {
 		errors = append(errors, fmt.Errorf("unable to remove endpoint from global policy map: %s", err))
@@ -974,6 +1102,20 @@ func (e *Endpoint) syncPolicyMap() error {
 		return fmt.Errorf("not syncing PolicyMap state for endpoint because PolicyMap is nil")
 	}
 
+	// Other endpoints with the same identity must not write a shared
+	// policy map between the revision check, the dump and the updates
+	// below. If the map already holds a more recent policy than the one
+	// desired by this endpoint, it is left alone; the endpoint is
+	// regenerated for that revision soon.
+	if identity := e.sharedPolicyMapIdentity; identity != 0 {
+		sharedpolicymap.Lock(identity)
+		defer sharedpolicymap.Unlock(identity)
+
+		if e.nextPolicyRevision < sharedpolicymap.Revision(identity) {
+			return nil
+		}
+	}
+
 	currentMapContents, err := e.PolicyMap.DumpToSlice()
 
 	// If map is unable to be dumped, attempt to close map and open it again.
@@ -989,7 +1131,7 @@ func (e *Endpoint) syncPolicyMap() error {
 			e.getLogger().WithError(err).Error("unable to close PolicyMap which was not able to be dumped")
 		}
 
-		e.PolicyMap, _, err = policymap.OpenOrCreate(e.PolicyMapPathLocked())
+		e.PolicyMap, _, err = policymap.OpenOrCreate(e.policyMapPathLocked())
 		if err != nil {
 			return fmt.Errorf("unable to open PolicyMap for endpoint: %s", err)
 		}
@@ -1001,6 +1143,25 @@ func (e *Endpoint) syncPolicyMap() error {
 		}
 	}
 
+	// A shared policy map may have been brought up to date by another
+	// endpoint with the same identity, so its content is what has been
+	// realized. This avoids rewriting the same entries for each endpoint.
+	if e.sharedPolicyMapIdentity != 0 {
+		e.realizedPolicy.PolicyMapState = make(policy.MapState, len(currentMapContents))
+		for _, entry := range currentMapContents {
+			keyHostOrder := entry.Key.ToHost()
+			e.realizedPolicy.PolicyMapState[policy.Key{
+				Identity:         keyHostOrder.Identity,
+				DestPort:         keyHostOrder.DestPort,
+				Nexthdr:          keyHostOrder.Nexthdr,
+				TrafficDirection: keyHostOrder.TrafficDirection,
+			}] = policy.MapStateEntry{
+				ProxyPort: byteorder.NetworkToHost(entry.ProxyPort).(uint16),
+				IsDeny:    entry.IsDeny(),
+			}
+		}
+	}
+
 	errors := []error{}
 
 	for _, entry := range currentMapContents {
@@ -1041,7 +1202,12 @@ func (e *Endpoint) syncPolicyMap() error {
 				TrafficDirection: keyToAdd.TrafficDirection,
 			}
 
-			err := e.PolicyMap.AllowKey(policyKeyToPolicyMapKey, entry.ProxyPort)
+			var err error
+			if entry.IsDeny {
+				err = e.PolicyMap.DenyKey(policyKeyToPolicyMapKey)
+			} else {
+				err = e.PolicyMap.AllowKey(policyKeyToPolicyMapKey, entry.ProxyPort)
+			}
 			if err != nil {
 				e.getLogger().WithError(err).Errorf("Failed to add PolicyMap key %s %d", policyKeyToPolicyMapKey.String(), entry.ProxyPort)
 				errors = append(errors, err)
@@ -1056,6 +1222,10 @@ func (e *Endpoint) syncPolicyMap() error {
 		return fmt.Errorf("synchronizing desired PolicyMap state failed: %s", errors)
 	}
 
+	if e.sharedPolicyMapIdentity != 0 {
+		sharedpolicymap.SetRevision(e.sharedPolicyMapIdentity, e.nextPolicyRevision)
+	}
+
 	return nil
 }
 
@@ -194,6 +194,11 @@ type Endpoint struct {
 	// reference to all policy related BPF
 	PolicyMap *policymap.PolicyMap `json:"-"`
 
+	// sharedPolicyMapIdentity is the identity whose shared policy map is
+	// referenced by PolicyMap, or 0 if PolicyMap is private to this
+	// endpoint. Only used if shared policy maps are enabled.
+	sharedPolicyMapIdentity uint32
+
 	// Options determine the datapath configuration of the endpoint.
 	Options *option.IntOptions
 
@@ -41,7 +41,7 @@ const (
 
 	// CustomResourceDefinitionSchemaVersion is semver-conformant version of CRD schema
 	// Used to determine if CRD needs to be updated in cluster
-	CustomResourceDefinitionSchemaVersion = "1.14"
+	CustomResourceDefinitionSchemaVersion = "1.15"
 
 	// CustomResourceDefinitionSchemaVersionKey is key to label which holds the CRD schema version
 	CustomResourceDefinitionSchemaVersionKey = "io.cilium.k8s.crd.schema.version"
@@ -906,6 +906,11 @@ var (
 				Format: "uint16",
 			},
 			"rules": L7Rules,
+			"deny": {
+				Description: "Deny drops the traffic matching the Ports instead of " +
+					"allowing it. Layer 7 rules cannot be combined with Deny.",
+				Type: "boolean",
+			},
 		},
 	}
 
@@ -0,0 +1,203 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package capturemap
+
+import (
+	"fmt"
+	"os"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+const (
+	// MapName is the name of the capture length map.
+	MapName = "cilium_capture_len"
+
+	// maxNotifyLen is the length of the largest notification followed by
+	// packet data, must match CAPTURE_NOTIFY_MAX_LEN in <bpf/lib/events.h>
+	maxNotifyLen = 32
+
+	// MaxLen is the largest capture length carried by a perf event. The
+	// size of a perf sample is a u16 which also covers the sample header,
+	// the raw data size and alignment and the notification. Must match
+	// CAPTURE_LEN_PERF_MAX in <bpf/lib/events.h>
+	MaxLen = (1<<16-1-8)&^7 - 4 - maxNotifyLen
+
+	// MaxLenRingBuf is the largest capture length when the datapath emits
+	// events through the ring buffer.
+	MaxLenRingBuf = 1<<16 - 1
+
+	// flagSet must match CAPTURE_LEN_F_SET in <bpf/lib/events.h>
+	flagSet = 1
+)
+
+// Type is a notification type of the capture length map.
+type Type uint32
+
+// Notification types, must match CAPTURE_LEN_* in <bpf/lib/events.h>
+const (
+	// TypeTrace is indexed by the observation point of the notification
+	TypeTrace Type = iota
+	// TypeDrop is indexed by the drop reason of the notification
+	TypeDrop
+	typeMax
+)
+
+func (t Type) String() string {
+	switch t {
+	case TypeTrace:
+		return "trace"
+	case TypeDrop:
+		return "drop"
+	}
+	return fmt.Sprintf("%d", uint32(t))
+}
+
+// ParseType parses the name of a notification type.
+func ParseType(name string) (Type, error) {
+	for t := TypeTrace; t < typeMax; t++ {
+		if t.String() == name {
+			return t, nil
+		}
+	}
+	return 0, fmt.Errorf("unknown notification type %q", name)
+}
+
+// Key is the index into the capture length map, (type << 8) | subtype.
+type Key struct {
+	Index uint32
+}
+
+// NewKey returns the key of the given notification type and subtype.
+func NewKey(t Type, subtype uint8) Key {
+	return Key{Index: uint32(t)<<8 | uint32(subtype)}
+}
+
+// Type returns the notification type of the key.
+func (k *Key) Type() Type { return Type(k.Index >> 8) }
+
+// Subtype returns the observation point or drop reason of the key.
+func (k *Key) Subtype() uint8 { return uint8(k.Index & 0xff) }
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key) NewValue() bpf.MapValue { return &Value{} }
+
+func (k *Key) String() string { return fmt.Sprintf("%s:%d", k.Type(), k.Subtype()) }
+
+// Value is the capture length of a notification type and subtype.
+//
+// Must be in sync with struct capture_len in <bpf/lib/events.h>
+type Value struct {
+	Len   uint16
+	Flags uint8
+	Pad   uint8
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (v *Value) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(v) }
+
+// IsSet returns true if the value overrides the default capture length.
+func (v *Value) IsSet() bool { return v.Flags&flagSet != 0 }
+
+func (v *Value) String() string {
+	if !v.IsSet() {
+		return "default"
+	}
+	return fmt.Sprintf("%d", v.Len)
+}
+
+// Map is the capture length map. It is created by the agent and only read
+// by the datapath.
+var Map = bpf.NewMap(MapName,
+	bpf.BPF_MAP_TYPE_ARRAY,
+	int(unsafe.Sizeof(Key{})),
+	int(unsafe.Sizeof(Value{})),
+	int(typeMax)<<8,
+	0, 0,
+	func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+		k, v := Key{}, Value{}
+
+		if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+			return nil, nil, err
+		}
+		return &k, &v, nil
+	})
+
+// SetLen sets the number of packet bytes captured by notifications of the
+// given type and subtype, 0 meaning only the notification header.
+// maxLen returns the largest capture length of the event transport in use.
+// The ring buffer is only pinned if the datapath emits events through it.
+func maxLen() int {
+	if _, err := os.Stat(bpf.MapPath(bpf.EventsRingMapName)); err == nil {
+		return MaxLenRingBuf
+	}
+	return MaxLen
+}
+
+func SetLen(t Type, subtype uint8, length int) error {
+	if max := maxLen(); length < 0 || length > max {
+		return fmt.Errorf("capture length %d must be between 0 and %d", length, max)
+	}
+
+	if _, err := Map.OpenOrCreate(); err != nil {
+		return fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	key := NewKey(t, subtype)
+	return Map.Update(&key, &Value{Len: uint16(length), Flags: flagSet})
+}
+
+// UnsetLen restores the default capture length of notifications of the
+// given type and subtype.
+func UnsetLen(t Type, subtype uint8) error {
+	if _, err := Map.OpenOrCreate(); err != nil {
+		return fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	key := NewKey(t, subtype)
+	return Map.Update(&key, &Value{})
+}
+
+// Entry is a configured capture length.
+type Entry struct {
+	Type    Type
+	Subtype uint8
+	Len     uint16
+}
+
+// Dump returns all capture lengths overriding the default.
+func Dump() ([]Entry, error) {
+	if err := Map.Open(); err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	entries := []Entry{}
+	cb := func(key bpf.MapKey, value bpf.MapValue) {
+		k, v := key.(*Key), value.(*Value)
+		if v.IsSet() {
+			entries = append(entries, Entry{Type: k.Type(), Subtype: k.Subtype(), Len: v.Len})
+		}
+	}
+	if err := Map.DumpWithCallback(cb); err != nil {
+		return nil, fmt.Errorf("unable to dump %s: %s", MapName, err)
+	}
+
+	return entries, nil
+}
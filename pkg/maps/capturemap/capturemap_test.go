@@ -0,0 +1,62 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package capturemap
+
+import (
+	"testing"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type CaptureMapTestSuite struct{}
+
+var _ = Suite(&CaptureMapTestSuite{})
+
+func (s *CaptureMapTestSuite) TestValueSize(c *C) {
+	// Must match struct capture_len in bpf/lib/events.h
+	c.Assert(unsafe.Sizeof(Value{}), Equals, uintptr(4))
+}
+
+func (s *CaptureMapTestSuite) TestMaxLen(c *C) {
+	// The perf sample header, the raw data size, the notification and
+	// the packet data padded to 8 bytes must fit into the u16 sample size
+	size := 8 + (4+maxNotifyLen+MaxLen+7)&^7
+	c.Assert(size <= 1<<16-1, Equals, true)
+	c.Assert(size+8 > 1<<16-1, Equals, true)
+	c.Assert(MaxLen < MaxLenRingBuf, Equals, true)
+}
+
+func (s *CaptureMapTestSuite) TestKey(c *C) {
+	key := NewKey(TypeDrop, 133)
+	c.Assert(key.Index, Equals, uint32(1<<8|133))
+	c.Assert(key.Type(), Equals, TypeDrop)
+	c.Assert(key.Subtype(), Equals, uint8(133))
+	c.Assert(key.String(), Equals, "drop:133")
+
+	for _, t := range []Type{TypeTrace, TypeDrop} {
+		parsed, err := ParseType(t.String())
+		c.Assert(err, IsNil)
+		c.Assert(parsed, Equals, t)
+	}
+	_, err := ParseType("debug")
+	c.Assert(err, Not(IsNil))
+}
@@ -138,6 +138,28 @@ func (cm *CIDRMap) CIDRDump(to []string) []string {
 	}
 }
 
+// DeleteAll deletes all entries from map 'cm'.
+func (cm *CIDRMap) DeleteAll() error {
+	var key, keyNext cidrKey
+	keys := []cidrKey{key}
+
+	// The walk starts from the zero key, which is thus deleted
+	// unconditionally as it would be skipped if present.
+	for bpf.GetNextKey(cm.Fd, unsafe.Pointer(&key), unsafe.Pointer(&keyNext)) == nil {
+		keys = append(keys, keyNext)
+		key = keyNext
+	}
+
+	log.WithField(logfields.Path, cm.path).Debugf("Removing all %d CIDR entries", len(keys)-1)
+	for i := range keys {
+		err := bpf.DeleteElement(cm.Fd, unsafe.Pointer(&keys[i]))
+		if err != nil && i != 0 {
+			return err
+		}
+	}
+	return nil
+}
+
 // String returns the path of the map.
 func (cm *CIDRMap) String() string {
 	if cm == nil {
@@ -0,0 +1,272 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package debugmap
+
+import (
+	"bytes"
+	"fmt"
+	"net"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
+	"github.com/cilium/cilium/pkg/u8proto"
+)
+
+const (
+	// MapName is the name of the debug filter map.
+	MapName = "cilium_debug_filter"
+
+	// MaxSubtype is the largest debug subtype which can be filtered on.
+	MaxSubtype = 255
+)
+
+// Filter modes, must be in sync with <bpf/lib/dbg.h>
+const (
+	// ModeAll emits all debug events
+	ModeAll = iota
+	// ModeNone emits no debug events
+	ModeNone
+	// ModeMatch emits the debug events matching all criteria of the filter
+	ModeMatch
+)
+
+// Filter criteria, must be in sync with <bpf/lib/dbg.h>
+const (
+	// FilterEndpoint matches debug events of the endpoint Endpoint
+	FilterEndpoint = 1 << iota
+	// FilterIdentity matches debug events of programs of the security
+	// identity Identity
+	FilterIdentity
+	// FilterSubtype matches debug events of the subtypes set in MsgTypes
+	// and CaptureTypes
+	FilterSubtype
+	// FilterTuple matches debug events of packets of the filter's tuple
+	FilterTuple
+)
+
+// Address families of the tuple, must be in sync with <bpf/lib/dbg.h>
+const (
+	familyIPv4 = 4
+	familyIPv6 = 6
+)
+
+var modeNames = map[uint8]string{
+	ModeAll:   "all",
+	ModeNone:  "none",
+	ModeMatch: "match",
+}
+
+// Key is the key of the debug filter map.
+type Key struct {
+	Index uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key) NewValue() bpf.MapValue { return &Filter{} }
+
+func (k *Key) String() string { return fmt.Sprintf("%d", k.Index) }
+
+// Filter is the runtime filter of debug events. Zero family, addresses,
+// ports and protocol of the tuple act as wildcards.
+//
+// Must be in sync with struct debug_filter in <bpf/lib/dbg.h>
+type Filter struct {
+	Mode         uint8
+	Family       uint8
+	Nexthdr      u8proto.U8proto
+	Flags        uint8
+	Identity     uint32
+	Endpoint     uint16
+	Sport        uint16 // network byte order
+	Dport        uint16 // network byte order
+	Pad          uint16
+	SrcAddr      [16]byte
+	DstAddr      [16]byte
+	MsgTypes     [8]uint32
+	CaptureTypes [8]uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (f *Filter) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(f) }
+
+// AddMsgType adds the DBG_* subtype t to the filter.
+func (f *Filter) AddMsgType(t uint8) {
+	f.Flags |= FilterSubtype
+	f.MsgTypes[t/32] |= 1 << (t % 32)
+}
+
+// AddCaptureType adds the DBG_CAPTURE_* subtype t to the filter.
+func (f *Filter) AddCaptureType(t uint8) {
+	f.Flags |= FilterSubtype
+	f.CaptureTypes[t/32] |= 1 << (t % 32)
+}
+
+// SetAddrs sets the addresses of the tuple to match. Either address may be
+// nil to match any address, but both must be of the same family.
+func (f *Filter) SetAddrs(src, dst net.IP) error {
+	family := uint8(0)
+	for _, ip := range []net.IP{src, dst} {
+		if ip == nil {
+			continue
+		}
+		ipFamily := uint8(familyIPv6)
+		if ip.To4() != nil {
+			ipFamily = familyIPv4
+		}
+		if family != 0 && family != ipFamily {
+			return fmt.Errorf("addresses %s and %s are of different families", src, dst)
+		}
+		family = ipFamily
+	}
+
+	f.Flags |= FilterTuple
+	f.Family = family
+	f.SrcAddr = addrBytes(src)
+	f.DstAddr = addrBytes(dst)
+	return nil
+}
+
+// SetPorts sets the L4 protocol and ports of the tuple to match, zero
+// values match any protocol or port.
+func (f *Filter) SetPorts(proto u8proto.U8proto, sport, dport uint16) {
+	f.Flags |= FilterTuple
+	f.Nexthdr = proto
+	f.Sport = byteorder.HostToNetwork(sport).(uint16)
+	f.Dport = byteorder.HostToNetwork(dport).(uint16)
+}
+
+// addrBytes returns the datapath representation of ip, IPv4 addresses are
+// stored in the first four bytes.
+func addrBytes(ip net.IP) (addr [16]byte) {
+	if ip4 := ip.To4(); ip4 != nil {
+		copy(addr[:], ip4)
+	} else if ip != nil {
+		copy(addr[:], ip.To16())
+	}
+	return addr
+}
+
+func addrString(family uint8, addr [16]byte) string {
+	switch {
+	case addr == [16]byte{}:
+		return "*"
+	case family == familyIPv4:
+		return net.IP(addr[:4]).String()
+	default:
+		return net.IP(addr[:]).String()
+	}
+}
+
+func portString(port uint16) string {
+	if port == 0 {
+		return "*"
+	}
+	return fmt.Sprintf("%d", byteorder.NetworkToHost(port).(uint16))
+}
+
+func typesString(types [8]uint32) string {
+	var buffer bytes.Buffer
+	for t := 0; t <= MaxSubtype; t++ {
+		if types[t/32]&(1<<uint(t%32)) != 0 {
+			if buffer.Len() > 0 {
+				buffer.WriteString(",")
+			}
+			buffer.WriteString(fmt.Sprintf("%d", t))
+		}
+	}
+	return buffer.String()
+}
+
+// String returns the filter in human readable form
+func (f *Filter) String() string {
+	mode, ok := modeNames[f.Mode]
+	if !ok {
+		mode = fmt.Sprintf("%d", f.Mode)
+	}
+
+	var buffer bytes.Buffer
+	buffer.WriteString("mode=" + mode)
+	if f.Mode != ModeMatch {
+		return buffer.String()
+	}
+
+	if f.Flags&FilterEndpoint != 0 {
+		buffer.WriteString(fmt.Sprintf(" endpoint=%d", f.Endpoint))
+	}
+	if f.Flags&FilterIdentity != 0 {
+		buffer.WriteString(fmt.Sprintf(" identity=%d", f.Identity))
+	}
+	if f.Flags&FilterSubtype != 0 {
+		buffer.WriteString(fmt.Sprintf(" types=[%s] capture-types=[%s]",
+			typesString(f.MsgTypes), typesString(f.CaptureTypes)))
+	}
+	if f.Flags&FilterTuple != 0 {
+		proto := "*"
+		if f.Nexthdr != 0 {
+			proto = f.Nexthdr.String()
+		}
+		buffer.WriteString(fmt.Sprintf(" tuple=%s %s:%s <-> %s:%s", proto,
+			addrString(f.Family, f.SrcAddr), portString(f.Sport),
+			addrString(f.Family, f.DstAddr), portString(f.Dport)))
+	}
+
+	return buffer.String()
+}
+
+// Map is the debug filter map. It is read by the datapath before building
+// every debug event.
+var Map = bpf.NewMap(MapName,
+	bpf.BPF_MAP_TYPE_ARRAY,
+	int(unsafe.Sizeof(Key{})),
+	int(unsafe.Sizeof(Filter{})),
+	1,
+	0, 0,
+	func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+		k, v := Key{}, Filter{}
+
+		if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+			return nil, nil, err
+		}
+		return &k, &v, nil
+	})
+
+// SetFilter installs the debug filter f, it takes effect immediately for
+// all programs compiled with debugging enabled.
+func SetFilter(f *Filter) error {
+	if _, err := Map.OpenOrCreate(); err != nil {
+		return fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	return Map.Update(&Key{}, f)
+}
+
+// GetFilter returns the installed debug filter.
+func GetFilter() (*Filter, error) {
+	if err := Map.Open(); err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	value, err := Map.Lookup(&Key{})
+	if err != nil {
+		return nil, fmt.Errorf("unable to lookup %s: %s", MapName, err)
+	}
+
+	return value.(*Filter), nil
+}
@@ -0,0 +1,65 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package debugmap
+
+import (
+	"net"
+	"testing"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type DebugMapTestSuite struct{}
+
+var _ = Suite(&DebugMapTestSuite{})
+
+func (s *DebugMapTestSuite) TestFilterSize(c *C) {
+	// Must match struct debug_filter in bpf/lib/dbg.h
+	c.Assert(unsafe.Sizeof(Filter{}), Equals, uintptr(112))
+}
+
+func (s *DebugMapTestSuite) TestFilter(c *C) {
+	f := Filter{Mode: ModeMatch}
+	c.Assert(f.String(), Equals, "mode=match")
+
+	f.AddMsgType(3)
+	f.AddMsgType(40)
+	f.AddCaptureType(4)
+	c.Assert(f.MsgTypes[0], Equals, uint32(1<<3))
+	c.Assert(f.MsgTypes[1], Equals, uint32(1<<8))
+	c.Assert(f.String(), Equals, "mode=match types=[3,40] capture-types=[4]")
+
+	c.Assert(f.SetAddrs(net.ParseIP("10.0.0.1"), nil), IsNil)
+	f.SetPorts(u8proto.TCP, 0, 80)
+	c.Assert(f.Family, Equals, uint8(familyIPv4))
+	c.Assert(f.SrcAddr[:4], DeepEquals, []byte{10, 0, 0, 1})
+	c.Assert(f.String(), Equals, "mode=match types=[3,40] capture-types=[4] tuple=TCP 10.0.0.1:* <-> *:80")
+
+	c.Assert(f.SetAddrs(net.ParseIP("10.0.0.1"), net.ParseIP("f00d::1")), Not(IsNil))
+	c.Assert(f.SetAddrs(nil, net.ParseIP("f00d::1")), IsNil)
+	c.Assert(f.Family, Equals, uint8(familyIPv6))
+	c.Assert(f.SrcAddr, Equals, [16]byte{})
+
+	c.Assert((&Filter{Mode: ModeNone, Flags: FilterTuple}).String(), Equals, "mode=none")
+}
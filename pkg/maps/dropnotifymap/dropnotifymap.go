@@ -0,0 +1,82 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+package dropnotifymap
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+// MaxEntries is the number of drop reasons the map holds a bucket for.
+//
+// Must match max_elem of DROP_NOTIFY_RATE_MAP in <bpf/lib/drop.h>
+const MaxEntries = 256
+
+// Bucket is the per-CPU value of the drop notification rate map.
+//
+// Must be in sync with struct drop_notify_bucket in <bpf/lib/drop.h>
+type Bucket struct {
+	Tat        uint64
+	Suppressed uint64
+}
+
+// Entry is the number of notifications suppressed for a drop reason, summed
+// over all CPUs.
+type Entry struct {
+	Reason     uint8
+	Suppressed uint64
+}
+
+// Dump returns the drop reasons for which notifications were suppressed by
+// the rate limit, along with the number of suppressed notifications.
+func Dump() ([]Entry, error) {
+	path := bpf.MapPath(bpf.DropNotifyRateMapName)
+	m, err := bpf.OpenMap(path)
+	if err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", bpf.DropNotifyRateMapName, err)
+	}
+	defer m.Close()
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return nil, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	values := make([]Bucket, possibleCPUs)
+	entries := []Entry{}
+	for key := uint32(0); key < MaxEntries; key++ {
+		err := bpf.LookupElement(m.GetFd(), unsafe.Pointer(&key), unsafe.Pointer(&values[0]))
+		if err != nil {
+			return nil, fmt.Errorf("unable to lookup %s: %s", bpf.DropNotifyRateMapName, err)
+		}
+
+		entry := Entry{Reason: uint8(key), Suppressed: Sum(values)}
+		if entry.Suppressed != 0 {
+			entries = append(entries, entry)
+		}
+	}
+
+	return entries, nil
+}
+
+// Sum returns the number of suppressed notifications of the per-CPU buckets.
+func Sum(buckets []Bucket) uint64 {
+	n := uint64(0)
+	for i := range buckets {
+		n += buckets[i].Suppressed
+	}
+	return n
+}
@@ -0,0 +1,45 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// +build !privileged_tests
+
+package dropnotifymap
+
+import (
+	"testing"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type DropNotifyMapTestSuite struct{}
+
+var _ = Suite(&DropNotifyMapTestSuite{})
+
+func (s *DropNotifyMapTestSuite) TestBucketSize(c *C) {
+	// Must match struct drop_notify_bucket in bpf/lib/drop.h
+	c.Assert(unsafe.Sizeof(Bucket{}), Equals, uintptr(16))
+}
+
+func (s *DropNotifyMapTestSuite) TestSum(c *C) {
+	c.Assert(Sum(nil), Equals, uint64(0))
+	c.Assert(Sum([]Bucket{
+		{Tat: 100, Suppressed: 3},
+		{Tat: 200},
+		{Tat: 300, Suppressed: 5},
+	}), Equals, uint64(8))
+}
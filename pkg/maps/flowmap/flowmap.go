@@ -0,0 +1,178 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package flowmap
+
+import (
+	"fmt"
+	"net"
+	"unsafe"
+
+	"github.com/cilium/cilium/common/types"
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
+	"github.com/cilium/cilium/pkg/u8proto"
+)
+
+const (
+	// MapName is the name of the flow summary map. It is created and
+	// updated by the datapath.
+	MapName = "cilium_flow_summary"
+
+	// MaxEntries is the maximum number of flows in the flow summary map,
+	// the least recently used flows are evicted beyond.
+	MaxEntries = 65536
+
+	// familyIPv4 and familyIPv6 must match ENDPOINT_KEY_IPV4 and
+	// ENDPOINT_KEY_IPV6 in <bpf/lib/common.h>
+	familyIPv4 = 1
+	familyIPv6 = 2
+)
+
+// Verdicts of a flow, must match FLOW_VERDICT_* in <bpf/lib/flow.h>
+const (
+	VerdictForwarded = 1
+	VerdictDropped   = 2
+)
+
+// Key is the 5-tuple and the security identities of a flow.
+//
+// Must be in sync with struct flow_key in <bpf/lib/flow.h>
+type Key struct {
+	SourceAddr types.IPv6
+	DestAddr   types.IPv6
+	SourcePort uint16
+	DestPort   uint16
+	NextHeader u8proto.U8proto
+	Family     uint8
+	Pad        uint16
+	SourceID   uint32
+	DestID     uint32
+}
+
+// Value is the summary of a flow.
+//
+// Must be in sync with struct flow_value in <bpf/lib/flow.h>
+type Value struct {
+	Packets    uint64 `json:"packets"`
+	Bytes      uint64 `json:"bytes"`
+	FirstSeen  uint64 `json:"first-seen"`
+	LastSeen   uint64 `json:"last-seen"`
+	Verdict    uint8  `json:"verdict"`
+	ObsPoint   uint8  `json:"observation-point"`
+	DropReason uint8  `json:"drop-reason"`
+	Pad1       uint8  `json:"-"`
+	Pad2       uint32 `json:"-"`
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key) NewValue() bpf.MapValue { return &Value{} }
+
+func (k *Key) addr(addr *types.IPv6) net.IP {
+	if k.Family == familyIPv4 {
+		return net.IPv4(addr[0], addr[1], addr[2], addr[3])
+	}
+	return addr.IP()
+}
+
+// SourceIP returns the source address of the flow.
+func (k *Key) SourceIP() net.IP { return k.addr(&k.SourceAddr) }
+
+// DestIP returns the destination address of the flow.
+func (k *Key) DestIP() net.IP { return k.addr(&k.DestAddr) }
+
+// SourcePortHost returns the source port of the flow in host byte order.
+func (k *Key) SourcePortHost() uint16 {
+	return byteorder.NetworkToHost(k.SourcePort).(uint16)
+}
+
+// DestPortHost returns the destination port of the flow in host byte order.
+func (k *Key) DestPortHost() uint16 {
+	return byteorder.NetworkToHost(k.DestPort).(uint16)
+}
+
+func (k *Key) String() string {
+	return fmt.Sprintf("%s %s -> %s identity %d -> %d",
+		k.NextHeader,
+		net.JoinHostPort(k.SourceIP().String(), fmt.Sprintf("%d", k.SourcePortHost())),
+		net.JoinHostPort(k.DestIP().String(), fmt.Sprintf("%d", k.DestPortHost())),
+		k.SourceID, k.DestID)
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (v *Value) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(v) }
+
+// IsDrop returns true if the last packet of the flow was dropped.
+func (v *Value) IsDrop() bool {
+	return v.Verdict == VerdictDropped
+}
+
+func (v *Value) String() string {
+	return fmt.Sprintf("packets=%d bytes=%d first=%d last=%d verdict=%d reason=%d",
+		v.Packets, v.Bytes, v.FirstSeen, v.LastSeen, v.Verdict, v.reason())
+}
+
+func (v *Value) reason() uint8 {
+	if v.IsDrop() {
+		return v.DropReason
+	}
+	return v.ObsPoint
+}
+
+// Map is the flow summary map.
+var Map = bpf.NewMap(MapName,
+	bpf.BPF_MAP_TYPE_LRU_HASH,
+	int(unsafe.Sizeof(Key{})),
+	int(unsafe.Sizeof(Value{})),
+	MaxEntries,
+	0, 0,
+	func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+		k, v := Key{}, Value{}
+
+		if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+			return nil, nil, err
+		}
+		return &k, &v, nil
+	})
+
+// Flow is a flow summary as read from the map.
+type Flow struct {
+	Key   Key
+	Value Value
+}
+
+// Dump returns all flow summaries currently held by the datapath.
+func Dump() ([]Flow, error) {
+	if err := Map.Open(); err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+	defer Map.Close()
+
+	flows := []Flow{}
+	cb := func(key bpf.MapKey, value bpf.MapValue) {
+		flows = append(flows, Flow{
+			Key:   *key.(*Key),
+			Value: *value.(*Value),
+		})
+	}
+	if err := Map.DumpWithCallback(cb); err != nil {
+		return nil, fmt.Errorf("unable to dump %s: %s", MapName, err)
+	}
+
+	return flows, nil
+}
@@ -0,0 +1,61 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package flowmap
+
+import (
+	"net"
+	"testing"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/byteorder"
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type FlowMapTestSuite struct{}
+
+var _ = Suite(&FlowMapTestSuite{})
+
+func (s *FlowMapTestSuite) TestSizes(c *C) {
+	// Must match struct flow_key and struct flow_value in bpf/lib/flow.h
+	c.Assert(unsafe.Sizeof(Key{}), Equals, uintptr(48))
+	c.Assert(unsafe.Sizeof(Value{}), Equals, uintptr(40))
+}
+
+func (s *FlowMapTestSuite) TestKeyString(c *C) {
+	key := Key{
+		SourcePort: byteorder.HostToNetwork(uint16(41000)).(uint16),
+		DestPort:   byteorder.HostToNetwork(uint16(80)).(uint16),
+		NextHeader: u8proto.TCP,
+		Family:     familyIPv4,
+		SourceID:   1000,
+		DestID:     2000,
+	}
+	copy(key.SourceAddr[:], net.ParseIP("10.0.0.1").To4())
+	copy(key.DestAddr[:], net.ParseIP("10.0.0.2").To4())
+	c.Assert(key.String(), Equals, "TCP 10.0.0.1:41000 -> 10.0.0.2:80 identity 1000 -> 2000")
+
+	key.Family = familyIPv6
+	copy(key.SourceAddr[:], net.ParseIP("f00d::1"))
+	copy(key.DestAddr[:], net.ParseIP("f00d::2"))
+	c.Assert(key.String(), Equals, "TCP [f00d::1]:41000 -> [f00d::2]:80 identity 1000 -> 2000")
+}
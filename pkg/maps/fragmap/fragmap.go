@@ -0,0 +1,32 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Package fragmap represents the maps tracking the L4 ports of fragmented
+// IPv4 and IPv6 datagrams. It is populated and consumed by the datapath only, entries
+// are aged out by LRU eviction.
+package fragmap
+
+const (
+	// MapName is the name of the map used to track IPv4 datagram
+	// fragments.
+	MapName = "cilium_ipv4_frag_datagrams"
+
+	// MapName6 is the name of the map used to track IPv6 datagram
+	// fragments.
+	MapName6 = "cilium_ipv6_frag_datagrams"
+
+	// MaxEntries is the maximum number of datagrams tracked at once per
+	// address family.
+	MaxEntries = 8192
+)
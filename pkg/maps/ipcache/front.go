@@ -0,0 +1,148 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package ipcache
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/lock"
+)
+
+const (
+	// FrontMapName is the name of the per-CPU front cache of the IPCache
+	// map. It is created and only accessed by the datapath.
+	FrontMapName = "cilium_ipcache_front"
+
+	// FrontMapSize is the number of slots per CPU in the front cache. It
+	// must be a power of two no larger than 65536.
+	FrontMapSize = 256
+
+	// FrontGenMapName is the name of the map holding the generation of the
+	// IPCache map content. Bumping it invalidates the front cache.
+	FrontGenMapName = "cilium_ipcache_front_gen"
+
+	// FrontStatsMapName is the name of the per-CPU map holding the hit and
+	// miss counters of the front cache.
+	FrontStatsMapName = "cilium_ipcache_front_stats"
+)
+
+// FrontKey is the key of the front cache generation and statistics maps.
+type FrontKey struct {
+	Index uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *FrontKey) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *FrontKey) NewValue() bpf.MapValue { return &FrontGeneration{} }
+
+func (k *FrontKey) String() string { return fmt.Sprintf("%d", k.Index) }
+
+// FrontGeneration is the value of the front cache generation map.
+type FrontGeneration struct {
+	Generation uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (g *FrontGeneration) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(g) }
+
+func (g *FrontGeneration) String() string { return fmt.Sprintf("%d", g.Generation) }
+
+// FrontStats is the per-CPU value of the front cache statistics map.
+//
+// Must be in sync with struct ipcache_front_stats in <bpf/lib/common.h>
+type FrontStats struct {
+	Hits   uint64 `json:"hits"`
+	Misses uint64 `json:"misses"`
+}
+
+// HitRatio returns the ratio of lookups served from the front cache.
+func (s *FrontStats) HitRatio() float64 {
+	if s.Hits+s.Misses == 0 {
+		return 0
+	}
+	return float64(s.Hits) / float64(s.Hits+s.Misses)
+}
+
+var (
+	// FrontGenerationMap holds the generation of the IPCache content which
+	// is checked by the datapath before using a front cache slot.
+	FrontGenerationMap = bpf.NewMap(FrontGenMapName,
+		bpf.BPF_MAP_TYPE_ARRAY,
+		int(unsafe.Sizeof(FrontKey{})),
+		int(unsafe.Sizeof(FrontGeneration{})),
+		1,
+		0, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := FrontKey{}, FrontGeneration{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+
+	// frontGenerationMutex serializes generation bumps.
+	frontGenerationMutex lock.Mutex
+)
+
+// BumpFrontGeneration invalidates all entries of the datapath front cache.
+// It must be called after every modification of the IPCache map.
+func BumpFrontGeneration() error {
+	frontGenerationMutex.Lock()
+	defer frontGenerationMutex.Unlock()
+
+	key := FrontKey{}
+	value, err := FrontGenerationMap.Lookup(&key)
+	if err != nil {
+		return fmt.Errorf("unable to lookup ipcache generation: %s", err)
+	}
+
+	gen := value.(*FrontGeneration)
+	gen.Generation++
+	return FrontGenerationMap.Update(&key, gen)
+}
+
+// DumpFrontStats returns the front cache statistics summed over all CPUs.
+func DumpFrontStats() (*FrontStats, error) {
+	m, err := bpf.OpenMap(FrontStatsMapName)
+	if err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", FrontStatsMapName, err)
+	}
+	defer m.Close()
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return nil, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	key := FrontKey{}
+	values := make([]FrontStats, possibleCPUs)
+	if err := bpf.LookupElement(m.GetFd(), key.GetKeyPtr(), unsafe.Pointer(&values[0])); err != nil {
+		return nil, fmt.Errorf("unable to lookup %s: %s", FrontStatsMapName, err)
+	}
+
+	stats := &FrontStats{}
+	for i := range values {
+		stats.Hits += values[i].Hits
+		stats.Misses += values[i].Misses
+	}
+
+	return stats, nil
+}
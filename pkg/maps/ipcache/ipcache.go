@@ -24,6 +24,7 @@ import (
 	"github.com/cilium/cilium/pkg/bpf"
 	"github.com/cilium/cilium/pkg/logging"
 	"github.com/cilium/cilium/pkg/logging/logfields"
+	"github.com/cilium/cilium/pkg/option"
 
 	"golang.org/x/sys/unix"
 )
@@ -38,6 +39,14 @@ const (
 	// Name is the canonical name for the IPCache map on the filesystem.
 	Name = "cilium_ipcache"
 
+	// Name4 is the canonical name for the IPv4 IPCache map on the
+	// filesystem when the IPCache is split by address family.
+	Name4 = "cilium_ipcache4"
+
+	// Name6 is the canonical name for the IPv6 IPCache map on the
+	// filesystem when the IPCache is split by address family.
+	Name6 = "cilium_ipcache6"
+
 	// maxPrefixLengths is an approximation of how many different CIDR
 	// prefix lengths may be supported by the BPF datapath without causing
 	// BPF code generation to exceed the verifier instruction limit.
@@ -122,6 +131,44 @@ func NewKey(ip net.IP, mask net.IPMask) Key {
 	return result
 }
 
+// Key4 implements the bpf.MapKey interface for the IPv4 IPCache map.
+//
+// Must be in sync with struct ipcache4_key in <bpf/lib/maps.h>
+type Key4 struct {
+	Prefixlen uint32
+	IP        types.IPv4
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key4) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key4) NewValue() bpf.MapValue { return &RemoteEndpointInfo{} }
+
+func (k *Key4) String() string {
+	return fmt.Sprintf("%s/%d", net.IP(k.IP[:]).String(), k.Prefixlen)
+}
+
+// Key6 implements the bpf.MapKey interface for the IPv6 IPCache map.
+//
+// Must be in sync with struct ipcache6_key in <bpf/lib/maps.h>
+type Key6 struct {
+	Prefixlen uint32
+	IP        types.IPv6
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key6) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key6) NewValue() bpf.MapValue { return &RemoteEndpointInfo{} }
+
+func (k *Key6) String() string {
+	return fmt.Sprintf("%s/%d", k.IP.String(), k.Prefixlen)
+}
+
 // RemoteEndpointInfo implements the bpf.MapValue interface. It contains the
 // security identity of a remote endpoint.
 type RemoteEndpointInfo struct {
@@ -148,29 +195,112 @@ type Map struct {
 	// whether the underlying kernel supports delete operations on the map
 	// the first time that supportsDelete() is called.
 	deleteSupport bool
+
+	// family is the address family stored in the map, or 0 if the map
+	// holds entries of both families.
+	family int
 }
 
-// NewMap instantiates a Map.
-func NewMap(name string) *Map {
+func newMap(name string, family int, keySize int, parser bpf.DumpParser) *Map {
 	return &Map{
 		Map: *bpf.NewMap(
 			name,
 			bpf.BPF_MAP_TYPE_LPM_TRIE,
-			int(unsafe.Sizeof(Key{})),
+			keySize,
 			int(unsafe.Sizeof(RemoteEndpointInfo{})),
 			MaxEntries,
 			bpf.BPF_F_NO_PREALLOC, 0,
-			func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
-				k, v := Key{}, RemoteEndpointInfo{}
-
-				if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
-					return nil, nil, err
-				}
-				return &k, &v, nil
-			},
+			parser,
 		).WithCache(),
 		deleteSupport: true,
+		family:        family,
+	}
+}
+
+// NewMap instantiates a Map holding entries of both address families.
+func NewMap(name string) *Map {
+	return newMap(name, 0, int(unsafe.Sizeof(Key{})),
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := Key{}, RemoteEndpointInfo{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+}
+
+// NewMap4 instantiates a Map holding IPv4 entries only.
+func NewMap4(name string) *Map {
+	return newMap(name, unix.AF_INET, int(unsafe.Sizeof(Key4{})),
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := Key4{}, RemoteEndpointInfo{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+}
+
+// NewMap6 instantiates a Map holding IPv6 entries only.
+func NewMap6(name string) *Map {
+	return newMap(name, unix.AF_INET6, int(unsafe.Sizeof(Key6{})),
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := Key6{}, RemoteEndpointInfo{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+}
+
+// NewMapLike instantiates a Map with the given name which holds the same
+// address families as 'm'.
+func NewMapLike(m *Map, name string) *Map {
+	switch m.family {
+	case unix.AF_INET:
+		return NewMap4(name)
+	case unix.AF_INET6:
+		return NewMap6(name)
+	}
+	return NewMap(name)
+}
+
+// Handles returns true if entries for 'ip' are stored in the map.
+func (m *Map) Handles(ip net.IP) bool {
+	switch m.family {
+	case unix.AF_INET:
+		return ip.To4() != nil
+	case unix.AF_INET6:
+		return ip.To4() == nil
+	}
+	return true
+}
+
+// NewKey returns the key for the provided IP address and mask in the format
+// of the map.
+func (m *Map) NewKey(ip net.IP, mask net.IPMask) bpf.MapKey {
+	ones, _ := mask.Size()
+	switch m.family {
+	case unix.AF_INET:
+		if mask == nil {
+			ones = net.IPv4len * 8
+		}
+		key := &Key4{Prefixlen: uint32(ones)}
+		copy(key.IP[:], ip.To4())
+		return key
+	case unix.AF_INET6:
+		if mask == nil {
+			ones = net.IPv6len * 8
+		}
+		key := &Key6{Prefixlen: uint32(ones)}
+		copy(key.IP[:], ip)
+		return key
 	}
+	key := NewKey(ip, mask)
+	return &key
 }
 
 // delete removes a key from the ipcache BPF map, and returns whether the
@@ -202,7 +332,7 @@ func (m *Map) Delete(k bpf.MapKey) error {
 // GetMaxPrefixLengths determines how many unique prefix lengths are supported
 // simultaneously based on the underlying BPF map type in use.
 func (m *Map) GetMaxPrefixLengths(ipv6 bool) (count int) {
-	if IPCache.MapType == bpf.BPF_MAP_TYPE_LPM_TRIE {
+	if BackedByLPM() {
 		if ipv6 {
 			return net.IPv6len*8 + 1
 		} else {
@@ -217,8 +347,18 @@ func (m *Map) GetMaxPrefixLengths(ipv6 bool) (count int) {
 
 func (m *Map) supportsDelete() bool {
 	m.detectDeleteSupport.Do(func() {
-		// Entry is invalid because IPCache needs a family specified.
-		invalidEntry := &Key{}
+		// Entry is invalid because IPCache needs a family specified,
+		// or for the family specific maps, because the prefix length
+		// exceeds the address length.
+		var invalidEntry bpf.MapKey
+		switch m.family {
+		case unix.AF_INET:
+			invalidEntry = &Key4{Prefixlen: net.IPv4len*8 + 1}
+		case unix.AF_INET6:
+			invalidEntry = &Key6{Prefixlen: net.IPv6len*8 + 1}
+		default:
+			invalidEntry = &Key{}
+		}
 		m.deleteSupport, _ = m.delete(invalidEntry, false)
 		log.Debugf("Detected IPCache delete operation support: %t", m.deleteSupport)
 		if !m.deleteSupport {
@@ -231,13 +371,13 @@ func (m *Map) supportsDelete() bool {
 // SupportsDelete determines whether the underlying kernel map type supports
 // the delete operation.
 func SupportsDelete() bool {
-	return IPCache.supportsDelete()
+	return Maps()[0].supportsDelete()
 }
 
 // BackedByLPM returns true if the IPCache is backed by a proper LPM
 // implementation (provided by Linux kernels 4.11 or later), false otherwise.
 func BackedByLPM() bool {
-	return IPCache.MapType == bpf.BPF_MAP_TYPE_LPM_TRIE
+	return Maps()[0].MapType == bpf.BPF_MAP_TYPE_LPM_TRIE
 }
 
 var (
@@ -245,10 +385,41 @@ var (
 	// Cilium agent is a part of to their corresponding security identities.
 	// It is a singleton; there is only one such map per agent.
 	IPCache = NewMap(Name)
+
+	// IPCache4 and IPCache6 replace IPCache if the IPCache is split by
+	// address family. Their keys only carry the prefix length and the
+	// address, which reduces the memory footprint of IPv4 entries and the
+	// depth of the LPM trie.
+	IPCache4 = NewMap4(Name4)
+	IPCache6 = NewMap6(Name6)
 )
 
-// Reopen attempts to close and re-open the IPCache map at the standard path
+// Maps returns the IPCache maps in use by the datapath.
+func Maps() []*Map {
+	if option.Config.EnableSplitIPCache {
+		return []*Map{IPCache4, IPCache6}
+	}
+	return []*Map{IPCache}
+}
+
+// Reopen attempts to close and re-open the IPCache maps at the standard path
 // on the filesystem.
 func Reopen() error {
-	return IPCache.Map.Reopen()
+	for _, m := range Maps() {
+		if err := m.Map.Reopen(); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// DumpAll dumps the content of all IPCache maps present on the filesystem
+// into 'entries'.
+func DumpAll(entries map[string][]string) error {
+	for _, m := range []*Map{IPCache, IPCache4, IPCache6} {
+		if err := m.DumpIfExists(entries); err != nil {
+			return err
+		}
+	}
+	return nil
 }
@@ -0,0 +1,86 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package ipcache
+
+import (
+	"net"
+	"testing"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type IPCacheMapTestSuite struct{}
+
+var _ = Suite(&IPCacheMapTestSuite{})
+
+func (s *IPCacheMapTestSuite) TestSplitKeys(c *C) {
+	// Must match struct ipcache4_key and ipcache6_key in bpf/lib/maps.h
+	c.Assert(unsafe.Sizeof(Key4{}), Equals, uintptr(8))
+	c.Assert(unsafe.Sizeof(Key6{}), Equals, uintptr(20))
+
+	m4 := NewMap4("test_ipcache4")
+	m6 := NewMap6("test_ipcache6")
+	m := NewMap("test_ipcache")
+
+	_, cidr4, _ := net.ParseCIDR("10.1.0.0/16")
+	_, cidr6, _ := net.ParseCIDR("f00d::/96")
+
+	c.Assert(m4.Handles(cidr4.IP), Equals, true)
+	c.Assert(m4.Handles(cidr6.IP), Equals, false)
+	c.Assert(m6.Handles(cidr4.IP), Equals, false)
+	c.Assert(m6.Handles(cidr6.IP), Equals, true)
+	c.Assert(m.Handles(cidr4.IP), Equals, true)
+	c.Assert(m.Handles(cidr6.IP), Equals, true)
+
+	key4 := m4.NewKey(cidr4.IP, cidr4.Mask)
+	c.Assert(key4, DeepEquals, &Key4{Prefixlen: 16, IP: [4]byte{10, 1, 0, 0}})
+	c.Assert(key4.String(), Equals, "10.1.0.0/16")
+
+	key6 := m6.NewKey(cidr6.IP, cidr6.Mask)
+	c.Assert(key6.(*Key6).Prefixlen, Equals, uint32(96))
+	c.Assert(key6.String(), Equals, "f00d::/96")
+
+	// Host entries without mask
+	c.Assert(m4.NewKey(net.ParseIP("10.1.1.1"), nil).String(), Equals, "10.1.1.1/32")
+	c.Assert(m6.NewKey(net.ParseIP("f00d::1"), nil).String(), Equals, "f00d::1/128")
+
+	// The combined map uses the same string representation
+	c.Assert(m.NewKey(cidr4.IP, cidr4.Mask).String(), Equals, "10.1.0.0/16")
+	c.Assert(m.NewKey(cidr6.IP, cidr6.Mask).String(), Equals, "f00d::/96")
+}
+
+func (s *IPCacheMapTestSuite) TestNewPrefixes(c *C) {
+	// Must match struct ipcache_prefixes in bpf/lib/common.h
+	c.Assert(unsafe.Sizeof(Prefixes{}), Equals, uintptr(24))
+	// Must match struct ipcache_prefixes_info in bpf/lib/common.h
+	c.Assert(unsafe.Sizeof(PrefixesInfo{}), Equals, uintptr(52))
+
+	p, err := NewPrefixes([]int{128, 0}, []int{32, 24, 0})
+	c.Assert(err, IsNil)
+	c.Assert(p.Count6, Equals, uint8(2))
+	c.Assert(p.Count4, Equals, uint8(3))
+	c.Assert(p.Prefixes6[:p.Count6], DeepEquals, []uint8{128, 0})
+	c.Assert(p.Prefixes4[:p.Count4], DeepEquals, []uint8{32, 24, 0})
+
+	_, err = NewPrefixes([]int{128, 96, 64, 48, 0}, nil)
+	c.Assert(err, Not(IsNil))
+}
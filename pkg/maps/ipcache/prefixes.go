@@ -0,0 +1,171 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package ipcache
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/lock"
+)
+
+const (
+	// PrefixesMapName is the name of the map holding the prefix lengths
+	// the datapath probes in the IPCache map when the kernel lacks LPM
+	// map support.
+	PrefixesMapName = "cilium_ipcache_prefixes"
+)
+
+// PrefixesKey is the key of the prefix lengths map, which only has a single
+// entry at index 0.
+type PrefixesKey struct {
+	Index uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *PrefixesKey) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *PrefixesKey) NewValue() bpf.MapValue { return &PrefixesInfo{} }
+
+func (k *PrefixesKey) String() string { return fmt.Sprintf("%d", k.Index) }
+
+// Prefixes is a slot of the prefix lengths map value. Prefix lengths are
+// ordered from high to low.
+//
+// Must be in sync with struct ipcache_prefixes in <bpf/lib/common.h>
+type Prefixes struct {
+	Count4    uint8
+	Count6    uint8
+	Prefixes4 [maxPrefixLengths4]uint8
+	Prefixes6 [maxPrefixLengths6]uint8
+}
+
+func (p *Prefixes) String() string {
+	return fmt.Sprintf("v4=%v v6=%v", p.Prefixes4[:p.Count4], p.Prefixes6[:p.Count6])
+}
+
+// PrefixesInfo is the value of the prefix lengths map. The datapath reads the
+// slot selected by Active, the other slot is written by the agent before
+// Active is flipped.
+//
+// Must be in sync with struct ipcache_prefixes_info in <bpf/lib/common.h>
+type PrefixesInfo struct {
+	Slots  [2]Prefixes
+	Active uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (p *PrefixesInfo) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(p) }
+
+func (p *PrefixesInfo) String() string {
+	return fmt.Sprintf("active=%d %s", p.Active, p.Slots[p.Active&1].String())
+}
+
+// NewPrefixes converts the prefix lengths, each sorted from high to low,
+// into the value of the prefix lengths map.
+func NewPrefixes(s6, s4 []int) (*Prefixes, error) {
+	p := &Prefixes{}
+
+	if len(s6) > maxPrefixLengths6 {
+		return nil, fmt.Errorf("%d IPv6 prefix lengths exceed the maximum of %d",
+			len(s6), maxPrefixLengths6)
+	}
+	if len(s4) > maxPrefixLengths4 {
+		return nil, fmt.Errorf("%d IPv4 prefix lengths exceed the maximum of %d",
+			len(s4), maxPrefixLengths4)
+	}
+
+	for i, prefix := range s6 {
+		p.Prefixes6[i] = uint8(prefix)
+	}
+	p.Count6 = uint8(len(s6))
+	for i, prefix := range s4 {
+		p.Prefixes4[i] = uint8(prefix)
+	}
+	p.Count4 = uint8(len(s4))
+
+	return p, nil
+}
+
+// PrefixesMap holds the prefix lengths present in the IPCache map. The
+// datapath only probes these prefix lengths when the IPCache map is not
+// backed by an LPM trie, so CIDR policy changes only need to update this map
+// instead of recompiling the BPF programs.
+var PrefixesMap = bpf.NewMap(PrefixesMapName,
+	bpf.BPF_MAP_TYPE_ARRAY,
+	int(unsafe.Sizeof(PrefixesKey{})),
+	int(unsafe.Sizeof(PrefixesInfo{})),
+	1,
+	0, 0,
+	func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+		k, v := PrefixesKey{}, PrefixesInfo{}
+
+		if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+			return nil, nil, err
+		}
+		return &k, &v, nil
+	})
+
+var (
+	prefixesMutex lock.Mutex
+
+	// prefixes mirrors the content of PrefixesMap, nil until it has been
+	// read from the map.
+	prefixes *PrefixesInfo
+)
+
+// UpdatePrefixes writes the prefix lengths, each sorted from high to low, into
+// the prefix lengths map.
+//
+// The inactive slot is written first and then made active by a second update
+// which only changes the active index. Each update leaves the bytes read by
+// the datapath unchanged, so the datapath never sees a torn slot.
+func UpdatePrefixes(s6, s4 []int) error {
+	p, err := NewPrefixes(s6, s4)
+	if err != nil {
+		return err
+	}
+
+	prefixesMutex.Lock()
+	defer prefixesMutex.Unlock()
+
+	if prefixes == nil {
+		// The map may have been left behind by a previous run, continue
+		// from the slot it has marked active.
+		info := &PrefixesInfo{}
+		if v, err := PrefixesMap.Lookup(&PrefixesKey{}); err == nil {
+			info = v.(*PrefixesInfo)
+		}
+		prefixes = info
+	}
+
+	next := *prefixes
+	next.Slots[(next.Active+1)&1] = *p
+	if err := PrefixesMap.Update(&PrefixesKey{}, &next); err != nil {
+		return err
+	}
+	*prefixes = next
+
+	next.Active = (next.Active + 1) & 1
+	if err := PrefixesMap.Update(&PrefixesKey{}, &next); err != nil {
+		return err
+	}
+	*prefixes = next
+
+	return nil
+}
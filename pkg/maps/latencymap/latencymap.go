@@ -0,0 +1,178 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package latencymap
+
+import (
+	"fmt"
+	"time"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+const (
+	// MapName is the name of the latency histogram map. It is created and
+	// updated by the datapath.
+	MapName = "cilium_latency"
+
+	// Buckets is the number of log2 buckets of a histogram, bucket i
+	// counts samples in [2^i, 2^(i+1)) nanoseconds.
+	//
+	// Must match LATENCY_BUCKETS in <bpf/lib/latency.h>
+	Buckets = 32
+)
+
+// Instrumented programs, must match LATENCY_PROG_* in <bpf/lib/latency.h>
+var programs = []string{
+	"from-container",
+	"to-container",
+	"from-netdev",
+	"from-host",
+	"from-overlay",
+}
+
+// Measured stages, must match LATENCY_STAGE_* in <bpf/lib/latency.h>
+var stages = []string{
+	"total",
+	"conntrack",
+	"loadbalancer",
+	"policy",
+}
+
+// Histogram is the per-CPU value of the latency histogram map.
+//
+// Must be in sync with struct latency_hist in <bpf/lib/latency.h>
+type Histogram struct {
+	Start   uint64
+	Buckets [Buckets]uint64
+}
+
+// Samples returns the number of samples in the histogram.
+func (h *Histogram) Samples() uint64 {
+	n := uint64(0)
+	for _, count := range h.Buckets {
+		n += count
+	}
+	return n
+}
+
+// bucketBound returns the exclusive upper bound of the given bucket.
+func bucketBound(bucket int) time.Duration {
+	return time.Duration(uint64(1) << uint(bucket+1))
+}
+
+// Percentile returns the upper bound of the bucket holding the given
+// percentile of the samples, or 0 if the histogram is empty.
+func (h *Histogram) Percentile(p float64) time.Duration {
+	samples := h.Samples()
+	if samples == 0 {
+		return 0
+	}
+
+	rank := uint64(p / 100 * float64(samples))
+	if rank >= samples {
+		rank = samples - 1
+	}
+
+	seen := uint64(0)
+	for i, count := range h.Buckets {
+		seen += count
+		if seen > rank {
+			return bucketBound(i)
+		}
+	}
+	return bucketBound(Buckets - 1)
+}
+
+// Max returns the upper bound of the highest non-empty bucket, or 0 if the
+// histogram is empty.
+func (h *Histogram) Max() time.Duration {
+	for i := Buckets - 1; i >= 0; i-- {
+		if h.Buckets[i] != 0 {
+			return bucketBound(i)
+		}
+	}
+	return 0
+}
+
+// Entry is the histogram of a stage of a program summed over all CPUs.
+type Entry struct {
+	Program   string
+	Stage     string
+	Histogram Histogram
+}
+
+// Dump returns the non-empty histograms of the datapath, summed over all
+// CPUs.
+func Dump() ([]Entry, error) {
+	m, err := bpf.OpenMap(bpf.MapPath(MapName))
+	if err != nil {
+		return nil, fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+	defer m.Close()
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return nil, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	values := make([]Histogram, possibleCPUs)
+	entries := []Entry{}
+	for p := range programs {
+		for s := range stages {
+			key := uint32(p*len(stages) + s)
+			err := bpf.LookupElement(m.GetFd(), unsafe.Pointer(&key), unsafe.Pointer(&values[0]))
+			if err != nil {
+				return nil, fmt.Errorf("unable to lookup %s: %s", MapName, err)
+			}
+
+			entry := Entry{Program: programs[p], Stage: stages[s]}
+			for i := range values {
+				for b := range values[i].Buckets {
+					entry.Histogram.Buckets[b] += values[i].Buckets[b]
+				}
+			}
+			if entry.Histogram.Samples() != 0 {
+				entries = append(entries, entry)
+			}
+		}
+	}
+
+	return entries, nil
+}
+
+// Reset clears all histograms.
+func Reset() error {
+	m, err := bpf.OpenMap(bpf.MapPath(MapName))
+	if err != nil {
+		return fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+	defer m.Close()
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	values := make([]Histogram, possibleCPUs)
+	for key := uint32(0); key < uint32(len(programs)*len(stages)); key++ {
+		err := bpf.UpdateElement(m.GetFd(), unsafe.Pointer(&key), unsafe.Pointer(&values[0]), 0)
+		if err != nil {
+			return fmt.Errorf("unable to reset %s: %s", MapName, err)
+		}
+	}
+
+	return nil
+}
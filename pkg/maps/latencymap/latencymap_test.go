@@ -0,0 +1,58 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package latencymap
+
+import (
+	"testing"
+	"time"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type LatencyMapTestSuite struct{}
+
+var _ = Suite(&LatencyMapTestSuite{})
+
+func (s *LatencyMapTestSuite) TestHistogramSize(c *C) {
+	// Must match struct latency_hist in bpf/lib/latency.h
+	c.Assert(unsafe.Sizeof(Histogram{}), Equals, uintptr(8+Buckets*8))
+}
+
+func (s *LatencyMapTestSuite) TestPercentile(c *C) {
+	h := Histogram{}
+	c.Assert(h.Samples(), Equals, uint64(0))
+	c.Assert(h.Percentile(50), Equals, time.Duration(0))
+	c.Assert(h.Max(), Equals, time.Duration(0))
+
+	// 90 samples in [512ns, 1024ns), 9 in [4096ns, 8192ns), 1 above 2^31ns
+	h.Buckets[9] = 90
+	h.Buckets[12] = 9
+	h.Buckets[Buckets-1] = 1
+
+	c.Assert(h.Samples(), Equals, uint64(100))
+	c.Assert(h.Percentile(0), Equals, 1024*time.Nanosecond)
+	c.Assert(h.Percentile(50), Equals, 1024*time.Nanosecond)
+	c.Assert(h.Percentile(90), Equals, 8192*time.Nanosecond)
+	c.Assert(h.Percentile(99), Equals, time.Duration(1<<32))
+	c.Assert(h.Percentile(100), Equals, time.Duration(1<<32))
+	c.Assert(h.Max(), Equals, time.Duration(1<<32))
+}
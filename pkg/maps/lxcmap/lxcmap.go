@@ -22,6 +22,7 @@ import (
 	"github.com/cilium/cilium/pkg/bpf"
 	"github.com/cilium/cilium/pkg/logging"
 	"github.com/cilium/cilium/pkg/logging/logfields"
+	"github.com/cilium/cilium/pkg/option"
 )
 
 var log = logging.DefaultLogger.WithField(logfields.LogSubsys, "map-lxc")
@@ -161,20 +162,24 @@ func WriteEndpoint(f EndpointFrontend) error {
 	}
 
 	// FIXME: Revert on failure
-	for _, v := range f.GetBPFKeys() {
+	keys := f.GetBPFKeys()
+	for _, v := range keys {
 		if err := LXCMap.Update(v, info); err != nil {
 			return err
 		}
 	}
 
-	return nil
+	return writeTable(keys, info)
 }
 
 // AddHostEntry adds a special endpoint which represents the local host
 func AddHostEntry(ip net.IP) error {
 	key := NewEndpointKey(ip)
 	ep := &EndpointInfo{Flags: EndpointFlagHost}
-	return LXCMap.Update(key, ep)
+	if err := LXCMap.Update(key, ep); err != nil {
+		return err
+	}
+	return writeTable([]*EndpointKey{key}, ep)
 }
 
 // SyncHostEntry checks if a host entry exists in the lxcmap and adds one if needed.
@@ -193,7 +198,11 @@ func SyncHostEntry(ip net.IP) (bool, error) {
 
 // DeleteEntry deletes a single map entry
 func DeleteEntry(ip net.IP) error {
-	return LXCMap.Delete(NewEndpointKey(ip))
+	key := NewEndpointKey(ip)
+	if err := deleteTable(key); err != nil {
+		return err
+	}
+	return LXCMap.Delete(key)
 }
 
 // DeleteElement deletes the endpoint using all keys which represent the
@@ -201,6 +210,9 @@ func DeleteEntry(ip net.IP) error {
 func DeleteElement(f EndpointFrontend) []error {
 	var errors []error
 	for _, k := range f.GetBPFKeys() {
+		if err := deleteTable(k); err != nil {
+			errors = append(errors, fmt.Errorf("Unable to delete key %v from %s: %s", k, TableMapName, err))
+		}
 		if err := LXCMap.Delete(k); err != nil {
 			errors = append(errors, fmt.Errorf("Unable to delete key %v from %s: %s", k, bpf.MapPath(MapName), err))
 		}
@@ -209,6 +221,19 @@ func DeleteElement(f EndpointFrontend) []error {
 	return errors
 }
 
+// DeleteAll deletes all endpoints including their endpoint table mappings
+func DeleteAll() error {
+	if option.Config.EnableEndpointTable {
+		if err := EndpointID4Map.DeleteAll(); err != nil {
+			return err
+		}
+		if err := EndpointID6Map.DeleteAll(); err != nil {
+			return err
+		}
+	}
+	return LXCMap.DeleteAll()
+}
+
 // DumpToMap dumps the contents of the lxcmap into a map and returns it
 func DumpToMap() (map[string]*EndpointInfo, error) {
 	m := map[string]*EndpointInfo{}
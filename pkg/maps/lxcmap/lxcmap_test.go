@@ -0,0 +1,47 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package lxcmap
+
+import (
+	"net"
+	"testing"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type LXCMapTestSuite struct{}
+
+var _ = Suite(&LXCMapTestSuite{})
+
+func (s *LXCMapTestSuite) TestEndpointTableKeys(c *C) {
+	// Must match struct endpoint_info in bpf/lib/common.h, which keeps
+	// its layout so that cilium_lxc survives upgrades
+	c.Assert(unsafe.Sizeof(EndpointInfo{}), Equals, uintptr(48))
+
+	m, key := idKey(NewEndpointKey(net.ParseIP("10.0.0.1")))
+	c.Assert(m, Equals, EndpointID4Map)
+	c.Assert(key, DeepEquals, &ID4Key{IP: [4]byte{10, 0, 0, 1}})
+
+	m, key = idKey(NewEndpointKey(net.ParseIP("f00d::1")))
+	c.Assert(m, Equals, EndpointID6Map)
+	c.Assert(key.String(), Equals, "f00d::1")
+}
@@ -0,0 +1,193 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package lxcmap
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/common/types"
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/option"
+
+	"golang.org/x/sys/unix"
+)
+
+const (
+	// TableMapName is the name of the array holding the local endpoints
+	// indexed by endpoint ID.
+	TableMapName = "cilium_lxc_table"
+
+	// ID4MapName is the name of the map from local endpoint IPv4 address
+	// to endpoint ID.
+	ID4MapName = "cilium_lxc_id4"
+
+	// ID6MapName is the name of the map from local endpoint IPv6 address
+	// to endpoint ID.
+	ID6MapName = "cilium_lxc_id6"
+)
+
+// TableKey is the key of the endpoint table, and the value of the endpoint ID
+// maps.
+type TableKey struct {
+	LxcID uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *TableKey) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (k *TableKey) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *TableKey) NewValue() bpf.MapValue { return &EndpointInfo{} }
+
+func (k *TableKey) String() string { return fmt.Sprintf("%d", k.LxcID) }
+
+// ID4Key is the key of the IPv4 endpoint ID map.
+type ID4Key struct {
+	IP types.IPv4
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *ID4Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *ID4Key) NewValue() bpf.MapValue { return &TableKey{} }
+
+func (k *ID4Key) String() string { return k.IP.String() }
+
+// ID6Key is the key of the IPv6 endpoint ID map.
+type ID6Key struct {
+	IP types.IPv6
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *ID6Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *ID6Key) NewValue() bpf.MapValue { return &TableKey{} }
+
+func (k *ID6Key) String() string { return k.IP.String() }
+
+var (
+	// EndpointTable holds the local endpoints indexed by endpoint ID. The
+	// host is stored at index 0 which is never allocated to an endpoint.
+	EndpointTable = bpf.NewMap(TableMapName,
+		bpf.BPF_MAP_TYPE_ARRAY,
+		int(unsafe.Sizeof(TableKey{})),
+		int(unsafe.Sizeof(EndpointInfo{})),
+		MaxEntries,
+		0, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := TableKey{}, EndpointInfo{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+
+	// EndpointID4Map maps local endpoint IPv4 addresses to endpoint IDs
+	EndpointID4Map = bpf.NewMap(ID4MapName,
+		bpf.MapTypeHash,
+		int(unsafe.Sizeof(ID4Key{})),
+		int(unsafe.Sizeof(TableKey{})),
+		MaxEntries,
+		0, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := ID4Key{}, TableKey{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+
+	// EndpointID6Map maps local endpoint IPv6 addresses to endpoint IDs
+	EndpointID6Map = bpf.NewMap(ID6MapName,
+		bpf.MapTypeHash,
+		int(unsafe.Sizeof(ID6Key{})),
+		int(unsafe.Sizeof(TableKey{})),
+		MaxEntries,
+		0, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := ID6Key{}, TableKey{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+)
+
+// TableMaps returns the maps backing the endpoint table.
+func TableMaps() []*bpf.Map {
+	return []*bpf.Map{EndpointTable, EndpointID4Map, EndpointID6Map}
+}
+
+// idKey returns the endpoint ID map and its key for the endpoint key.
+func idKey(k *EndpointKey) (*bpf.Map, bpf.MapKey) {
+	if k.Family == bpf.EndpointKeyIPv4 {
+		key := &ID4Key{}
+		copy(key.IP[:], k.IP[:4])
+		return EndpointID4Map, key
+	}
+
+	key := &ID6Key{}
+	copy(key.IP[:], k.IP[:])
+	return EndpointID6Map, key
+}
+
+// writeTable inserts the endpoint into the endpoint table and maps each of
+// the keys to it. The table entry is written first so that the datapath never
+// resolves an address to a stale entry.
+func writeTable(keys []*EndpointKey, info *EndpointInfo) error {
+	if !option.Config.EnableEndpointTable {
+		return nil
+	}
+
+	id := &TableKey{LxcID: uint32(info.LxcID)}
+	if err := EndpointTable.Update(id, info); err != nil {
+		return err
+	}
+
+	for _, k := range keys {
+		m, key := idKey(k)
+		if err := m.Update(key, id); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// deleteTable removes the mapping of the key to its endpoint table entry, if
+// any. The table entry itself is left in place until the endpoint ID is
+// reused.
+func deleteTable(k *EndpointKey) error {
+	if !option.Config.EnableEndpointTable {
+		return nil
+	}
+
+	m, key := idKey(k)
+	if err, errno := m.DeleteWithErrno(key); err != nil && errno != unix.ENOENT {
+		return err
+	}
+	return nil
+}
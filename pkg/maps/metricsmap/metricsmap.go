@@ -16,11 +16,7 @@ package metricsmap
 
 import (
 	"fmt"
-	"io"
-	"io/ioutil"
-	"os"
 	"strconv"
-	"strings"
 	"unsafe"
 
 	"github.com/cilium/cilium/pkg/bpf"
@@ -42,16 +38,17 @@ var (
 const (
 	// MapName for metrics map.
 	MapName = "cilium_metrics"
-	// MaxEntries is the maximum number of keys that can be present in the
-	// Metrics Map.
-	MaxEntries = 65536
+	// EndpointMapPrefix is the prefix of the per endpoint drop metrics
+	// maps.
+	EndpointMapPrefix = "cilium_ep_metrics_"
+	// MaxEntries is the number of slots of the metrics maps, one for each
+	// combination of reason and direction.
+	MaxEntries = 1024
 	// dirIngress and dirEgress values should match with
 	// METRIC_INGRESS and METRIC_EGRESS in bpf/lib/common.h
 	dirIngress = 1
 	dirEgress  = 2
 	dirUnknown = 0
-
-	possibleCPUSysfsPath = "/sys/devices/system/cpu/possible"
 )
 
 // direction is the metrics direction i.e ingress (to an endpoint)
@@ -63,12 +60,26 @@ var direction = map[uint8]string{
 	2: "EGRESS",
 }
 
-// Key must be in sync with struct metrics_key in <bpf/lib/common.h>
+// Key is the index into the metrics maps, (dir << 8) | reason.
+//
+// Must be in sync with metrics_key() in <bpf/lib/metrics.h>
 type Key struct {
-	Reason uint8
-	Dir    uint8
-	Pad1   uint16
-	Pad2   uint32
+	Index uint32
+}
+
+// NewKey returns the key of the metrics of the given reason and direction.
+func NewKey(reason, dir uint8) Key {
+	return Key{Index: uint32(dir&0x3)<<8 | uint32(reason)}
+}
+
+// Reason returns the forward (0) or drop reason of the key.
+func (k *Key) Reason() uint8 {
+	return uint8(k.Index & 0xff)
+}
+
+// Dir returns the direction of the key.
+func (k *Key) Dir() uint8 {
+	return uint8((k.Index >> 8) & 0x3)
 }
 
 // Value must be in sync with struct metrics_value in <bpf/lib/common.h>
@@ -79,28 +90,31 @@ type Value struct {
 
 // String converts the key into a human readable string format
 func (k *Key) String() string {
-	return fmt.Sprintf("reason:%d dir:%d", k.Reason, k.Dir)
+	return fmt.Sprintf("reason:%d dir:%d", k.Reason(), k.Dir())
 }
 
 // Direction gets the direction in human readable string format
 func (k *Key) Direction() string {
-	switch k.Dir {
-	case dirIngress:
-		return direction[k.Dir]
-	case dirEgress:
-		return direction[k.Dir]
+	switch dir := k.Dir(); dir {
+	case dirIngress, dirEgress:
+		return direction[dir]
 	}
 	return direction[dirUnknown]
 }
 
 // DropForwardReason gets the forwarded/dropped reason in human readable string format
 func (k *Key) DropForwardReason() string {
-	return monitorAPI.DropReason(k.Reason)
+	return monitorAPI.DropReason(k.Reason())
 }
 
 // GetKeyPtr returns the unsafe pointer to the BPF key
 func (k *Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
 
+// IsZero returns true if no packet has been accounted in the value.
+func (v *Value) IsZero() bool {
+	return v.Count == 0 && v.Bytes == 0
+}
+
 // String converts the value into a human readable string format
 func (v *Value) String() string {
 	return fmt.Sprintf("count:%d bytes:%d", v.Count, v.Bytes)
@@ -118,7 +132,7 @@ func (v *Value) RequestBytes() string {
 
 // IsDrop checks if the reason is drop or not.
 func (k *Key) IsDrop() bool {
-	return k.Reason != 0
+	return k.Reason() != 0
 }
 
 // CountFloat converts the request count to float
@@ -172,94 +186,83 @@ func updatePrometheusMetrics(key *Key, val *Value) {
 	}, val.bytesFloat())
 }
 
-// SyncMetricsMap is called periodically to sync off the metrics map by
-// aggregating it into drops (by drop reason and direction) and
-// forwards (by direction) with the prometheus server.
-func SyncMetricsMap() error {
-	entry := make([]Value, possibleCpus)
-	file := bpf.MapPath(MapName)
-	metricsmap, err := bpf.OpenMap(file)
-
+// dumpMap returns the non-zero entries of the metrics map with the given
+// name. Values of per-CPU maps are summed over all CPUs.
+func dumpMap(name string, perCPU bool) (map[Key]Value, error) {
+	m, err := bpf.OpenMap(bpf.MapPath(name))
 	if err != nil {
-		return fmt.Errorf("unable to open metrics map: %s", err)
+		return nil, fmt.Errorf("unable to open metrics map %s: %s", name, err)
 	}
-	defer metricsmap.Close()
+	defer m.Close()
 
-	var key, nextKey Key
-	for {
-		err := bpf.GetNextKey(metricsmap.GetFd(), unsafe.Pointer(&key), unsafe.Pointer(&nextKey))
-		if err != nil {
-			break
-		}
-		err = bpf.LookupElement(metricsmap.GetFd(), unsafe.Pointer(&nextKey), unsafe.Pointer(&entry[0]))
+	numValues := 1
+	if perCPU {
+		numValues = possibleCpus
+	}
+	entry := make([]Value, numValues)
+	entries := map[Key]Value{}
+
+	for index := uint32(0); index < MaxEntries; index++ {
+		key := Key{Index: index}
+		err := bpf.LookupElement(m.GetFd(), unsafe.Pointer(&key), unsafe.Pointer(&entry[0]))
 		if err != nil {
-			return fmt.Errorf("unable to lookup metrics map: %s", err)
+			return nil, fmt.Errorf("unable to lookup metrics map %s: %s", name, err)
 		}
 
-		// cannot use `range entry` since, if the first value for a particular
-		// CPU is zero, it never iterates over the next non-zero value.
-		for i := 0; i < possibleCpus; i++ {
-			// Increment Prometheus metrics here.
-			updatePrometheusMetrics(&nextKey, &entry[i])
+		sum := Value{}
+		for i := range entry {
+			sum.Count += entry[i].Count
+			sum.Bytes += entry[i].Bytes
+		}
+		if !sum.IsZero() {
+			entries[key] = sum
 		}
-		key = nextKey
-
 	}
-	return nil
+
+	return entries, nil
 }
 
-// getNumPossibleCPUs returns a total number of possible CPUS, i.e. CPUs that
-// have been allocated resources and can be brought online if they are present.
-// The number is retrieved by parsing /sys/device/system/cpu/possible.
-//
-// See https://git.kernel.org/pub/scm/linux/kernel/git/torvalds/linux.git/tree/include/linux/cpumask.h?h=v4.19#n50
-// for more details.
-func getNumPossibleCPUs() int {
-	f, err := os.Open(possibleCPUSysfsPath)
-	if err != nil {
-		log.WithError(err).Errorf("unable to open %q", possibleCPUSysfsPath)
-	}
-	defer f.Close()
+// Dump returns the non-zero entries of the node wide metrics map, summed
+// over all CPUs.
+func Dump() (map[Key]Value, error) {
+	return dumpMap(MapName, true)
+}
 
-	return getNumPossibleCPUsFromReader(f)
+// EndpointMapName returns the name of the drop metrics map of the endpoint
+// with the given ID.
+func EndpointMapName(epID uint16) string {
+	return bpf.LocalMapName(EndpointMapPrefix, epID)
 }
 
-func getNumPossibleCPUsFromReader(r io.Reader) int {
-	out, err := ioutil.ReadAll(r)
+// DumpEndpoint returns the non-zero entries of the drop metrics map of the
+// endpoint with the given ID.
+func DumpEndpoint(epID uint16) (map[Key]Value, error) {
+	return dumpMap(EndpointMapName(epID), false)
+}
+
+// SyncMetricsMap is called periodically to sync off the metrics map by
+// aggregating it into drops (by drop reason and direction) and
+// forwards (by direction) with the prometheus server.
+func SyncMetricsMap() error {
+	entries, err := Dump()
 	if err != nil {
-		log.WithError(err).Errorf("unable to read %q to get CPU count", possibleCPUSysfsPath)
-		return 0
+		return err
 	}
 
-	var start, end int
-	count := 0
-	for _, s := range strings.Split(string(out), ",") {
-		// Go's scanf will return an error if a format cannot be fully matched.
-		// So, just ignore it, as a partial match (e.g. when there is only one
-		// CPU) is expected.
-		n, err := fmt.Sscanf(s, "%d-%d", &start, &end)
-
-		switch n {
-		case 0:
-			log.WithError(err).Errorf("failed to scan %q to retrieve number of possible CPUs!", s)
-			return 0
-		case 1:
-			count++
-		default:
-			count += (end - start + 1)
-		}
+	for key, value := range entries {
+		// Increment Prometheus metrics here.
+		updatePrometheusMetrics(&key, &value)
 	}
-
-	return count
+	return nil
 }
 
 func init() {
-	possibleCpus = getNumPossibleCPUs()
+	possibleCpus = bpf.GetNumPossibleCPUs()
 	// Metrics is a mapping of all packet drops and forwards associated with
 	// the node on ingress/egress direction
 	Metrics = bpf.NewMap(
 		MapName,
-		bpf.BPF_MAP_TYPE_PERCPU_HASH,
+		bpf.BPF_MAP_TYPE_PERCPU_ARRAY,
 		int(unsafe.Sizeof(Key{})),
 		int(unsafe.Sizeof(Value{})),
 		MaxEntries,
@@ -1,4 +1,4 @@
-// Copyright 2018 Authors of Cilium
+// Copyright 2019 Authors of Cilium
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
@@ -17,34 +17,33 @@
 package metricsmap
 
 import (
-	"strings"
 	"testing"
 
 	. "gopkg.in/check.v1"
 )
 
-type MetricsMapTestSuite struct{}
-
-var _ = Suite(&MetricsMapTestSuite{})
-
 func Test(t *testing.T) {
 	TestingT(t)
 }
 
-func (m *MetricsMapTestSuite) TestGetNumPossibleCPUsFromReader(c *C) {
-	tests := []struct {
-		in       string
-		expected int
-	}{
-		{"0", 1},
-		{"0-7", 8},
-		{"0,2-3", 3},
-		{"", 0},
-		{"foobar", 0},
-	}
-
-	for _, t := range tests {
-		c.Assert(getNumPossibleCPUsFromReader(strings.NewReader(t.in)), Equals, t.expected)
-	}
+type MetricsMapTestSuite struct{}
+
+var _ = Suite(&MetricsMapTestSuite{})
 
+func (s *MetricsMapTestSuite) TestKey(c *C) {
+	key := NewKey(132, dirEgress)
+	c.Assert(key.Index, Equals, uint32(2<<8|132))
+	c.Assert(key.Reason(), Equals, uint8(132))
+	c.Assert(key.Dir(), Equals, uint8(dirEgress))
+	c.Assert(key.IsDrop(), Equals, true)
+	c.Assert(key.Direction(), Equals, "EGRESS")
+	c.Assert(key.String(), Equals, "reason:132 dir:2")
+
+	key = NewKey(0, dirIngress)
+	c.Assert(key.IsDrop(), Equals, false)
+	c.Assert(key.Direction(), Equals, "INGRESS")
+
+	// All keys must fit into the map
+	key = NewKey(0xff, 0xff)
+	c.Assert(key.Index < MaxEntries, Equals, true)
 }
@@ -50,6 +50,10 @@ const (
 	// are allowed. In the datapath, this is represented with the value 0 in the
 	// port field of map elements.
 	AllPorts = uint16(0)
+
+	// PolicyEntryFlagDeny is set in PolicyEntry.Flags if matching traffic
+	// must be dropped. It corresponds to the deny bit of policy_entry.
+	PolicyEntryFlagDeny = uint8(1 << 0)
 )
 
 var log = logging.DefaultLogger.WithField(logfields.LogSubsys, "map-policy")
@@ -59,9 +63,17 @@ type PolicyMap struct {
 }
 
 func (pe *PolicyEntry) String() string {
+	if pe.IsDeny() {
+		return fmt.Sprintf("deny %d %d", pe.Packets, pe.Bytes)
+	}
 	return fmt.Sprintf("%d %d %d", pe.ProxyPort, pe.Packets, pe.Bytes)
 }
 
+// IsDeny returns true if the entry denies matching traffic.
+func (pe *PolicyEntry) IsDeny() bool {
+	return pe.Flags&PolicyEntryFlagDeny != 0
+}
+
 // PolicyKey represents a key in the BPF policy map for an endpoint. It must
 // match the layout of policy_key in bpf/lib/common.h.
 type PolicyKey struct {
@@ -75,7 +87,8 @@ type PolicyKey struct {
 // match the layout of policy_entry in bpf/lib/common.h.
 type PolicyEntry struct {
 	ProxyPort uint16 // In network byte-order
-	Pad0      uint16
+	Flags     uint8
+	Pad0      uint8
 	Pad1      uint16
 	Pad2      uint16
 	Packets   uint64
@@ -166,6 +179,23 @@ func newEntry(proxyPort uint16) PolicyEntry {
 	}
 }
 
+// DenyKey pushes a deny entry into the PolicyMap for the given PolicyKey k.
+// Returns an error if the update of the PolicyMap fails.
+func (pm *PolicyMap) DenyKey(k PolicyKey) error {
+	return pm.Deny(k.Identity, k.DestPort, u8proto.U8proto(k.Nexthdr), trafficdirection.TrafficDirection(k.TrafficDirection))
+}
+
+// Deny pushes an entry into the PolicyMap to deny traffic in the given
+// `trafficDirection` for identity `id` with destination port `dport` over
+// protocol `proto`. A deny entry takes precedence over any less specific
+// entry, see __policy_can_access() in the datapath. It is assumed that
+// `dport` is in host byte-order.
+func (pm *PolicyMap) Deny(id uint32, dport uint16, proto u8proto.U8proto, trafficDirection trafficdirection.TrafficDirection) error {
+	key := newKey(id, dport, proto, trafficDirection)
+	entry := PolicyEntry{Flags: PolicyEntryFlagDeny}
+	return pm.Update(&key, &entry)
+}
+
 // AllowKey pushes an entry into the PolicyMap for the given PolicyKey k.
 // Returns an error if the update of the PolicyMap fails.
 func (pm *PolicyMap) AllowKey(k PolicyKey, proxyPort uint16) error {
@@ -20,6 +20,7 @@ import (
 	"github.com/cilium/cilium/pkg/policy/trafficdirection"
 
 	"testing"
+	"unsafe"
 
 	. "gopkg.in/check.v1"
 )
@@ -145,3 +146,15 @@ func (pm *PolicyMapTestSuite) TestPolicyEntriesDump_Less(c *C) {
 		c.Assert(got, Equals, tt.want, Commentf("Test Name: %s", tt.name))
 	}
 }
+
+func (pm *PolicyMapTestSuite) TestPolicyEntryDeny(c *C) {
+	// Must match sizeof(struct policy_entry) in bpf/lib/common.h
+	c.Assert(unsafe.Sizeof(PolicyEntry{}), Equals, uintptr(24))
+
+	entry := PolicyEntry{ProxyPort: 80}
+	c.Assert(entry.IsDeny(), Equals, false)
+
+	entry = PolicyEntry{Flags: PolicyEntryFlagDeny}
+	c.Assert(entry.IsDeny(), Equals, true)
+	c.Assert(entry.String(), Equals, "deny 0 0")
+}
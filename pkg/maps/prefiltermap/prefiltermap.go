@@ -0,0 +1,212 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package prefiltermap
+
+import (
+	"fmt"
+	"net"
+	"unsafe"
+
+	"github.com/cilium/cilium/common/types"
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
+	"github.com/cilium/cilium/pkg/u8proto"
+)
+
+const (
+	// Dst4MapName is the name of the IPv4 destination rule map
+	Dst4MapName = "cilium_prefilter_dst4"
+
+	// Dst6MapName is the name of the IPv6 destination rule map
+	Dst6MapName = "cilium_prefilter_dst6"
+
+	// EndpointPortsMapName is the name of the map holding the allowed
+	// ports per local endpoint
+	EndpointPortsMapName = "cilium_prefilter_ep_ports"
+
+	// RuleStatsMapName is the name of the per-CPU map holding the drop
+	// counters per rule ID
+	RuleStatsMapName = "cilium_prefilter_rule_stats"
+
+	// MaxEntries is the maximum number of entries in the destination rule
+	// maps and in the endpoint ports map
+	MaxEntries = 16384
+
+	// MaxRules is the number of drop counters, rule IDs must be lower
+	MaxRules = 1024
+
+	// l4KeyPrefixLen is the number of bits in the destination rule keys
+	// preceding the address, see struct lpm_v4_l4_key in <bpf/lib/xdp.h>
+	l4KeyPrefixLen = 32
+)
+
+// Dst4Key is the key of the IPv4 destination rule map.
+//
+// Must be in sync with struct lpm_v4_l4_key in <bpf/lib/xdp.h>
+type Dst4Key struct {
+	Prefixlen uint32
+	Nexthdr   uint8
+	Pad       uint8
+	DPort     uint16 // network byte order
+	IP        types.IPv4
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Dst4Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Dst4Key) NewValue() bpf.MapValue { return &Rule{} }
+
+// CIDR returns the destination prefix of the key
+func (k *Dst4Key) CIDR() *net.IPNet {
+	return &net.IPNet{
+		IP:   k.IP.IP(),
+		Mask: net.CIDRMask(int(k.Prefixlen)-l4KeyPrefixLen, net.IPv4len*8),
+	}
+}
+
+func (k *Dst4Key) String() string {
+	return fmt.Sprintf("%s %s", k.CIDR(), portString(k.Nexthdr, k.DPort))
+}
+
+// Dst6Key is the key of the IPv6 destination rule map.
+//
+// Must be in sync with struct lpm_v6_l4_key in <bpf/lib/xdp.h>
+type Dst6Key struct {
+	Prefixlen uint32
+	Nexthdr   uint8
+	Pad       uint8
+	DPort     uint16 // network byte order
+	IP        types.IPv6
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Dst6Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Dst6Key) NewValue() bpf.MapValue { return &Rule{} }
+
+// CIDR returns the destination prefix of the key
+func (k *Dst6Key) CIDR() *net.IPNet {
+	return &net.IPNet{
+		IP:   k.IP.IP(),
+		Mask: net.CIDRMask(int(k.Prefixlen)-l4KeyPrefixLen, net.IPv6len*8),
+	}
+}
+
+func (k *Dst6Key) String() string {
+	return fmt.Sprintf("%s %s", k.CIDR(), portString(k.Nexthdr, k.DPort))
+}
+
+// EndpointPortKey is the key of the endpoint ports map. The key with port and
+// protocol 0 restricts the endpoint to the ports listed with its ID.
+//
+// Must be in sync with struct xdp_ep_port_key in <bpf/lib/xdp.h>
+type EndpointPortKey struct {
+	LxcID   uint16
+	DPort   uint16 // network byte order
+	Nexthdr uint8
+	Pad     [3]uint8
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *EndpointPortKey) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *EndpointPortKey) NewValue() bpf.MapValue { return &Rule{} }
+
+func (k *EndpointPortKey) String() string {
+	return fmt.Sprintf("%d %s", k.LxcID, portString(k.Nexthdr, k.DPort))
+}
+
+// Rule is the value of the rule maps, it selects the drop counter.
+//
+// Must be in sync with struct xdp_rule in <bpf/lib/xdp.h>
+type Rule struct {
+	RuleID uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (r *Rule) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(r) }
+
+func (r *Rule) String() string { return fmt.Sprintf("%d", r.RuleID) }
+
+// RuleStats is the per-CPU value of the rule statistics map.
+//
+// Must be in sync with struct xdp_stats in <bpf/lib/xdp.h>
+type RuleStats struct {
+	Packets uint64 `json:"packets"`
+	Bytes   uint64 `json:"bytes"`
+}
+
+// Port is a destination port and protocol matched by a rule. A port of 0
+// matches all ports of the protocol.
+type Port struct {
+	Port     uint16
+	Protocol u8proto.U8proto
+}
+
+func (p Port) String() string {
+	return fmt.Sprintf("%d/%s", p.Port, p.Protocol)
+}
+
+func portString(nexthdr uint8, dport uint16) string {
+	return Port{
+		Port:     byteorder.NetworkToHost(dport).(uint16),
+		Protocol: u8proto.U8proto(nexthdr),
+	}.String()
+}
+
+func newRuleMap(name string, mapType bpf.MapType, keySize uintptr, parse func() (bpf.MapKey, bpf.MapValue)) *bpf.Map {
+	return bpf.NewMap(name,
+		mapType,
+		int(keySize),
+		int(unsafe.Sizeof(Rule{})),
+		MaxEntries,
+		bpf.BPF_F_NO_PREALLOC, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := parse()
+
+			if err := bpf.ConvertKeyValue(key, value, k, v); err != nil {
+				return nil, nil, err
+			}
+			return k, v, nil
+		})
+}
+
+var (
+	// Dst4Map holds the IPv4 destination prefix rules
+	Dst4Map = newRuleMap(Dst4MapName, bpf.MapTypeLPMTrie, unsafe.Sizeof(Dst4Key{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &Dst4Key{}, &Rule{} })
+
+	// Dst6Map holds the IPv6 destination prefix rules
+	Dst6Map = newRuleMap(Dst6MapName, bpf.MapTypeLPMTrie, unsafe.Sizeof(Dst6Key{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &Dst6Key{}, &Rule{} })
+
+	// EndpointPortsMap holds the allowed ports per local endpoint
+	EndpointPortsMap = newRuleMap(EndpointPortsMapName, bpf.MapTypeHash, unsafe.Sizeof(EndpointPortKey{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &EndpointPortKey{}, &Rule{} })
+
+	// RuleStatsMap holds the drop counters indexed by rule ID
+	RuleStatsMap = bpf.NewMap(RuleStatsMapName,
+		bpf.BPF_MAP_TYPE_PERCPU_ARRAY,
+		int(unsafe.Sizeof(Rule{})),
+		int(unsafe.Sizeof(RuleStats{})),
+		MaxRules,
+		0, 0, nil)
+)
@@ -0,0 +1,99 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package prefiltermap
+
+import (
+	"net"
+	"testing"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type PrefilterMapTestSuite struct{}
+
+var _ = Suite(&PrefilterMapTestSuite{})
+
+func (s *PrefilterMapTestSuite) TestKeySizes(c *C) {
+	// Must match the structs in bpf/lib/xdp.h
+	c.Assert(unsafe.Sizeof(Dst4Key{}), Equals, uintptr(12))
+	c.Assert(unsafe.Sizeof(Dst6Key{}), Equals, uintptr(24))
+	c.Assert(unsafe.Sizeof(EndpointPortKey{}), Equals, uintptr(8))
+}
+
+func (s *PrefilterMapTestSuite) TestNewDstKey(c *C) {
+	_, cidr, err := net.ParseCIDR("10.1.0.0/16")
+	c.Assert(err, IsNil)
+
+	m, key, err := NewDstKey(cidr, Port{Port: 80, Protocol: u8proto.TCP})
+	c.Assert(err, IsNil)
+	c.Assert(m, Equals, Dst4Map)
+	k := key.(*Dst4Key)
+	c.Assert(k.Prefixlen, Equals, uint32(48))
+	c.Assert(k.IP.String(), Equals, "10.1.0.0")
+	c.Assert(k.String(), Equals, "10.1.0.0/16 80/TCP")
+
+	_, cidr, err = net.ParseCIDR("f00d::/64")
+	c.Assert(err, IsNil)
+
+	m, key, err = NewDstKey(cidr, Port{Protocol: u8proto.UDP})
+	c.Assert(err, IsNil)
+	c.Assert(m, Equals, Dst6Map)
+	c.Assert(key.(*Dst6Key).Prefixlen, Equals, uint32(96))
+	c.Assert(key.String(), Equals, "f00d::/64 0/UDP")
+}
+
+func (s *PrefilterMapTestSuite) TestNewRateClass(c *C) {
+	// Must match the structs in bpf/lib/xdp.h
+	c.Assert(unsafe.Sizeof(Src4Key{}), Equals, uintptr(8))
+	c.Assert(unsafe.Sizeof(Src6Key{}), Equals, uintptr(20))
+	c.Assert(unsafe.Sizeof(RateClass{}), Equals, uintptr(24))
+
+	class, err := NewRateClass(1000, 50, false)
+	c.Assert(err, IsNil)
+	c.Assert(class.IntervalNs, Equals, uint64(1000000))
+	c.Assert(class.BurstNs, Equals, uint64(50000000))
+	c.Assert(class.Rate(), Equals, uint64(1000))
+	c.Assert(class.Burst(), Equals, uint64(50))
+	c.Assert(class.Flags, Equals, uint32(0))
+
+	class, err = NewRateClass(10, 1, true)
+	c.Assert(err, IsNil)
+	c.Assert(class.Flags, Equals, uint32(RateClassAggregate))
+
+	_, err = NewRateClass(0, 1, false)
+	c.Assert(err, Not(IsNil))
+	_, err = NewRateClass(10, 0, false)
+	c.Assert(err, Not(IsNil))
+	_, err = NewRateClass(1, ^uint64(0), false)
+	c.Assert(err, Not(IsNil))
+	c.Assert((&RateClass{}).Enabled(), Equals, false)
+}
+
+func (s *PrefilterMapTestSuite) TestReasons(c *C) {
+	// Must match PREFILTER_* in bpf/lib/xdp.h
+	c.Assert(len(reasons), Equals, 12)
+	c.Assert(reasons[firstTXReason], Equals, "syncookie")
+	c.Assert(reasons[firstDropReason], Equals, "invalid")
+	c.Assert(unsafe.Sizeof(SyncookieSecret{}), Equals, uintptr(8))
+}
@@ -0,0 +1,401 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package prefiltermap
+
+import (
+	"fmt"
+	"net"
+	"sort"
+	"time"
+	"unsafe"
+
+	"github.com/cilium/cilium/common/types"
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+const (
+	// Rate4MapName is the name of the IPv4 source prefix rate limit map
+	Rate4MapName = "cilium_prefilter_rate4"
+
+	// Rate6MapName is the name of the IPv6 source prefix rate limit map
+	Rate6MapName = "cilium_prefilter_rate6"
+
+	// RateClassMapName is the name of the map holding the token bucket
+	// parameters per rate class
+	RateClassMapName = "cilium_prefilter_rate_class"
+
+	// RateStatsMapName is the name of the per-CPU map holding the passed
+	// and dropped packet counters per rate class
+	RateStatsMapName = "cilium_prefilter_rate_stats"
+
+	// RateBucketsMapName is the name of the LRU map holding the token
+	// bucket state per source. It is created and only accessed by the
+	// datapath.
+	RateBucketsMapName = "cilium_prefilter_rate_buckets"
+
+	// RateBucketsMaxEntries is the number of sources tracked at once, the
+	// least recently seen sources start over with a full bucket.
+	RateBucketsMaxEntries = 65536
+
+	// MaxRateClasses is the number of rate classes, class IDs must be lower
+	MaxRateClasses = 256
+
+	// RateClassAggregate makes all sources of a rate class share a single
+	// token bucket.
+	RateClassAggregate = 1
+)
+
+// Src4Key is the key of the IPv4 source prefix rate limit map.
+//
+// Must be in sync with struct lpm_v4_key in <bpf/lib/xdp.h>
+type Src4Key struct {
+	Prefixlen uint32
+	IP        types.IPv4
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Src4Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Src4Key) NewValue() bpf.MapValue { return &RateRule{} }
+
+func (k *Src4Key) String() string {
+	return fmt.Sprintf("%s/%d", k.IP, k.Prefixlen)
+}
+
+// Src6Key is the key of the IPv6 source prefix rate limit map.
+//
+// Must be in sync with struct lpm_v6_key in <bpf/lib/xdp.h>
+type Src6Key struct {
+	Prefixlen uint32
+	IP        types.IPv6
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Src6Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Src6Key) NewValue() bpf.MapValue { return &RateRule{} }
+
+func (k *Src6Key) String() string {
+	return fmt.Sprintf("%s/%d", k.IP, k.Prefixlen)
+}
+
+// RateRule is the value of the source prefix rate limit maps.
+//
+// Must be in sync with struct xdp_rate_rule in <bpf/lib/xdp.h>
+type RateRule struct {
+	ClassID uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (r *RateRule) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(r) }
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (r *RateRule) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(r) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (r *RateRule) NewValue() bpf.MapValue { return &RateClass{} }
+
+func (r *RateRule) String() string { return fmt.Sprintf("%d", r.ClassID) }
+
+// RateClass holds the token bucket parameters of a rate class in time: every
+// packet costs Interval and the bucket holds up to Burst worth of packets.
+//
+// Must be in sync with struct xdp_rate_class in <bpf/lib/xdp.h>
+type RateClass struct {
+	IntervalNs uint64
+	BurstNs    uint64
+	Flags      uint32
+	Pad        uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (c *RateClass) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(c) }
+
+func (c *RateClass) String() string {
+	return fmt.Sprintf("%d/s burst %d", c.Rate(), c.Burst())
+}
+
+// NewRateClass returns the token bucket parameters for a rate in packets per
+// second and a burst in packets.
+func NewRateClass(rate, burst uint64, aggregate bool) (*RateClass, error) {
+	if rate == 0 || rate > uint64(time.Second) {
+		return nil, fmt.Errorf("rate must be between 1 and %d packets per second", uint64(time.Second))
+	}
+	if burst == 0 {
+		return nil, fmt.Errorf("burst must be at least one packet")
+	}
+
+	interval := uint64(time.Second) / rate
+	if burst > ^uint64(0)/interval {
+		return nil, fmt.Errorf("burst %d too large for rate %d", burst, rate)
+	}
+
+	c := &RateClass{
+		IntervalNs: interval,
+		BurstNs:    interval * burst,
+	}
+	if aggregate {
+		c.Flags |= RateClassAggregate
+	}
+	return c, nil
+}
+
+// Enabled returns true if the rate class limits packets.
+func (c *RateClass) Enabled() bool { return c.IntervalNs != 0 }
+
+// Rate returns the rate in packets per second.
+func (c *RateClass) Rate() uint64 {
+	if c.IntervalNs == 0 {
+		return 0
+	}
+	return uint64(time.Second) / c.IntervalNs
+}
+
+// Burst returns the burst in packets.
+func (c *RateClass) Burst() uint64 {
+	if c.IntervalNs == 0 {
+		return 0
+	}
+	return c.BurstNs / c.IntervalNs
+}
+
+// RateStats is the per-CPU value of the rate class statistics map.
+//
+// Must be in sync with struct xdp_rate_stats in <bpf/lib/xdp.h>
+type RateStats struct {
+	Passed  uint64 `json:"passed"`
+	Dropped uint64 `json:"dropped"`
+}
+
+func newRateMap(name string, keySize uintptr, parse func() (bpf.MapKey, bpf.MapValue)) *bpf.Map {
+	return bpf.NewMap(name,
+		bpf.MapTypeLPMTrie,
+		int(keySize),
+		int(unsafe.Sizeof(RateRule{})),
+		MaxEntries,
+		bpf.BPF_F_NO_PREALLOC, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := parse()
+
+			if err := bpf.ConvertKeyValue(key, value, k, v); err != nil {
+				return nil, nil, err
+			}
+			return k, v, nil
+		})
+}
+
+var (
+	// Rate4Map maps IPv4 source prefixes to rate classes
+	Rate4Map = newRateMap(Rate4MapName, unsafe.Sizeof(Src4Key{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &Src4Key{}, &RateRule{} })
+
+	// Rate6Map maps IPv6 source prefixes to rate classes
+	Rate6Map = newRateMap(Rate6MapName, unsafe.Sizeof(Src6Key{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &Src6Key{}, &RateRule{} })
+
+	// RateClassMap holds the token bucket parameters indexed by class ID
+	RateClassMap = bpf.NewMap(RateClassMapName,
+		bpf.BPF_MAP_TYPE_ARRAY,
+		int(unsafe.Sizeof(RateRule{})),
+		int(unsafe.Sizeof(RateClass{})),
+		MaxRateClasses,
+		0, 0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k, v := RateRule{}, RateClass{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+			return &k, &v, nil
+		})
+
+	// RateStatsMap holds the passed and dropped counters indexed by class ID
+	RateStatsMap = bpf.NewMap(RateStatsMapName,
+		bpf.BPF_MAP_TYPE_PERCPU_ARRAY,
+		int(unsafe.Sizeof(RateRule{})),
+		int(unsafe.Sizeof(RateStats{})),
+		MaxRateClasses,
+		0, 0, nil)
+)
+
+// RateMaps returns all maps of the rate limiter managed by the agent.
+func RateMaps() []*bpf.Map {
+	return []*bpf.Map{Rate4Map, Rate6Map, RateClassMap, RateStatsMap}
+}
+
+func checkClassID(classID uint32) error {
+	if classID >= MaxRateClasses {
+		return fmt.Errorf("class ID %d exceeds the maximum of %d", classID, MaxRateClasses-1)
+	}
+	return nil
+}
+
+// SetRateClass configures the rate class. Sources of the class already
+// tracked by the datapath keep their bucket level.
+func SetRateClass(classID uint32, class *RateClass) error {
+	if err := checkClassID(classID); err != nil {
+		return err
+	}
+	return RateClassMap.Update(&RateRule{ClassID: classID}, class)
+}
+
+// DisableRateClass stops rate limiting sources of the class, their prefixes
+// remain assigned to the class.
+func DisableRateClass(classID uint32) error {
+	return SetRateClass(classID, &RateClass{})
+}
+
+// NewSrcKey returns the rate limit map for the address family of the prefix
+// together with the key matching the prefix.
+func NewSrcKey(cidr *net.IPNet) (*bpf.Map, bpf.MapKey, error) {
+	ones, bits := cidr.Mask.Size()
+	ip := cidr.IP.Mask(cidr.Mask)
+
+	switch bits {
+	case net.IPv4len * 8:
+		key := &Src4Key{Prefixlen: uint32(ones)}
+		copy(key.IP[:], ip.To4())
+		return Rate4Map, key, nil
+	case net.IPv6len * 8:
+		key := &Src6Key{Prefixlen: uint32(ones)}
+		copy(key.IP[:], ip.To16())
+		return Rate6Map, key, nil
+	}
+
+	return nil, nil, fmt.Errorf("invalid prefix %s", cidr)
+}
+
+// AddRateRule rate limits packets from the source prefix according to the
+// rate class.
+func AddRateRule(classID uint32, cidr *net.IPNet) error {
+	if err := checkClassID(classID); err != nil {
+		return err
+	}
+
+	m, key, err := NewSrcKey(cidr)
+	if err != nil {
+		return err
+	}
+
+	return m.Update(key, &RateRule{ClassID: classID})
+}
+
+// DeleteRateRule removes the rate limit of the source prefix.
+func DeleteRateRule(cidr *net.IPNet) error {
+	m, key, err := NewSrcKey(cidr)
+	if err != nil {
+		return err
+	}
+
+	return m.Delete(key)
+}
+
+// RateClassEntry is a rate class together with its source prefixes and
+// counters.
+type RateClassEntry struct {
+	ClassID   uint32   `json:"class-id"`
+	Rate      uint64   `json:"rate"`
+	Burst     uint64   `json:"burst"`
+	Aggregate bool     `json:"aggregate"`
+	Prefixes  []string `json:"prefixes"`
+	RateStats
+}
+
+// lookupRateStats returns the counters of the rate class summed over all CPUs.
+func lookupRateStats(classID uint32) (RateStats, error) {
+	stats := RateStats{}
+
+	if err := RateStatsMap.Open(); err != nil {
+		return stats, err
+	}
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return stats, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	key := RateRule{ClassID: classID}
+	values := make([]RateStats, possibleCPUs)
+	if err := bpf.LookupElement(RateStatsMap.GetFd(), key.GetKeyPtr(), unsafe.Pointer(&values[0])); err != nil {
+		return stats, err
+	}
+
+	for i := range values {
+		stats.Passed += values[i].Passed
+		stats.Dropped += values[i].Dropped
+	}
+
+	return stats, nil
+}
+
+// DumpRateClasses returns all rate classes which are enabled or have source
+// prefixes assigned, sorted by class ID.
+func DumpRateClasses() ([]*RateClassEntry, error) {
+	classes := map[uint32]*RateClassEntry{}
+	getClass := func(classID uint32) *RateClassEntry {
+		entry, ok := classes[classID]
+		if !ok {
+			entry = &RateClassEntry{ClassID: classID, Prefixes: []string{}}
+			classes[classID] = entry
+		}
+		return entry
+	}
+
+	params := func(key bpf.MapKey, value bpf.MapValue) {
+		c := value.(*RateClass)
+		if !c.Enabled() {
+			return
+		}
+		entry := getClass(key.(*RateRule).ClassID)
+		entry.Rate = c.Rate()
+		entry.Burst = c.Burst()
+		entry.Aggregate = c.Flags&RateClassAggregate != 0
+	}
+	if err := dumpIfExists(RateClassMap, params); err != nil {
+		return nil, err
+	}
+
+	prefixes := func(key bpf.MapKey, value bpf.MapValue) {
+		entry := getClass(value.(*RateRule).ClassID)
+		entry.Prefixes = append(entry.Prefixes, key.String())
+	}
+	for _, m := range []*bpf.Map{Rate4Map, Rate6Map} {
+		if err := dumpIfExists(m, prefixes); err != nil {
+			return nil, err
+		}
+	}
+
+	entries := make([]*RateClassEntry, 0, len(classes))
+	for _, entry := range classes {
+		stats, err := lookupRateStats(entry.ClassID)
+		if err != nil {
+			return nil, fmt.Errorf("unable to lookup counters of class %d: %s", entry.ClassID, err)
+		}
+		entry.RateStats = stats
+		sort.Strings(entry.Prefixes)
+		entries = append(entries, entry)
+	}
+
+	sort.Slice(entries, func(i, j int) bool {
+		return entries[i].ClassID < entries[j].ClassID
+	})
+
+	return entries, nil
+}
@@ -0,0 +1,315 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package prefiltermap
+
+import (
+	"fmt"
+	"net"
+	"os"
+	"sort"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
+)
+
+// RuleEntry is a prefilter rule together with its drop counters.
+type RuleEntry struct {
+	RuleID uint32   `json:"rule-id"`
+	Action string   `json:"action"`
+	Target string   `json:"target"`
+	Ports  []string `json:"ports"`
+	RuleStats
+}
+
+// Rule actions of RuleEntry
+const (
+	// ActionDeny drops packets to the destination prefix and ports
+	ActionDeny = "deny"
+
+	// ActionAllow drops packets to the local endpoint unless they are
+	// destined to one of the ports
+	ActionAllow = "allow"
+
+	// ActionSyncookie challenges connection attempts to the ports of the
+	// local endpoint with SYN cookies
+	ActionSyncookie = "syncookie"
+)
+
+func checkRuleID(ruleID uint32) error {
+	if ruleID >= MaxRules {
+		return fmt.Errorf("rule ID %d exceeds the maximum of %d", ruleID, MaxRules-1)
+	}
+	return nil
+}
+
+// NewDstKey returns the destination rule map for the address family of the
+// prefix together with the key matching the prefix and port.
+func NewDstKey(cidr *net.IPNet, port Port) (*bpf.Map, bpf.MapKey, error) {
+	ones, bits := cidr.Mask.Size()
+	ip := cidr.IP.Mask(cidr.Mask)
+	dport := byteorder.HostToNetwork(port.Port).(uint16)
+
+	switch bits {
+	case net.IPv4len * 8:
+		key := &Dst4Key{
+			Prefixlen: uint32(l4KeyPrefixLen + ones),
+			Nexthdr:   uint8(port.Protocol),
+			DPort:     dport,
+		}
+		copy(key.IP[:], ip.To4())
+		return Dst4Map, key, nil
+	case net.IPv6len * 8:
+		key := &Dst6Key{
+			Prefixlen: uint32(l4KeyPrefixLen + ones),
+			Nexthdr:   uint8(port.Protocol),
+			DPort:     dport,
+		}
+		copy(key.IP[:], ip.To16())
+		return Dst6Map, key, nil
+	}
+
+	return nil, nil, fmt.Errorf("invalid prefix %s", cidr)
+}
+
+// AddDenyRule drops all packets destined to the prefix and port, accounting
+// them to the rule ID.
+func AddDenyRule(ruleID uint32, cidr *net.IPNet, port Port) error {
+	if err := checkRuleID(ruleID); err != nil {
+		return err
+	}
+
+	m, key, err := NewDstKey(cidr, port)
+	if err != nil {
+		return err
+	}
+
+	return m.Update(key, &Rule{RuleID: ruleID})
+}
+
+// DeleteDenyRule removes the rule for the prefix and port.
+func DeleteDenyRule(cidr *net.IPNet, port Port) error {
+	m, key, err := NewDstKey(cidr, port)
+	if err != nil {
+		return err
+	}
+
+	return m.Delete(key)
+}
+
+func newEndpointPortKey(epID uint16, port Port) *EndpointPortKey {
+	return &EndpointPortKey{
+		LxcID:   epID,
+		DPort:   byteorder.HostToNetwork(port.Port).(uint16),
+		Nexthdr: uint8(port.Protocol),
+	}
+}
+
+// endpointPortKeys returns all keys of the endpoint port map m for the
+// endpoint, including the key restricting the endpoint.
+func endpointPortKeys(m *bpf.Map, epID uint16) ([]*EndpointPortKey, error) {
+	keys := []*EndpointPortKey{}
+	cb := func(key bpf.MapKey, _ bpf.MapValue) {
+		if k := key.(*EndpointPortKey); k.LxcID == epID {
+			keys = append(keys, k)
+		}
+	}
+
+	if err := m.DumpWithCallback(cb); err != nil {
+		return nil, err
+	}
+	return keys, nil
+}
+
+// SetEndpointPorts restricts the local endpoint to the ports, replacing any
+// previously allowed ports. Dropped packets are accounted to the rule ID.
+func SetEndpointPorts(ruleID uint32, epID uint16, ports []Port) error {
+	if err := checkRuleID(ruleID); err != nil {
+		return err
+	}
+
+	existing, err := endpointPortKeys(EndpointPortsMap, epID)
+	if err != nil {
+		return err
+	}
+
+	// Allow the new ports before restricting the endpoint, and only
+	// then remove the ports no longer allowed.
+	rule := &Rule{RuleID: ruleID}
+	allowed := map[EndpointPortKey]struct{}{}
+	for _, p := range ports {
+		if p.Port == 0 || p.Protocol == 0 {
+			return fmt.Errorf("invalid port %s", p)
+		}
+
+		key := newEndpointPortKey(epID, p)
+		if err := EndpointPortsMap.Update(key, rule); err != nil {
+			return err
+		}
+		allowed[*key] = struct{}{}
+	}
+
+	restrict := newEndpointPortKey(epID, Port{})
+	if err := EndpointPortsMap.Update(restrict, rule); err != nil {
+		return err
+	}
+	allowed[*restrict] = struct{}{}
+
+	for _, key := range existing {
+		if _, ok := allowed[*key]; !ok {
+			if err := EndpointPortsMap.Delete(key); err != nil {
+				return err
+			}
+		}
+	}
+
+	return nil
+}
+
+// ClearEndpointPorts lifts the port restriction of the local endpoint.
+func ClearEndpointPorts(epID uint16) error {
+	keys, err := endpointPortKeys(EndpointPortsMap, epID)
+	if err != nil {
+		return err
+	}
+
+	// Lift the restriction before removing the allowed ports
+	sort.Slice(keys, func(i, j int) bool { return keys[i].DPort < keys[j].DPort })
+	for _, key := range keys {
+		if err := EndpointPortsMap.Delete(key); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// lookupRuleStats returns the drop counters of the rule summed over all CPUs.
+func lookupRuleStats(ruleID uint32) (RuleStats, error) {
+	stats := RuleStats{}
+
+	if err := RuleStatsMap.Open(); err != nil {
+		return stats, err
+	}
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return stats, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	key := Rule{RuleID: ruleID}
+	values := make([]RuleStats, possibleCPUs)
+	if err := bpf.LookupElement(RuleStatsMap.GetFd(), key.GetValuePtr(), unsafe.Pointer(&values[0])); err != nil {
+		return stats, err
+	}
+
+	for i := range values {
+		stats.Packets += values[i].Packets
+		stats.Bytes += values[i].Bytes
+	}
+
+	return stats, nil
+}
+
+func dumpIfExists(m *bpf.Map, cb bpf.DumpCallback) error {
+	path, err := m.Path()
+	if err != nil {
+		return err
+	}
+
+	if _, err := os.Stat(path); err != nil {
+		return nil
+	}
+
+	return m.DumpWithCallback(cb)
+}
+
+// DumpRules returns all prefilter rules with their drop counters. Rules sharing
+// a rule ID report the same counters.
+func DumpRules() ([]*RuleEntry, error) {
+	entries := []*RuleEntry{}
+
+	deny := func(key bpf.MapKey, value bpf.MapValue) {
+		var target string
+		var port string
+
+		switch k := key.(type) {
+		case *Dst4Key:
+			target, port = k.CIDR().String(), portString(k.Nexthdr, k.DPort)
+		case *Dst6Key:
+			target, port = k.CIDR().String(), portString(k.Nexthdr, k.DPort)
+		}
+
+		entries = append(entries, &RuleEntry{
+			RuleID: value.(*Rule).RuleID,
+			Action: ActionDeny,
+			Target: target,
+			Ports:  []string{port},
+		})
+	}
+	for _, m := range []*bpf.Map{Dst4Map, Dst6Map} {
+		if err := dumpIfExists(m, deny); err != nil {
+			return nil, err
+		}
+	}
+
+	for _, m := range []*bpf.Map{EndpointPortsMap, SyncookiePortsMap} {
+		action := ActionAllow
+		if m == SyncookiePortsMap {
+			action = ActionSyncookie
+		}
+
+		endpoints := map[uint16]*RuleEntry{}
+		perEndpoint := func(key bpf.MapKey, value bpf.MapValue) {
+			k := key.(*EndpointPortKey)
+			entry, ok := endpoints[k.LxcID]
+			if !ok {
+				entry = &RuleEntry{
+					Action: action,
+					Target: fmt.Sprintf("endpoint %d", k.LxcID),
+					Ports:  []string{},
+				}
+				endpoints[k.LxcID] = entry
+			}
+
+			// All keys of an endpoint share the rule ID
+			entry.RuleID = value.(*Rule).RuleID
+			if k.DPort != 0 || k.Nexthdr != 0 {
+				entry.Ports = append(entry.Ports, portString(k.Nexthdr, k.DPort))
+			}
+		}
+		if err := dumpIfExists(m, perEndpoint); err != nil {
+			return nil, err
+		}
+		for _, entry := range endpoints {
+			sort.Strings(entry.Ports)
+			entries = append(entries, entry)
+		}
+	}
+
+	for _, entry := range entries {
+		stats, err := lookupRuleStats(entry.RuleID)
+		if err != nil {
+			return nil, fmt.Errorf("unable to lookup counters of rule %d: %s", entry.RuleID, err)
+		}
+		entry.RuleStats = stats
+	}
+
+	sort.SliceStable(entries, func(i, j int) bool {
+		return entries[i].RuleID < entries[j].RuleID
+	})
+
+	return entries, nil
+}
@@ -0,0 +1,112 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package prefiltermap
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+const (
+	// StatsMapName is the name of the per-CPU map holding the packet and
+	// byte counters per verdict reason of the prefilter
+	StatsMapName = "cilium_prefilter_stats"
+)
+
+// Verdicts of the prefilter
+const (
+	VerdictPass = "pass"
+	VerdictTX   = "tx"
+	VerdictDrop = "drop"
+)
+
+// reasons holds the verdict reasons indexed by their value in the datapath.
+//
+// Must be in sync with PREFILTER_* in <bpf/lib/xdp.h>
+var reasons = []string{
+	"endpoint",
+	"non-ip",
+	"syncookie",
+	"invalid",
+	"cidr",
+	"cidr-lpm",
+	"destination-rule",
+	"endpoint-port",
+	"no-endpoint",
+	"rate-limit",
+	"syncookie-data",
+	"syncookie-validated",
+}
+
+const (
+	// firstTXReason is the first reason transmitting the packet back
+	firstTXReason = 2
+
+	// firstDropReason is the first reason dropping the packet
+	firstDropReason = 3
+)
+
+// StatsMap holds the packet and byte counters indexed by verdict reason
+var StatsMap = bpf.NewMap(StatsMapName,
+	bpf.BPF_MAP_TYPE_PERCPU_ARRAY,
+	int(unsafe.Sizeof(Rule{})),
+	int(unsafe.Sizeof(RuleStats{})),
+	len(reasons),
+	0, 0, nil)
+
+// ReasonStats are the counters of a verdict reason summed over all CPUs.
+type ReasonStats struct {
+	Reason  string `json:"reason"`
+	Verdict string `json:"verdict"`
+	RuleStats
+}
+
+// DumpStats returns the counters of all verdict reasons.
+func DumpStats() ([]*ReasonStats, error) {
+	if err := StatsMap.Open(); err != nil {
+		return nil, err
+	}
+
+	possibleCPUs := bpf.GetNumPossibleCPUs()
+	if possibleCPUs == 0 {
+		return nil, fmt.Errorf("unable to determine number of possible CPUs")
+	}
+
+	entries := make([]*ReasonStats, 0, len(reasons))
+	values := make([]RuleStats, possibleCPUs)
+	for i, reason := range reasons {
+		key := Rule{RuleID: uint32(i)}
+		if err := bpf.LookupElement(StatsMap.GetFd(), key.GetValuePtr(), unsafe.Pointer(&values[0])); err != nil {
+			return nil, fmt.Errorf("unable to lookup counters of %s: %s", reason, err)
+		}
+
+		entry := &ReasonStats{Reason: reason, Verdict: VerdictPass}
+		switch {
+		case i >= firstDropReason:
+			entry.Verdict = VerdictDrop
+		case i >= firstTXReason:
+			entry.Verdict = VerdictTX
+		}
+		for _, v := range values {
+			entry.Packets += v.Packets
+			entry.Bytes += v.Bytes
+		}
+		entries = append(entries, entry)
+	}
+
+	return entries, nil
+}
@@ -0,0 +1,157 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package prefiltermap
+
+import (
+	"crypto/rand"
+	"encoding/binary"
+	"fmt"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/u8proto"
+)
+
+const (
+	// SyncookiePortsMapName is the name of the map holding the local
+	// endpoint ports protected with SYN cookies
+	SyncookiePortsMapName = "cilium_prefilter_syncookie_ports"
+
+	// SyncookieSecretMapName is the name of the map holding the secret
+	// SYN cookies are keyed with
+	SyncookieSecretMapName = "cilium_prefilter_syncookie_secret"
+
+	// SyncookieValidMapName is the name of the LRU map holding the sources
+	// which echoed a valid cookie. It is created and only accessed by the
+	// datapath.
+	SyncookieValidMapName = "cilium_prefilter_syncookie_valid"
+
+	// SyncookieValidMaxEntries is the number of validated sources tracked
+	// at once, the least recently validated sources are challenged again.
+	SyncookieValidMaxEntries = 65536
+
+	// SyncookieLifetime is the number of seconds a validated source may
+	// connect without being challenged again
+	SyncookieLifetime = 300
+)
+
+// SyncookieSecret is the value of the SYN cookie secret map.
+//
+// Must be in sync with struct xdp_syncookie_secret in <bpf/lib/xdp.h>
+type SyncookieSecret struct {
+	Key [2]uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (s *SyncookieSecret) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(s) }
+
+func (s *SyncookieSecret) String() string { return "<hidden>" }
+
+var (
+	// SyncookiePortsMap holds the protected ports per local endpoint
+	SyncookiePortsMap = newRuleMap(SyncookiePortsMapName, bpf.MapTypeHash, unsafe.Sizeof(EndpointPortKey{}),
+		func() (bpf.MapKey, bpf.MapValue) { return &EndpointPortKey{}, &Rule{} })
+
+	// SyncookieSecretMap holds the SYN cookie secret at index 0
+	SyncookieSecretMap = bpf.NewMap(SyncookieSecretMapName,
+		bpf.BPF_MAP_TYPE_ARRAY,
+		int(unsafe.Sizeof(Rule{})),
+		int(unsafe.Sizeof(SyncookieSecret{})),
+		1,
+		0, 0, nil)
+)
+
+// SyncookieMaps returns all maps of the SYN cookie filter managed by the
+// agent.
+func SyncookieMaps() []*bpf.Map {
+	return []*bpf.Map{SyncookiePortsMap, SyncookieSecretMap}
+}
+
+// InitSyncookieSecret generates the SYN cookie secret unless the datapath
+// already uses one, which keeps outstanding cookies valid across restarts.
+func InitSyncookieSecret() error {
+	key := Rule{}
+	secret := SyncookieSecret{}
+	fd := SyncookieSecretMap.GetFd()
+	if err := bpf.LookupElement(fd, key.GetValuePtr(), secret.GetValuePtr()); err != nil {
+		return fmt.Errorf("unable to lookup SYN cookie secret: %s", err)
+	}
+	if secret.Key != [2]uint32{} {
+		return nil
+	}
+
+	var buf [8]byte
+	if _, err := rand.Read(buf[:]); err != nil {
+		return fmt.Errorf("unable to generate SYN cookie secret: %s", err)
+	}
+
+	secret.Key[0] = binary.LittleEndian.Uint32(buf[:4])
+	secret.Key[1] = binary.LittleEndian.Uint32(buf[4:])
+	return bpf.UpdateElement(fd, key.GetValuePtr(), secret.GetValuePtr(), 0)
+}
+
+// SetSyncookiePorts protects the TCP ports of the local endpoint with SYN
+// cookies, replacing any previously protected ports. Challenged and
+// validated connection attempts are accounted to the rule ID.
+func SetSyncookiePorts(ruleID uint32, epID uint16, ports []uint16) error {
+	if err := checkRuleID(ruleID); err != nil {
+		return err
+	}
+
+	existing, err := endpointPortKeys(SyncookiePortsMap, epID)
+	if err != nil {
+		return err
+	}
+
+	rule := &Rule{RuleID: ruleID}
+	protected := map[EndpointPortKey]struct{}{}
+	for _, p := range ports {
+		if p == 0 {
+			return fmt.Errorf("invalid port %d", p)
+		}
+
+		key := newEndpointPortKey(epID, Port{Port: p, Protocol: u8proto.TCP})
+		if err := SyncookiePortsMap.Update(key, rule); err != nil {
+			return err
+		}
+		protected[*key] = struct{}{}
+	}
+
+	for _, key := range existing {
+		if _, ok := protected[*key]; !ok {
+			if err := SyncookiePortsMap.Delete(key); err != nil {
+				return err
+			}
+		}
+	}
+
+	return nil
+}
+
+// ClearSyncookiePorts stops protecting the ports of the local endpoint.
+func ClearSyncookiePorts(epID uint16) error {
+	keys, err := endpointPortKeys(SyncookiePortsMap, epID)
+	if err != nil {
+		return err
+	}
+
+	for _, key := range keys {
+		if err := SyncookiePortsMap.Delete(key); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
@@ -0,0 +1,23 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Package sharedpolicymap represents the map from an endpoint ID to the
+// policy map enforced by the endpoint. This map is of type
+// BPF_MAP_TYPE_HASH_OF_MAPS. Endpoints sharing a security identity and not
+// requiring any proxy redirection reference the same per-identity policy map,
+// so that memory usage and the number of policy map updates scale with the
+// number of identities rather than with the number of endpoints. Endpoints
+// with proxy redirects keep using their own policy map, as the proxy ports
+// are allocated per endpoint.
+package sharedpolicymap
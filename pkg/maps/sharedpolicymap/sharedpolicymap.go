@@ -0,0 +1,306 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package sharedpolicymap
+
+import (
+	"fmt"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/lock"
+	"github.com/cilium/cilium/pkg/logging"
+	"github.com/cilium/cilium/pkg/logging/logfields"
+	"github.com/cilium/cilium/pkg/maps/policymap"
+)
+
+var (
+	log          = logging.DefaultLogger.WithField(logfields.LogSubsys, "map-shared-policy")
+	MapName      = "cilium_ep_shared_policy"
+	innerMapName = "ep-shared-policy-inner-map"
+)
+
+const (
+	// MaxEntries represents the maximum number of endpoints in the map
+	MaxEntries = 65535
+
+	// IdentityMapPrefix is the prefix of the per-identity policy maps
+	IdentityMapPrefix = policymap.MapName + "id_"
+)
+
+// EndpointKey is the endpoint ID used as key in the map
+type EndpointKey struct{ ID uint32 }
+
+// PolicyFd is the file descriptor of the policy map of an endpoint
+type PolicyFd struct{ Fd uint32 }
+
+var (
+	buildMap sync.Once
+
+	// SharedPolicyMap is the map from endpoint ID to policy map
+	SharedPolicyMap = bpf.NewMap(MapName,
+		bpf.MapTypeHashOfMaps,
+		int(unsafe.Sizeof(EndpointKey{})),
+		int(unsafe.Sizeof(PolicyFd{})),
+		MaxEntries,
+		0,
+		0,
+		func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+			k := EndpointKey{}
+			v := PolicyFd{}
+
+			if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+				return nil, nil, err
+			}
+
+			return &k, &v, nil
+		},
+	).WithCache()
+
+	// mutex protects users, revisions and identityLocks
+	mutex lock.Mutex
+
+	// users maps each identity to the set of endpoints referencing its
+	// policy map
+	users = map[uint32]map[uint16]struct{}{}
+
+	// revisions maps each identity to the policy revision its policy map
+	// was last synchronized to
+	revisions = map[uint32]uint64{}
+
+	// identityLocks maps each identity to the lock serializing the
+	// synchronization of its policy map, as long as it is held or waited
+	// for
+	identityLocks = map[uint32]*identityLock{}
+)
+
+// identityLock is the lock of an identity along with the number of callers
+// holding or waiting for it
+type identityLock struct {
+	lock.Mutex
+	refs int
+}
+
+func (k EndpointKey) String() string { return fmt.Sprintf("%d", k.ID) }
+
+// GetKeyPtr returns the unsafe pointer to the endpoint ID
+func (k *EndpointKey) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the policy map fd
+func (k EndpointKey) NewValue() bpf.MapValue { return &PolicyFd{} }
+
+func (v PolicyFd) String() string { return fmt.Sprintf("fd=%d", v.Fd) }
+
+// GetValuePtr returns the unsafe value pointer to the policy map fd
+func (v *PolicyFd) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(v) }
+
+// CreateMap creates the inner map template needed for map in map types and
+// then opens or creates the endpoint to policy map. The inner map must match
+// the layout and flags of the policy maps which are inserted.
+func CreateMap() error {
+	var err error
+
+	buildMap.Do(func() {
+		var fd int
+
+		fd, err = bpf.CreateMap(bpf.BPF_MAP_TYPE_HASH,
+			uint32(unsafe.Sizeof(policymap.PolicyKey{})),
+			uint32(unsafe.Sizeof(policymap.PolicyEntry{})),
+			policymap.MaxEntries,
+			bpf.GetPreAllocateMapFlags(bpf.BPF_MAP_TYPE_HASH),
+			0, innerMapName)
+		if err != nil {
+			return
+		}
+
+		SharedPolicyMap.InnerID = uint32(fd)
+	})
+	if err != nil {
+		return fmt.Errorf("unable to create inner map for shared policy map: %s", err)
+	}
+
+	_, err = SharedPolicyMap.OpenOrCreate()
+	return err
+}
+
+// IdentityMapName returns the name of the policy map shared by all endpoints
+// with the given identity.
+func IdentityMapName(identity uint32) string {
+	return fmt.Sprintf("%s%d", IdentityMapPrefix, identity)
+}
+
+// IdentityMapPath returns the path to the policy map shared by all endpoints
+// with the given identity.
+func IdentityMapPath(identity uint32) string {
+	return bpf.MapPath(IdentityMapName(identity))
+}
+
+// IdentityFromMapName returns the identity of a per-identity policy map
+// name, ok is false if name does not refer to one.
+func IdentityFromMapName(name string) (identity uint32, ok bool) {
+	if !strings.HasPrefix(name, IdentityMapPrefix) {
+		return 0, false
+	}
+
+	id, err := strconv.ParseUint(strings.TrimPrefix(name, IdentityMapPrefix), 10, 32)
+	if err != nil {
+		return 0, false
+	}
+
+	return uint32(id), true
+}
+
+// Acquire opens or creates the policy map shared by all endpoints with the
+// given identity and registers the endpoint as a user of it. Every
+// successful call must be paired with a call to Release().
+func Acquire(identity uint32, endpointID uint16) (*policymap.PolicyMap, error) {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	m, _, err := policymap.OpenOrCreate(IdentityMapPath(identity))
+	if err != nil {
+		return nil, err
+	}
+
+	if users[identity] == nil {
+		users[identity] = map[uint16]struct{}{}
+	}
+	users[identity][endpointID] = struct{}{}
+
+	return m, nil
+}
+
+// Release unregisters the endpoint as a user of the policy map of the given
+// identity. The map is unpinned when the last user is gone, the kernel
+// releases it once no program references it anymore.
+func Release(identity uint32, endpointID uint16) {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	delete(users[identity], endpointID)
+	if len(users[identity]) > 0 {
+		return
+	}
+	delete(users, identity)
+	delete(revisions, identity)
+
+	path := IdentityMapPath(identity)
+	if err := os.RemoveAll(path); err != nil {
+		log.WithError(err).WithField(logfields.Path, path).Warning("Unable to remove shared policy map")
+	}
+}
+
+// Restore registers an endpoint restored from a previous run of the agent as
+// a user of the policy map of the given identity, if that map still exists.
+// The endpoint may have been attached to it, which must keep the map from
+// being removed while other endpoints release it. Returns true if the
+// endpoint was registered and must call Release() eventually.
+func Restore(identity uint32, endpointID uint16) bool {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	if _, err := os.Stat(IdentityMapPath(identity)); err != nil {
+		return false
+	}
+
+	if users[identity] == nil {
+		users[identity] = map[uint16]struct{}{}
+	}
+	users[identity][endpointID] = struct{}{}
+
+	return true
+}
+
+// Lock serializes the synchronization of the policy map of the given
+// identity across endpoints. It must be held from reading the revision and
+// the content of the map until the revision has been updated after the map
+// has been written, so that an endpoint never overwrites a map that another
+// endpoint has synchronized to a more recent revision in the meantime.
+func Lock(identity uint32) {
+	mutex.Lock()
+	l, ok := identityLocks[identity]
+	if !ok {
+		l = &identityLock{}
+		identityLocks[identity] = l
+	}
+	l.refs++
+	mutex.Unlock()
+
+	l.Lock()
+}
+
+// Unlock releases the lock taken with Lock().
+func Unlock(identity uint32) {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	l := identityLocks[identity]
+	l.Unlock()
+	l.refs--
+	if l.refs == 0 {
+		delete(identityLocks, identity)
+	}
+}
+
+// Revision returns the policy revision the policy map of the given identity
+// was last synchronized to, or 0 if it is not known.
+func Revision(identity uint32) uint64 {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	return revisions[identity]
+}
+
+// SetRevision records that the policy map of the given identity has been
+// synchronized to the given policy revision. The revision never decreases.
+func SetRevision(identity uint32, revision uint64) {
+	mutex.Lock()
+	defer mutex.Unlock()
+
+	if _, ok := users[identity]; ok && revision > revisions[identity] {
+		revisions[identity] = revision
+	}
+}
+
+// Attach fills the policy map with populate() and then points the endpoint to
+// it in the datapath, so that the datapath never looks up the policy of the
+// endpoint in a map that is still being filled. The endpoint is not attached
+// if populate() fails.
+func Attach(endpointID uint16, pm *policymap.PolicyMap, populate func() error) error {
+	if err := populate(); err != nil {
+		return err
+	}
+
+	return WriteEndpoint(endpointID, pm)
+}
+
+// WriteEndpoint points the endpoint to the given policy map in the datapath.
+func WriteEndpoint(endpointID uint16, pm *policymap.PolicyMap) error {
+	fd := pm.GetFd()
+	if fd < 0 {
+		return fmt.Errorf("invalid policy map fd %d", fd)
+	}
+
+	return SharedPolicyMap.Update(&EndpointKey{ID: uint32(endpointID)},
+		&PolicyFd{Fd: uint32(fd)})
+}
+
+// DeleteEndpoint removes the endpoint from the map.
+func DeleteEndpoint(endpointID uint16) error {
+	return SharedPolicyMap.Delete(&EndpointKey{ID: uint32(endpointID)})
+}
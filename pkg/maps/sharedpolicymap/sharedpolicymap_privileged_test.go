@@ -0,0 +1,141 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build privileged_tests
+
+package sharedpolicymap
+
+import (
+	"errors"
+	"os"
+	"testing"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/maps/policymap"
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	. "gopkg.in/check.v1"
+)
+
+// Hook up gocheck into the "go test" runner.
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type SharedPolicyMapPrivilegedTestSuite struct{}
+
+var _ = Suite(&SharedPolicyMapPrivilegedTestSuite{})
+
+const testIdentity = 4242
+
+func (s *SharedPolicyMapPrivilegedTestSuite) SetUpSuite(c *C) {
+	bpf.CheckOrMountFS("")
+	MapName = "unit_test_ep_shared_policy"
+	innerMapName = "unit_test_ep_shared_policy_inner_map"
+	c.Assert(CreateMap(), IsNil)
+}
+
+func (s *SharedPolicyMapPrivilegedTestSuite) TearDownSuite(c *C) {
+	SharedPolicyMap.Unpin()
+}
+
+func (s *SharedPolicyMapPrivilegedTestSuite) TearDownTest(c *C) {
+	os.RemoveAll(IdentityMapPath(testIdentity))
+	delete(users, testIdentity)
+	delete(revisions, testIdentity)
+}
+
+func (s *SharedPolicyMapPrivilegedTestSuite) TestAcquireRelease(c *C) {
+	path := IdentityMapPath(testIdentity)
+
+	m1, err := Acquire(testIdentity, 1)
+	c.Assert(err, IsNil)
+	defer m1.Close()
+	m2, err := Acquire(testIdentity, 2)
+	c.Assert(err, IsNil)
+	defer m2.Close()
+
+	// Both endpoints use the same map
+	c.Assert(m1.AllowKey(policymap.PolicyKey{Identity: 1, DestPort: 80, Nexthdr: uint8(u8proto.TCP)}, 0), IsNil)
+	entries, err := m2.DumpToSlice()
+	c.Assert(err, IsNil)
+	c.Assert(len(entries), Equals, 1)
+
+	// Acquiring twice does not take a second reference
+	m3, err := Acquire(testIdentity, 1)
+	c.Assert(err, IsNil)
+	m3.Close()
+
+	Release(testIdentity, 1)
+	_, err = os.Stat(path)
+	c.Assert(err, IsNil)
+
+	// The map is unpinned with the last user
+	Release(testIdentity, 2)
+	_, err = os.Stat(path)
+	c.Assert(os.IsNotExist(err), Equals, true)
+	c.Assert(Revision(testIdentity), Equals, uint64(0))
+}
+
+func (s *SharedPolicyMapPrivilegedTestSuite) TestRestore(c *C) {
+	// Nothing to restore if the map is gone
+	c.Assert(Restore(testIdentity, 1), Equals, false)
+
+	m, err := Acquire(testIdentity, 2)
+	c.Assert(err, IsNil)
+	defer m.Close()
+
+	// Simulate an agent restart which lost the references
+	delete(users, testIdentity)
+	c.Assert(Restore(testIdentity, 1), Equals, true)
+	c.Assert(Restore(testIdentity, 2), Equals, true)
+
+	// The map must survive the release of one of the restored endpoints
+	Release(testIdentity, 2)
+	_, err = os.Stat(IdentityMapPath(testIdentity))
+	c.Assert(err, IsNil)
+
+	Release(testIdentity, 1)
+	_, err = os.Stat(IdentityMapPath(testIdentity))
+	c.Assert(os.IsNotExist(err), Equals, true)
+}
+
+func (s *SharedPolicyMapPrivilegedTestSuite) TestAttachOrdering(c *C) {
+	key := &EndpointKey{ID: 7}
+	defer DeleteEndpoint(7)
+
+	m, err := Acquire(testIdentity, 7)
+	c.Assert(err, IsNil)
+	defer m.Close()
+
+	// The endpoint is not pointed to the map while it is populated
+	err = Attach(7, m, func() error {
+		_, err := SharedPolicyMap.Lookup(key)
+		c.Assert(err, Not(IsNil))
+		return m.AllowKey(policymap.PolicyKey{Identity: 1, DestPort: 80, Nexthdr: uint8(u8proto.TCP)}, 0)
+	})
+	c.Assert(err, IsNil)
+
+	_, err = SharedPolicyMap.Lookup(key)
+	c.Assert(err, IsNil)
+
+	// A map that failed to populate is not attached
+	c.Assert(DeleteEndpoint(7), IsNil)
+	populateErr := errors.New("populate failed")
+	err = Attach(7, m, func() error { return populateErr })
+	c.Assert(err, Equals, populateErr)
+
+	_, err = SharedPolicyMap.Lookup(key)
+	c.Assert(err, Not(IsNil))
+}
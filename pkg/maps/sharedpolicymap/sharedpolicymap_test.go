@@ -0,0 +1,102 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package sharedpolicymap
+
+import (
+	"testing"
+	"time"
+
+	. "gopkg.in/check.v1"
+)
+
+// Hook up gocheck into the "go test" runner.
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type SharedPolicyMapTestSuite struct{}
+
+var _ = Suite(&SharedPolicyMapTestSuite{})
+
+func (s *SharedPolicyMapTestSuite) TestIdentityMapName(c *C) {
+	c.Assert(IdentityMapName(1234), Equals, "cilium_policy_id_1234")
+
+	id, ok := IdentityFromMapName(IdentityMapName(1234))
+	c.Assert(ok, Equals, true)
+	c.Assert(id, Equals, uint32(1234))
+
+	// Per-endpoint policy maps and the tail call map must not match
+	_, ok = IdentityFromMapName("cilium_policy_1234")
+	c.Assert(ok, Equals, false)
+	_, ok = IdentityFromMapName("cilium_policy")
+	c.Assert(ok, Equals, false)
+	_, ok = IdentityFromMapName("cilium_policy_id_")
+	c.Assert(ok, Equals, false)
+}
+
+func (s *SharedPolicyMapTestSuite) TestRevision(c *C) {
+	c.Assert(Revision(1234), Equals, uint64(0))
+
+	// Revisions are only tracked for maps in use
+	SetRevision(1234, 5)
+	c.Assert(Revision(1234), Equals, uint64(0))
+
+	users[1234] = map[uint16]struct{}{1: {}}
+	defer func() {
+		delete(users, 1234)
+		delete(revisions, 1234)
+	}()
+
+	SetRevision(1234, 5)
+	c.Assert(Revision(1234), Equals, uint64(5))
+
+	// An endpoint lagging behind must not roll back the revision
+	SetRevision(1234, 4)
+	c.Assert(Revision(1234), Equals, uint64(5))
+
+	SetRevision(1234, 6)
+	c.Assert(Revision(1234), Equals, uint64(6))
+}
+
+func (s *SharedPolicyMapTestSuite) TestLock(c *C) {
+	Lock(1234)
+
+	locked := make(chan struct{})
+	go func() {
+		Lock(1234)
+		close(locked)
+		Unlock(1234)
+	}()
+
+	// Other identities are not serialized with 1234
+	Lock(1235)
+	Unlock(1235)
+
+	select {
+	case <-locked:
+		c.Fatal("lock of identity 1234 acquired twice")
+	case <-time.After(10 * time.Millisecond):
+	}
+
+	Unlock(1234)
+	<-locked
+
+	// Locks are dropped once nobody holds or waits for them
+	mutex.Lock()
+	c.Assert(identityLocks, HasLen, 0)
+	mutex.Unlock()
+}
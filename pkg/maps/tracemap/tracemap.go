@@ -0,0 +1,121 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package tracemap
+
+import (
+	"fmt"
+	"math/bits"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+)
+
+const (
+	// MapName is the name of the trace configuration map.
+	MapName = "cilium_trace_config"
+
+	// MaxSampleRate is the largest supported sampling rate.
+	MaxSampleRate = 1 << 31
+)
+
+// Key is the key of the trace configuration map.
+type Key struct {
+	Index uint32
+}
+
+// GetKeyPtr returns the unsafe pointer to the BPF key
+func (k *Key) GetKeyPtr() unsafe.Pointer { return unsafe.Pointer(k) }
+
+// NewValue returns a new empty instance of the structure representing the BPF
+// map value
+func (k *Key) NewValue() bpf.MapValue { return &Config{} }
+
+func (k *Key) String() string { return fmt.Sprintf("%d", k.Index) }
+
+// Config is the runtime configuration of trace notifications.
+//
+// Must be in sync with struct trace_config in <bpf/lib/trace.h>
+type Config struct {
+	// SampleShift is the binary logarithm of the sampling rate
+	SampleShift uint32
+	Pad         uint32
+}
+
+// GetValuePtr returns the unsafe pointer to the BPF value
+func (c *Config) GetValuePtr() unsafe.Pointer { return unsafe.Pointer(c) }
+
+func (c *Config) String() string { return fmt.Sprintf("sample-rate=%d", c.SampleRate()) }
+
+// SampleRate returns the configured sampling rate, i.e. one in SampleRate()
+// notifications is emitted.
+func (c *Config) SampleRate() uint64 {
+	return 1 << c.SampleShift
+}
+
+// SampleShift validates a sampling rate and returns its binary logarithm.
+func SampleShift(rate uint64) (uint32, error) {
+	if rate == 0 || rate > MaxSampleRate || rate&(rate-1) != 0 {
+		return 0, fmt.Errorf("sampling rate %d must be a power of two between 1 and %d",
+			rate, uint64(MaxSampleRate))
+	}
+	return uint32(bits.TrailingZeros64(rate)), nil
+}
+
+// Map is the trace configuration map. It is created by the agent and only
+// read by the datapath.
+var Map = bpf.NewMap(MapName,
+	bpf.BPF_MAP_TYPE_ARRAY,
+	int(unsafe.Sizeof(Key{})),
+	int(unsafe.Sizeof(Config{})),
+	1,
+	0, 0,
+	func(key []byte, value []byte) (bpf.MapKey, bpf.MapValue, error) {
+		k, v := Key{}, Config{}
+
+		if err := bpf.ConvertKeyValue(key, value, &k, &v); err != nil {
+			return nil, nil, err
+		}
+		return &k, &v, nil
+	})
+
+// SetSampleRate configures the datapath to emit one in rate trace
+// notifications. The rate must be a power of two, a rate of 1 disables
+// sampling.
+func SetSampleRate(rate uint64) error {
+	shift, err := SampleShift(rate)
+	if err != nil {
+		return err
+	}
+
+	if _, err := Map.OpenOrCreate(); err != nil {
+		return fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	return Map.Update(&Key{}, &Config{SampleShift: shift})
+}
+
+// GetSampleRate returns the sampling rate of trace notifications.
+func GetSampleRate() (uint64, error) {
+	if err := Map.Open(); err != nil {
+		return 0, fmt.Errorf("unable to open %s: %s", MapName, err)
+	}
+
+	value, err := Map.Lookup(&Key{})
+	if err != nil {
+		return 0, fmt.Errorf("unable to lookup %s: %s", MapName, err)
+	}
+
+	return value.(*Config).SampleRate(), nil
+}
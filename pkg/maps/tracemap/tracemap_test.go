@@ -0,0 +1,51 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !privileged_tests
+
+package tracemap
+
+import (
+	"testing"
+	"unsafe"
+
+	. "gopkg.in/check.v1"
+)
+
+func Test(t *testing.T) {
+	TestingT(t)
+}
+
+type TraceMapTestSuite struct{}
+
+var _ = Suite(&TraceMapTestSuite{})
+
+func (s *TraceMapTestSuite) TestConfigSize(c *C) {
+	// Must match struct trace_config in bpf/lib/trace.h
+	c.Assert(unsafe.Sizeof(Config{}), Equals, uintptr(8))
+}
+
+func (s *TraceMapTestSuite) TestSampleShift(c *C) {
+	for rate, shift := range map[uint64]uint32{1: 0, 2: 1, 1024: 10, MaxSampleRate: 31} {
+		got, err := SampleShift(rate)
+		c.Assert(err, IsNil)
+		c.Assert(got, Equals, shift)
+		c.Assert((&Config{SampleShift: got}).SampleRate(), Equals, rate)
+	}
+
+	for _, rate := range []uint64{0, 3, 1000, MaxSampleRate << 1} {
+		_, err := SampleShift(rate)
+		c.Assert(err, Not(IsNil))
+	}
+}
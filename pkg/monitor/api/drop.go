@@ -57,6 +57,8 @@ var errors = map[uint8]string{
 	163: "Unknown connection tracking state",
 	164: "Local host is unreachable",
 	165: "No configuration available to perform policy decision",
+	166: "First fragment of datagram not seen",
+	167: "Policy denied by deny entry",
 }
 
 // DropReason prints the drop reason in a human readable string
@@ -36,11 +36,28 @@ type TraceNotify struct {
 	DstLabel uint32
 	DstID    uint16
 	Reason   uint8
-	Pad      uint8
-	Ifindex  uint32
+	// SampleShift is the binary logarithm of the rate the notification
+	// was sampled at by the datapath
+	SampleShift uint8
+	Ifindex     uint32
 	// data
 }
 
+// SampleRate returns the rate the notification was sampled at, i.e. it
+// stands for SampleRate() forwarded packets.
+func (n *TraceNotify) SampleRate() uint32 {
+	return 1 << n.SampleShift
+}
+
+// sampleSummary returns a description of the sampling rate or an empty
+// string if the notification was not sampled
+func (n *TraceNotify) sampleSummary() string {
+	if n.SampleShift == 0 {
+		return ""
+	}
+	return fmt.Sprintf(", sampled 1/%d", n.SampleRate())
+}
+
 // Available observation points.
 const (
 	TraceToLxc = iota
@@ -68,7 +85,8 @@ var traceObsPoints = map[uint8]string{
 	TraceFromOverlay: "from-overlay",
 }
 
-func obsPoint(obsPoint uint8) string {
+// ObsPoint returns the name of the given trace observation point
+func ObsPoint(obsPoint uint8) string {
 	if str, ok := traceObsPoints[obsPoint]; ok {
 		return str
 	}
@@ -126,15 +144,16 @@ func (n *TraceNotify) traceSummary() string {
 
 // DumpInfo prints a summary of the trace messages.
 func (n *TraceNotify) DumpInfo(data []byte) {
-	fmt.Printf("%s flow %#x identity %d->%d state %s ifindex %s: %s\n",
+	fmt.Printf("%s flow %#x identity %d->%d state %s ifindex %s%s: %s\n",
 		n.traceSummary(), n.Hash, n.SrcLabel, n.DstLabel,
-		connState(n.Reason), ifname(int(n.Ifindex)), GetConnectionSummary(data[TraceNotifyLen:]))
+		connState(n.Reason), ifname(int(n.Ifindex)), n.sampleSummary(),
+		GetConnectionSummary(data[TraceNotifyLen:]))
 }
 
 // DumpVerbose prints the trace notification in human readable form
 func (n *TraceNotify) DumpVerbose(dissect bool, data []byte, prefix string) {
 	fmt.Printf("%s MARK %#x FROM %d %s: %d bytes (%d captured), state %s",
-		prefix, n.Hash, n.Source, obsPoint(n.ObsPoint), n.OrigLen, n.CapLen, connState(n.Reason))
+		prefix, n.Hash, n.Source, ObsPoint(n.ObsPoint), n.OrigLen, n.CapLen, connState(n.Reason))
 
 	if n.Ifindex != 0 {
 		fmt.Printf(", interface %s", ifname(int(n.Ifindex)))
@@ -144,6 +163,8 @@ func (n *TraceNotify) DumpVerbose(dissect bool, data []byte, prefix string) {
 		fmt.Printf(", identity %d->%d", n.SrcLabel, n.DstLabel)
 	}
 
+	fmt.Printf("%s", n.sampleSummary())
+
 	if n.DstID != 0 {
 		fmt.Printf(", to endpoint %d\n", n.DstID)
 	} else {
@@ -190,6 +211,10 @@ type TraceNotifyVerbose struct {
 	DstLabel uint32 `json:"dstLabel"`
 	DstID    uint16 `json:"dstID"`
 
+	// SampleRate is the rate the notification was sampled at, it is
+	// omitted if the notification was not sampled
+	SampleRate uint32 `json:"sampleRate,omitempty"`
+
 	Summary *DissectSummary `json:"summary,omitempty"`
 }
 
@@ -200,12 +225,22 @@ func TraceNotifyToVerbose(n *TraceNotify) TraceNotifyVerbose {
 		Mark:             fmt.Sprintf("%#x", n.Hash),
 		Ifindex:          ifname(int(n.Ifindex)),
 		State:            connState(n.Reason),
-		ObservationPoint: obsPoint(n.ObsPoint),
+		ObservationPoint: ObsPoint(n.ObsPoint),
 		TraceSummary:     n.traceSummary(),
 		Source:           n.Source,
 		Bytes:            n.OrigLen,
 		SrcLabel:         n.SrcLabel,
 		DstLabel:         n.DstLabel,
 		DstID:            n.DstID,
+		SampleRate:       n.sampleRate(),
+	}
+}
+
+// sampleRate returns the sampling rate for the verbose notification, zero
+// if the notification was not sampled
+func (n *TraceNotify) sampleRate() uint32 {
+	if n.SampleShift == 0 {
+		return 0
 	}
+	return n.SampleRate()
 }
@@ -225,6 +225,13 @@ const (
 	// TracePayloadlen length of payload to capture when tracing
 	TracePayloadlen = "trace-payloadlen"
 
+	// TraceSampleRate is the rate at which trace notifications are sampled
+	TraceSampleRate = "trace-sample-rate"
+
+	// DropNotifyRate is the maximum number of drop notifications per
+	// second, drop reason and CPU
+	DropNotifyRate = "drop-notify-rate"
+
 	// Version prints the version information
 	Version = "version"
 
@@ -252,6 +259,26 @@ const (
 	// PrefilterMode { "+ModePreFilterNative+" | "+ModePreFilterGeneric+" } (default: "+option.ModePreFilterNative+")
 	PrefilterMode = "prefilter-mode"
 
+	// PrefilterEndpointPorts restricts prefiltered traffic to local
+	// endpoints to their allowed ports
+	PrefilterEndpointPorts = "prefilter-endpoint-ports"
+
+	// PrefilterDestinations enables destination prefix and port rules in
+	// the prefilter
+	PrefilterDestinations = "prefilter-destinations"
+
+	// PrefilterRateLimit enables rate limiting of source prefixes in
+	// the prefilter
+	PrefilterRateLimit = "prefilter-rate-limit"
+
+	// PrefilterEncap applies the prefilter to the inner headers of
+	// VXLAN and Geneve traffic
+	PrefilterEncap = "prefilter-encap"
+
+	// PrefilterSyncookies protects configured endpoint ports with SYN
+	// cookies in the prefilter
+	PrefilterSyncookies = "prefilter-syncookies"
+
 	// PrometheusServeAddr IP:Port on which to serve prometheus metrics (pass ":Port" to bind on all interfaces, "" is off)
 	PrometheusServeAddr = "prometheus-serve-addr"
 
@@ -402,6 +429,42 @@ const (
 
 	// IPSecKeyFileName is the name of the option for ipsec key file
 	IPSecKeyFileName = "ipsec-key-file"
+
+	// EnableIPv4FragmentsTrackingName is the name of the option to enable
+	// IPv4 fragments tracking for L4-based lookups
+	EnableIPv4FragmentsTrackingName = "enable-ipv4-fragment-tracking"
+
+	// EnableIPv6FragmentsTrackingName is the name of the option to enable
+	// IPv6 fragments tracking for L4-based lookups
+	EnableIPv6FragmentsTrackingName = "enable-ipv6-fragment-tracking"
+
+	// EnableSharedPolicyMapsName is the name of the option to share policy
+	// maps between endpoints with the same security identity
+	EnableSharedPolicyMapsName = "enable-shared-policy-maps"
+
+	// EnableIPCacheFrontCacheName is the name of the option to enable the
+	// per-CPU datapath cache in front of ipcache lookups
+	EnableIPCacheFrontCacheName = "enable-ipcache-front-cache"
+
+	// EnableSplitIPCacheName is the name of the option to split the
+	// ipcache into separate maps per address family
+	EnableSplitIPCacheName = "enable-split-ipcache"
+
+	// EnableEndpointTableName is the name of the option to look up local
+	// endpoints in an array indexed by endpoint ID
+	EnableEndpointTableName = "enable-endpoint-table"
+
+	// EnableEndpointDropMetricsName is the name of the option to account
+	// drops per endpoint in the datapath
+	EnableEndpointDropMetricsName = "enable-endpoint-drop-metrics"
+
+	// EnableFlowSummaryName is the name of the option to aggregate flow
+	// summaries in the datapath
+	EnableFlowSummaryName = "enable-flow-summary"
+
+	// EnableLatencyHistogramsName is the name of the option to compile
+	// latency instrumentation into the datapath
+	EnableLatencyHistogramsName = "enable-latency-histograms"
 )
 
 // FQDNS variables
@@ -521,6 +584,11 @@ type DaemonConfig struct {
 	Device          string     // Receive device
 	DevicePreFilter string     // XDP device
 	ModePreFilter   string     // XDP mode, values: { native | generic }
+	PortsPreFilter  bool       // XDP filtering of allowed ports per endpoint
+	DstPreFilter    bool       // XDP destination prefix and port rules
+	RatePreFilter   bool       // XDP rate limiting of source prefixes
+	EncapPreFilter  bool       // XDP filtering of inner headers of tunnel traffic
+	CookiePreFilter bool       // XDP SYN cookies for protected endpoint ports
 	HostV4Addr      net.IP     // Host v4 address of the snooping device
 	HostV6Addr      net.IP     // Host v6 address of the snooping device
 	LBInterface     string     // Set with name of the interface to loadbalance packets from
@@ -681,6 +749,42 @@ type DaemonConfig struct {
 	// IPSec key file for stored keys
 	IPSecKeyFile string
 
+	// EnableIPv4FragmentsTracking enables IPv4 fragments tracking for
+	// L4-based lookups
+	EnableIPv4FragmentsTracking bool
+
+	// EnableIPv6FragmentsTracking enables IPv6 fragments tracking for
+	// L4-based lookups
+	EnableIPv6FragmentsTracking bool
+
+	// EnableSharedPolicyMaps enables sharing of policy maps between
+	// endpoints with the same security identity
+	EnableSharedPolicyMaps bool
+
+	// EnableIPCacheFrontCache enables the per-CPU datapath cache in front
+	// of ipcache lookups
+	EnableIPCacheFrontCache bool
+
+	// EnableSplitIPCache splits the ipcache into separate maps per address
+	// family with compact keys
+	EnableSplitIPCache bool
+
+	// EnableEndpointTable looks up local endpoints in an array indexed by
+	// endpoint ID instead of the endpoint hash map
+	EnableEndpointTable bool
+
+	// EnableEndpointDropMetrics accounts drops by reason and direction in a
+	// metrics map of each endpoint
+	EnableEndpointDropMetrics bool
+
+	// EnableFlowSummary aggregates forwarded and dropped packets into flow
+	// summaries in the datapath
+	EnableFlowSummary bool
+
+	// EnableLatencyHistograms compiles latency instrumentation into the
+	// datapath programs
+	EnableLatencyHistograms bool
+
 	// MonitorQueueSize is the size of the monitor event queue
 	MonitorQueueSize int
 
@@ -734,6 +838,8 @@ type DaemonConfig struct {
 	SidecarIstioProxyImage string
 	SocketPath             string
 	TracePayloadlen        int
+	TraceSampleRate        int
+	DropNotifyRate         int
 	Version                string
 	PProf                  bool
 	PrometheusServeAddr    string
@@ -1022,7 +1128,21 @@ func (c *DaemonConfig) Populate() {
 	c.EnableIPv4 = getIPv4Enabled()
 	c.EnableIPv6 = viper.GetBool(EnableIPv6Name)
 	c.EnableIPSec = viper.GetBool(EnableIPSecName)
+	c.EnableIPv4FragmentsTracking = viper.GetBool(EnableIPv4FragmentsTrackingName)
+	c.EnableIPv6FragmentsTracking = viper.GetBool(EnableIPv6FragmentsTrackingName)
+	c.EnableSharedPolicyMaps = viper.GetBool(EnableSharedPolicyMapsName)
+	c.EnableIPCacheFrontCache = viper.GetBool(EnableIPCacheFrontCacheName)
+	c.EnableSplitIPCache = viper.GetBool(EnableSplitIPCacheName)
+	c.EnableEndpointTable = viper.GetBool(EnableEndpointTableName)
+	c.EnableEndpointDropMetrics = viper.GetBool(EnableEndpointDropMetricsName)
+	c.EnableFlowSummary = viper.GetBool(EnableFlowSummaryName)
+	c.EnableLatencyHistograms = viper.GetBool(EnableLatencyHistogramsName)
 	c.DevicePreFilter = viper.GetString(PrefilterDevice)
+	c.PortsPreFilter = viper.GetBool(PrefilterEndpointPorts)
+	c.DstPreFilter = viper.GetBool(PrefilterDestinations)
+	c.RatePreFilter = viper.GetBool(PrefilterRateLimit)
+	c.EncapPreFilter = viper.GetBool(PrefilterEncap)
+	c.CookiePreFilter = viper.GetBool(PrefilterSyncookies)
 	c.DisableCiliumEndpointCRD = viper.GetBool(DisableCiliumEndpointCRDName)
 	c.DisableK8sServices = viper.GetBool(DisableK8sServices)
 	c.DockerEndpoint = viper.GetString(Docker)
@@ -1080,6 +1200,8 @@ func (c *DaemonConfig) Populate() {
 	c.SocketPath = viper.GetString(SocketPath)
 	c.SockopsEnable = viper.GetBool(SockopsEnableName)
 	c.TracePayloadlen = viper.GetInt(TracePayloadlen)
+	c.TraceSampleRate = viper.GetInt(TraceSampleRate)
+	c.DropNotifyRate = viper.GetInt(DropNotifyRate)
 	c.Tunnel = viper.GetString(TunnelName)
 	c.Version = viper.GetString(Version)
 	c.Workloads = viper.GetStringSlice(ContainerRuntime)
@@ -57,6 +57,14 @@ type PortRule struct {
 	//
 	// +optional
 	Rules *L7Rules `json:"rules,omitempty"`
+
+	// Deny drops the traffic matching the Ports instead of allowing it. It
+	// takes precedence over any allow of the same peer and port, including
+	// an allow of the peer on all ports. Layer 7 rules cannot be combined
+	// with Deny.
+	//
+	// +optional
+	Deny bool `json:"deny,omitempty"`
 }
 
 // L7Rules is a union of port level rule types. Mixing of different port
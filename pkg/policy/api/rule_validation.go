@@ -349,6 +349,10 @@ func (pr *PortRule) sanitize() error {
 		}
 	}
 
+	if pr.Deny && !pr.Rules.IsEmpty() {
+		return fmt.Errorf("L7 rules cannot be combined with deny")
+	}
+
 	// Sanitize L7 rules
 	if !pr.Rules.IsEmpty() {
 		if err := pr.Rules.sanitize(); err != nil {
@@ -115,6 +115,8 @@ type L4Filter struct {
 	Ingress bool `json:"-"`
 	// The rule labels of this Filter
 	DerivedFromRules labels.LabelArrayList `json:"-"`
+	// IsDeny is true if the filter drops the traffic it matches
+	IsDeny bool `json:"deny,omitempty"`
 }
 
 // AllowsAllAtL3 returns whether this L4Filter applies to all endpoints at L3.
@@ -219,6 +221,7 @@ func CreateL4Filter(peerEndpoints api.EndpointSelectorSlice, rule api.PortRule,
 		Endpoints:        filterEndpoints,
 		DerivedFromRules: labels.LabelArrayList{ruleLabels},
 		Ingress:          ingress,
+		IsDeny:           rule.Deny,
 	}
 
 	if protocol == api.ProtoTCP && rule.Rules != nil {
@@ -316,8 +319,12 @@ func (l4 L4Filter) matchesLabels(labels labels.LabelArray) bool {
 	return false
 }
 
+// denyKeySuffix is appended to the L4PolicyMap key of deny filters, so that
+// they are kept apart from the allow filters of the same port
+const denyKeySuffix = "/deny"
+
 // L4PolicyMap is a list of L4 filters indexable by protocol/port
-// key format: "port/proto"
+// key format: "port/proto", or "port/proto/deny" for deny filters
 type L4PolicyMap map[string]L4Filter
 
 // HasRedirect returns true if at least one L4 filter contains a port
@@ -341,6 +348,7 @@ func (l4 L4PolicyMap) HasRedirect() bool {
 // * If a single port is not present in the `L4PolicyMap`.
 // * If a port is present in the `L4PolicyMap`, but it applies ToEndpoints or
 // FromEndpoints constraints that require labels not present in `labels`.
+// * If a deny filter for a port applies to `labels`.
 // Otherwise, returns api.Allowed.
 func (l4 L4PolicyMap) containsAllL3L4(labels labels.LabelArray, ports []*models.Port) api.Decision {
 	if len(l4) == 0 {
@@ -355,23 +363,14 @@ func (l4 L4PolicyMap) containsAllL3L4(labels labels.LabelArray, ports []*models.
 		lwrProtocol := l4Ctx.Protocol
 		switch lwrProtocol {
 		case "", models.PortProtocolANY:
-			tcpPort := fmt.Sprintf("%d/TCP", l4Ctx.Port)
-			tcpFilter, tcpmatch := l4[tcpPort]
-			if tcpmatch {
-				tcpmatch = tcpFilter.matchesLabels(labels)
-			}
-			udpPort := fmt.Sprintf("%d/UDP", l4Ctx.Port)
-			udpFilter, udpmatch := l4[udpPort]
-			if udpmatch {
-				udpmatch = udpFilter.matchesLabels(labels)
-			}
+			tcpmatch := l4.allowsPort(fmt.Sprintf("%d/TCP", l4Ctx.Port), labels)
+			udpmatch := l4.allowsPort(fmt.Sprintf("%d/UDP", l4Ctx.Port), labels)
 			if !tcpmatch && !udpmatch {
 				return api.Denied
 			}
 		default:
 			port := fmt.Sprintf("%d/%s", l4Ctx.Port, lwrProtocol)
-			filter, match := l4[port]
-			if !match || !filter.matchesLabels(labels) {
+			if !l4.allowsPort(port, labels) {
 				return api.Denied
 			}
 		}
@@ -379,6 +378,16 @@ func (l4 L4PolicyMap) containsAllL3L4(labels labels.LabelArray, ports []*models.
 	return api.Allowed
 }
 
+// allowsPort returns true if the filter for port allows `labels` and no deny
+// filter for the same port matches them
+func (l4 L4PolicyMap) allowsPort(port string, labels labels.LabelArray) bool {
+	if filter, ok := l4[port+denyKeySuffix]; ok && filter.matchesLabels(labels) {
+		return false
+	}
+	filter, ok := l4[port]
+	return ok && filter.matchesLabels(labels)
+}
+
 type L4Policy struct {
 	Ingress L4PolicyMap
 	Egress  L4PolicyMap
@@ -71,6 +71,10 @@ type MapStateEntry struct {
 	// If 0 (default), there is no proxy redirection for the corresponding
 	// Key.
 	ProxyPort uint16
+
+	// IsDeny is true if traffic matching the corresponding Key must be
+	// dropped. It takes precedence over less specific keys.
+	IsDeny bool
 }
 
 // DetermineAllowFromWorld determines whether world should be allowed to
@@ -115,6 +115,15 @@ func (p *EndpointPolicy) computeDirectionL4PolicyMapEntries(identityCache cache.
 					continue
 				}
 			}
+			if filter.IsDeny {
+				p.PolicyMapState[keyFromFilter] = MapStateEntry{IsDeny: true}
+				continue
+			}
+			// A deny for the same key takes precedence, regardless of
+			// the order in which the filters are visited.
+			if entry, ok := p.PolicyMapState[keyFromFilter]; ok && entry.IsDeny {
+				continue
+			}
 			p.PolicyMapState[keyFromFilter] = MapStateEntry{ProxyPort: proxyPort}
 		}
 	}
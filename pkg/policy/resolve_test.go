@@ -25,6 +25,7 @@ import (
 	"github.com/cilium/cilium/pkg/labels"
 	"github.com/cilium/cilium/pkg/option"
 	"github.com/cilium/cilium/pkg/policy/api"
+	"github.com/cilium/cilium/pkg/policy/trafficdirection"
 
 	. "gopkg.in/check.v1"
 )
@@ -273,3 +274,63 @@ func (ds *PolicyTestSuite) TestL7WithLocalHostWildcardd(c *C) {
 
 	c.Assert(policy, checker.DeepEquals, &expectedEndpointPolicy)
 }
+
+func (ds *PolicyTestSuite) TestDenyRule(c *C) {
+	repo := NewPolicyRepository()
+
+	selBar := api.NewESFromLabels(labels.ParseSelectLabel("id=bar"))
+	selFoo := api.NewESFromLabels(labels.ParseSelectLabel("id=foo"))
+	selBaz := api.NewESFromLabels(labels.ParseSelectLabel("id=baz"))
+	selTeam := api.NewESFromLabels(labels.ParseSelectLabel("team=a"))
+	rule1 := api.Rule{
+		EndpointSelector: selBar,
+		Ingress: []api.IngressRule{
+			{FromEndpoints: []api.EndpointSelector{api.WildcardEndpointSelector}},
+			{
+				FromEndpoints: []api.EndpointSelector{selFoo},
+				ToPorts: []api.PortRule{{
+					Ports: []api.PortProtocol{{Port: "22", Protocol: api.ProtoTCP}},
+					Deny:  true,
+				}},
+			},
+			{
+				FromEndpoints: []api.EndpointSelector{selFoo, selBaz},
+				ToPorts: []api.PortRule{{
+					Ports: []api.PortProtocol{{Port: "22", Protocol: api.ProtoTCP}},
+				}},
+			},
+			{FromRequires: []api.EndpointSelector{selTeam}},
+		},
+	}
+
+	rule1.Sanitize()
+	_, err := repo.Add(rule1)
+	c.Assert(err, IsNil)
+
+	repo.Mutex.RLock()
+	defer repo.Mutex.RUnlock()
+
+	identityCache := cache.IdentityCache{
+		2001: labels.ParseSelectLabelArray("id=foo", "team=a"),
+		2002: labels.ParseSelectLabelArray("id=baz", "team=a"),
+		2003: labels.ParseSelectLabelArray("id=qux"),
+	}
+	policy, err := repo.ResolvePolicy(10, labels.ParseSelectLabelArray("id=bar"), DummyOwner{}, identityCache)
+	c.Assert(err, IsNil)
+
+	// The deny wins over the allow of the same peer and port, and only
+	// carves the port out of the allow of the peer at L3. Identities
+	// failing FromRequires are left out rather than denied. Egress is not
+	// enforced.
+	ingress := trafficdirection.Ingress.Uint8()
+	egress := trafficdirection.Egress.Uint8()
+	c.Assert(policy.PolicyMapState, checker.DeepEquals, MapState{
+		{Identity: 2001, TrafficDirection: ingress}:                           {},
+		{Identity: 2001, DestPort: 22, Nexthdr: 6, TrafficDirection: ingress}: {IsDeny: true},
+		{Identity: 2002, TrafficDirection: ingress}:                           {},
+		{Identity: 2002, DestPort: 22, Nexthdr: 6, TrafficDirection: ingress}: {},
+		{Identity: 2001, TrafficDirection: egress}:                            {},
+		{Identity: 2002, TrafficDirection: egress}:                            {},
+		{Identity: 2003, TrafficDirection: egress}:                            {},
+	})
+}
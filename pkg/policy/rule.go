@@ -135,6 +135,9 @@ func mergeL4IngressPort(ctx *SearchContext, endpoints []api.EndpointSelector, en
 	proto api.L4Proto, ruleLabels labels.LabelArray, resMap L4PolicyMap) (int, error) {
 
 	key := p.Port + "/" + string(proto)
+	if r.Deny {
+		key += denyKeySuffix
+	}
 	existingFilter, ok := resMap[key]
 	if !ok {
 		resMap[key] = CreateL4IngressFilter(endpoints, endpointsWithL3Override, r, p, proto, ruleLabels)
@@ -521,6 +524,9 @@ func mergeL4EgressPort(ctx *SearchContext, endpoints []api.EndpointSelector, r a
 	proto api.L4Proto, ruleLabels labels.LabelArray, resMap L4PolicyMap) (int, error) {
 
 	key := p.Port + "/" + string(proto)
+	if r.Deny {
+		key += denyKeySuffix
+	}
 	existingFilter, ok := resMap[key]
 	if !ok {
 		resMap[key] = CreateL4EgressFilter(endpoints, r, p, proto, ruleLabels)
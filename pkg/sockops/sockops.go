@@ -190,8 +190,10 @@ func bpftoolDetach(bpfObject string) error {
 // #bpftool prog load $bpfObject /sys/fs/bpf/sockops
 func bpftoolLoad(bpfObject string, bpfFsFile string) error {
 	sockopsMaps := [...]string{
-		"cilium_lxc",
-		"cilium_ipcache",
+		"cilium_lxc", "cilium_lxc_table", "cilium_lxc_id4", "cilium_lxc_id6",
+		"cilium_ipcache", "cilium_ipcache4", "cilium_ipcache6",
+		"cilium_ipcache_front", "cilium_ipcache_front_gen",
+		"cilium_ipcache_front_stats", "cilium_ipcache_prefixes",
 		"cilium_metric",
 		"cilium_events",
 		"cilium_sock_ops",
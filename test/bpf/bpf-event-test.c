@@ -1,27 +1,46 @@
 #include "event.h"
 
+#include <stdio.h>
+
 #ifndef __NR_CPUS__
 #define __NR_CPUS__ 1
 #endif
 
-struct bpf_elf_map __section_maps perf_test_events = {
-	.type           = BPF_MAP_TYPE_PERF_EVENT_ARRAY,
-	.size_key       = sizeof(int),
-	.size_value     = sizeof(int),
-	.pinning        = PIN_GLOBAL_NS,
-	.max_elem       = __NR_CPUS__,
-};
+/* Number of events emitted per packet to amplify the event rate. */
+#ifndef EVENTS_PER_PACKET
+#define EVENTS_PER_PACKET 1
+#endif
+
+#include "node_config.h"
+
+#undef EVENTS_MAP
+#undef EVENTS_RINGBUF_MAP
+#undef EVENTS_RINGBUF_LOST_MAP
+#define EVENTS_MAP perf_test_events
+
+/* Built with EVENT_RINGBUF, events are emitted to a shared ring buffer
+ * with the same record format as the datapath. */
+#ifdef EVENT_RINGBUF
+# define HAVE_RINGBUF_MAP_TYPE
+# define EVENTS_RINGBUF_MAP ringbuf_test_events
+# define EVENTS_RINGBUF_LOST_MAP ringbuf_test_lost
+#endif
+
+#include "lib/events.h"
 
 __section_cls_entry
 int cls_entry(struct __sk_buff *skb)
 {
 	struct event_msg msg = {0};
+	int i;
 
 	msg.type = EVENT_TYPE_SAMPLE;
 
 	skb_load_bytes(skb, 0, &msg.data, sizeof(msg.data));
-	skb_event_output(skb, &perf_test_events, BPF_F_CURRENT_CPU,
-		     &msg, sizeof(msg));
+
+#pragma unroll
+	for (i = 0; i < EVENTS_PER_PACKET; i++)
+		skb_event_emit(skb, &msg, sizeof(msg), 0);
 
 	return TC_ACT_OK;
 }
@@ -0,0 +1,527 @@
+// SPDX-License-Identifier: GPL-2.0
+// Copyright (c) 2019 Authors of Cilium
+
+/*
+ * Native shim of the BPF helper API
+ *
+ * Compiles the datapath library with the test configs in bpf/ as a native
+ * program and replaces the BPF helpers with userspace implementations, so
+ * that datapath functions can run in-process without a BPF-capable kernel:
+ *
+ * - Maps are open addressing hash tables created on first access from
+ *   their struct bpf_elf_map definition. Arrays are indexed directly, LPM
+ *   tries only match exact keys, LRU maps evict the home slot of a key
+ *   when full. Maps hold at most SHIM_MAP_MAX_ELEM entries.
+ * - Packets live in a struct shim_skb. skb_load_bytes() and
+ *   skb_store_bytes() operate on its buffer and the checksum helpers
+ *   follow the kernel. The buffer is mapped in the low 2GB on x86-64 so
+ *   that skb->data and skb->data_end can hold it for direct packet access.
+ * - Tail calls always fail, as if the program array was empty, and all
+ *   events are discarded.
+ *
+ * Call shim_init() once before running any datapath function and
+ * shim_reset() to drop all map content.
+ */
+
+#ifndef __BPF_SHIM__
+#define __BPF_SHIM__
+
+#define ENABLE_IPV4
+#define ENABLE_IPV6
+#define HAVE_LRU_MAP_TYPE
+#define SKIP_DEBUG
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <node_config.h>
+#include <lxc_config.h>
+
+#include <bpf/api.h>
+
+#include "lib/utils.h"
+#include "lib/common.h"
+#include "lib/maps.h"
+#include "lib/ipv6.h"
+#include "lib/ipv4.h"
+#include "lib/conntrack.h"
+#include "lib/lb.h"
+#include "lib/policy.h"
+#include "lib/icmp6.h"
+
+#define SHIM_MAX_MAPS		64
+#define SHIM_MAP_MAX_ELEM	65536
+#define SHIM_SKB_SIZE		4096
+
+enum {
+	SHIM_SLOT_EMPTY,
+	SHIM_SLOT_USED,
+	SHIM_SLOT_DELETED,
+};
+
+struct shim_map {
+	const struct bpf_elf_map *def;
+	__u32 max_elem;
+	__u32 nr_slots;		/* power of two, hash maps only */
+	__u32 nr_used;
+	__u8 *state;		/* SHIM_SLOT_* per slot */
+	__u8 *keys;
+	__u8 *values;
+};
+
+/* Connection tracking table for ct_lookup4() and lb4_local(), the datapath
+ * programs define their own per endpoint.
+ */
+struct bpf_elf_map __section_maps shim_ct_map4 = {
+	.type		= BPF_MAP_TYPE_LRU_HASH,
+	.size_key	= sizeof(struct ipv4_ct_tuple),
+	.size_value	= sizeof(struct ct_entry),
+	.max_elem	= SHIM_MAP_MAX_ELEM,
+};
+
+struct shim_skb {
+	struct __sk_buff skb;	/* must be first */
+	__u8 *buf;
+};
+
+static struct shim_map shim_maps[SHIM_MAX_MAPS];
+static __u32 shim_prandom_state = 0x12345678;
+
+static bool shim_map_is_array(const struct bpf_elf_map *def)
+{
+	return def->type == BPF_MAP_TYPE_ARRAY ||
+	       def->type == BPF_MAP_TYPE_PERCPU_ARRAY ||
+	       def->type == BPF_MAP_TYPE_PROG_ARRAY;
+}
+
+static struct shim_map *shim_map_get(const void *map)
+{
+	const struct bpf_elf_map *def = map;
+	struct shim_map *m;
+	__u32 max_elem;
+	int i;
+
+	for (i = 0; i < SHIM_MAX_MAPS; i++) {
+		m = &shim_maps[i];
+		if (m->def == def)
+			return m;
+		if (!m->def)
+			break;
+	}
+	if (i == SHIM_MAX_MAPS) {
+		fprintf(stderr, "shim: more than %d maps\n", SHIM_MAX_MAPS);
+		abort();
+	}
+
+	max_elem = def->max_elem;
+	if (max_elem > SHIM_MAP_MAX_ELEM)
+		max_elem = SHIM_MAP_MAX_ELEM;
+
+	m->def = def;
+	m->max_elem = max_elem;
+	if (shim_map_is_array(def)) {
+		m->nr_slots = max_elem;
+	} else {
+		m->nr_slots = 1;
+		while (m->nr_slots < 2 * max_elem)
+			m->nr_slots <<= 1;
+	}
+	m->state = calloc(m->nr_slots, 1);
+	m->keys = calloc(m->nr_slots, def->size_key);
+	m->values = calloc(m->nr_slots, def->size_value);
+	if (!m->state || !m->keys || !m->values) {
+		fprintf(stderr, "shim: unable to allocate map\n");
+		abort();
+	}
+
+	return m;
+}
+
+static __u32 shim_hash(const void *key, __u32 size)
+{
+	const __u8 *p = key;
+	__u32 hash = 2166136261u;	/* FNV-1a */
+	__u32 i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* Returns the slot holding the key, or -1 with *free set to the first
+ * usable slot of the probe sequence, or -1 if the table is full.
+ */
+static int shim_map_find(struct shim_map *m, const void *key, int *free)
+{
+	__u32 size = m->def->size_key;
+	__u32 mask = m->nr_slots - 1;
+	__u32 slot = shim_hash(key, size) & mask;
+	__u32 i;
+
+	*free = -1;
+	for (i = 0; i < m->nr_slots; i++, slot = (slot + 1) & mask) {
+		switch (m->state[slot]) {
+		case SHIM_SLOT_EMPTY:
+			if (*free < 0)
+				*free = slot;
+			return -1;
+		case SHIM_SLOT_DELETED:
+			if (*free < 0)
+				*free = slot;
+			break;
+		case SHIM_SLOT_USED:
+			if (!memcmp(m->keys + slot * size, key, size))
+				return slot;
+			break;
+		}
+	}
+
+	return -1;
+}
+
+static void *shim_map_lookup_elem(void *map, const void *key)
+{
+	struct shim_map *m = shim_map_get(map);
+	int slot, free;
+
+	if (shim_map_is_array(m->def)) {
+		__u32 index = *(const __u32 *) key;
+
+		if (index >= m->max_elem || m->def->type == BPF_MAP_TYPE_PROG_ARRAY)
+			return NULL;
+		return m->values + index * m->def->size_value;
+	}
+
+	slot = shim_map_find(m, key, &free);
+	if (slot < 0)
+		return NULL;
+
+	return m->values + slot * m->def->size_value;
+}
+
+static int shim_map_update_elem(void *map, const void *key, const void *value,
+				uint32_t flags)
+{
+	struct shim_map *m = shim_map_get(map);
+	__u32 size_key = m->def->size_key;
+	__u32 size_value = m->def->size_value;
+	int slot, free;
+
+	if (shim_map_is_array(m->def)) {
+		__u32 index = *(const __u32 *) key;
+
+		if (index >= m->max_elem)
+			return -E2BIG;
+		if (flags == BPF_NOEXIST)
+			return -EEXIST;
+		memcpy(m->values + index * size_value, value, size_value);
+		return 0;
+	}
+
+	slot = shim_map_find(m, key, &free);
+	if (slot >= 0) {
+		if (flags == BPF_NOEXIST)
+			return -EEXIST;
+	} else {
+		if (flags == BPF_EXIST)
+			return -ENOENT;
+		if (m->nr_used >= m->max_elem || free < 0) {
+			if (m->def->type != BPF_MAP_TYPE_LRU_HASH)
+				return -E2BIG;
+			/* Evict the home slot of the key */
+			slot = shim_hash(key, size_key) & (m->nr_slots - 1);
+			while (m->state[slot] != SHIM_SLOT_USED)
+				slot = (slot + 1) & (m->nr_slots - 1);
+		} else {
+			slot = free;
+			m->state[slot] = SHIM_SLOT_USED;
+			m->nr_used++;
+		}
+		memcpy(m->keys + slot * size_key, key, size_key);
+	}
+	memcpy(m->values + slot * size_value, value, size_value);
+
+	return 0;
+}
+
+static int shim_map_delete_elem(void *map, const void *key)
+{
+	struct shim_map *m = shim_map_get(map);
+	int slot, free;
+
+	if (shim_map_is_array(m->def))
+		return -EINVAL;
+
+	slot = shim_map_find(m, key, &free);
+	if (slot < 0)
+		return -ENOENT;
+
+	m->state[slot] = SHIM_SLOT_DELETED;
+	m->nr_used--;
+
+	return 0;
+}
+
+static struct shim_skb *shim_skb_of(struct __sk_buff *skb)
+{
+	return (struct shim_skb *) skb;
+}
+
+static int shim_skb_load_bytes(struct __sk_buff *skb, uint32_t off, void *to,
+			       uint32_t len)
+{
+	if ((__u64) off + len > skb->len)
+		return -EFAULT;
+	memcpy(to, shim_skb_of(skb)->buf + off, len);
+	return 0;
+}
+
+static int shim_skb_store_bytes(struct __sk_buff *skb, uint32_t off,
+				const void *from, uint32_t len, uint32_t flags)
+{
+	if ((__u64) off + len > skb->len)
+		return -EFAULT;
+	memcpy(shim_skb_of(skb)->buf + off, from, len);
+	return 0;
+}
+
+static __u32 shim_csum_add(__u32 csum, __u32 addend)
+{
+	csum += addend;
+	return csum + (csum < addend);
+}
+
+static __u16 shim_csum_fold(__u32 csum)
+{
+	csum = (csum & 0xffff) + (csum >> 16);
+	csum = (csum & 0xffff) + (csum >> 16);
+	return (__u16) ~csum;
+}
+
+/* Updates the checksum at @off as csum_replace{2,4}() and
+ * csum_replace_by_diff() in the kernel
+ */
+static int shim_csum_replace(struct __sk_buff *skb, uint32_t off,
+			     uint32_t from, uint32_t to, uint32_t flags)
+{
+	__u16 csum;
+	__u32 sum;
+
+	if ((__u64) off + sizeof(csum) > skb->len)
+		return -EFAULT;
+	memcpy(&csum, shim_skb_of(skb)->buf + off, sizeof(csum));
+
+	if ((flags & BPF_F_MARK_MANGLED_0) && !csum)
+		return 0;
+
+	sum = (__u16) ~csum;
+	switch (flags & BPF_F_HDR_FIELD_MASK) {
+	case 0:
+		sum = shim_csum_add(sum, to);
+		break;
+	case 2:
+		sum = shim_csum_add(sum, (__u16) ~from);
+		sum = shim_csum_add(sum, (__u16) to);
+		break;
+	case 4:
+		sum = shim_csum_add(sum, ~from);
+		sum = shim_csum_add(sum, to);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	csum = shim_csum_fold(sum);
+	if ((flags & BPF_F_MARK_MANGLED_0) && !csum)
+		csum = 0xffff;
+	memcpy(shim_skb_of(skb)->buf + off, &csum, sizeof(csum));
+
+	return 0;
+}
+
+static int shim_l3_csum_replace(struct __sk_buff *skb, uint32_t off,
+				uint32_t from, uint32_t to, uint32_t flags)
+{
+	return shim_csum_replace(skb, off, from, to, flags);
+}
+
+static int shim_l4_csum_replace(struct __sk_buff *skb, uint32_t off,
+				uint32_t from, uint32_t to, uint32_t flags)
+{
+	return shim_csum_replace(skb, off, from, to, flags);
+}
+
+static int shim_csum_diff(void *from, uint32_t from_size, void *to,
+			  uint32_t to_size, uint32_t seed)
+{
+	__u32 *f = from, *t = to;
+	__u32 sum = seed;
+	__u32 i;
+
+	if (from_size % 4 || to_size % 4)
+		return -EINVAL;
+
+	for (i = 0; i < from_size / 4; i++)
+		sum = shim_csum_add(sum, ~f[i]);
+	for (i = 0; i < to_size / 4; i++)
+		sum = shim_csum_add(sum, t[i]);
+
+	return sum;
+}
+
+static uint64_t shim_ktime_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/* Deterministic, so that fuzzer inputs reproduce */
+static uint32_t shim_get_prandom_u32(void)
+{
+	shim_prandom_state ^= shim_prandom_state << 13;
+	shim_prandom_state ^= shim_prandom_state >> 17;
+	shim_prandom_state ^= shim_prandom_state << 5;
+	return shim_prandom_state;
+}
+
+static uint32_t shim_get_smp_processor_id(void)
+{
+	return 0;
+}
+
+static uint32_t shim_get_hash_recalc(struct __sk_buff *skb)
+{
+	return shim_hash(shim_skb_of(skb)->buf, skb->len);
+}
+
+static uint32_t shim_set_hash_invalid(struct __sk_buff *skb)
+{
+	return 0;
+}
+
+static void shim_tail_call(struct __sk_buff *skb, void *map, uint32_t index)
+{
+}
+
+static int shim_redirect(int ifindex, uint32_t flags)
+{
+	return TC_ACT_REDIRECT;
+}
+
+static int shim_skb_change_tail(struct __sk_buff *skb, uint32_t nlen,
+				uint32_t flags)
+{
+	if (nlen > SHIM_SKB_SIZE)
+		return -EINVAL;
+	if (nlen > skb->len)
+		memset(shim_skb_of(skb)->buf + skb->len, 0, nlen - skb->len);
+	skb->len = nlen;
+	skb->data_end = skb->data + nlen;
+	return 0;
+}
+
+static int shim_skb_event_output(struct __sk_buff *skb, void *map,
+				 uint64_t index, const void *data, uint32_t size)
+{
+	return 0;
+}
+
+static void shim_trace_printk(const char *fmt, int fmt_size, ...)
+{
+}
+
+/**
+ * shim_skb_init
+ * @s:		skb to initialize
+ * @data:	packet starting with the Ethernet header
+ * @len:	length of the packet, at most SHIM_SKB_SIZE
+ *
+ * Returns 0 on success or -1 if the packet is too large.
+ */
+static int shim_skb_init(struct shim_skb *s, const void *data, __u32 len)
+{
+	if (len > SHIM_SKB_SIZE)
+		return -1;
+
+	if (!s->buf) {
+#ifdef MAP_32BIT
+		s->buf = mmap(NULL, SHIM_SKB_SIZE, PROT_READ | PROT_WRITE,
+			      MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+		if (s->buf == MAP_FAILED)
+			s->buf = NULL;
+#endif
+		if (!s->buf)
+			s->buf = malloc(SHIM_SKB_SIZE);
+		if (!s->buf) {
+			fprintf(stderr, "shim: unable to allocate skb\n");
+			abort();
+		}
+	}
+
+	memset(&s->skb, 0, sizeof(s->skb));
+	memcpy(s->buf, data, len);
+	s->skb.len = len;
+	if (len >= ETH_HLEN)
+		memcpy(&s->skb.protocol, s->buf + 2 * ETH_ALEN, sizeof(__be16));
+
+	/* Without a buffer below 4GB, direct packet access sees an empty
+	 * packet and fails its bounds checks.
+	 */
+	if ((uintptr_t) s->buf + SHIM_SKB_SIZE <= UINT32_MAX) {
+		s->skb.data = (__u32) (uintptr_t) s->buf;
+		s->skb.data_end = s->skb.data + len;
+	}
+
+	return 0;
+}
+
+static void shim_reset(void)
+{
+	int i;
+
+	for (i = 0; i < SHIM_MAX_MAPS && shim_maps[i].def; i++) {
+		struct shim_map *m = &shim_maps[i];
+
+		memset(m->state, 0, m->nr_slots);
+		if (shim_map_is_array(m->def))
+			memset(m->values, 0,
+			       (size_t) m->nr_slots * m->def->size_value);
+		m->nr_used = 0;
+	}
+	shim_prandom_state = 0x12345678;
+}
+
+static void shim_init(void)
+{
+	map_lookup_elem = shim_map_lookup_elem;
+	map_update_elem = shim_map_update_elem;
+	map_delete_elem = shim_map_delete_elem;
+	ktime_get_ns = shim_ktime_get_ns;
+	trace_printk = shim_trace_printk;
+	get_prandom_u32 = shim_get_prandom_u32;
+	tail_call = shim_tail_call;
+	get_smp_processor_id = shim_get_smp_processor_id;
+	get_hash_recalc = shim_get_hash_recalc;
+	set_hash_invalid = shim_set_hash_invalid;
+	redirect = shim_redirect;
+	skb_load_bytes = shim_skb_load_bytes;
+	skb_store_bytes = shim_skb_store_bytes;
+	l3_csum_replace = shim_l3_csum_replace;
+	l4_csum_replace = shim_l4_csum_replace;
+	csum_diff = shim_csum_diff;
+	skb_change_tail = shim_skb_change_tail;
+	skb_event_output = shim_skb_event_output;
+}
+
+#endif /* __BPF_SHIM__ */
@@ -14,35 +14,86 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+# Loads every program in each option combination that is compile tested by
+# bpf/Makefile and checks the instructions processed by the verifier for
+# each section against the budgets in complexity-budgets.json. Sections
+# without a budget are checked against the complexity limit of kernels
+# before 5.2. A missing or empty budget file fails the check. The budgets
+# are measured by running with --update on a test kernel, and the resulting
+# file is checked in.
+#
+# Usage: check-complexity.sh [-o json] [--update]
+#
+# With -o json, the instructions processed, total states and peak states
+# of each section are printed as JSON. With --update, the budgets are
+# rewritten from the current complexity plus headroom.
+
 set -eo pipefail
 
 TESTDIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null && pwd )"
 BPFDIR="$TESTDIR/../../bpf/"
+DEV="cilium-complexity"
+WORK_DIR=$(mktemp -d)
+
+CLANG=${CLANG:-clang}
+LLC=${LLC:-llc}
+CLANG_FLAGS="-I${BPFDIR}/include -I${BPFDIR} -D__NR_CPUS__=$(nproc) -O2 -target bpf -emit-llvm"
+CLANG_FLAGS+=" -Wall -Werror -Wno-address-of-packed-member -Wno-unknown-warning-option"
+LLC_FLAGS="-march=bpf -mcpu=probe -filetype=obj"
+
+function clean_maps {
+	rm -rf /sys/fs/bpf/tc/globals/*
+}
+
+function cleanup {
+	ip link del ${DEV} 2>/dev/null || true
+	clean_maps
+	rm -rf ${WORK_DIR}
+}
 
-function get_insn_cnt {
-	grep -e "^Prog" -e processed -e "Proccessed" -e "^=>" -e "over limit"
+function get_section {
+	grep "__section(" $1 | sed 's/__sec[^\"]*\"\([0-9A-Za-z_-]*\).*/\1/'
 }
 
-# These are derived from bpf/lib/common.h CILIUM_CALL_*.
-function annotate_section_names {
-	sed -e "s/\(section \)'\(1\)\/\([0-9x]*\)'/\1'\2\/\3' (lxc ingress program for EP \3)/" \
-	    -e "s/\(section '2\/1'\)/\1 (tail_call DROP_NOTIFY)/" \
-	    -e "s/\(section '2\/2'\)/\1 (tail_call ERROR_NOTIFY)/" \
-	    -e "s/\(section '2\/3'\)/\1 (tail_call SEND_ICMP6_ECHO_REPLY)/" \
-	    -e "s/\(section '2\/4'\)/\1 (tail_call HANDLE_ICMP6_NS)/" \
-	    -e "s/\(section '2\/5'\)/\1 (tail_call SEND_ICMP6_TIME_EXCEEDED)/" \
-	    -e "s/\(section '2\/6'\)/\1 (tail_call ARP)/" \
-	    -e "s/\(section '2\/7'\)/\1 (tail_call IPV4_FROM_LXC)/" \
-	    -e "s/\(section '2\/8'\)/\1 (tail_call NAT64)/" \
-	    -e "s/\(section '2\/9'\)/\1 (tail_call NAT46)/" \
-	    -e "s/\(section '2\/10'\)/\1 (tail_call IPV6_FROM_LXC)/" \
-	    -e "s/\(section '2\/11'\)/\1 (tail_call IPV4_TO_LXC)/" \
-	    -e "s/\(section '2\/12'\)/\1 (tail_call IPV6_TO_LXC)/"
+# load_object builds the program with the options and prints the verifier
+# logs of all of its sections
+function load_object {
+	prog=$1
+	opts=$2
+
+	echo "=> Object ${prog} options: ${opts}"
+	${CLANG} ${CLANG_FLAGS} ${opts} -c ${BPFDIR}/${prog}.c -o - | \
+		${LLC} ${LLC_FLAGS} -o ${WORK_DIR}/${prog}.o
+
+	for section in $(get_section ${BPFDIR}/${prog}.c); do
+		if [ "$prog" == "bpf_xdp" ]; then
+			ip link set dev ${DEV} xdpgeneric off 2>/dev/null || true
+			ip link set dev ${DEV} xdpgeneric obj ${WORK_DIR}/${prog}.o \
+				sec ${section} verbose 2>&1 || true
+		else
+			tc filter replace dev ${DEV} ingress bpf da \
+				obj ${WORK_DIR}/${prog}.o sec ${section} verbose 2>&1 || true
+		fi
+		clean_maps
+	done
 }
 
-if ! grep -q "CILIUM_CALL_SIZE.*13" "$BPFDIR/lib/common.h" ; then
-	echo "This script is out of date compared to CILIUM_CALL_SIZE." 1>&2
+if [ $(id -u) -ne 0 ]; then
+	echo "Must be run as root" 1>&2
 	exit 1
 fi
 
-"$TESTDIR/verifier-test.sh" -v | get_insn_cnt | annotate_section_names
+if ps cax | grep cilium-agent; then
+	echo "WARNING: This test will conflict with running cilium instances." 1>&2
+	echo "Shut down cilium before continuing." 1>&2
+	exit 1
+fi
+
+trap cleanup EXIT
+ip link add ${DEV} type dummy
+tc qdisc replace dev ${DEV} clsact
+
+make -s -C ${BPFDIR} print-options | sort -u | while read prog opts; do
+	load_object ${prog} "${opts//:/ }"
+done | "$TESTDIR/verifier-complexity" --budgets "$TESTDIR/complexity-budgets.json" \
+	--common-header "$BPFDIR/lib/common.h" "$@"
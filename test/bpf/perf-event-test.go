@@ -17,6 +17,7 @@ package main
 import (
 	"fmt"
 	"os"
+	"time"
 
 	"github.com/cilium/cilium/pkg/bpf"
 
@@ -31,14 +32,42 @@ var (
 		SampleType:   bpf.PERF_SAMPLE_RAW,
 		WakeupEvents: 1,
 	}
+
+	// ringBuf selects the shared ring buffer built into
+	// bpf-event-test-ringbuf.o instead of per-CPU perf buffers
+	ringBuf bool
+
+	// duration enables benchmark mode: events are counted instead of
+	// printed and a summary is printed after the given duration
+	duration time.Duration
+
+	received, receivedBytes, lost uint64
 )
 
 func receiveEvent(msg *bpf.PerfEventSample, cpu int) {
+	if duration > 0 {
+		received++
+		receivedBytes += uint64(msg.Size)
+		return
+	}
 	fmt.Printf("%+v\n", msg)
 }
 
-func lostEvent(lost *bpf.PerfEventLost, cpu int) {
-	fmt.Printf("Lost %d\n", lost.Lost)
+func receiveRingEvent(data []byte, cpu int) {
+	if duration > 0 {
+		received++
+		receivedBytes += uint64(len(data))
+		return
+	}
+	fmt.Printf("cpu %d: %v\n", cpu, data)
+}
+
+func lostEvent(msg *bpf.PerfEventLost, cpu int) {
+	if duration > 0 {
+		lost += msg.Lost
+		return
+	}
+	fmt.Printf("Lost %d\n", msg.Lost)
 }
 
 func errEvent(err *bpf.PerfEvent) {
@@ -49,22 +78,80 @@ var RootCmd = &cobra.Command{
 	Use:   "perf-event-test",
 	Short: "Test utility for perf events",
 	Run: func(cmd *cobra.Command, args []string) {
-		events, err := bpf.NewPerCpuEvents(&config)
+		if ringBuf {
+			runRingBuf()
+		} else {
+			runPerf()
+		}
+	},
+}
+
+// expired returns true once the benchmark duration has passed
+func expired(start time.Time) bool {
+	return duration > 0 && time.Since(start) >= duration
+}
+
+// pollTimeout is the poll timeout in milliseconds, bounded in benchmark
+// mode so that the summary is printed even without traffic
+func pollTimeout() int {
+	if duration > 0 {
+		return 100
+	}
+	return -1
+}
+
+func printSummary(transport string, elapsed time.Duration) {
+	secs := elapsed.Seconds()
+	fmt.Printf("transport=%s duration=%.3fs events=%d bytes=%d lost=%d events/s=%.0f MB/s=%.2f\n",
+		transport, secs, received, receivedBytes, lost,
+		float64(received)/secs, float64(receivedBytes)/secs/1e6)
+}
+
+func runPerf() {
+	events, err := bpf.NewPerCpuEvents(&config)
+	if err != nil {
+		panic(err)
+	}
+
+	start := time.Now()
+	for !expired(start) {
+		todo, err := events.Poll(pollTimeout())
 		if err != nil {
 			panic(err)
 		}
+		if todo > 0 {
+			events.ReadAll(receiveEvent, lostEvent, errEvent)
+		}
+	}
+
+	printSummary("perf", time.Since(start))
+}
+
+func runRingBuf() {
+	events, err := bpf.NewRingBufEvents("ringbuf_test_events", "ringbuf_test_lost")
+	if err != nil {
+		panic(err)
+	}
+	defer events.Close()
 
-		for {
-			todo, err := events.Poll(-1)
-			if err != nil {
-				panic(err)
-			}
-			if todo > 0 {
-				events.ReadAll(receiveEvent, lostEvent, errEvent)
-			}
+	start := time.Now()
+	for !expired(start) {
+		if _, err := events.Poll(pollTimeout()); err != nil {
+			panic(err)
 		}
+		events.ReadAll(receiveRingEvent)
 
-	},
+		n, err := events.LostEvents()
+		if err != nil {
+			panic(err)
+		}
+		if n > 0 && duration == 0 {
+			fmt.Printf("Lost %d\n", n)
+		}
+		lost += n
+	}
+
+	printSummary("ringbuf", time.Since(start))
 }
 
 func main() {
@@ -78,4 +165,6 @@ func init() {
 	flags := RootCmd.PersistentFlags()
 	flags.IntVarP(&config.NumCpus, "num-cpus", "c", 1, "Number of CPUs")
 	flags.IntVarP(&config.NumPages, "num-pagse", "n", 8, "Number of pages for ring buffer")
+	flags.BoolVarP(&ringBuf, "ringbuf", "r", false, "Read events from the shared BPF ring buffer")
+	flags.DurationVarP(&duration, "duration", "d", 0, "Count events for the given duration and print a throughput summary")
 }
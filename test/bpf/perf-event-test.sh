@@ -9,6 +9,8 @@ TESTDEV2=${TESTDEV}_peer
 ADDR1="10.254.254.253"
 ADDR2="10.254.254.254"
 
+BENCH_SECS=${BENCH_SECS:-10}
+
 function cleanup
 {
 	ip addr del $ADDR1/24 dev $TESTDEV1 2> /dev/null || true
@@ -36,16 +38,32 @@ function setup
 function main
 {
 	if [ $# -lt 1 ]; then
-		echo "usage: $0 <bpf-object-file>"
+		echo "usage: $0 <bpf-object-file> [bench]"
+		echo ""
+		echo "Objects built with EVENT_RINGBUF (bpf-event-test-ringbuf.o)"
+		echo "are read from the shared ring buffer. In bench mode, the"
+		echo "peer is flooded for $BENCH_SECS seconds and a throughput"
+		echo "summary is printed instead of the individual events."
 		exit 1
 	fi
 
+	OPTS=""
+	case "$1" in
+	*ringbuf*) OPTS="--ringbuf";;
+	esac
+
 	cleanup
 	trap cleanup EXIT
-	setup "$@"
+	setup "$1"
 
-	ping -c 10 $ADDR2&
-	timeout 10 ./perf-event-test || true
+	if [ "$2" == "bench" ]; then
+		timeout $((BENCH_SECS + 1)) ping -f -q $ADDR2 > /dev/null &
+		./perf-event-test $OPTS -c $(nproc) --duration ${BENCH_SECS}s
+		wait || true
+	else
+		ping -c 10 $ADDR2&
+		timeout 10 ./perf-event-test $OPTS || true
+	fi
 }
 
 main "$@"
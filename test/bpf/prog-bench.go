@@ -0,0 +1,604 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// prog-bench runs packet corpora through the datapath programs loaded by
+// prog-bench.sh with BPF_PROG_TEST_RUN and reports the run time per packet
+// of each scenario.
+package main
+
+import (
+	"encoding/binary"
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"net"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"unsafe"
+
+	"github.com/cilium/cilium/pkg/bpf"
+	"github.com/cilium/cilium/pkg/byteorder"
+	"github.com/cilium/cilium/pkg/maps/ipcache"
+	"github.com/cilium/cilium/pkg/maps/lbmap"
+	"github.com/cilium/cilium/pkg/maps/policymap"
+	"github.com/cilium/cilium/pkg/policy/trafficdirection"
+	"github.com/cilium/cilium/pkg/u8proto"
+
+	"github.com/google/gopacket"
+	"github.com/google/gopacket/layers"
+	"github.com/spf13/cobra"
+)
+
+// Addresses and identities of the benchmark setup. The generated configs
+// place the endpoint in nodeCIDR, the maps are populated with a remote pod
+// behind a tunnel endpoint which also backs the service.
+var (
+	nodeCIDR   = &net.IPNet{IP: net.ParseIP("10.15.0.0").To4(), Mask: net.CIDRMask(16, 32)}
+	gatewayIP  = net.ParseIP("10.15.255.255").To4()
+	loopbackIP = net.ParseIP("10.15.255.1").To4()
+	endpointIP = net.ParseIP("10.15.0.10").To4()
+	remoteIP   = net.ParseIP("10.16.0.20").To4()
+	tunnelIP   = net.ParseIP("192.168.1.2").To4()
+	worldIP    = net.ParseIP("192.168.1.100").To4()
+	deniedCIDR = &net.IPNet{IP: net.ParseIP("192.168.100.0").To4(), Mask: net.CIDRMask(24, 32)}
+	serviceIP  = net.ParseIP("172.20.0.10").To4()
+
+	endpointIP6 = net.ParseIP("f00d::a0f:0:0:a")
+	remoteIP6   = net.ParseIP("f00d::a10:0:0:14")
+
+	endpointMAC = net.HardwareAddr{0x0a, 0x00, 0x00, 0x00, 0x00, 0x01}
+	nodeMAC     = net.HardwareAddr{0xde, 0xad, 0xbe, 0xef, 0xc0, 0xde}
+)
+
+const (
+	endpointIdentity = 1000
+	remoteIdentity   = 2000
+
+	allowedPort = 80
+	deniedPort  = 81
+	backendPort = 8080
+	proxiedPort = 8081
+	proxyPort   = 15001
+	servicePort = 80
+	serviceID   = 1
+
+	// Offset of non-first fragments in units of 8 bytes
+	fragmentOffset = 16
+
+	// Map names of the test configs in bpf/
+	ipcacheMapName  = "test_cilium_ipcache"
+	policyMapName   = "cilium_policy_foo"
+	lb4ServicesName = "test_cilium_lb4_services"
+	lb4RevNatName   = "test_cilium_lb4_reverse_nat"
+	prefilterName   = "v4_dyn"
+)
+
+var (
+	objectName string
+	progID     uint32
+	repeat     uint32
+	flows      int
+	payloadLen int
+	output     string
+)
+
+// scenario is a packet corpus run through a program. The packets of a new
+// flow scenario are each run once so that every run creates its flow. The
+// packet of other scenarios is run once to set up its flow and then
+// repeatedly for the measurement. A scenario fails if the program does not
+// return retval, e.g. because the maps were not populated as expected.
+type scenario struct {
+	name     string
+	newFlows bool
+	retval   uint32
+	packet   func(i int) []byte
+}
+
+// result is the machine readable result of a scenario, one JSON object per
+// line is printed for regression tracking.
+type result struct {
+	Object      string  `json:"object"`
+	Scenario    string  `json:"scenario"`
+	Runs        uint64  `json:"runs"`
+	NsPerPacket float64 `json:"ns_per_packet"`
+	Retval      uint32  `json:"retval"`
+	Verdict     string  `json:"verdict"`
+}
+
+// scenarios lists the scenarios of each object. Scenarios which do not apply
+// to a program, e.g. conntrack in bpf_netdev or anything but the missing
+// tunnel key in bpf_overlay, are left out.
+var scenarios = map[string][]scenario{
+	"bpf_lxc": {
+		{"new-flow", true, tcOK, func(i int) []byte {
+			return tcpPacket(endpointIP, remoteIP, uint16(10000+i), allowedPort, true)
+		}},
+		{"established", false, tcOK, func(i int) []byte {
+			return tcpPacket(endpointIP, remoteIP, 40000, allowedPort, false)
+		}},
+		{"service", false, tcOK, func(i int) []byte {
+			return tcpPacket(endpointIP, serviceIP, 40001, servicePort, false)
+		}},
+		{"drop", false, tcShot, func(i int) []byte {
+			return tcpPacket(endpointIP, remoteIP, 40002, deniedPort, false)
+		}},
+		{"proxy-redirect", false, tcRedirect, func(i int) []byte {
+			return tcpPacket(endpointIP, remoteIP, 40003, proxiedPort, false)
+		}},
+		// Fragment trains, the first fragment must run before the
+		// following fragments of its datagram.
+		{"frag6-first", false, tcOK, func(i int) []byte {
+			return fragment6Packet(1, 40004, true, false)
+		}},
+		{"frag6-next", false, tcOK, func(i int) []byte {
+			return fragment6Packet(1, 40004, false, false)
+		}},
+		{"frag6-opt-first", false, tcOK, func(i int) []byte {
+			return fragment6Packet(2, 40005, true, true)
+		}},
+		{"frag6-opt-next", false, tcOK, func(i int) []byte {
+			return fragment6Packet(2, 40005, false, true)
+		}},
+	},
+	"bpf_netdev": {
+		{"new-flow", true, tcOK, func(i int) []byte {
+			return tcpPacket(remoteIP, worldIP, uint16(10000+i), allowedPort, true)
+		}},
+		{"drop", false, tcShot, truncatedPacket},
+	},
+	"bpf_overlay": {
+		{"drop", false, tcShot, func(i int) []byte {
+			return tcpPacket(remoteIP, endpointIP, 40000, allowedPort, false)
+		}},
+	},
+	"bpf_lb": {
+		{"new-flow", true, tcOK, func(i int) []byte {
+			return tcpPacket(worldIP, remoteIP, uint16(10000+i), allowedPort, true)
+		}},
+		{"service", false, tcRedirect, func(i int) []byte {
+			return tcpPacket(worldIP, serviceIP, 40000, servicePort, false)
+		}},
+		{"drop", false, tcShot, truncatedPacket},
+	},
+	"bpf_xdp": {
+		{"new-flow", true, xdpPass, func(i int) []byte {
+			return tcpPacket(worldIP, endpointIP, uint16(10000+i), allowedPort, true)
+		}},
+		{"drop", false, xdpDrop, func(i int) []byte {
+			src := net.IPv4(192, 168, 100, 1).To4()
+			return tcpPacket(src, endpointIP, 40000, allowedPort, false)
+		}},
+	},
+}
+
+// tcpPacket returns an Ethernet frame of a TCP segment, a SYN if syn is true
+// or else an ACK.
+func tcpPacket(src, dst net.IP, sport, dport uint16, syn bool) []byte {
+	eth := &layers.Ethernet{
+		SrcMAC:       endpointMAC,
+		DstMAC:       nodeMAC,
+		EthernetType: layers.EthernetTypeIPv4,
+	}
+	ip := &layers.IPv4{
+		Version:  4,
+		TTL:      64,
+		Protocol: layers.IPProtocolTCP,
+		SrcIP:    src,
+		DstIP:    dst,
+	}
+	tcp := &layers.TCP{
+		SrcPort: layers.TCPPort(sport),
+		DstPort: layers.TCPPort(dport),
+		SYN:     syn,
+		ACK:     !syn,
+		Seq:     1,
+		Window:  65535,
+	}
+	tcp.SetNetworkLayerForChecksum(ip)
+
+	buf := gopacket.NewSerializeBuffer()
+	opts := gopacket.SerializeOptions{FixLengths: true, ComputeChecksums: true}
+	if err := gopacket.SerializeLayers(buf, opts, eth, ip, tcp,
+		gopacket.Payload(make([]byte, payloadLen))); err != nil {
+		Fatalf("Unable to build packet: %s", err)
+	}
+
+	return buf.Bytes()
+}
+
+// fragment6Packet returns an Ethernet frame of a fragment of an IPv6 TCP
+// datagram from the endpoint to the remote pod. The first fragment carries
+// the TCP header, the following fragment only payload. If destOpts is true,
+// a destination options header precedes the TCP header in the fragmentable
+// part, so that only the first fragment carries the upper layer protocol.
+func fragment6Packet(id uint32, sport uint16, first, destOpts bool) []byte {
+	eth := &layers.Ethernet{
+		SrcMAC:       endpointMAC,
+		DstMAC:       nodeMAC,
+		EthernetType: layers.EthernetTypeIPv6,
+	}
+	ip := &layers.IPv6{
+		Version:    6,
+		HopLimit:   64,
+		NextHeader: layers.IPProtocolIPv6Fragment,
+		SrcIP:      endpointIP6,
+		DstIP:      remoteIP6,
+	}
+
+	// See struct ipv6_frag_hdr in <bpf/lib/ipv6.h>
+	frag := make([]byte, 8)
+	frag[0] = byte(layers.IPProtocolTCP)
+	if destOpts {
+		frag[0] = byte(layers.IPProtocolIPv6Destination)
+	}
+	if first {
+		binary.BigEndian.PutUint16(frag[2:], 1)
+	} else {
+		binary.BigEndian.PutUint16(frag[2:], fragmentOffset<<3)
+	}
+	binary.BigEndian.PutUint32(frag[4:], id)
+
+	var data []byte
+	if first {
+		if destOpts {
+			// Next header TCP, padded to 8 bytes with a PadN option
+			data = append(data, byte(layers.IPProtocolTCP), 0, 1, 4, 0, 0, 0, 0)
+		}
+		tcp := &layers.TCP{
+			SrcPort: layers.TCPPort(sport),
+			DstPort: layers.TCPPort(allowedPort),
+			SYN:     true,
+			Seq:     1,
+			Window:  65535,
+		}
+		buf := gopacket.NewSerializeBuffer()
+		if err := gopacket.SerializeLayers(buf, gopacket.SerializeOptions{FixLengths: true},
+			tcp); err != nil {
+			Fatalf("Unable to build packet: %s", err)
+		}
+		data = append(data, buf.Bytes()...)
+	}
+	data = append(data, make([]byte, payloadLen)...)
+
+	buf := gopacket.NewSerializeBuffer()
+	opts := gopacket.SerializeOptions{FixLengths: true}
+	if err := gopacket.SerializeLayers(buf, opts, eth, ip,
+		gopacket.Payload(append(frag, data...))); err != nil {
+		Fatalf("Unable to build packet: %s", err)
+	}
+
+	return buf.Bytes()
+}
+
+// truncatedPacket returns an Ethernet frame with a truncated IPv4 header
+func truncatedPacket(i int) []byte {
+	pkt := tcpPacket(worldIP, endpointIP, 40000, allowedPort, false)
+	return pkt[:14+10]
+}
+
+// Fatalf prints the error message and exits
+func Fatalf(msg string, args ...interface{}) {
+	fmt.Fprintf(os.Stderr, "Error: "+msg+"\n", args...)
+	os.Exit(1)
+}
+
+func hostToNetwork(ip []byte) uint32 {
+	return byteorder.HostSliceToNetwork(ip, reflect.Uint32).(uint32)
+}
+
+// ipv6Bytes returns the IPv6 address in the format of LXC_IP
+func ipv6Bytes(ip net.IP) string {
+	b := make([]string, 0, net.IPv6len)
+	for _, v := range ip.To16() {
+		b = append(b, fmt.Sprintf("%#x", v))
+	}
+	return strings.Join(b, ", ")
+}
+
+// writeConfig writes config headers to dir which override the addresses of
+// the test configs in bpf/. They must be found before bpf/ in the include
+// path.
+func writeConfig(dir string) error {
+	node := fmt.Sprintf(`#include_next <node_config.h>
+
+#undef IPV4_GATEWAY
+#undef IPV4_LOOPBACK
+#undef IPV4_MASK
+#define IPV4_GATEWAY %#x
+#define IPV4_LOOPBACK %#x
+#define IPV4_MASK %#x
+`, hostToNetwork(gatewayIP), hostToNetwork(loopbackIP), hostToNetwork(nodeCIDR.Mask))
+
+	lxc := fmt.Sprintf(`#include_next <lxc_config.h>
+
+#undef LXC_IP
+#undef LXC_IPV4
+#undef SECLABEL
+#undef SECLABEL_NB
+#define LXC_IP %s
+#define LXC_IPV4 %#x
+#define SECLABEL %d
+#define SECLABEL_NB %#x
+`, ipv6Bytes(endpointIP6), hostToNetwork(endpointIP), endpointIdentity,
+		byteorder.HostToNetwork(uint32(endpointIdentity)).(uint32))
+
+	for name, content := range map[string]string{
+		"node_config.h": node,
+		"lxc_config.h":  lxc,
+	} {
+		header := "/* Generated by prog-bench, do not edit */\n" + content
+		if err := ioutil.WriteFile(filepath.Join(dir, name), []byte(header), 0644); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// mapUpdate updates an element of the pinned map with the given name if the
+// loaded program uses it.
+func mapUpdate(name string, key, value unsafe.Pointer) error {
+	path := bpf.MapPath(name)
+	if _, err := os.Stat(path); os.IsNotExist(err) {
+		return nil
+	}
+
+	fd, err := bpf.ObjGet(path)
+	if err != nil {
+		return err
+	}
+	defer bpf.ObjClose(fd)
+
+	return bpf.UpdateElement(fd, key, value, 0)
+}
+
+// populateMaps fills the maps used by the loaded program with the remote
+// pod, its policy, the service and the prefilter.
+func populateMaps() error {
+	info := ipcache.RemoteEndpointInfo{SecurityIdentity: remoteIdentity}
+	copy(info.TunnelEndpoint[:], tunnelIP)
+	for _, key := range []ipcache.Key{
+		ipcache.NewKey(remoteIP, net.CIDRMask(32, 32)),
+		ipcache.NewKey(remoteIP6, net.CIDRMask(128, 128)),
+	} {
+		if err := mapUpdate(ipcacheMapName, key.GetKeyPtr(), info.GetValuePtr()); err != nil {
+			return fmt.Errorf("unable to populate ipcache: %s", err)
+		}
+	}
+
+	if _, err := os.Stat(bpf.MapPath(policyMapName)); err == nil {
+		pm, err := policymap.Open(bpf.MapPath(policyMapName))
+		if err != nil {
+			return err
+		}
+		defer pm.Close()
+
+		for port, proxy := range map[uint16]uint16{
+			allowedPort: 0,
+			backendPort: 0,
+			proxiedPort: proxyPort,
+		} {
+			if err := pm.Allow(remoteIdentity, port, u8proto.TCP, trafficdirection.Egress, proxy); err != nil {
+				return fmt.Errorf("unable to populate policy: %s", err)
+			}
+		}
+	}
+
+	master := lbmap.NewService4Key(serviceIP, servicePort, 0).ToNetwork()
+	masterValue := lbmap.NewService4Value(1, net.IPv4zero, 0, serviceID, 0).ToNetwork()
+	slave := lbmap.NewService4Key(serviceIP, servicePort, 1).ToNetwork()
+	slaveValue := lbmap.NewService4Value(0, remoteIP, backendPort, serviceID, 0).ToNetwork()
+	revNat := lbmap.NewRevNat4Key(serviceID).ToNetwork()
+	revNatValue := lbmap.NewRevNat4Value(serviceIP, servicePort).ToNetwork()
+	for _, e := range []struct {
+		name  string
+		key   bpf.MapKey
+		value bpf.MapValue
+	}{
+		{lb4ServicesName, master, masterValue},
+		{lb4ServicesName, slave, slaveValue},
+		{lb4RevNatName, revNat, revNatValue},
+	} {
+		if err := mapUpdate(e.name, e.key.GetKeyPtr(), e.value.GetValuePtr()); err != nil {
+			return fmt.Errorf("unable to populate services: %s", err)
+		}
+	}
+
+	// Must be in sync with struct lpm_v4_key and lpm_val in <bpf/lib/xdp.h>
+	prefix := struct {
+		Prefixlen uint32
+		Addr      [4]byte
+	}{Prefixlen: 24}
+	copy(prefix.Addr[:], deniedCIDR.IP)
+	flags := uint8(0)
+	if err := mapUpdate(prefilterName, unsafe.Pointer(&prefix), unsafe.Pointer(&flags)); err != nil {
+		return fmt.Errorf("unable to populate prefilter: %s", err)
+	}
+
+	return nil
+}
+
+// Return values of tc programs, see <linux/pkt_cls.h>
+const (
+	tcOK       = 0
+	tcShot     = 2
+	tcRedirect = 7
+)
+
+// Return values of XDP programs, see enum xdp_action in <linux/bpf.h>
+const (
+	xdpAborted  = 0
+	xdpDrop     = 1
+	xdpPass     = 2
+	xdpTX       = 3
+	xdpRedirect = 4
+)
+
+// verdict returns the name of the return value of a program
+func verdict(retval uint32) string {
+	if objectName == "bpf_xdp" {
+		switch retval {
+		case xdpAborted:
+			return "aborted"
+		case xdpDrop:
+			return "drop"
+		case xdpPass:
+			return "pass"
+		case xdpTX:
+			return "tx"
+		case xdpRedirect:
+			return "redirect"
+		}
+	} else {
+		switch retval {
+		case tcOK:
+			return "ok"
+		case tcShot:
+			return "shot"
+		case tcRedirect:
+			return "redirect"
+		}
+	}
+	return "unknown"
+}
+
+// checkRetval returns an error if the program did not return the expected
+// value of the scenario.
+func checkRetval(s scenario, retval uint32) error {
+	if retval != s.retval {
+		return fmt.Errorf("program returned %s (%d), expected %s (%d)",
+			verdict(retval), retval, verdict(s.retval), s.retval)
+	}
+	return nil
+}
+
+func runScenario(fd int, s scenario) (*result, error) {
+	var (
+		total uint64
+		ret   *bpf.TestRunResult
+		err   error
+	)
+
+	r := &result{Object: objectName, Scenario: s.name}
+	if s.newFlows {
+		for i := 0; i < flows; i++ {
+			pkt := s.packet(i)
+			if ret, err = bpf.TestRunProgram(fd, pkt, 1, len(pkt)+256); err != nil {
+				return nil, err
+			}
+			if err = checkRetval(s, ret.Retval); err != nil {
+				return nil, fmt.Errorf("flow %d: %s", i, err)
+			}
+			total += uint64(ret.Duration)
+		}
+		r.Runs = uint64(flows)
+		r.NsPerPacket = float64(total) / float64(flows)
+	} else {
+		pkt := s.packet(0)
+		if _, err = bpf.TestRunProgram(fd, pkt, 1, len(pkt)+256); err != nil {
+			return nil, err
+		}
+		if ret, err = bpf.TestRunProgram(fd, pkt, repeat, len(pkt)+256); err != nil {
+			return nil, err
+		}
+		if err = checkRetval(s, ret.Retval); err != nil {
+			return nil, err
+		}
+		r.Runs = uint64(repeat)
+		r.NsPerPacket = float64(ret.Duration)
+	}
+
+	r.Retval = ret.Retval
+	r.Verdict = verdict(ret.Retval)
+
+	return r, nil
+}
+
+func run() {
+	list, ok := scenarios[objectName]
+	if !ok {
+		Fatalf("Unknown object %q", objectName)
+	}
+
+	if err := populateMaps(); err != nil {
+		Fatalf("%s", err)
+	}
+
+	fd, err := bpf.GetProgFDByID(progID)
+	if err != nil {
+		Fatalf("%s", err)
+	}
+	defer bpf.ObjClose(fd)
+
+	enc := json.NewEncoder(os.Stdout)
+	for _, s := range list {
+		r, err := runScenario(fd, s)
+		if err != nil {
+			Fatalf("Scenario %s: %s", s.name, err)
+		}
+
+		switch output {
+		case "json":
+			enc.Encode(r)
+		default:
+			fmt.Printf("%-12s %-15s %10d %12.1f %8s\n", r.Object, r.Scenario,
+				r.Runs, r.NsPerPacket, r.Verdict)
+		}
+	}
+}
+
+var rootCmd = &cobra.Command{
+	Use:   "prog-bench",
+	Short: "Benchmark datapath programs with BPF_PROG_TEST_RUN",
+}
+
+var configCmd = &cobra.Command{
+	Use:   "config <dir>",
+	Short: "Write config headers matching the packet corpora",
+	Run: func(cmd *cobra.Command, args []string) {
+		if len(args) != 1 {
+			Fatalf("Missing config directory")
+		}
+		if err := writeConfig(args[0]); err != nil {
+			Fatalf("Unable to write config: %s", err)
+		}
+	},
+}
+
+var runCmd = &cobra.Command{
+	Use:   "run",
+	Short: "Populate maps and run the scenarios of a loaded program",
+	Run: func(cmd *cobra.Command, args []string) {
+		run()
+	},
+}
+
+func init() {
+	runCmd.Flags().StringVar(&objectName, "object", "", "Name of the loaded object, e.g. bpf_lxc")
+	runCmd.Flags().Uint32Var(&progID, "prog-id", 0, "ID of the loaded program")
+	runCmd.Flags().Uint32Var(&repeat, "repeat", 1000000, "Number of runs of repeated scenarios")
+	runCmd.Flags().IntVar(&flows, "flows", 1000, "Number of flows of new flow scenarios")
+	runCmd.Flags().IntVar(&payloadLen, "payload", 64, "Length of the TCP payload")
+	runCmd.Flags().StringVarP(&output, "output", "o", "text", "Output format {text | json}")
+	rootCmd.AddCommand(configCmd, runCmd)
+}
+
+func main() {
+	if err := rootCmd.Execute(); err != nil {
+		fmt.Println(err)
+		os.Exit(1)
+	}
+}
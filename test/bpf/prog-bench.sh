@@ -0,0 +1,133 @@
+#!/bin/bash
+#
+# Copyright 2019 Authors of Cilium
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Benchmarks the datapath programs with BPF_PROG_TEST_RUN. Each object is
+# built against the test configs in bpf/ with the addresses overridden by
+# "prog-bench config", loaded on a dummy device, and its maps are populated
+# by "prog-bench run" which then runs the packet corpora of the scenarios.
+#
+# Usage: prog-bench.sh [-o json]
+#
+# With -o json, one JSON object per scenario is printed for regression
+# tracking. REPEAT and FLOWS set the number of runs of repeated and new flow
+# scenarios.
+
+set -e
+
+DEV="cilium-bench"
+DIR=$(dirname $0)
+BPF_DIR=${DIR}/../../bpf
+WORK_DIR=$(mktemp -d)
+OBJECTS="bpf_lxc:from-container bpf_netdev:from-netdev bpf_overlay:from-overlay bpf_lb:from-netdev bpf_xdp:from-netdev"
+REPEAT=${REPEAT:-1000000}
+FLOWS=${FLOWS:-1000}
+OUTPUT="text"
+
+CLANG=${CLANG:-clang}
+LLC=${LLC:-llc}
+CLANG_FLAGS="-I${WORK_DIR} -I${BPF_DIR}/include -I${BPF_DIR} -D__NR_CPUS__=$(nproc) -O2 -target bpf -emit-llvm"
+CLANG_FLAGS+=" -Wall -Werror -Wno-address-of-packed-member -Wno-unknown-warning-option"
+CLANG_FLAGS+=" -DSKIP_DEBUG -DENABLE_IPV4 -DENABLE_IPV6"
+LLC_FLAGS="-march=bpf -mcpu=probe -filetype=obj"
+
+function clean_maps {
+	rm -rf /sys/fs/bpf/tc/globals/*
+}
+
+function cleanup {
+	ip link del ${DEV} 2>/dev/null || true
+	clean_maps
+	rm -rf ${WORK_DIR}
+}
+
+function build_prog {
+	prog=$1
+	opts=""
+	case "$prog" in
+	bpf_lb) opts="-DLB_L3 -DLB_L4";;
+	bpf_lxc) opts="-DHAVE_LRU_MAP_TYPE -DENABLE_IPV4_FRAGMENTS -DENABLE_IPV6_FRAGMENTS";;
+	esac
+
+	${CLANG} ${CLANG_FLAGS} ${opts} -c ${BPF_DIR}/${prog}.c -o - | \
+		${LLC} ${LLC_FLAGS} -o ${WORK_DIR}/${prog}.o
+}
+
+# load_prog loads the section of the object and prints the program ID
+function load_prog {
+	prog=$1
+	section=$2
+
+	if [ "$prog" == "bpf_xdp" ]; then
+		ip link set dev ${DEV} xdpgeneric obj ${WORK_DIR}/${prog}.o sec ${section}
+		ip -d link show dev ${DEV} | sed -n 's/.*prog\/xdp id \([0-9]*\).*/\1/p'
+	else
+		tc qdisc replace dev ${DEV} clsact
+		tc filter replace dev ${DEV} ingress prio 1 handle 1 bpf da \
+			obj ${WORK_DIR}/${prog}.o sec ${section}
+		tc filter show dev ${DEV} ingress | sed -n 's/.* id \([0-9]*\).*/\1/p'
+	fi
+}
+
+function unload_prog {
+	ip link set dev ${DEV} xdpgeneric off 2>/dev/null || true
+	tc qdisc del dev ${DEV} clsact 2>/dev/null || true
+	clean_maps
+}
+
+if [ $(id -u) -ne 0 ]; then
+	echo "Must be run as root" 1>&2
+	exit 1
+fi
+
+if ps cax | grep cilium-agent; then
+	echo "WARNING: This test will conflict with running cilium instances." 1>&2
+	echo "Shut down cilium before continuing." 1>&2
+	exit 1
+fi
+
+if [ $# -gt 0 ]; then
+	case "$1" in
+	-o|--output)
+		OUTPUT=$2
+		;;
+	*)
+		echo "Unrecognized argument '$1'" 1>&2
+		exit 1
+		;;
+	esac
+fi
+
+trap cleanup EXIT
+ip link add ${DEV} type dummy
+ip link set ${DEV} up
+clean_maps
+
+${DIR}/prog-bench config ${WORK_DIR}
+
+if [ "$OUTPUT" == "text" ]; then
+	printf "%-12s %-15s %10s %12s %8s\n" OBJECT SCENARIO RUNS NS/PKT VERDICT
+fi
+
+for obj in ${OBJECTS}; do
+	prog=${obj%%:*}
+	section=${obj##*:}
+
+	build_prog ${prog}
+	id=$(load_prog ${prog} ${section})
+	${DIR}/prog-bench run --object ${prog} --prog-id ${id} \
+		--repeat ${REPEAT} --flows ${FLOWS} -o ${OUTPUT}
+	unload_prog
+done
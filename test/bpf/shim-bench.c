@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: GPL-2.0
+// Copyright (c) 2019 Authors of Cilium
+
+/*
+ * Microbenchmarks of datapath helpers running on the native BPF shim
+ *
+ * Measures the algorithmic cost of the helpers compiled natively, which is
+ * useful to compare changes to the datapath library without a BPF capable
+ * kernel. Absolute numbers differ from the JITed programs, use prog-bench
+ * for those.
+ *
+ * The command line and the output follow Google Benchmark:
+ *   ./shim-bench [--benchmark_filter=<regex>] [--benchmark_min_time=<s>]
+ *                [--benchmark_format=console|json]
+ */
+
+#include <regex.h>
+
+#include "bpf-shim.h"
+
+#define BENCH_SADDR	0x0100000a	/* 10.0.0.1 */
+#define BENCH_DADDR	0x0200000a	/* 10.0.0.2 */
+#define BENCH_VIP	0x0a00000a	/* 10.0.0.10 */
+#define BENCH_BACKENDS	4
+#define BENCH_IDENTITY	1000
+
+struct bench {
+	const char *name;
+	void (*setup)(void);
+	int (*run)(void);
+};
+
+struct bench_result {
+	const struct bench *bench;
+	__u64 iterations;
+	double real_time;	/* ns per iteration */
+	double cpu_time;	/* ns per iteration */
+};
+
+static struct shim_skb bench_skb;
+static volatile int bench_sink;
+
+static struct ipv4_ct_tuple bench_tuple4;
+static struct lb4_key bench_lb4_key;
+static struct lb4_service *bench_svc;
+static struct csum_offset bench_csum_off;
+static __u8 bench_nexthdr;
+static struct ipv6hdr bench_ip6;
+
+static void bench_udp4_init(__be32 daddr, __be16 dport)
+{
+	__u8 pkt[ETH_HLEN + sizeof(struct iphdr) + sizeof(struct udphdr)] = {};
+	struct iphdr *ip4 = (struct iphdr *) (pkt + ETH_HLEN);
+	struct udphdr *udp = (struct udphdr *) (ip4 + 1);
+	__be16 proto = bpf_htons(ETH_P_IP);
+
+	memcpy(pkt + 2 * ETH_ALEN, &proto, sizeof(proto));
+	ip4->version = 4;
+	ip4->ihl = 5;
+	ip4->tot_len = bpf_htons(sizeof(pkt) - ETH_HLEN);
+	ip4->ttl = 64;
+	ip4->protocol = IPPROTO_UDP;
+	ip4->saddr = BENCH_SADDR;
+	ip4->daddr = daddr;
+	udp->source = bpf_htons(40000);
+	udp->dest = dport;
+	udp->len = bpf_htons(sizeof(*udp));
+
+	shim_skb_init(&bench_skb, pkt, sizeof(pkt));
+
+	memset(&bench_tuple4, 0, sizeof(bench_tuple4));
+	bench_tuple4.nexthdr = IPPROTO_UDP;
+	bench_tuple4.saddr = BENCH_SADDR;
+	bench_tuple4.daddr = daddr;
+}
+
+/* Builds an IPv6 packet to the router with the given extension headers,
+ * each of them 8 bytes long, followed by an 8 byte ICMPv6 header.
+ */
+static void bench_ipv6_init(const __u8 *exthdrs, int nr_exthdrs, __u8 icmp_type)
+{
+	__u8 pkt[ETH_HLEN + sizeof(struct ipv6hdr) + 8 * 8 + 8] = {};
+	struct ipv6hdr *ip6 = (struct ipv6hdr *) (pkt + ETH_HLEN);
+	__u8 *l4 = (__u8 *) (ip6 + 1);
+	__be16 proto = bpf_htons(ETH_P_IPV6);
+	union v6addr router_ip;
+	int i;
+
+	memcpy(pkt + 2 * ETH_ALEN, &proto, sizeof(proto));
+	BPF_V6(router_ip, ROUTER_IP);
+	ip6->version = 6;
+	ip6->hop_limit = 64;
+	ip6->payload_len = bpf_htons(nr_exthdrs * 8 + 8);
+	ip6->nexthdr = nr_exthdrs ? exthdrs[0] : IPPROTO_ICMPV6;
+	memcpy(&ip6->daddr, &router_ip, sizeof(router_ip));
+
+	for (i = 0; i < nr_exthdrs; i++, l4 += 8)
+		l4[0] = i + 1 < nr_exthdrs ? exthdrs[i + 1] : IPPROTO_ICMPV6;
+	l4[0] = icmp_type;
+
+	shim_skb_init(&bench_skb, pkt, ETH_HLEN + sizeof(*ip6) + nr_exthdrs * 8 + 8);
+	bench_ip6 = *ip6;
+	bench_nexthdr = ip6->nexthdr;
+}
+
+static int bench_ct_lookup4(void)
+{
+	struct ipv4_ct_tuple tuple = bench_tuple4;
+	struct ct_state state = {};
+	__u32 monitor = 0;
+
+	return ct_lookup4(&shim_ct_map4, &tuple, &bench_skb.skb,
+			  ETH_HLEN + sizeof(struct iphdr), CT_EGRESS, &state,
+			  &monitor);
+}
+
+static void setup_ct_lookup4_new(void)
+{
+	bench_udp4_init(BENCH_DADDR, bpf_htons(80));
+}
+
+static void setup_ct_lookup4_established(void)
+{
+	struct ipv4_ct_tuple tuple = bench_tuple4;
+	struct ct_state state = {};
+	__u32 monitor = 0;
+
+	setup_ct_lookup4_new();
+
+	/* ct_lookup4() leaves the tuple in the order to create the entry in */
+	ct_lookup4(&shim_ct_map4, &tuple, &bench_skb.skb,
+		   ETH_HLEN + sizeof(struct iphdr), CT_EGRESS, &state, &monitor);
+	ct_create4(&shim_ct_map4, &tuple, &bench_skb.skb, CT_EGRESS, &state);
+}
+
+static void setup_lb4_local(void)
+{
+	struct lb4_service svc = {
+		.count = BENCH_BACKENDS,
+		.rev_nat_index = 1,
+	};
+	int i;
+
+	bench_udp4_init(BENCH_VIP, bpf_htons(80));
+	bench_tuple4.dport = bpf_htons(80);
+	bench_tuple4.sport = bpf_htons(40000);
+	csum_l4_offset_and_flags(IPPROTO_UDP, &bench_csum_off);
+
+	bench_lb4_key.address = BENCH_VIP;
+	bench_lb4_key.dport = bpf_htons(80);
+	map_update_elem(&LB4_SERVICES_MAP, &bench_lb4_key, &svc, 0);
+
+	/* Backends listen on the service port, so that the L4 header and with
+	 * it the conntrack entry stay the same across iterations.
+	 */
+	svc.count = 0;
+	svc.port = bpf_htons(80);
+	for (i = 1; i <= BENCH_BACKENDS; i++) {
+		svc.target = BENCH_DADDR + (i << 24);
+		bench_lb4_key.slave = i;
+		map_update_elem(&LB4_SERVICES_MAP, &bench_lb4_key, &svc, 0);
+	}
+	bench_lb4_key.slave = 0;
+	bench_svc = map_lookup_elem(&LB4_SERVICES_MAP, &bench_lb4_key);
+}
+
+static int bench_lb4_local(void)
+{
+	struct ipv4_ct_tuple tuple = bench_tuple4;
+	struct lb4_key key = bench_lb4_key;
+	struct ct_state state = {};
+
+	return lb4_local(&shim_ct_map4, &bench_skb.skb, ETH_HLEN,
+			 ETH_HLEN + sizeof(struct iphdr), &bench_csum_off, &key,
+			 &tuple, bench_svc, &state, BENCH_SADDR, true);
+}
+
+static void setup_lb4_local_established(void)
+{
+	setup_lb4_local();
+	bench_lb4_local();
+}
+
+static void setup_policy(void)
+{
+	struct policy_entry entry = {};
+	struct policy_key key = {
+		.sec_label = BENCH_IDENTITY,
+		.dport = bpf_htons(80),
+		.protocol = IPPROTO_TCP,
+	};
+
+	map_update_elem(&POLICY_MAP, &key, &entry, 0);
+	key.sec_label = BENCH_IDENTITY + 1;
+	key.dport = 0;
+	key.protocol = 0;
+	map_update_elem(&POLICY_MAP, &key, &entry, 0);
+	bench_udp4_init(BENCH_DADDR, bpf_htons(80));
+}
+
+static int bench_policy_l4_hit(void)
+{
+	return __policy_can_access(&POLICY_MAP, &bench_skb.skb, BENCH_IDENTITY,
+				   bpf_htons(80), IPPROTO_TCP, 0, NULL,
+				   CT_INGRESS, false);
+}
+
+static int bench_policy_l3_fallback(void)
+{
+	return __policy_can_access(&POLICY_MAP, &bench_skb.skb,
+				   BENCH_IDENTITY + 1, bpf_htons(80),
+				   IPPROTO_TCP, 0, NULL, CT_INGRESS, false);
+}
+
+static int bench_policy_miss(void)
+{
+	return __policy_can_access(&POLICY_MAP, &bench_skb.skb,
+				   BENCH_IDENTITY + 2, bpf_htons(80),
+				   IPPROTO_TCP, 0, NULL, CT_INGRESS, false);
+}
+
+static void setup_ipv6_no_ext(void)
+{
+	bench_ipv6_init(NULL, 0, ICMPV6_ECHO_REQUEST);
+}
+
+static void setup_ipv6_ext_headers(void)
+{
+	static const __u8 exthdrs[] = {
+		NEXTHDR_HOP, NEXTHDR_ROUTING, NEXTHDR_DEST,
+	};
+
+	bench_ipv6_init(exthdrs, ARRAY_SIZE(exthdrs), ICMPV6_ECHO_REQUEST);
+}
+
+static int bench_ipv6_hdrlen(void)
+{
+	__u8 nexthdr = bench_nexthdr;
+
+	return ipv6_hdrlen(&bench_skb.skb, ETH_HLEN, &nexthdr);
+}
+
+static void setup_icmp6_other(void)
+{
+	bench_ipv6_init(NULL, 0, ICMPV6_ECHO_REPLY);
+}
+
+static int bench_icmp6_handle(void)
+{
+	return icmp6_handle(&bench_skb.skb, ETH_HLEN, &bench_ip6, METRIC_INGRESS);
+}
+
+static const struct bench benches[] = {
+	{ "ct_lookup4/new", setup_ct_lookup4_new, bench_ct_lookup4 },
+	{ "ct_lookup4/established", setup_ct_lookup4_established, bench_ct_lookup4 },
+	{ "lb4_local/established", setup_lb4_local_established, bench_lb4_local },
+	{ "__policy_can_access/l4_hit", setup_policy, bench_policy_l4_hit },
+	{ "__policy_can_access/l3_fallback", setup_policy, bench_policy_l3_fallback },
+	{ "__policy_can_access/miss", setup_policy, bench_policy_miss },
+	{ "ipv6_hdrlen/no_ext", setup_ipv6_no_ext, bench_ipv6_hdrlen },
+	{ "ipv6_hdrlen/ext_headers", setup_ipv6_ext_headers, bench_ipv6_hdrlen },
+	{ "icmp6_handle/echo_request", setup_ipv6_no_ext, bench_icmp6_handle },
+	{ "icmp6_handle/other", setup_icmp6_other, bench_icmp6_handle },
+};
+
+static double bench_clock(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_run(const struct bench *b, double min_time,
+		      struct bench_result *res)
+{
+	double real, cpu;
+	__u64 iters = 1, i;
+
+	shim_reset();
+	b->setup();
+
+	for (;;) {
+		real = bench_clock(CLOCK_MONOTONIC);
+		cpu = bench_clock(CLOCK_PROCESS_CPUTIME_ID);
+		for (i = 0; i < iters; i++)
+			bench_sink = b->run();
+		real = bench_clock(CLOCK_MONOTONIC) - real;
+		cpu = bench_clock(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+		if (real >= min_time * 1e9 || iters >= 1ULL << 40)
+			break;
+		iters *= real < 1e6 ? 10 : 2;
+	}
+
+	res->bench = b;
+	res->iterations = iters;
+	res->real_time = real / iters;
+	res->cpu_time = cpu / iters;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] "
+		"[--benchmark_min_time=<seconds>] "
+		"[--benchmark_format=console|json]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_result results[ARRAY_SIZE(benches)];
+	const char *filter = ".", *format = "console";
+	double min_time = 0.5;
+	int nr_results = 0;
+	regex_t re;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strncmp(argv[i], "--benchmark_filter=", 19)) {
+			filter = argv[i] + 19;
+		} else if (!strncmp(argv[i], "--benchmark_min_time=", 21)) {
+			min_time = atof(argv[i] + 21);
+		} else if (!strncmp(argv[i], "--benchmark_format=", 19)) {
+			format = argv[i] + 19;
+			if (strcmp(format, "console") && strcmp(format, "json")) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (regcomp(&re, filter, REG_EXTENDED | REG_NOSUB)) {
+		fprintf(stderr, "invalid filter: %s\n", filter);
+		return 1;
+	}
+
+	shim_init();
+
+	if (!strcmp(format, "console"))
+		printf("%-40s %12s %12s %12s\n", "Benchmark", "Time",
+		       "CPU", "Iterations");
+
+	for (i = 0; i < ARRAY_SIZE(benches); i++) {
+		struct bench_result *res = &results[nr_results];
+
+		if (regexec(&re, benches[i].name, 0, NULL, 0))
+			continue;
+
+		bench_run(&benches[i], min_time, res);
+		nr_results++;
+
+		if (!strcmp(format, "console"))
+			printf("%-40s %9.1f ns %9.1f ns %12llu\n",
+			       res->bench->name, res->real_time, res->cpu_time,
+			       (unsigned long long) res->iterations);
+	}
+	regfree(&re);
+
+	if (!strcmp(format, "json")) {
+		printf("{\n  \"benchmarks\": [\n");
+		for (i = 0; i < nr_results; i++)
+			printf("    {\n"
+			       "      \"name\": \"%s\",\n"
+			       "      \"iterations\": %llu,\n"
+			       "      \"real_time\": %.2f,\n"
+			       "      \"cpu_time\": %.2f,\n"
+			       "      \"time_unit\": \"ns\"\n"
+			       "    }%s\n",
+			       results[i].bench->name,
+			       (unsigned long long) results[i].iterations,
+			       results[i].real_time, results[i].cpu_time,
+			       i + 1 < nr_results ? "," : "");
+		printf("  ]\n}\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: GPL-2.0
+// Copyright (c) 2019 Authors of Cilium
+
+/*
+ * libFuzzer target for datapath helpers running on the native BPF shim
+ *
+ * An input is a struct fuzz_params followed by an Ethernet frame. The
+ * params select the function under test and the state it runs against,
+ * such as the service or the policy entry installed before the call.
+ * Besides memory errors, the asserts check invariants of the results.
+ *
+ * Build with "make shim-fuzz" and run as any libFuzzer target:
+ *   ./shim-fuzz -max_len=512 corpus/
+ *
+ * When built with -DFUZZ_STANDALONE, the inputs given as arguments are run
+ * once each, for example to reproduce a crash without libFuzzer.
+ */
+
+#include <assert.h>
+
+#include "bpf-shim.h"
+
+enum {
+	FUZZ_CT_LOOKUP4,
+	FUZZ_LB4_LOCAL,
+	FUZZ_POLICY_CAN_ACCESS,
+	FUZZ_IPV6_HDRLEN,
+	FUZZ_ICMP6_HANDLE,
+	FUZZ_MAX,
+};
+
+struct fuzz_params {
+	__u8	target;		/* FUZZ_* modulo FUZZ_MAX */
+	__u8	dir;		/* CT_* or policy direction */
+	__u8	count;		/* number of service backends - 1 */
+	__u8	deny;
+	__u32	identity;
+	__be32	backend;
+	__be16	backend_port;
+	__be16	proxy_port;
+	__u16	dport;
+	__u8	proto;
+	__u8	pad;
+} __attribute__((packed));
+
+static struct shim_skb fuzz_skb;
+
+static bool ipv4_csum_valid(const __u8 *ip4, int len)
+{
+	__u32 sum = 0;
+	int i;
+
+	for (i = 0; i < len; i += 2)
+		sum += (ip4[i] << 8) | ip4[i + 1];
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum == 0xffff;
+}
+
+/* Fills in the tuple from the IPv4 header like the datapath programs and
+ * returns the offset of the L4 header or -1 for a non-IPv4 packet.
+ */
+static int fuzz_ipv4_tuple(struct __sk_buff *skb, struct iphdr *ip4,
+			   struct ipv4_ct_tuple *tuple)
+{
+	if (skb->protocol != bpf_htons(ETH_P_IP) ||
+	    skb_load_bytes(skb, ETH_HLEN, ip4, sizeof(*ip4)) < 0 ||
+	    ip4->ihl < 5)
+		return -1;
+
+	memset(tuple, 0, sizeof(*tuple));
+	tuple->nexthdr = ip4->protocol;
+	tuple->daddr = ip4->daddr;
+	tuple->saddr = ip4->saddr;
+
+	return ETH_HLEN + ipv4_hdrlen(ip4);
+}
+
+static void fuzz_ct_lookup4(const struct fuzz_params *p)
+{
+	struct __sk_buff *skb = &fuzz_skb.skb;
+	struct ct_state state = {}, state_new = {};
+	struct ipv4_ct_tuple tuple;
+	struct iphdr ip4;
+	int dir = p->dir % 3;
+	__u32 monitor = 0;
+	int l4_off, ret;
+
+	l4_off = fuzz_ipv4_tuple(skb, &ip4, &tuple);
+	if (l4_off < 0)
+		return;
+
+	ret = ct_lookup4(&shim_ct_map4, &tuple, skb, l4_off, dir, &state, &monitor);
+	if (ret != CT_NEW) {
+		assert(ret < 0);
+		return;
+	}
+
+	ret = ct_create4(&shim_ct_map4, &tuple, skb, dir, &state_new);
+	assert(ret == 0);
+
+	/* The entry just created must be found by the next packet of the
+	 * flow. Service entries are only looked up in the order of the
+	 * packet, which reports them as replies.
+	 */
+	if (ip4.protocol == IPPROTO_UDP) {
+		fuzz_ipv4_tuple(skb, &ip4, &tuple);
+		ret = ct_lookup4(&shim_ct_map4, &tuple, skb, l4_off, dir,
+				 &state, &monitor);
+		assert(ret == (dir == CT_SERVICE ? CT_REPLY : CT_ESTABLISHED));
+	}
+}
+
+static void fuzz_lb4_local(const struct fuzz_params *p)
+{
+	struct __sk_buff *skb = &fuzz_skb.skb;
+	struct csum_offset csum_off = {};
+	struct lb4_service svc = {}, *master;
+	struct ipv4_ct_tuple tuple;
+	struct ct_state state = {};
+	struct lb4_key key = {};
+	struct iphdr ip4;
+	bool csum_valid;
+	int l4_off, ret, i;
+
+	l4_off = fuzz_ipv4_tuple(skb, &ip4, &tuple);
+	if (l4_off < 0 || ETH_HLEN + ipv4_hdrlen(&ip4) > skb->len)
+		return;
+	csum_valid = ipv4_csum_valid(fuzz_skb.buf + ETH_HLEN, ipv4_hdrlen(&ip4));
+
+	if (skb_load_bytes(skb, l4_off, &tuple.dport, 4) < 0)
+		return;
+	key.address = tuple.daddr;
+	key.dport = tuple.dport;
+	csum_l4_offset_and_flags(tuple.nexthdr, &csum_off);
+
+	/* The agent never installs a service without backends and the
+	 * modulo in lb4_select_slave() would trap natively.
+	 */
+	svc.count = p->count % 8 + 1;
+	svc.rev_nat_index = 1;
+	map_update_elem(&LB4_SERVICES_MAP, &key, &svc, 0);
+	for (i = 1; i <= svc.count; i++) {
+		svc.target = p->backend + i - 1;
+		svc.port = p->backend_port;
+		svc.count = 0;
+		key.slave = i;
+		map_update_elem(&LB4_SERVICES_MAP, &key, &svc, 0);
+	}
+	key.slave = 0;
+	master = map_lookup_elem(&LB4_SERVICES_MAP, &key);
+	assert(master);
+
+	ret = lb4_local(&shim_ct_map4, skb, ETH_HLEN, l4_off, &csum_off, &key,
+			&tuple, master, &state, ip4.saddr, true);
+	if (ret != TC_ACT_OK) {
+		assert(ret < 0);
+		return;
+	}
+
+	assert(state.slave >= 1 && state.slave <= master->count);
+	assert(state.rev_nat_index == 1);
+
+	/* Translation must keep a valid IPv4 header checksum valid */
+	if (csum_valid)
+		assert(ipv4_csum_valid(fuzz_skb.buf + ETH_HLEN, ipv4_hdrlen(&ip4)));
+}
+
+static void fuzz_policy_can_access(const struct fuzz_params *p)
+{
+	struct __sk_buff *skb = &fuzz_skb.skb;
+	struct policy_entry entry = {
+		.proxy_port = p->proxy_port,
+		.deny = p->deny & 1,
+	};
+	struct policy_key key = {
+		.sec_label = p->identity,
+		.dport = p->dport,
+		.protocol = p->proto,
+		.egress = !(p->dir & 1),
+	};
+	int ret;
+
+	map_update_elem(&POLICY_MAP, &key, &entry, 0);
+
+	ret = __policy_can_access(&POLICY_MAP, skb, p->identity, p->dport,
+				  p->proto, 0, NULL, p->dir & 1, false);
+	if (entry.deny)
+		assert(ret == DROP_POLICY_DENY);
+	else
+		assert(ret == entry.proxy_port);
+
+	if (p->identity) {
+		ret = __policy_can_access(&POLICY_MAP, skb, p->identity + 1,
+					  p->dport, p->proto, 0, NULL,
+					  p->dir & 1, false);
+		assert(ret == DROP_POLICY);
+	}
+
+	/* Untracked fragments only match L3 entries */
+	if (p->dport || p->proto) {
+		ret = __policy_can_access(&POLICY_MAP, skb, p->identity,
+					  p->dport, p->proto, 0, NULL,
+					  p->dir & 1, true);
+		assert(ret == DROP_FRAG_NOSUPPORT);
+	}
+}
+
+static void fuzz_ipv6_hdrlen(void)
+{
+	struct __sk_buff *skb = &fuzz_skb.skb;
+	__u8 nexthdr;
+	int ret;
+
+	if (skb_load_bytes(skb, ETH_HLEN + offsetof(struct ipv6hdr, nexthdr),
+			   &nexthdr, sizeof(nexthdr)) < 0)
+		return;
+
+	ret = ipv6_hdrlen(skb, ETH_HLEN, &nexthdr);
+	if (ret < 0)
+		return;
+
+	assert(ret >= sizeof(struct ipv6hdr));
+	assert(ret % 4 == 0);
+}
+
+static void fuzz_icmp6_handle(const struct fuzz_params *p)
+{
+	struct __sk_buff *skb = &fuzz_skb.skb;
+	struct ipv6hdr ip6;
+	int ret;
+
+	if (skb_load_bytes(skb, ETH_HLEN, &ip6, sizeof(ip6)) < 0)
+		return;
+
+	/* Tail calls always fail on the shim */
+	ret = icmp6_handle(skb, ETH_HLEN, &ip6, p->dir & 1);
+	assert(ret == 0 || ret == DROP_MISSED_TAIL_CALL);
+}
+
+int LLVMFuzzerTestOneInput(const __u8 *data, size_t size)
+{
+	static bool initialized;
+	struct fuzz_params p;
+
+	if (!initialized) {
+		shim_init();
+		initialized = true;
+	}
+
+	if (size < sizeof(p))
+		return 0;
+	memcpy(&p, data, sizeof(p));
+	if (shim_skb_init(&fuzz_skb, data + sizeof(p), size - sizeof(p)) < 0)
+		return 0;
+	shim_reset();
+
+	switch (p.target % FUZZ_MAX) {
+	case FUZZ_CT_LOOKUP4:
+		fuzz_ct_lookup4(&p);
+		break;
+	case FUZZ_LB4_LOCAL:
+		fuzz_lb4_local(&p);
+		break;
+	case FUZZ_POLICY_CAN_ACCESS:
+		fuzz_policy_can_access(&p);
+		break;
+	case FUZZ_IPV6_HDRLEN:
+		fuzz_ipv6_hdrlen();
+		break;
+	case FUZZ_ICMP6_HANDLE:
+		fuzz_icmp6_handle(&p);
+		break;
+	}
+
+	return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+int main(int argc, char *argv[])
+{
+	static __u8 buf[sizeof(struct fuzz_params) + SHIM_SKB_SIZE];
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		FILE *f = fopen(argv[i], "rb");
+		size_t n;
+
+		if (!f) {
+			perror(argv[i]);
+			return 1;
+		}
+		n = fread(buf, 1, sizeof(buf), f);
+		fclose(f);
+
+		LLVMFuzzerTestOneInput(buf, n);
+		printf("%s: ok\n", argv[i]);
+	}
+
+	return 0;
+}
+#endif
@@ -7,7 +7,11 @@
 #include "lib/utils.h"
 #include "node_config.h"
 
+#define HAVE_LRU_MAP_TYPE
+#define ENABLE_IPV6_FRAGMENTS
+
 #include "lib/common.h"
+#include "lib/ipv4.h"
 #include "lib/ipv6.h"
 
 #define SKIP_UNDEF_LPM_LOOKUP_FN
@@ -15,6 +19,7 @@
 
 #define htonl bpf_htonl
 #define ntohl bpf_ntohl
+#define htons bpf_htons
 
 static void test_ipv6_addr_clear_suffix()
 {
@@ -56,6 +61,171 @@ static void test_ipv6_addr_clear_suffix()
 	assert(ntohl(v6.p4) == 0x00000000);
 }
 
+static void test_ipv4_fragments()
+{
+	struct iphdr ip4 = {};
+
+	ip4.frag_off = htons(0x4000); /* DF */
+	assert(!ipv4_is_fragment(&ip4));
+	assert(ipv4_has_l4_header(&ip4));
+
+	ip4.frag_off = htons(0x2000); /* MF, offset 0 */
+	assert(ipv4_is_fragment(&ip4));
+	assert(!ipv4_is_not_first_fragment(&ip4));
+	assert(ipv4_has_l4_header(&ip4));
+
+	ip4.frag_off = htons(0x2000 | 185); /* MF, offset 1480 */
+	assert(ipv4_is_fragment(&ip4));
+	assert(ipv4_is_not_first_fragment(&ip4));
+	assert(!ipv4_has_l4_header(&ip4));
+
+	ip4.frag_off = htons(370); /* last fragment */
+	assert(ipv4_is_fragment(&ip4));
+	assert(ipv4_is_not_first_fragment(&ip4));
+	assert(!ipv4_has_l4_header(&ip4));
+}
+
+/* Minimal stand-ins for the helpers used by the fragment tracking code. The
+ * skb is a plain buffer starting at the ethernet header and the datagram map
+ * holds a single entry, which is all a fragment train of one datagram needs.
+ */
+static __u8 test_pkt[256];
+static struct ipv6_frag_id test_frag_key;
+static struct ipv6_frag_l4ports test_frag_value;
+static bool test_frag_valid;
+
+static int test_skb_load_bytes(struct __sk_buff *skb, __u32 off, void *to,
+			       __u32 len)
+{
+	if (off + len > sizeof(test_pkt))
+		return -1;
+	memcpy(to, test_pkt + off, len);
+	return 0;
+}
+
+static void *test_map_lookup_elem(void *map, const void *key)
+{
+	if (test_frag_valid && !memcmp(key, &test_frag_key, sizeof(test_frag_key)))
+		return &test_frag_value;
+	return NULL;
+}
+
+static int test_map_update_elem(void *map, const void *key, const void *value,
+				uint32_t flags)
+{
+	memcpy(&test_frag_key, key, sizeof(test_frag_key));
+	memcpy(&test_frag_value, value, sizeof(test_frag_value));
+	test_frag_valid = true;
+	return 0;
+}
+
+/* Builds ETH + IPv6 + fragment header and returns the offset of the data
+ * following the fragment header. */
+static int build_ipv6_fragment(__u8 nexthdr, __be32 id, __u16 offset, bool mf)
+{
+	struct ipv6hdr *ip6 = (struct ipv6hdr *) (test_pkt + ETH_HLEN);
+	struct ipv6_frag_hdr *fh = (struct ipv6_frag_hdr *) (ip6 + 1);
+
+	memset(test_pkt, 0, sizeof(test_pkt));
+	ip6->version = 6;
+	ip6->nexthdr = NEXTHDR_FRAGMENT;
+	ip6->saddr.s6_addr[15] = 1;
+	ip6->daddr.s6_addr[15] = 2;
+	fh->nexthdr = nexthdr;
+	fh->frag_off = htons((offset & IPV6_FRAG_OFFSET) | (mf ? IPV6_FRAG_MF : 0));
+	fh->id = id;
+
+	return ETH_HLEN + sizeof(*ip6) + sizeof(*fh);
+}
+
+static void test_ipv6_fragments()
+{
+	struct __sk_buff *skb = (struct __sk_buff *) test_pkt;
+	struct ipv6_frag_l4ports ports;
+	struct ipv6_frag_info frag;
+	__u8 nexthdr;
+	int l4_off;
+
+	skb_load_bytes = test_skb_load_bytes;
+	map_lookup_elem = test_map_lookup_elem;
+	map_update_elem = test_map_update_elem;
+
+	/* Non-first fragment before the first one: ports are unknown */
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(42), 1448, false);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	assert(nexthdr == IPPROTO_UDP);
+	assert(frag.is_fragment && !frag.has_l4_header);
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == DROP_FRAG_NOT_FOUND);
+
+	/* First fragment carries the UDP header */
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(42), 0, true);
+	test_pkt[l4_off + 1] = 80;
+	test_pkt[l4_off + 3] = 53;
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	assert(frag.is_fragment && frag.has_l4_header);
+	assert(frag.id == htonl(42));
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == 0);
+	assert(ports.sport == htons(80) && ports.dport == htons(53));
+
+	/* Middle and last fragments resolve to the ports of the first one */
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(42), 1448, true);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	memset(&ports, 0, sizeof(ports));
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == 0);
+	assert(ports.sport == htons(80) && ports.dport == htons(53));
+
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(42), 2896, false);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	memset(&ports, 0, sizeof(ports));
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == 0);
+	assert(ports.sport == htons(80) && ports.dport == htons(53));
+
+	/* A fragment of another datagram must not match */
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(43), 1448, false);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == DROP_FRAG_NOT_FOUND);
+
+	/* Extension headers following the fragment header are only present
+	 * in the first fragment, the datagram is keyed on the next header of
+	 * the fragment header. */
+	l4_off = build_ipv6_fragment(NEXTHDR_DEST, htonl(44), 0, true);
+	test_pkt[l4_off] = IPPROTO_UDP;
+	l4_off += 8;
+	test_pkt[l4_off + 1] = 80;
+	test_pkt[l4_off + 3] = 53;
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	assert(nexthdr == IPPROTO_UDP && frag.proto == NEXTHDR_DEST);
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == 0);
+
+	l4_off = build_ipv6_fragment(NEXTHDR_DEST, htonl(44), 1448, false);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	memset(&ports, 0, sizeof(ports));
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, true) == 0);
+	assert(ports.sport == htons(80) && ports.dport == htons(53));
+
+	/* Lookups that don't track leave the map untouched */
+	test_frag_valid = false;
+	l4_off = build_ipv6_fragment(IPPROTO_UDP, htonl(45), 0, true);
+	nexthdr = NEXTHDR_FRAGMENT;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == l4_off - ETH_HLEN);
+	assert(ipv6_load_l4_ports(skb, ETH_HLEN, l4_off, &frag, &ports, false) == 0);
+	assert(!test_frag_valid);
+
+	/* Unfragmented packets are unaffected */
+	memset(test_pkt, 0, sizeof(test_pkt));
+	test_pkt[ETH_HLEN + offsetof(struct ipv6hdr, nexthdr)] = IPPROTO_TCP;
+	nexthdr = IPPROTO_TCP;
+	assert(ipv6_hdrlen_frag(skb, ETH_HLEN, &nexthdr, &frag) == sizeof(struct ipv6hdr));
+	assert(!frag.is_fragment && frag.has_l4_header);
+}
+
 static __be32 *dummy_map = NULL;
 
 static __be32 match_dummy_prefix(void *map, __be32 addr, __u32 prefix)
@@ -104,6 +274,8 @@ int main(int argc, char *argv[])
 {
 	test_lpm_lookup();
 	test_ipv6_addr_clear_suffix();
+	test_ipv4_fragments();
+	test_ipv6_fragments();
 
 	return 0;
 }
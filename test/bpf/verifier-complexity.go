@@ -0,0 +1,342 @@
+// Copyright 2019 Authors of Cilium
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// verifier-complexity parses the verifier logs of the programs loaded by
+// check-complexity.sh and compares the instructions processed by the
+// verifier for each section against the checked-in budgets.
+package main
+
+import (
+	"bufio"
+	"encoding/json"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"regexp"
+	"sort"
+	"strconv"
+	"strings"
+
+	"github.com/spf13/cobra"
+)
+
+var (
+	budgetsPath  string
+	commonHeader string
+	defaultLimit uint64
+	headroom     uint64
+	update       bool
+	output       string
+
+	objectRegexp  = regexp.MustCompile(`^=> Object (\S+) options: ?(.*)$`)
+	sectionRegexp = regexp.MustCompile(`^Prog section '([^']*)' (loaded|rejected)`)
+	insnsRegexp   = regexp.MustCompile(`processed (\d+) insns`)
+	statesRegexp  = regexp.MustCompile(`total_states (\d+)`)
+	peakRegexp    = regexp.MustCompile(`peak_states (\d+)`)
+	callRegexp    = regexp.MustCompile(`^#define CILIUM_CALL_(\w+)\s+(\d+)`)
+)
+
+// section is the verifier complexity of a section of a program built with
+// an option combination. Budget is the maximum number of instructions the
+// verifier may process.
+type section struct {
+	Program     string `json:"program"`
+	Options     string `json:"options"`
+	Section     string `json:"section"`
+	Name        string `json:"name,omitempty"`
+	Insns       uint64 `json:"insns"`
+	TotalStates uint64 `json:"total_states,omitempty"`
+	PeakStates  uint64 `json:"peak_states,omitempty"`
+	Budget      uint64 `json:"budget,omitempty"`
+	Rejected    bool   `json:"rejected,omitempty"`
+}
+
+func (s *section) key() string {
+	return budgetKey(s.Program, s.Section, s.Options)
+}
+
+// budget is the checked-in budget of a section
+type budget struct {
+	Program string `json:"program"`
+	Options string `json:"options"`
+	Section string `json:"section"`
+	Insns   uint64 `json:"insns"`
+}
+
+func budgetKey(program, sec, options string) string {
+	return program + " " + sec + " " + options
+}
+
+// overBudget returns true if the section was rejected or the verifier
+// processed more instructions than budgeted
+func (s *section) overBudget() bool {
+	return s.Rejected || s.Insns > s.Budget
+}
+
+// Fatalf prints the error message and exits
+func Fatalf(msg string, args ...interface{}) {
+	fmt.Fprintf(os.Stderr, "Error: "+msg+"\n", args...)
+	os.Exit(1)
+}
+
+// readCallNames returns the names of the tail calls by index as defined by
+// CILIUM_CALL_* in the given header
+func readCallNames(path string) (map[string]string, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	names := map[string]string{}
+	scanner := bufio.NewScanner(f)
+	for scanner.Scan() {
+		if m := callRegexp.FindStringSubmatch(scanner.Text()); m != nil && m[1] != "SIZE" {
+			names[m[2]] = m[1]
+		}
+	}
+
+	return names, scanner.Err()
+}
+
+// sectionName returns a description of tail call and policy sections
+func sectionName(sec string, calls map[string]string) string {
+	switch {
+	case strings.HasPrefix(sec, "1/"):
+		return "lxc ingress program for EP " + strings.TrimPrefix(sec, "1/")
+	case strings.HasPrefix(sec, "2/"):
+		if name, ok := calls[strings.TrimPrefix(sec, "2/")]; ok {
+			return "tail_call " + name
+		}
+	}
+	return ""
+}
+
+// parseLogs parses the verifier logs printed by tc and ip for the objects
+// announced by "=> Object <program> options: <options>" lines. Sections
+// loaded several times, such as tail calls loaded with each entry section,
+// are reported once with their highest complexity.
+func parseLogs(r io.Reader) ([]*section, error) {
+	var (
+		program, options string
+		current          *section
+	)
+
+	sections := map[string]*section{}
+	scanner := bufio.NewScanner(r)
+	scanner.Buffer(make([]byte, 64*1024), 16*1024*1024)
+	for scanner.Scan() {
+		line := scanner.Text()
+
+		if m := objectRegexp.FindStringSubmatch(line); m != nil {
+			program, options, current = m[1], strings.TrimSpace(m[2]), nil
+			continue
+		}
+
+		if m := sectionRegexp.FindStringSubmatch(line); m != nil {
+			s := &section{Program: program, Options: options, Section: m[1]}
+			if old, ok := sections[s.key()]; ok {
+				s = old
+			} else {
+				sections[s.key()] = s
+			}
+			if m[2] == "rejected" {
+				s.Rejected = true
+			}
+			current = s
+			continue
+		}
+
+		if current == nil {
+			continue
+		}
+
+		if m := insnsRegexp.FindStringSubmatch(line); m != nil {
+			insns, _ := strconv.ParseUint(m[1], 10, 64)
+			if insns > current.Insns {
+				current.Insns = insns
+			}
+			if m := statesRegexp.FindStringSubmatch(line); m != nil {
+				states, _ := strconv.ParseUint(m[1], 10, 64)
+				if states > current.TotalStates {
+					current.TotalStates = states
+				}
+			}
+			if m := peakRegexp.FindStringSubmatch(line); m != nil {
+				peak, _ := strconv.ParseUint(m[1], 10, 64)
+				if peak > current.PeakStates {
+					current.PeakStates = peak
+				}
+			}
+		}
+	}
+
+	list := make([]*section, 0, len(sections))
+	for _, s := range sections {
+		list = append(list, s)
+	}
+	sort.Slice(list, func(i, j int) bool {
+		if list[i].Program != list[j].Program {
+			return list[i].Program < list[j].Program
+		}
+		if list[i].Options != list[j].Options {
+			return list[i].Options < list[j].Options
+		}
+		return list[i].Section < list[j].Section
+	})
+
+	return list, scanner.Err()
+}
+
+// readBudgets returns the budgets of the sections by key. A missing or empty
+// budget file is an error, as it would let every section fall back to the
+// default limit unnoticed.
+func readBudgets(path string) (map[string]uint64, error) {
+	budgets := map[string]uint64{}
+
+	data, err := ioutil.ReadFile(path)
+	if os.IsNotExist(err) {
+		return nil, fmt.Errorf("%s does not exist, run with --update on a test kernel to create it", path)
+	} else if err != nil {
+		return nil, err
+	}
+
+	var list []budget
+	if err := json.Unmarshal(data, &list); err != nil {
+		return nil, fmt.Errorf("unable to parse %s: %s", path, err)
+	}
+	if len(list) == 0 {
+		return nil, fmt.Errorf("%s has no budgets, run with --update to create them", path)
+	}
+	for _, b := range list {
+		budgets[budgetKey(b.Program, b.Section, b.Options)] = b.Insns
+	}
+
+	return budgets, nil
+}
+
+// writeBudgets writes the instructions processed by the verifier plus the
+// headroom as budgets of the sections
+func writeBudgets(path string, sections []*section) error {
+	list := make([]budget, 0, len(sections))
+	for _, s := range sections {
+		list = append(list, budget{
+			Program: s.Program,
+			Options: s.Options,
+			Section: s.Section,
+			Insns:   s.Insns + s.Insns*headroom/100,
+		})
+	}
+
+	data, err := json.MarshalIndent(list, "", "\t")
+	if err != nil {
+		return err
+	}
+
+	return ioutil.WriteFile(path, append(data, '\n'), 0644)
+}
+
+func run() {
+	calls, err := readCallNames(commonHeader)
+	if err != nil {
+		Fatalf("Unable to read tail call names: %s", err)
+	}
+
+	sections, err := parseLogs(os.Stdin)
+	if err != nil {
+		Fatalf("Unable to parse verifier logs: %s", err)
+	}
+	if len(sections) == 0 {
+		Fatalf("No verifier logs found")
+	}
+
+	if update {
+		if err := writeBudgets(budgetsPath, sections); err != nil {
+			Fatalf("Unable to write budgets: %s", err)
+		}
+	}
+
+	budgets, err := readBudgets(budgetsPath)
+	if err != nil {
+		Fatalf("Unable to read budgets: %s", err)
+	}
+
+	failed := 0
+	for _, s := range sections {
+		s.Name = sectionName(s.Section, calls)
+		if insns, ok := budgets[s.key()]; ok {
+			s.Budget = insns
+		} else {
+			s.Budget = defaultLimit
+		}
+		if s.overBudget() {
+			failed++
+		}
+	}
+
+	switch output {
+	case "json":
+		data, err := json.MarshalIndent(sections, "", "\t")
+		if err != nil {
+			Fatalf("%s", err)
+		}
+		fmt.Println(string(data))
+	default:
+		for _, s := range sections {
+			status := "OK"
+			if s.Rejected {
+				status = "REJECTED"
+			} else if s.overBudget() {
+				status = "OVER BUDGET"
+			}
+			name := s.Section
+			if s.Name != "" {
+				name += " (" + s.Name + ")"
+			}
+			fmt.Printf("%s [%s] %s: %d insns (budget %d), %d states, %d peak states: %s\n",
+				s.Program, s.Options, name, s.Insns, s.Budget,
+				s.TotalStates, s.PeakStates, status)
+		}
+	}
+
+	if failed > 0 {
+		Fatalf("%d sections exceed their verifier complexity budget", failed)
+	}
+}
+
+var rootCmd = &cobra.Command{
+	Use:   "verifier-complexity",
+	Short: "Check verifier complexity of datapath programs against budgets",
+	Run: func(cmd *cobra.Command, args []string) {
+		run()
+	},
+}
+
+func init() {
+	rootCmd.Flags().StringVar(&budgetsPath, "budgets", "complexity-budgets.json", "Path to the checked-in budgets")
+	rootCmd.Flags().StringVar(&commonHeader, "common-header", "../../bpf/lib/common.h", "Path to the header defining CILIUM_CALL_*")
+	// Complexity limit of kernels before 5.2
+	rootCmd.Flags().Uint64Var(&defaultLimit, "limit", 131072, "Budget of sections without a checked-in budget")
+	rootCmd.Flags().Uint64Var(&headroom, "headroom", 10, "Headroom in percent added to budgets on update")
+	rootCmd.Flags().BoolVar(&update, "update", false, "Write the budgets from the current complexity")
+	rootCmd.Flags().StringVarP(&output, "output", "o", "text", "Output format {text | json}")
+}
+
+func main() {
+	if err := rootCmd.Execute(); err != nil {
+		fmt.Println(err)
+		os.Exit(1)
+	}
+}